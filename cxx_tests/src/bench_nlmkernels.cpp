@@ -0,0 +1,92 @@
+#include <iostream>
+#include <complex>
+#include <chrono>
+#include <vector>
+#include <boost/format.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <soap/nlmkernels.hpp>
+
+// Timings of the (N, L)-specialized kernels against the generic kernels
+// and the ublas loops they replace (PowerExpansion::computeCoefficients)
+
+namespace ub = boost::numeric::ublas;
+typedef std::complex<double> cmplx_t;
+typedef std::chrono::high_resolution_clock bench_clock_t;
+
+template<class F>
+double time_per_call(F f, int repeats) {
+    // Best of five rounds
+    double t_best = -1.;
+    for (int round = 0; round < 5; ++round) {
+        bench_clock_t::time_point t0 = bench_clock_t::now();
+        for (int i = 0; i < repeats; ++i) f();
+        bench_clock_t::time_point t1 = bench_clock_t::now();
+        double t = std::chrono::duration<double, std::micro>(t1-t0).count()/repeats;
+        if (t_best < 0. || t < t_best) t_best = t;
+    }
+    return t_best;
+}
+
+static void power_ublas(int N, int L, ub::matrix<cmplx_t> &coeff1, ub::matrix<cmplx_t> &coeff2,
+        const std::vector<double> &prefac, ub::matrix<cmplx_t> &xnkl) {
+    for (int n = 0; n < N; ++n) {
+        for (int k = 0; k < N; ++k) {
+            for (int l = 0; l < (L+1); ++l) {
+                cmplx_t c_nkl = 0.0;
+                for (int m = -l; m <= l; ++m) {
+                    c_nkl += coeff1(n, l*l+l+m)*std::conj(coeff2(k, l*l+l+m));
+                }
+                xnkl(n*N+k, l) = prefac[l]*c_nkl;
+            }
+        }
+    }
+}
+
+static void bench(int N, int L, int repeats) {
+    int LM = (L+1)*(L+1);
+    ub::matrix<cmplx_t> q1(N, LM), q2(N, LM), x(N*N, L+1);
+    std::vector<double> radial(N*(L+1)), dradial(N*(L+1)), prefac(L+1);
+    std::vector<cmplx_t> angular(LM), dangular(LM), qnlm(N*LM);
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < LM; ++j) {
+            q1(i,j) = cmplx_t(0.1*i-0.01*j, 0.02*j);
+            q2(i,j) = cmplx_t(0.03*j, 0.1*i+0.01*j);
+        }
+    }
+    for (int i = 0; i < radial.size(); ++i) radial[i] = dradial[i] = 0.01*i;
+    for (int i = 0; i < LM; ++i) angular[i] = dangular[i] = cmplx_t(0.1, -0.01*i);
+    for (int l = 0; l <= L; ++l) prefac[l] = 1./(2*l+1);
+
+    const soap::nlm_kernels_t *spec = soap::nlm_kernels_resolve(N, L);
+    const soap::nlm_kernels_t *gen = soap::nlm_kernels_generic();
+    const cmplx_t *p1 = &q1.data()[0];
+    const cmplx_t *p2 = &q2.data()[0];
+    cmplx_t *px = &x.data()[0];
+
+    double t_ublas = time_per_call([&]() { power_ublas(N, L, q1, q2, prefac, x); }, repeats);
+    double t_gen = time_per_call([&]() { gen->power(N, L, p1, p2, prefac.data(), 1., false, px); }, repeats);
+    double t_spec = time_per_call([&]() { spec->power(N, L, p1, p2, prefac.data(), 1., false, px); }, repeats);
+    std::cout << boost::format("power      N=%1$2d L=%2$2d  ublas %3$8.3f us  generic %4$8.3f us  specialized %5$8.3f us%6$s")
+        % N % L % t_ublas % t_gen % t_spec % ((spec == gen) ? " (not specialized)" : "") << std::endl;
+
+    t_gen = time_per_call([&]() { gen->merge(N, L, radial.data(), angular.data(), 0.5, qnlm.data()); }, repeats);
+    t_spec = time_per_call([&]() { spec->merge(N, L, radial.data(), angular.data(), 0.5, qnlm.data()); }, repeats);
+    std::cout << boost::format("merge      N=%1$2d L=%2$2d  generic %3$8.3f us  specialized %4$8.3f us")
+        % N % L % t_gen % t_spec << std::endl;
+
+    t_gen = time_per_call([&]() { gen->merge_grad(N, L, radial.data(), dradial.data(),
+        angular.data(), dangular.data(), 1., 0.5, 0.1, qnlm.data()); }, repeats);
+    t_spec = time_per_call([&]() { spec->merge_grad(N, L, radial.data(), dradial.data(),
+        angular.data(), dangular.data(), 1., 0.5, 0.1, qnlm.data()); }, repeats);
+    std::cout << boost::format("merge_grad N=%1$2d L=%2$2d  generic %3$8.3f us  specialized %4$8.3f us")
+        % N % L % t_gen % t_spec << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::cout << "soapxx/bench/nlmkernels" << std::endl;
+    int repeats = 2000;
+    bench(9, 6, repeats);
+    bench(12, 9, repeats);
+    bench(8, 6, repeats);
+    return 0;
+}
@@ -0,0 +1,422 @@
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <vector>
+#include <dirent.h>
+#include <boost/format.hpp>
+#include <benchmark/benchmark.h>
+#include <soap/spectrum.hpp>
+#include <soap/options.hpp>
+#include <soap/xyz.hpp>
+#include <soap/kernel.hpp>
+
+// Microbenchmarks of the descriptor engine (google-benchmark):
+// o BM_RadialBasis, BM_AngularBasis, BM_BasisExpansion: per-neighbour expansions
+// o BM_PowerExpansion, BM_PowerExpansionGradients: per-center contractions
+// o BM_BoundaryConnect: single and batched minimum-image connects
+// o BM_SpectrumConfig: Spectrum::compute on the structures in test/configs
+// o BM_SpectrumBox: Spectrum::compute for centers in synthetic periodic boxes
+// o BM_KernelDotQnlm: center-center density kernel, double vs single precision
+// swept over (N, L) and, where it applies, with/without gradients (last arg).
+// Counters per_neighbour and per_center are times in seconds, e.g.
+//   bench_soap.exe --benchmark_out=bench.json --benchmark_out_format=json
+//   bench_soap.exe --benchmark_filter=BM_BasisExpansion --soap_configs=<dir>
+
+namespace {
+
+typedef std::complex<double> cmplx_t;
+
+std::string configs_dir =
+#ifdef SOAP_BENCH_CONFIGS
+    SOAP_BENCH_CONFIGS;
+#else
+    "../test/configs";
+#endif
+
+// Bases are configured once per (N, L) and kept for all benchmarks
+struct basis_entry_t
+{
+    soap::Options *options;
+    soap::Basis *basis;
+};
+
+static soap::Options *make_options(int N, int L, bool gradients) {
+    soap::Options *options = new soap::Options();
+    options->set("radialbasis.N", N);
+    options->set("angularbasis.L", L);
+    options->set("spectrum.gradients", gradients);
+    return options;
+}
+
+static soap::Basis *get_basis(int N, int L) {
+    static std::map<std::pair<int, int>, basis_entry_t> bases;
+    auto it = bases.find(std::pair<int, int>(N, L));
+    if (it != bases.end()) return it->second.basis;
+    basis_entry_t entry;
+    entry.options = make_options(N, L, false);
+    entry.basis = new soap::Basis(entry.options);
+    bases[std::pair<int, int>(N, L)] = entry;
+    return entry.basis;
+}
+
+// Neighbour connections at distances within the cutoff, fixed across runs
+static void sample_neighbours(int n, double rc, std::vector<double> &r, std::vector<soap::vec> &d) {
+    unsigned int seed = 2017;
+    r.resize(n);
+    d.resize(n);
+    for (int i = 0; i < n; ++i) {
+        double u[3];
+        for (int k = 0; k < 3; ++k) {
+            seed = 1103515245*seed + 12345;
+            u[k] = ((seed >> 8) % 100000)/100000.;
+        }
+        double cos_theta = 2.*u[0]-1.;
+        double sin_theta = sqrt(1.-cos_theta*cos_theta);
+        double phi = 2.*M_PI*u[1];
+        d[i] = soap::vec(sin_theta*cos(phi), sin_theta*sin(phi), cos_theta);
+        r[i] = 0.5 + (rc-0.5)*u[2];
+    }
+}
+
+// Random C/H/O atoms at ~0.1 atoms/A^3 in a periodic cubic box
+static soap::Structure *make_box(int n_atoms) {
+    double a = pow(n_atoms/0.1, 1./3.);
+    std::vector<double> xyz(3*n_atoms);
+    std::vector<std::string> types(n_atoms);
+    unsigned int seed = 12345;
+    for (int i = 0; i < n_atoms; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            seed = 1103515245*seed + 12345;
+            xyz[3*i+k] = a*((seed >> 8) % 100000)/100000.;
+        }
+        types[i] = (i % 3 == 0) ? "C" : ((i % 3 == 1) ? "H" : "O");
+    }
+    double box[9] = { a,0.,0., 0.,a,0., 0.,0.,a };
+    bool pbc[3] = { true, true, true };
+    soap::Structure *structure = new soap::Structure("box");
+    structure->setBoundary(box, pbc);
+    structure->addParticles(n_atoms, xyz.data(), types.data(), NULL, NULL, NULL);
+    return structure;
+}
+
+// Neighbours within rc (incl. periodic images) summed over <centers>
+static long count_neighbours(soap::Structure &structure, soap::Structure::particle_array_t &centers, double rc) {
+    int n = structure.particles().size();
+    std::vector<soap::vec> dr(n);
+    std::vector<int> reps = structure.getBoundary()->calculateRepetitions(rc);
+    soap::vec a = structure.getBoundary()->getBox().getCol(0);
+    soap::vec b = structure.getBoundary()->getBox().getCol(1);
+    soap::vec c = structure.getBoundary()->getBox().getCol(2);
+    long n_nbs = 0;
+    for (auto it = centers.begin(); it != centers.end(); ++it) {
+        structure.connectMany((*it)->getPos(), structure.getPositions(), n, dr.data(), NULL);
+        for (int j = 0; j < n; ++j) {
+            for (int na = -reps[0]; na <= reps[0]; ++na) {
+            for (int nb = -reps[1]; nb <= reps[1]; ++nb) {
+            for (int nc = -reps[2]; nc <= reps[2]; ++nc) {
+                soap::vec drj = dr[j] + na*a + nb*b + nc*c;
+                n_nbs += (drj*drj <= rc*rc && drj*drj > 0.); // <- not the center itself
+            }}}
+        }
+    }
+    return n_nbs;
+}
+
+static void set_costs(benchmark::State &state, double n_neighbours, double n_centers) {
+    if (n_neighbours > 0) {
+        state.counters["per_neighbour"] = benchmark::Counter(n_neighbours,
+            benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    }
+    if (n_centers > 0) {
+        state.counters["per_center"] = benchmark::Counter(n_centers,
+            benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    }
+}
+
+const int N_SAMPLES = 64;
+
+}
+
+// ==================
+// EXPANSION KERNELS
+// ==================
+
+static void BM_RadialBasis(benchmark::State &state) {
+    int N = state.range(0);
+    int L = state.range(1);
+    bool gradients = state.range(2);
+    soap::Basis *basis = get_basis(N, L);
+    soap::RadialBasis *radbasis = basis->getRadBasis();
+    std::vector<double> r;
+    std::vector<soap::vec> d;
+    sample_neighbours(N_SAMPLES, basis->getCutoff()->getCutoff(), r, d);
+    soap::RadialBasis::radcoeff_t G = soap::RadialBasis::radcoeff_zero_t(N, L+1);
+    soap::RadialBasis::radcoeff_t dGx = G, dGy = G, dGz = G;
+    for (auto _ : state) {
+        for (int i = 0; i < N_SAMPLES; ++i) {
+            if (gradients) radbasis->computeCoefficients(d[i], r[i], 0.5, G, &dGx, &dGy, &dGz);
+            else radbasis->computeCoefficients(d[i], r[i], 0.5, G, NULL, NULL, NULL);
+        }
+        benchmark::DoNotOptimize(G.data().begin());
+    }
+    set_costs(state, N_SAMPLES, 0);
+}
+
+static void BM_AngularBasis(benchmark::State &state) {
+    int N = state.range(0);
+    int L = state.range(1);
+    bool gradients = state.range(2);
+    soap::Basis *basis = get_basis(N, L);
+    soap::AngularBasis *angbasis = basis->getAngBasis();
+    std::vector<double> r;
+    std::vector<soap::vec> d;
+    sample_neighbours(N_SAMPLES, basis->getCutoff()->getCutoff(), r, d);
+    soap::AngularBasis::angcoeff_t Y = soap::AngularBasis::angcoeff_zero_t((L+1)*(L+1));
+    soap::AngularBasis::angcoeff_t dYx = Y, dYy = Y, dYz = Y;
+    for (auto _ : state) {
+        for (int i = 0; i < N_SAMPLES; ++i) {
+            if (gradients) angbasis->computeCoefficients(d[i], r[i], 0.5, Y, &dYx, &dYy, &dYz);
+            else angbasis->computeCoefficients(d[i], r[i], 0.5, Y, NULL, NULL, NULL);
+        }
+        benchmark::DoNotOptimize(Y.data().begin());
+    }
+    set_costs(state, N_SAMPLES, 0);
+}
+
+static void BM_BasisExpansion(benchmark::State &state) {
+    int N = state.range(0);
+    int L = state.range(1);
+    bool gradients = state.range(2);
+    soap::Basis *basis = get_basis(N, L);
+    std::vector<double> r;
+    std::vector<soap::vec> d;
+    sample_neighbours(N_SAMPLES, basis->getCutoff()->getCutoff(), r, d);
+    soap::BasisExpansion nb_expansion(basis);
+    for (auto _ : state) {
+        for (int i = 0; i < N_SAMPLES; ++i) {
+            nb_expansion.computeCoefficients(r[i], d[i], 1., 1., 0.5, gradients);
+        }
+        benchmark::DoNotOptimize(nb_expansion.getCoefficients().data().begin());
+    }
+    set_costs(state, N_SAMPLES, 0);
+}
+
+static void BM_PowerExpansion(benchmark::State &state) {
+    int N = state.range(0);
+    int L = state.range(1);
+    soap::Basis *basis = get_basis(N, L);
+    std::vector<double> r;
+    std::vector<soap::vec> d;
+    sample_neighbours(2, basis->getCutoff()->getCutoff(), r, d);
+    soap::BasisExpansion q1(basis), q2(basis);
+    q1.computeCoefficients(r[0], d[0], 1., 1., 0.5, false);
+    q2.computeCoefficients(r[1], d[1], 1., 1., 0.5, false);
+    soap::PowerExpansion xnkl(basis);
+    for (auto _ : state) {
+        xnkl.computeCoefficients(&q1, &q2);
+        benchmark::DoNotOptimize(xnkl.getCoefficients().data().begin());
+    }
+}
+
+static void BM_PowerExpansionGradients(benchmark::State &state) {
+    int N = state.range(0);
+    int L = state.range(1);
+    soap::Basis *basis = get_basis(N, L);
+    std::vector<double> r;
+    std::vector<soap::vec> d;
+    sample_neighbours(2, basis->getCutoff()->getCutoff(), r, d);
+    soap::BasisExpansion dq(basis), q(basis);
+    dq.computeCoefficients(r[0], d[0], 1., 1., 0.5, true);
+    q.computeCoefficients(r[1], d[1], 1., 1., 0.5, false);
+    soap::PowerExpansion dxnkl(basis);
+    for (auto _ : state) {
+        dxnkl.computeCoefficientsGradients(&dq, &q, true);
+        benchmark::DoNotOptimize(dxnkl.getCoefficientsGradX().data().begin());
+    }
+    set_costs(state, 1, 0);
+}
+
+// ==========
+// BOUNDARIES
+// ==========
+
+static void BM_BoundaryConnect(benchmark::State &state) {
+    // range(0): 0 open, 1 orthorhombic, 2 triclinic; range(1): 0 connect, 1 connectMany
+    int n_atoms = 1000;
+    soap::Structure *structure = make_box(n_atoms);
+    double a = structure->getBoundary()->getBox().getCol(0).getX();
+    double box_ortho[9] = { a,0.,0., 0.,a,0., 0.,0.,a };
+    double box_tri[9] = { a,0.,0., 0.3*a,a,0., 0.2*a,-0.1*a,a };
+    bool pbc[3] = { state.range(0) > 0, state.range(0) > 0, state.range(0) > 0 };
+    structure->setBoundary((state.range(0) == 2) ? box_tri : box_ortho, pbc);
+    soap::Boundary *boundary = structure->getBoundary();
+    const soap::vec *r = structure->getPositions();
+    std::vector<soap::vec> dr(n_atoms);
+    std::vector<double> d2(n_atoms);
+    int i = 0;
+    for (auto _ : state) {
+        const soap::vec &r_i = r[i];
+        if (state.range(1)) {
+            boundary->connectMany(r_i, r, n_atoms, dr.data(), d2.data());
+        }
+        else {
+            for (int j = 0; j < n_atoms; ++j) dr[j] = boundary->connect(r_i, r[j]);
+        }
+        benchmark::DoNotOptimize(dr.data());
+        i = (i+1) % n_atoms;
+    }
+    state.SetItemsProcessed(state.iterations()*n_atoms);
+    delete structure;
+}
+
+// ========
+// SPECTRUM
+// ========
+
+static void BM_SpectrumConfig(benchmark::State &state, std::string filename) {
+    int N = state.range(0);
+    int L = state.range(1);
+    bool gradients = state.range(2);
+    soap::XyzReader reader(filename);
+    soap::Structure *structure = reader.read(0);
+    soap::Options *options = make_options(N, L, gradients);
+    soap::Basis basis(options);
+    double rc = basis.getCutoff()->getCutoff();
+    long n_nbs = count_neighbours(*structure, structure->particles(), rc);
+    for (auto _ : state) {
+        soap::Spectrum spectrum(*structure, *options, basis);
+        spectrum.compute();
+        spectrum.computePower();
+        if (gradients) spectrum.computePowerGradients();
+    }
+    set_costs(state, n_nbs, structure->particles().size());
+    delete options;
+    delete structure;
+}
+
+static void BM_SpectrumBox(benchmark::State &state) {
+    // Per-center cost in a box of range(0) atoms, for a subset of centers,
+    // so that 100k atoms remain feasible: the targets are always all atoms
+    int n_atoms = state.range(0);
+    int N = state.range(1);
+    int L = state.range(2);
+    bool gradients = state.range(3);
+    static std::map<int, soap::Structure*> boxes;
+    if (!boxes.count(n_atoms)) boxes[n_atoms] = make_box(n_atoms);
+    soap::Structure *structure = boxes[n_atoms];
+    int n_centers = std::min(n_atoms, 100);
+    soap::Structure::particle_array_t centers(structure->particles().begin(),
+        structure->particles().begin()+n_centers);
+    soap::Options *options = make_options(N, L, gradients);
+    soap::Basis basis(options);
+    double rc = basis.getCutoff()->getCutoff();
+    long n_nbs = count_neighbours(*structure, centers, rc);
+    for (auto _ : state) {
+        soap::Spectrum spectrum(*structure, *options, basis);
+        spectrum.compute(centers, structure->particles());
+        spectrum.computePower();
+    }
+    set_costs(state, n_nbs, n_centers);
+    state.counters["neighbours_per_center"] = n_nbs/double(n_centers);
+    delete options;
+}
+
+// ======
+// KERNEL
+// ======
+
+static void BM_KernelDotQnlm(benchmark::State &state) {
+    // Kernel matrix between all centers of a box of range(0) atoms, in
+    // double (range(1) = 0) or single precision, single-threaded. The
+    // counter packed_bytes is the memory of the packed coefficients.
+    int n_atoms = state.range(0);
+    bool single = state.range(1);
+    soap::Structure *structure = make_box(n_atoms);
+    soap::Options *options = make_options(9, 6, false);
+    soap::Basis basis(options);
+    soap::Spectrum spectrum(*structure, *options, basis);
+    spectrum.compute();
+    soap::Options kernel_options;
+    kernel_options.set("kernel.qnlm.type", "specific");
+    kernel_options.set("kernel.qnlm.threads", 1);
+    kernel_options.set("kernel.qnlm.precision", (single) ? "single" : "double");
+    soap::KernelDotQnlm kernel(kernel_options);
+    soap::KernelDotQnlm::kernel_t kmat;
+    long n_blocks = 0;
+    for (auto it = spectrum.beginAtomic(); it != spectrum.endAtomic(); ++it) n_blocks += (*it)->getQnlmMap().size();
+    for (auto _ : state) {
+        kernel.compute(spectrum, spectrum, kmat);
+        benchmark::DoNotOptimize(kmat.data().begin());
+    }
+    state.SetItemsProcessed(state.iterations()*spectrum.length()*spectrum.length());
+    state.counters["packed_bytes"] = n_blocks*9*49*((single) ? sizeof(std::complex<float>) : sizeof(std::complex<double>));
+    delete options;
+    delete structure;
+}
+
+static void register_benchmarks() {
+    std::vector<int64_t> Ns = { 6, 9, 12 };
+    std::vector<int64_t> Ls = { 4, 6, 9 };
+    std::vector<int64_t> grads = { 0, 1 };
+    benchmark::RegisterBenchmark("BM_RadialBasis", BM_RadialBasis)
+        ->ArgsProduct({ Ns, Ls, grads })->ArgNames({ "N", "L", "grad" });
+    benchmark::RegisterBenchmark("BM_AngularBasis", BM_AngularBasis)
+        ->ArgsProduct({ { 9 }, Ls, grads })->ArgNames({ "N", "L", "grad" });
+    benchmark::RegisterBenchmark("BM_BasisExpansion", BM_BasisExpansion)
+        ->ArgsProduct({ Ns, Ls, grads })->ArgNames({ "N", "L", "grad" });
+    benchmark::RegisterBenchmark("BM_PowerExpansion", BM_PowerExpansion)
+        ->ArgsProduct({ Ns, Ls })->ArgNames({ "N", "L" });
+    benchmark::RegisterBenchmark("BM_PowerExpansionGradients", BM_PowerExpansionGradients)
+        ->ArgsProduct({ Ns, Ls })->ArgNames({ "N", "L" });
+    benchmark::RegisterBenchmark("BM_BoundaryConnect", BM_BoundaryConnect)
+        ->ArgsProduct({ { 0, 1, 2 }, { 0, 1 } })->ArgNames({ "pbc", "batched" });
+    // Structures of test/configs, if found
+    DIR *dir = opendir(configs_dir.c_str());
+    if (dir) {
+        std::vector<std::string> files;
+        for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.substr(name.size()-4) == ".xyz") files.push_back(name);
+        }
+        closedir(dir);
+        std::sort(files.begin(), files.end());
+        for (auto it = files.begin(); it != files.end(); ++it) {
+            benchmark::RegisterBenchmark(("BM_SpectrumConfig/" + *it).c_str(), BM_SpectrumConfig, configs_dir + "/" + *it)
+                ->ArgsProduct({ { 9 }, { 6 }, grads })->ArgNames({ "N", "L", "grad" })
+                ->Unit(benchmark::kMillisecond);
+        }
+    }
+    else {
+        std::cerr << "bench_soap: no configs in '" << configs_dir << "', skipping BM_SpectrumConfig" << std::endl;
+    }
+    benchmark::RegisterBenchmark("BM_SpectrumBox", BM_SpectrumBox)
+        ->ArgsProduct({ { 10000, 100000 }, { 9 }, { 6 }, { 0 } })
+        ->ArgsProduct({ { 1000 }, Ns, Ls, grads })
+        ->ArgNames({ "atoms", "N", "L", "grad" })
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_KernelDotQnlm", BM_KernelDotQnlm)
+        ->ArgsProduct({ { 200, 500 }, { 0, 1 } })->ArgNames({ "atoms", "single" })
+        ->Unit(benchmark::kMillisecond);
+}
+
+int main(int argc, char **argv) {
+    // Own flag, the rest is left to google-benchmark
+    std::vector<char*> args;
+    for (int a = 0; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg.find("--soap_configs=") == 0) configs_dir = arg.substr(15);
+        else args.push_back(argv[a]);
+    }
+    int n_args = args.size();
+    Py_Initialize(); // <- Options hold python objects
+    soap::RadialBasisFactory::registerAll();
+    soap::AngularBasisFactory::registerAll();
+    soap::CutoffFunctionFactory::registerAll();
+    soap::GLOG_SILENCE();
+    register_benchmarks();
+    benchmark::Initialize(&n_args, args.data());
+    if (benchmark::ReportUnrecognizedArguments(n_args, args.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
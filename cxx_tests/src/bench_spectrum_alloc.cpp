@@ -0,0 +1,90 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <dlfcn.h>
+#include <boost/format.hpp>
+#include <soap/spectrum.hpp>
+#include <soap/options.hpp>
+
+// Heap allocations and timings of Spectrum::compute + computePower and of
+// the teardown, for a periodic box of 1000 atoms, with and without density
+// gradients and with and without the spectrum arena (spectrum.arena). Heap
+// allocations are counted through the global operator new and posix_memalign.
+
+static long n_allocs = 0;
+
+void *operator new(std::size_t size) {
+    ++n_allocs;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+extern "C" int posix_memalign(void **ptr, std::size_t alignment, std::size_t size) {
+    typedef int (*posix_memalign_t)(void **, std::size_t, std::size_t);
+    static posix_memalign_t posix_memalign_next = (posix_memalign_t)dlsym(RTLD_NEXT, "posix_memalign");
+    ++n_allocs;
+    return posix_memalign_next(ptr, alignment, size);
+}
+
+typedef std::chrono::high_resolution_clock bench_clock_t;
+
+static double elapsed_ms(bench_clock_t::time_point t0) {
+    return std::chrono::duration<double, std::milli>(bench_clock_t::now()-t0).count();
+}
+
+static void bench(soap::Structure &structure, bool gradients, bool arena) {
+    soap::Options options;
+    options.set("spectrum.gradients", gradients);
+    options.set("spectrum.arena", arena);
+    long n0 = n_allocs;
+    bench_clock_t::time_point t0 = bench_clock_t::now();
+    soap::Spectrum *spectrum = new soap::Spectrum(structure, options);
+    spectrum->compute();
+    spectrum->computePower();
+    double t_compute = elapsed_ms(t0);
+    long n_compute = n_allocs - n0;
+    t0 = bench_clock_t::now();
+    delete spectrum;
+    double t_delete = elapsed_ms(t0);
+    std::cout << boost::format("gradients=%1$d arena=%2$d  compute: %3$9d allocations %4$9.1f ms  teardown: %5$8.2f ms")
+        % gradients % arena % n_compute % t_compute % t_delete << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::cout << "soapxx/bench/spectrum_alloc" << std::endl;
+    Py_Initialize(); // <- Options hold python objects
+    soap::RadialBasisFactory::registerAll();
+    soap::AngularBasisFactory::registerAll();
+    soap::CutoffFunctionFactory::registerAll();
+    soap::GLOG_SILENCE();
+
+    // 1000 atoms at roughly 0.1 atoms/A^3
+    int n_atoms = 1000;
+    double a = 21.5;
+    std::vector<double> xyz(3*n_atoms);
+    std::vector<std::string> types(n_atoms);
+    unsigned int seed = 12345;
+    for (int i = 0; i < n_atoms; ++i) {
+        for (int d = 0; d < 3; ++d) {
+            seed = 1103515245*seed + 12345;
+            xyz[3*i+d] = a*((seed >> 8) % 100000)/100000.;
+        }
+        types[i] = (i % 3 == 0) ? "C" : ((i % 3 == 1) ? "H" : "O");
+    }
+    double box[9] = { a,0.,0., 0.,a,0., 0.,0.,a };
+    bool pbc[3] = { true, true, true };
+    soap::Structure structure("bench");
+    structure.setBoundary(box, pbc);
+    structure.addParticles(n_atoms, xyz.data(), types.data(), NULL, NULL, NULL);
+
+    bench(structure, false, false);
+    bench(structure, false, true);
+    bench(structure, true, false);
+    bench(structure, true, true);
+    return 0;
+}
@@ -0,0 +1,342 @@
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <soap/archive.hpp>
+#include <soap/spectrum.hpp>
+#include <soap/options.hpp>
+#include "gtest_defines.hpp"
+#include "gtest_fixtures.hpp"
+
+class TestSpectrumArchive : public TestSmallMolecule
+{
+public:
+
+    std::string _filename;
+
+    virtual void SetUp() {
+        TestSmallMolecule::SetUp();
+        _filename = "gtest_archive.soapxx";
+    }
+
+    virtual void TearDown() {
+        TestSmallMolecule::TearDown();
+        std::remove(_filename.c_str());
+    }
+};
+
+TEST_F(TestSpectrumArchive, RoundTrip) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    ::testing::internal::GetCapturedStdout();
+
+    std::vector<std::string> species = { "H", "C", "N", "O" };
+    soap::SpectrumArchiveWriter writer(_filename, species, true);
+    writer.add(spectrum, "first");
+    writer.add(spectrum, "second");
+    writer.close();
+
+    soap::SpectrumArchive archive(_filename);
+    ASSERT_EQ(archive.N(), 5);
+    ASSERT_EQ(archive.L(), 3);
+    ASSERT_EQ(archive.nSpecies(), 4);
+    ASSERT_EQ(archive.nStructures(), 2);
+    ASSERT_EQ(archive.nCenters(), 2*spectrum.length());
+    EXPECT_TRUE(archive.hasPower());
+    EXPECT_EQ(archive.getStructure(1).first_center, spectrum.length());
+    EXPECT_EQ(std::string(archive.getStructure(1).label), "second");
+
+    int S = 4;
+    int size_qnlm = 5*4*4;
+    int size_xnkl = 5*5*4;
+    int c = spectrum.length();
+    for (auto a = spectrum.beginAtomic(); a != spectrum.endAtomic(); ++a, ++c) {
+        const soap::archive_center_t &center = archive.getCenter(c);
+        EXPECT_EQ(center.center_id, (*a)->getCenterId());
+        EXPECT_EQ(species[center.species], (*a)->getCenterType());
+        EXPECT_DOUBLE_EQ(center.pos[0], (*a)->getCenterPos().getX());
+        // Densities, absent species zero
+        const std::complex<double> *qnlm = archive.getQnlm(c);
+        for (int s = 0; s < S; ++s) {
+            auto it = (*a)->getQnlmMap().find(species[s]);
+            for (int i = 0; i < size_qnlm; ++i) {
+                std::complex<double> ref = (it == (*a)->getQnlmMap().end()) ?
+                    std::complex<double>(0.,0.) : it->second->getCoefficients().data()[i];
+                EXPECT_EQ(qnlm[s*size_qnlm+i], ref);
+            }
+        }
+        // Power spectra, by species pair and type-agnostic
+        const std::complex<double> *xnkl = archive.getXnkl(c);
+        soap::AtomicSpectrum::map_xnkl_t &map_xnkl = (*a)->getXnklMap();
+        for (auto it = map_xnkl.begin(); it != map_xnkl.end(); ++it) {
+            int s1 = std::find(species.begin(), species.end(), it->first.first) - species.begin();
+            int s2 = std::find(species.begin(), species.end(), it->first.second) - species.begin();
+            for (int i = 0; i < size_xnkl; ++i) {
+                EXPECT_EQ(xnkl[(s1*S+s2)*size_xnkl+i], it->second->getCoefficients().data()[i]);
+            }
+        }
+        const std::complex<double> *xnkl_gc = archive.getXnklGeneric(c);
+        for (int i = 0; i < size_xnkl; ++i) {
+            EXPECT_EQ(xnkl_gc[i], (*a)->getXnklGenericCoherent()->getCoefficients().data()[i]);
+        }
+    }
+}
+
+TEST_F(TestSpectrumArchive, RejectsUnknownSpecies) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    ::testing::internal::GetCapturedStdout();
+
+    std::vector<std::string> species = { "H", "C" };
+    soap::SpectrumArchiveWriter writer(_filename, species, false);
+    EXPECT_THROW(writer.add(spectrum, "test"), soap::base::APIError);
+    writer.close();
+}
+
+TEST_F(TestSpectrumArchive, FailedAddWritesNothing) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    soap::Spectrum spectrum_no_power(*_structure, _options);
+    spectrum_no_power.compute();
+    ::testing::internal::GetCapturedStdout();
+
+    std::vector<std::string> species = { "H", "C", "O" };
+    soap::SpectrumArchiveWriter writer(_filename, species, true);
+    writer.add(spectrum, "first");
+    EXPECT_THROW(writer.add(spectrum_no_power, "second"), soap::base::APIError);
+    writer.close();
+
+    soap::SpectrumArchive archive(_filename);
+    ASSERT_EQ(archive.nStructures(), 1);
+    ASSERT_EQ(archive.nCenters(), spectrum.length());
+    EXPECT_EQ(archive.getStructure(0).n_centers, spectrum.length());
+}
+
+TEST_F(TestSpectrumArchive, RejectsCorruptHeader) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    ::testing::internal::GetCapturedStdout();
+
+    std::vector<std::string> species = { "H", "C", "O" };
+    soap::SpectrumArchiveWriter writer(_filename, species, false);
+    writer.add(spectrum, "test");
+    writer.close();
+    soap::archive_header_t header;
+    std::ifstream ifs(_filename.c_str(), std::ios::binary);
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    ifs.close();
+
+    // Unknown flag bits, then tables beyond the end of the file
+    std::vector<soap::archive_header_t> corrupt(4, header);
+    corrupt[0].flags |= 1 << 7;
+    corrupt[1].offset_centers = header.size_file - 8;
+    corrupt[2].n_centers = header.n_centers + 1;
+    corrupt[3].offset_records = header.size_file;
+    for (int i = 0; i < corrupt.size(); ++i) {
+        std::fstream fs(_filename.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+        fs.write(reinterpret_cast<const char*>(&corrupt[i]), sizeof(header));
+        fs.close();
+        EXPECT_THROW(soap::SpectrumArchive archive(_filename), soap::base::IOError);
+    }
+}
+
+TEST_F(TestSpectrumArchive, ReducedPrecision) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    ::testing::internal::GetCapturedStdout();
+
+    std::vector<std::string> species = { "H", "C", "O" };
+    std::vector<std::string> dtypes = { "complex128", "complex64", "qint16", "qint8" };
+    // Bound on |decoded - stored| relative to the largest magnitude in the record
+    std::vector<double> tolerances = { 0., 1e-7, 1./32767, 1./127 };
+    std::vector<uint64_t> record_sizes;
+    for (int d = 0; d < dtypes.size(); ++d) {
+        soap::SpectrumArchiveWriter writer(_filename, species, true, dtypes[d]);
+        writer.add(spectrum, "test");
+        writer.close();
+
+        soap::SpectrumArchive archive(_filename);
+        ASSERT_EQ(archive.dtype(), soap::archive_dtype_from_string(dtypes[d]));
+        ASSERT_EQ(archive.nBlocks(), 3+9+1);
+        record_sizes.push_back(archive.recordSize());
+        if (d > 0) EXPECT_THROW(archive.getQnlm(0), soap::base::APIError);
+
+        // Reference from the complex128 decoding path
+        std::vector<std::complex<double> > out;
+        int c = 0;
+        for (auto a = spectrum.beginAtomic(); a != spectrum.endAtomic(); ++a, ++c) {
+            archive.decode(c, out);
+            std::vector<std::complex<double> > ref(out.size(), std::complex<double>(0.,0.));
+            int size_qnlm = 5*4*4;
+            int size_xnkl = 5*5*4;
+            for (int s = 0; s < 3; ++s) {
+                soap::BasisExpansion::coeff_t &qnlm = (*a)->getQnlmMap()[species[s]]->getCoefficients();
+                std::copy(&qnlm.data()[0], &qnlm.data()[0]+size_qnlm, &ref[s*size_qnlm]);
+            }
+            soap::AtomicSpectrum::map_xnkl_t &map_xnkl = (*a)->getXnklMap();
+            for (auto it = map_xnkl.begin(); it != map_xnkl.end(); ++it) {
+                int s1 = std::find(species.begin(), species.end(), it->first.first) - species.begin();
+                int s2 = std::find(species.begin(), species.end(), it->first.second) - species.begin();
+                soap::PowerExpansion::coeff_t &xnkl = it->second->getCoefficients();
+                std::copy(&xnkl.data()[0], &xnkl.data()[0]+size_xnkl, &ref[3*size_qnlm+(s1*3+s2)*size_xnkl]);
+            }
+            soap::PowerExpansion::coeff_t &xnkl_gc = (*a)->getXnklGenericCoherent()->getCoefficients();
+            std::copy(&xnkl_gc.data()[0], &xnkl_gc.data()[0]+size_xnkl, &ref[3*size_qnlm+9*size_xnkl]);
+
+            double max_abs = 0.;
+            double max_err = 0.;
+            for (int i = 0; i < ref.size(); ++i) {
+                max_abs = std::max(max_abs, std::abs(ref[i]));
+                max_err = std::max(max_err, std::abs(out[i]-ref[i]));
+            }
+            EXPECT_LE(max_err, tolerances[d]*max_abs);
+        }
+    }
+    // Storage per center: 1/2, ~1/4 and ~1/8 of complex128
+    EXPECT_EQ(2*record_sizes[1], record_sizes[0]);
+    EXPECT_LE(4*record_sizes[2], record_sizes[0]+4*13*4+32);
+    EXPECT_LE(8*record_sizes[3], record_sizes[0]+8*13*4+64);
+}
+
+TEST_F(TestSpectrumArchive, LazyAtomicSpectra) {
+    _options.set("spectrum.gradients", true);
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+
+    std::vector<std::string> species = { "H", "C", "O" };
+    soap::SpectrumArchiveWriter writer(_filename, species, true, "complex128", true);
+    writer.add(spectrum, "test");
+    writer.close();
+
+    soap::SpectrumArchive archive(_filename);
+    ASSERT_TRUE(archive.hasGradients());
+    ASSERT_EQ(archive.findCenters("H").size(), 2);
+    ASSERT_EQ(archive.findCenters("N").size(), 0);
+    ASSERT_EQ(archive.findCenters("").size(), 4);
+    for (auto a = spectrum.beginAtomic(); a != spectrum.endAtomic(); ++a) {
+        int c = archive.findCenter(0, (*a)->getCenterId());
+        ASSERT_GE(c, 0);
+        soap::AtomicSpectrum *atomic = archive.getAtomicSpectrum(c);
+        EXPECT_EQ(atomic->getCenterType(), (*a)->getCenterType());
+        EXPECT_EQ(atomic->getQnlmMap().size(), (*a)->getQnlmMap().size());
+        // Densities
+        soap::BasisExpansion::coeff_t &q = atomic->getQnlmGeneric()->getCoefficients();
+        soap::BasisExpansion::coeff_t &q_ref = (*a)->getQnlmGeneric()->getCoefficients();
+        for (int i = 0; i < q.data().size(); ++i) {
+            EXPECT_NEAR(std::abs(q.data()[i]-q_ref.data()[i]), 0., 1e-12);
+        }
+        // Power spectra
+        soap::AtomicSpectrum::map_xnkl_t &map_xnkl = (*a)->getXnklMap();
+        for (auto it = map_xnkl.begin(); it != map_xnkl.end(); ++it) {
+            soap::AtomicSpectrum::type_pair_t types = it->first;
+            ASSERT_TRUE(atomic->getXnkl(types) != NULL);
+            soap::PowerExpansion::coeff_t &x = atomic->getXnkl(types)->getCoefficients();
+            for (int i = 0; i < x.data().size(); ++i) {
+                EXPECT_EQ(x.data()[i], it->second->getCoefficients().data()[i]);
+            }
+        }
+        // Gradients, and without
+        EXPECT_EQ(atomic->getQnlmGradPids(), (*a)->getQnlmGradPids());
+        EXPECT_EQ(atomic->getQnlmGradTypes(), (*a)->getQnlmGradTypes());
+        EXPECT_EQ(atomic->getQnlmGrad(), (*a)->getQnlmGrad());
+        delete atomic;
+        atomic = archive.getAtomicSpectrum(c, false);
+        EXPECT_EQ(atomic->getQnlmGrad().size(), 0);
+        delete atomic;
+    }
+    ::testing::internal::GetCapturedStdout();
+}
+
+TEST_F(TestSpectrumArchive, ChunkedStreaming) {
+    _options.set("spectrum.gradients", true);
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+
+    // Chunks of at least 5 centers end at structures: 2+1 structures of 4 centers
+    std::vector<std::string> species = { "H", "C", "O" };
+    soap::SpectrumArchiveWriter writer(_filename, species, true, "complex64", true, 5);
+    for (int s = 0; s < 3; ++s) writer.add(spectrum, "test");
+    writer.close();
+
+    soap::SpectrumArchive archive(_filename);
+    ASSERT_EQ(archive.nCenters(), 3*spectrum.length());
+    std::vector<std::complex<double> > out;
+    for (int c = archive.nCenters()-1; c >= 0; --c) {
+        soap::AtomicSpectrum *ref = *(spectrum.beginAtomic() + c % spectrum.length());
+        ASSERT_EQ(archive.getCenter(c).center_id, ref->getCenterId());
+        archive.decode(c, out);
+        soap::BasisExpansion::coeff_t &q_ref = ref->getQnlmMap()[ref->getCenterType()]->getCoefficients();
+        int s = archive.getCenter(c).species;
+        for (int i = 0; i < q_ref.data().size(); ++i) {
+            EXPECT_NEAR(std::abs(out[s*q_ref.data().size()+i]-q_ref.data()[i]), 0., 1e-6);
+        }
+        soap::AtomicSpectrum *atomic = archive.getAtomicSpectrum(c);
+        EXPECT_EQ(atomic->getQnlmGradPids(), ref->getQnlmGradPids());
+        EXPECT_EQ(atomic->getQnlmGrad(), ref->getQnlmGrad());
+        delete atomic;
+    }
+    ::testing::internal::GetCapturedStdout();
+}
+
+TEST_F(TestSpectrumArchive, RecoversUnclosedChunks) {
+    _options.set("spectrum.gradients", true);
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    ::testing::internal::GetCapturedStdout();
+
+    std::vector<std::string> species = { "H", "C", "O" };
+    soap::SpectrumArchiveWriter writer(_filename, species, true, "complex128", true, 1);
+    for (int s = 0; s < 3; ++s) writer.add(spectrum, "test");
+    writer.close();
+
+    // Interrupted writer: the header as of the first add, the file cut
+    // within the last chunk, no tables
+    std::ifstream ifs(_filename.c_str(), std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    ifs.close();
+    soap::archive_header_t header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    ASSERT_EQ(header.n_chunks, 3);
+    soap::archive_chunk_t last;
+    std::memcpy(&last, data.data() + header.offset_chunks + 2*sizeof(last), sizeof(last));
+    header.n_structures = header.n_centers = header.n_chunks = 0;
+    header.offset_structures = header.offset_centers = header.offset_gradients = header.offset_chunks = 0;
+    header.size_file = 0;
+    data.resize(last.offset + last.size_compressed/2);
+    std::memcpy(&data[0], &header, sizeof(header));
+    std::ofstream ofs(_filename.c_str(), std::ios::binary | std::ios::trunc);
+    ofs.write(data.data(), data.size());
+    ofs.close();
+
+    soap::SpectrumArchive archive(_filename);
+    ASSERT_EQ(archive.nStructures(), 2);
+    ASSERT_EQ(archive.nCenters(), 2*spectrum.length());
+    EXPECT_EQ(archive.getStructure(1).first_center, spectrum.length());
+    ASSERT_EQ(archive.N(), 5);
+    for (int c = 0; c < archive.nCenters(); ++c) {
+        soap::AtomicSpectrum *ref = *(spectrum.beginAtomic() + c % spectrum.length());
+        soap::AtomicSpectrum *atomic = archive.getAtomicSpectrum(c);
+        EXPECT_EQ(atomic->getCenterId(), ref->getCenterId());
+        EXPECT_EQ(atomic->getQnlmGradPids(), ref->getQnlmGradPids());
+        EXPECT_EQ(atomic->getQnlmGrad(), ref->getQnlmGrad());
+        delete atomic;
+    }
+}
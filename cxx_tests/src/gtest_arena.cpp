@@ -0,0 +1,66 @@
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <soap/base/arena.hpp>
+#include <soap/linalg/tensor.hpp>
+
+TEST(TestArena, AlignmentAndChunks) {
+    soap::base::Arena arena(1024);
+    EXPECT_EQ(arena.getNumberOfChunks(), 0);
+    void *a = arena.allocate(10, 8);
+    void *b = arena.allocate(100, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b) % 64, 0);
+    EXPECT_GE(static_cast<char*>(b), static_cast<char*>(a)+10);
+    EXPECT_EQ(arena.getNumberOfChunks(), 1);
+    // Larger than a chunk: gets a chunk of its own, the first one stays in use
+    double *c = arena.allocate<double>(1000);
+    EXPECT_EQ(arena.getNumberOfChunks(), 2);
+    for (int i = 0; i < 1000; ++i) c[i] = i;
+    void *d = arena.allocate(10, 8);
+    EXPECT_EQ(arena.getNumberOfChunks(), 2);
+    EXPECT_GE(static_cast<char*>(d), static_cast<char*>(b)+100);
+    EXPECT_LT(static_cast<char*>(d), static_cast<char*>(a)+1024);
+    EXPECT_EQ(arena.getNumberOfAllocations(), 4);
+    EXPECT_EQ(arena.getBytesAllocated(), 120+1000*sizeof(double));
+    EXPECT_EQ(arena.getBytesReserved(), 1024+1000*sizeof(double)+16);
+    arena.release();
+    EXPECT_EQ(arena.getNumberOfChunks(), 0);
+    EXPECT_EQ(arena.getNumberOfAllocations(), 0);
+}
+
+TEST(TestArena, AllocatorBacksContainers) {
+    typedef soap::base::ArenaAllocator<std::pair<const int, double> > alloc_t;
+    typedef std::map<int, double, std::less<int>, alloc_t> map_t;
+    soap::base::Arena arena;
+    alloc_t alloc(&arena);
+    map_t map(std::less<int>(), alloc);
+    for (int i = 0; i < 10; ++i) map[i] = 0.5*i;
+    EXPECT_EQ(arena.getNumberOfAllocations(), 10);
+    // Copies go to the heap, so they may outlive the arena
+    map_t copy(map);
+    EXPECT_EQ(copy.get_allocator()._arena, (soap::base::Arena*)NULL);
+    EXPECT_EQ(arena.getNumberOfAllocations(), 10);
+    map.clear();
+    arena.release();
+    EXPECT_DOUBLE_EQ(copy[9], 4.5);
+}
+
+TEST(TestArena, AlignedMatrixFromArena) {
+    typedef std::complex<double> cmplx_t;
+    soap::base::Arena arena;
+    soap::linalg::aligned_matrix<cmplx_t> m;
+    m.setArena(&arena);
+    m = soap::linalg::aligned_zero_matrix<cmplx_t>(3, 4);
+    EXPECT_EQ(arena.getNumberOfAllocations(), 1);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&m.data()[0]) % 64, 0);
+    m(2, 3) = cmplx_t(1., 2.);
+    // Zeroing to the same (or a smaller) shape reuses the storage
+    m = soap::linalg::aligned_zero_matrix<cmplx_t>(2, 4);
+    EXPECT_EQ(arena.getNumberOfAllocations(), 1);
+    // Copies live on the heap
+    soap::linalg::aligned_matrix<cmplx_t> copy(m);
+    EXPECT_EQ(arena.getNumberOfAllocations(), 1);
+    EXPECT_EQ(copy.size1(), 2);
+    EXPECT_EQ(copy(1, 3), cmplx_t(0., 0.));
+}
@@ -0,0 +1,525 @@
+#include <iostream>
+#include <set>
+#include <algorithm>
+#include <vector>
+#include <gtest/gtest.h>
+#include <soap/spectrum.hpp>
+#include <soap/options.hpp>
+#include "gtest_defines.hpp"
+#include "gtest_fixtures.hpp"
+
+namespace ub = boost::numeric::ublas;
+
+class TestAtomicSpectrumGradients : public TestSmallMolecule
+{
+public:
+
+    virtual void SetUp() {
+        TestSmallMolecule::SetUp();
+        _options.set("spectrum.gradients", true);
+    }
+};
+
+TEST_F(TestAtomicSpectrumGradients, DenseTensorMatchesPowerExpansion) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.computePowerGradients();
+    ::testing::internal::GetCapturedStdout();
+
+    int size_slot = 5*5*(3+1);
+    for (auto a = spectrum.beginAtomic(); a != spectrum.endAtomic(); ++a) {
+        std::vector<int> &pids = (*a)->getPowerGradPids();
+        std::vector<soap::AtomicSpectrum::type_pair_t> &pairs = (*a)->getPowerGradTypePairs();
+        soap::AtomicSpectrum::map_qnlm_t &map_qnlm = (*a)->getQnlmMap();
+        ASSERT_EQ(pids.size(), 3);
+        for (int i = 0; i < pids.size(); ++i) {
+            std::string type = (*a)->getQnlmGradTypes()[i];
+            soap::BasisExpansion dqnlm_i(spectrum.getBasis());
+            soap::BasisExpansion *dqnlm = &dqnlm_i;
+            dqnlm->zeroGradient();
+            std::copy((*a)->qnlmGradSlot(i, 0), (*a)->qnlmGradSlot(i, 0)+dqnlm->getCoefficientsGradX().data().size(), &dqnlm->getCoefficientsGradX().data()[0]);
+            std::copy((*a)->qnlmGradSlot(i, 1), (*a)->qnlmGradSlot(i, 1)+dqnlm->getCoefficientsGradY().data().size(), &dqnlm->getCoefficientsGradY().data()[0]);
+            std::copy((*a)->qnlmGradSlot(i, 2), (*a)->qnlmGradSlot(i, 2)+dqnlm->getCoefficientsGradZ().data().size(), &dqnlm->getCoefficientsGradZ().data()[0]);
+            for (int p = 0; p < pairs.size(); ++p) {
+                // Reference: per-pid, per-pair PowerExpansion
+                soap::PowerExpansion ref(spectrum.getBasis());
+                if (pairs[p].first == type && pairs[p].second == type) {
+                    ref.computeCoefficientsGradients(dqnlm, map_qnlm[type], true);
+                }
+                else if (pairs[p].first == type) {
+                    ref.computeCoefficientsGradients(dqnlm, map_qnlm[pairs[p].second], false);
+                }
+                else if (pairs[p].second == type) {
+                    ref.computeCoefficientsGradients(map_qnlm[pairs[p].first], dqnlm, false);
+                }
+                else {
+                    ref.zeroGradient();
+                }
+                soap::PowerExpansion::coeff_t *ref_xyz[3] = {
+                    &ref.getCoefficientsGradX(), &ref.getCoefficientsGradY(), &ref.getCoefficientsGradZ() };
+                for (int d = 0; d < 3; ++d) {
+                    std::complex<double> *x = &(*a)->getPowerGrad()[((i*3+d)*pairs.size()+p)*size_slot];
+                    for (int j = 0; j < size_slot; ++j) {
+                        EXPECT_NEAR(x[j].real(), ref_xyz[d]->data()[j].real(), 1e-12);
+                        EXPECT_NEAR(x[j].imag(), ref_xyz[d]->data()[j].imag(), 1e-12);
+                    }
+                }
+            }
+            // Generic-coherent gradients via compatibility accessor
+            soap::PowerExpansion ref(spectrum.getBasis());
+            ref.computeCoefficientsGradients(dqnlm, (*a)->getQnlmGeneric(), true);
+            soap::PowerExpansion *xnkl_gc = (*a)->getPowerGradGeneric(pids[i]);
+            for (int j = 0; j < size_slot; ++j) {
+                EXPECT_NEAR(xnkl_gc->getCoefficientsGradY().data()[j].real(), ref.getCoefficientsGradY().data()[j].real(), 1e-12);
+                EXPECT_NEAR(xnkl_gc->getCoefficientsGradY().data()[j].imag(), ref.getCoefficientsGradY().data()[j].imag(), 1e-12);
+            }
+        }
+    }
+}
+
+TEST_F(TestAtomicSpectrumGradients, AdjointForcesMatchPowerGradients) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.computePowerGradients();
+    ::testing::internal::GetCapturedStdout();
+
+    int size_slot = 5*5*(3+1);
+    ub::matrix<double> dE_dX(spectrum.length(), size_slot);
+    for (int i = 0; i < dE_dX.size1(); ++i) {
+        for (int j = 0; j < dE_dX.size2(); ++j) {
+            dE_dX(i,j) = std::sin(0.37*(i+1)*(j+1));
+        }
+    }
+    ub::matrix<double> forces;
+    spectrum.computeForcesAdjoint(dE_dX, false, forces);
+    ASSERT_EQ(forces.size1(), 4);
+
+    // Reference: contract dE/dX with the stored generic-coherent gradients
+    ub::matrix<double> forces_ref = ub::zero_matrix<double>(4, 3);
+    int i = 0;
+    for (auto a = spectrum.beginAtomic(); a != spectrum.endAtomic(); ++a, ++i) {
+        std::vector<int> &pids = (*a)->getPowerGradPids();
+        for (int p = 0; p < pids.size(); ++p) {
+            for (int d = 0; d < 3; ++d) {
+                std::complex<double> *dx = &(*a)->getPowerGradGenericTensor()[(p*3+d)*size_slot];
+                for (int j = 0; j < size_slot; ++j) {
+                    forces_ref(pids[p]-1, d) -= dE_dX(i,j)*dx[j].real();
+                }
+            }
+        }
+    }
+    for (int j = 0; j < 4; ++j) {
+        for (int d = 0; d < 3; ++d) {
+            EXPECT_NEAR(forces(j,d), forces_ref(j,d), 1e-10);
+        }
+    }
+}
+
+TEST_F(TestAtomicSpectrumGradients, AdjointForcesRecomputeDensityGradients) {
+    // Without spectrum.gradients, the density gradients are recomputed in the
+    // backward pass (with periodic images) rather than read from the spectrum
+    double box[9] = { 3.5,0.,0., 0.3,3.7,0., -0.2,0.1,3.6 };
+    bool pbc[3] = { true, true, true };
+    _structure->setBoundary(box, pbc);
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum_stored(*_structure, _options);
+    spectrum_stored.compute();
+    spectrum_stored.computePower();
+    spectrum_stored.computeGlobal();
+    _options.set("spectrum.gradients", false);
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.computeGlobal();
+    ::testing::internal::GetCapturedStdout();
+    for (auto a = spectrum.beginAtomic(); a != spectrum.endAtomic(); ++a) {
+        EXPECT_EQ((*a)->getQnlmGradPids().size(), 0);
+        EXPECT_EQ((*a)->getQnlmGrad().size(), 0);
+    }
+
+    int size_slot = 5*5*(3+1);
+    for (int global = 0; global < 2; ++global) {
+        ub::matrix<double> dE_dX((global) ? 1 : spectrum.length(), size_slot);
+        for (int i = 0; i < dE_dX.size1(); ++i) {
+            for (int j = 0; j < dE_dX.size2(); ++j) {
+                dE_dX(i,j) = std::sin(0.37*(i+1)*(j+1));
+            }
+        }
+        ub::matrix<double> forces;
+        ub::matrix<double> forces_stored;
+        spectrum.computeForcesAdjoint(dE_dX, global, forces);
+        spectrum_stored.computeForcesAdjoint(dE_dX, global, forces_stored);
+        ASSERT_EQ(forces.size1(), 4);
+        double max_abs = 0.;
+        for (int j = 0; j < 4; ++j) {
+            for (int d = 0; d < 3; ++d) {
+                EXPECT_NEAR(forces(j,d), forces_stored(j,d), 1e-10);
+                max_abs = std::max(max_abs, std::abs(forces_stored(j,d)));
+            }
+        }
+        EXPECT_GT(max_abs, 1e-3);
+    }
+}
+
+TEST_F(TestAtomicSpectrumGradients, AdjointForcesRecomputeOverTargetSegment) {
+    // Targets restricted to a segment: the recomputed neighbours must be those of
+    // compute, not all particles of the structure
+    soap::Structure structure("segments");
+    soap::Segment &seg_a = structure.addSegment();
+    soap::Segment &seg_b = structure.addSegment();
+    int i = 0;
+    for (auto it = _structure->beginParticles(); it != _structure->endParticles(); ++it, ++i) {
+        soap::Particle &particle = structure.addParticle((i < 3) ? seg_a : seg_b);
+        particle.setType((*it)->getType());
+        particle.setPos((*it)->getPos().getX(), (*it)->getPos().getY(), (*it)->getPos().getZ());
+        particle.setWeight(1.);
+        particle.setSigma(0.5);
+    }
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum_stored(structure, _options);
+    spectrum_stored.compute(&seg_a, &seg_a);
+    spectrum_stored.computePower();
+    _options.set("spectrum.gradients", false);
+    soap::Spectrum spectrum(structure, _options);
+    spectrum.compute(&seg_a, &seg_a);
+    spectrum.computePower();
+    ::testing::internal::GetCapturedStdout();
+
+    int size_slot = 5*5*(3+1);
+    ub::matrix<double> dE_dX(spectrum.length(), size_slot);
+    for (int i = 0; i < dE_dX.size1(); ++i) {
+        for (int j = 0; j < dE_dX.size2(); ++j) {
+            dE_dX(i,j) = std::sin(0.37*(i+1)*(j+1));
+        }
+    }
+    ub::matrix<double> forces;
+    ub::matrix<double> forces_stored;
+    spectrum.computeForcesAdjoint(dE_dX, false, forces);
+    spectrum_stored.computeForcesAdjoint(dE_dX, false, forces_stored);
+    ASSERT_EQ(forces.size1(), 4);
+    for (int j = 0; j < 4; ++j) {
+        for (int d = 0; d < 3; ++d) {
+            EXPECT_NEAR(forces(j,d), forces_stored(j,d), 1e-10);
+        }
+    }
+    for (int d = 0; d < 3; ++d) EXPECT_EQ(forces(3,d), 0.); // <- not a target
+
+    // Further centers over other targets: the targets are no longer known
+    ::testing::internal::CaptureStdout();
+    spectrum.compute(&seg_b);
+    ::testing::internal::GetCapturedStdout();
+    ub::matrix<double> dE_dX_all(spectrum.length(), size_slot);
+    EXPECT_THROW(spectrum.computeForcesAdjoint(dE_dX_all, false, forces), soap::base::APIError);
+}
+
+TEST_F(TestAtomicSpectrumGradients, VirialMatchesPositionGradients) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.computePowerGradients();
+    ::testing::internal::GetCapturedStdout();
+
+    // Without periodic images, each pid is a single neighbour: V_ab = sum_j r_ja dX/dr_jb
+    int size_slot = 5*5*(3+1);
+    for (auto a = spectrum.beginAtomic(); a != spectrum.endAtomic(); ++a) {
+        std::vector<int> &pids = (*a)->getPowerGradPids();
+        int n_pairs = (*a)->getPowerGradTypePairs().size();
+        for (int ab = 0; ab < 9; ++ab) {
+            for (int j = 0; j < n_pairs*size_slot; ++j) {
+                int p = j/size_slot;
+                int nkl = j % size_slot;
+                std::complex<double> v_ref = 0.;
+                for (int i = 0; i < pids.size(); ++i) {
+                    soap::vec dr = _structure->connect((*a)->getCenterPos(), _structure->particles()[pids[i]-1]->getPos());
+                    double r[3] = { dr.getX(), dr.getY(), dr.getZ() };
+                    v_ref += r[ab/3]*(*a)->getPowerGrad()[((i*3+ab%3)*n_pairs+p)*size_slot+nkl];
+                }
+                std::complex<double> v = (*a)->getPowerVirial()[ab*n_pairs*size_slot+j];
+                EXPECT_NEAR(v.real(), v_ref.real(), 1e-10);
+                EXPECT_NEAR(v.imag(), v_ref.imag(), 1e-10);
+            }
+        }
+    }
+}
+
+TEST_F(TestAtomicSpectrumGradients, VirialMatchesStrainFiniteDifference) {
+    // Periodic box small enough for images within the cutoff. Shearing box
+    // and positions by F = 1 + eps e_b e_a^T maps every (image) connection
+    // r -> F r, so that dX/deps = sum_j r_ja dX/dr_jb = V_ab.
+    double box[9] = { 3.5,0.,0., 0.3,3.7,0., -0.2,0.1,3.6 };
+    bool pbc[3] = { true, true, true };
+    _structure->setBoundary(box, pbc);
+    // Fine radial quadrature: with the fixture's 15 steps the analytic and
+    // numerical derivatives of the radial integrals differ at ~1e-5.
+    _options.set("radialbasis.integration_steps", 100);
+    int n = _structure->getNumberOfParticles();
+    std::vector<double> xyz(reinterpret_cast<double*>(_structure->getPositions()),
+        reinterpret_cast<double*>(_structure->getPositions())+3*n);
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.computePowerGradients();
+
+    double eps = 1e-5;
+    int size_slot = 5*5*(3+1);
+    double max_err = 0.;
+    double max_abs = 0.;
+    for (int ab = 0; ab < 9; ++ab) {
+        int a = ab/3;
+        int b = ab%3;
+        std::vector<soap::Spectrum*> strained;
+        for (int sign = -1; sign <= 1; sign += 2) {
+            // Box vectors are the columns of the box matrix: row b += eps*row a
+            double box_s[9];
+            std::vector<double> xyz_s(xyz);
+            std::copy(box, box+9, box_s);
+            for (int j = 0; j < 3; ++j) box_s[3*b+j] += sign*eps*box[3*a+j];
+            for (int i = 0; i < n; ++i) xyz_s[3*i+b] += sign*eps*xyz[3*i+a];
+            _structure->setBoundary(box_s, pbc);
+            _structure->setPositions(xyz_s.data());
+            strained.push_back(new soap::Spectrum(*_structure, _options));
+            strained.back()->compute();
+            strained.back()->computePower();
+        }
+        for (int c = 0; c < spectrum.length(); ++c) {
+            soap::AtomicSpectrum *atomic = *(spectrum.beginAtomic()+c);
+            std::vector<soap::AtomicSpectrum::type_pair_t> &pairs = atomic->getPowerGradTypePairs();
+            for (int p = 0; p < pairs.size(); ++p) {
+                soap::PowerExpansion *x_minus = (*(strained[0]->beginAtomic()+c))->getXnkl(pairs[p]);
+                soap::PowerExpansion *x_plus = (*(strained[1]->beginAtomic()+c))->getXnkl(pairs[p]);
+                for (int nkl = 0; nkl < size_slot; ++nkl) {
+                    std::complex<double> fd = 0.;
+                    if (x_plus) fd += x_plus->getCoefficients().data()[nkl];
+                    if (x_minus) fd -= x_minus->getCoefficients().data()[nkl];
+                    fd /= 2.*eps;
+                    std::complex<double> v = atomic->getPowerVirial()[(ab*pairs.size()+p)*size_slot+nkl];
+                    max_err = std::max(max_err, std::abs(v-fd));
+                    max_abs = std::max(max_abs, std::abs(v));
+                }
+            }
+        }
+        for (auto it = strained.begin(); it != strained.end(); ++it) delete *it;
+    }
+    ::testing::internal::GetCapturedStdout();
+    EXPECT_GT(max_abs, 1e-3);
+    EXPECT_LT(max_err, 1e-6*max_abs);
+}
+
+TEST_F(TestAtomicSpectrumGradients, ArenaMatchesHeap) {
+    ::testing::internal::CaptureStdout();
+    _options.set("spectrum.arena", false);
+    soap::Spectrum spectrum_heap(*_structure, _options);
+    spectrum_heap.compute();
+    spectrum_heap.computePower();
+    spectrum_heap.computePowerGradients();
+    spectrum_heap.computeGlobal();
+    _options.set("spectrum.arena", true);
+    soap::Spectrum spectrum(*_structure, _options);
+    // Results must not depend on leftovers from a previous compute
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.clean();
+    EXPECT_EQ(spectrum.length(), 0);
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.computePowerGradients();
+    spectrum.computeGlobal();
+    ::testing::internal::GetCapturedStdout();
+
+    ASSERT_EQ(spectrum.length(), spectrum_heap.length());
+    std::vector<soap::AtomicSpectrum*> atomics(spectrum.beginAtomic(), spectrum.endAtomic());
+    std::vector<soap::AtomicSpectrum*> atomics_heap(spectrum_heap.beginAtomic(), spectrum_heap.endAtomic());
+    atomics.push_back(spectrum.getGlobal());
+    atomics_heap.push_back(spectrum_heap.getGlobal());
+    for (int i = 0; i < atomics.size(); ++i) {
+        soap::AtomicSpectrum::map_xnkl_t &map_xnkl = atomics[i]->getXnklMap();
+        soap::AtomicSpectrum::map_xnkl_t &map_xnkl_heap = atomics_heap[i]->getXnklMap();
+        ASSERT_EQ(map_xnkl.size(), map_xnkl_heap.size());
+        for (auto it = map_xnkl.begin(); it != map_xnkl.end(); ++it) {
+            soap::PowerExpansion::coeff_t &x = it->second->getCoefficients();
+            soap::PowerExpansion::coeff_t &x_heap = map_xnkl_heap[it->first]->getCoefficients();
+            for (int k = 0; k < x.data().size(); ++k) EXPECT_EQ(x.data()[k], x_heap.data()[k]);
+        }
+        soap::BasisExpansion::coeff_t &q = atomics[i]->getQnlmGeneric()->getCoefficients();
+        soap::BasisExpansion::coeff_t &q_heap = atomics_heap[i]->getQnlmGeneric()->getCoefficients();
+        for (int k = 0; k < q.data().size(); ++k) EXPECT_EQ(q.data()[k], q_heap.data()[k]);
+        soap::AtomicSpectrum::qnlm_grad_t &dq = atomics[i]->getQnlmGrad();
+        soap::AtomicSpectrum::qnlm_grad_t &dq_heap = atomics_heap[i]->getQnlmGrad();
+        ASSERT_EQ(dq.size(), dq_heap.size());
+        for (int k = 0; k < dq.size(); ++k) EXPECT_EQ(dq[k], dq_heap[k]);
+        EXPECT_TRUE(dq.get_allocator()._arena != NULL);
+        EXPECT_TRUE(dq_heap.get_allocator()._arena == NULL);
+        soap::AtomicSpectrum::xnkl_grad_t *dx[2] = { &atomics[i]->getPowerGrad(), &atomics[i]->getPowerGradGenericTensor() };
+        soap::AtomicSpectrum::xnkl_grad_t *dx_heap[2] = { &atomics_heap[i]->getPowerGrad(), &atomics_heap[i]->getPowerGradGenericTensor() };
+        for (int t = 0; t < 2; ++t) {
+            ASSERT_GT(dx[t]->size(), 0);
+            ASSERT_EQ(dx[t]->size(), dx_heap[t]->size());
+            for (int k = 0; k < dx[t]->size(); ++k) EXPECT_EQ((*dx[t])[k], (*dx_heap[t])[k]);
+            EXPECT_TRUE(dx[t]->get_allocator()._arena != NULL);
+        }
+    }
+}
+
+TEST_F(TestAtomicSpectrumGradients, NeighbourListsHoldEachPidOnce) {
+    // Images of a neighbour (small periodic box) and the merged global spectrum share blocks
+    double box[9] = { 3.5,0.,0., 0.,3.5,0., 0.,0.,3.5 };
+    bool pbc[3] = { true, true, true };
+    _structure->setBoundary(box, pbc);
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.computePowerGradients();
+    spectrum.computeGlobal();
+    ::testing::internal::GetCapturedStdout();
+
+    std::vector<soap::AtomicSpectrum*> atomics(spectrum.beginAtomic(), spectrum.endAtomic());
+    atomics.push_back(spectrum.getGlobal());
+    std::set<int> pids_global;
+    for (int i = 0; i < atomics.size(); ++i) {
+        std::vector<int> &pids = atomics[i]->getQnlmGradPids();
+        std::set<int> pids_unique(pids.begin(), pids.end());
+        EXPECT_EQ(pids_unique.size(), pids.size());
+        if (i+1 < atomics.size()) pids_global.insert(pids.begin(), pids.end());
+        else EXPECT_EQ(pids_unique, pids_global);
+        for (int k = 0; k < pids.size(); ++k) EXPECT_EQ(atomics[i]->getPowerGradPidIndex(pids[k]), k);
+        EXPECT_THROW(atomics[i]->getPowerGradPidIndex(0), soap::base::OutOfRange);
+    }
+}
+
+TEST_F(TestAtomicSpectrumGradients, MemoryEstimateMatchesUsage) {
+    // Open boundaries, then a small periodic box with images of the center,
+    // each with the full and the half neighbour list. Gradient blocks are
+    // counted by capacity, which is reserved to the number of neighbours.
+    for (int run = 0; run < 4; ++run) {
+        int periodic = run / 2;
+        _options.set("spectrum.half_neighbour_list", run % 2);
+        if (periodic) {
+            double box[9] = { 3.5,0.,0., 0.,3.5,0., 0.,0.,3.5 };
+            bool pbc[3] = { true, true, true };
+            _structure->setBoundary(box, pbc);
+        }
+        soap::spectrum_memory_t estimate = soap::Spectrum::estimateMemory(*_structure, _options, true, true);
+        ::testing::internal::CaptureStdout();
+        soap::Spectrum spectrum(*_structure, _options);
+        spectrum.compute();
+        spectrum.computePower();
+        spectrum.computePowerGradients();
+        spectrum.computeGlobal();
+        ::testing::internal::GetCapturedStdout();
+        soap::spectrum_memory_t usage = spectrum.getMemoryUsage();
+        EXPECT_GT(usage.density_gradients, 0);
+        EXPECT_GT(usage.power_gradients, 0);
+        EXPECT_EQ(estimate.density, usage.density);
+        EXPECT_EQ(estimate.power, usage.power);
+        EXPECT_EQ(estimate.density_gradients, usage.density_gradients);
+        EXPECT_EQ(estimate.power_gradients, usage.power_gradients);
+        EXPECT_EQ(estimate.total(), usage.total());
+    }
+}
+
+TEST_F(TestAtomicSpectrumGradients, MemoryBudgetFailsFast) {
+    soap::spectrum_memory_t estimate = soap::Spectrum::estimateMemory(*_structure, _options, false, false);
+    double mb = estimate.total()/(1024.*1024.);
+    for (int half = 0; half < 2; ++half) {
+        ::testing::internal::CaptureStdout();
+        _options.set("spectrum.half_neighbour_list", half == 1);
+        _options.set("spectrum.memory_budget", 0.5*mb);
+        soap::Spectrum spectrum(*_structure, _options);
+        EXPECT_THROW(spectrum.compute(), soap::base::MemoryBudgetExceeded);
+        EXPECT_EQ(spectrum.length(), 0);
+        // Densities & power fit, power gradients do not
+        _options.set("spectrum.memory_budget", 1.01*mb);
+        soap::Spectrum spectrum_fit(*_structure, _options);
+        spectrum_fit.compute();
+        spectrum_fit.computePower();
+        EXPECT_LE(spectrum_fit.getMemoryUsage().total(), estimate.total());
+        EXPECT_THROW(spectrum_fit.computePowerGradients(), soap::base::MemoryBudgetExceeded);
+        ::testing::internal::GetCapturedStdout();
+    }
+}
+
+TEST_F(TestAtomicSpectrumGradients, HalfNeighbourListMatchesFull) {
+    // Periodic images of the centers, and one pair with unequal sigmas
+    double box[9] = { 3.5,0.,0., 0.,3.5,0., 0.,0.,3.5 };
+    bool pbc[3] = { true, true, true };
+    _structure->setBoundary(box, pbc);
+    _structure->particles()[3]->setSigma(0.4);
+    ::testing::internal::CaptureStdout();
+    _options.set("spectrum.half_neighbour_list", false);
+    soap::Spectrum spectrum_full(*_structure, _options);
+    spectrum_full.compute();
+    spectrum_full.computePower();
+    spectrum_full.computePowerGradients();
+    _options.set("spectrum.half_neighbour_list", true);
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.computePowerGradients();
+    ::testing::internal::GetCapturedStdout();
+
+    // Inverted pair expansions sum the images of a target in a different
+    // order than the full list: compare per pid, up to rounding.
+    auto expect_blocks_near = [](
+            std::vector<int> &pids, soap::AtomicSpectrum::qnlm_grad_t &data,
+            std::vector<int> &pids_full, soap::AtomicSpectrum::qnlm_grad_t &data_full) {
+        ASSERT_EQ(pids.size(), pids_full.size());
+        ASSERT_EQ(data.size(), data_full.size());
+        if (pids.size() == 0) return;
+        int size_block = data.size()/pids.size();
+        for (int j = 0; j < pids.size(); ++j) {
+            auto it = std::find(pids_full.begin(), pids_full.end(), pids[j]);
+            ASSERT_TRUE(it != pids_full.end()) << "pid " << pids[j];
+            int j_full = it - pids_full.begin();
+            for (int k = 0; k < size_block; ++k) {
+                std::complex<double> v = data[j*size_block+k];
+                std::complex<double> v_full = data_full[j_full*size_block+k];
+                EXPECT_NEAR(v.real(), v_full.real(), 1e-10);
+                EXPECT_NEAR(v.imag(), v_full.imag(), 1e-10);
+            }
+        }
+    };
+    ASSERT_EQ(spectrum.length(), spectrum_full.length());
+    std::vector<soap::AtomicSpectrum*> atomics(spectrum.beginAtomic(), spectrum.endAtomic());
+    std::vector<soap::AtomicSpectrum*> atomics_full(spectrum_full.beginAtomic(), spectrum_full.endAtomic());
+    for (int i = 0; i < atomics.size(); ++i) {
+        soap::AtomicSpectrum::map_xnkl_t &map_xnkl = atomics[i]->getXnklMap();
+        soap::AtomicSpectrum::map_xnkl_t &map_xnkl_full = atomics_full[i]->getXnklMap();
+        ASSERT_EQ(map_xnkl.size(), map_xnkl_full.size());
+        for (auto it = map_xnkl.begin(); it != map_xnkl.end(); ++it) {
+            ASSERT_TRUE(map_xnkl_full.find(it->first) != map_xnkl_full.end());
+            soap::PowerExpansion::coeff_t &x = it->second->getCoefficients();
+            soap::PowerExpansion::coeff_t &x_full = map_xnkl_full[it->first]->getCoefficients();
+            for (int k = 0; k < x.data().size(); ++k) {
+                EXPECT_NEAR(x.data()[k].real(), x_full.data()[k].real(), 1e-10);
+                EXPECT_NEAR(x.data()[k].imag(), x_full.data()[k].imag(), 1e-10);
+            }
+        }
+        soap::BasisExpansion::coeff_t &q = atomics[i]->getQnlmGeneric()->getCoefficients();
+        soap::BasisExpansion::coeff_t &q_full = atomics_full[i]->getQnlmGeneric()->getCoefficients();
+        for (int k = 0; k < q.data().size(); ++k) {
+            EXPECT_NEAR(q.data()[k].real(), q_full.data()[k].real(), 1e-10);
+            EXPECT_NEAR(q.data()[k].imag(), q_full.data()[k].imag(), 1e-10);
+        }
+        expect_blocks_near(
+            atomics[i]->getQnlmGradPids(), atomics[i]->getQnlmGrad(),
+            atomics_full[i]->getQnlmGradPids(), atomics_full[i]->getQnlmGrad());
+        ASSERT_EQ(atomics[i]->getPowerGradTypePairs(), atomics_full[i]->getPowerGradTypePairs());
+        expect_blocks_near(
+            atomics[i]->getPowerGradPids(), atomics[i]->getPowerGrad(),
+            atomics_full[i]->getPowerGradPids(), atomics_full[i]->getPowerGrad());
+        soap::AtomicSpectrum::xnkl_grad_t &v = atomics[i]->getPowerVirial();
+        soap::AtomicSpectrum::xnkl_grad_t &v_full = atomics_full[i]->getPowerVirial();
+        ASSERT_EQ(v.size(), v_full.size());
+        for (int k = 0; k < v.size(); ++k) {
+            EXPECT_NEAR(v[k].real(), v_full[k].real(), 1e-10);
+            EXPECT_NEAR(v[k].imag(), v_full[k].imag(), 1e-10);
+        }
+    }
+}
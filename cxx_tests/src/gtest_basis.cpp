@@ -340,3 +340,111 @@ TEST_F(TestBasisExpansionWithHeavisideCutoff, Gradients) {
 
 
 
+
+class TestBasisCache : public ::testing::Test
+{
+public:
+
+    soap::Options _options;
+
+    virtual void SetUp() {
+        _options.set("radialbasis.mode", "adaptive");
+        _options.set("radialbasis.N", 6);
+        _options.set("angularbasis.L", 4);
+        soap::RadialBasisFactory::registerAll();
+        soap::AngularBasisFactory::registerAll();
+        soap::CutoffFunctionFactory::registerAll();
+        soap::BasisCache::clear();
+    }
+
+    virtual void TearDown() {
+        soap::BasisCache::setDirectory("");
+        soap::BasisCache::clear();
+    }
+};
+
+TEST_F(TestBasisCache, SharedForIdenticalOptions) {
+    soap::Options options_ref = _options;
+    soap::Basis basis_ref(&options_ref);
+    soap::Basis *basis = soap::BasisCache::get(_options);
+    EXPECT_EQ(soap::BasisCache::size(), 1);
+    // Adjusted cutoff written back as by Basis(options)
+    EXPECT_EQ(_options.get<std::string>("radialcutoff.Rc"), options_ref.get<std::string>("radialcutoff.Rc"));
+    EXPECT_EQ(_options.get<std::string>("radialcutoff.Rc_heaviside"), options_ref.get<std::string>("radialcutoff.Rc_heaviside"));
+    EXPECT_DOUBLE_EQ(basis->getCutoff()->getCutoff(), basis_ref.getCutoff()->getCutoff());
+    // Same basis for the adjusted options, and for options that do not affect the basis
+    EXPECT_EQ(soap::BasisCache::get(_options), basis);
+    soap::Options other;
+    other.set("radialbasis.mode", "adaptive");
+    other.set("radialbasis.N", 6);
+    other.set("angularbasis.L", 4);
+    other.set("spectrum.gradients", true);
+    EXPECT_EQ(soap::BasisCache::get(other), basis);
+    EXPECT_EQ(soap::BasisCache::size(), 1);
+    other.set("angularbasis.L", 3);
+    soap::Basis *basis_other = soap::BasisCache::get(other);
+    EXPECT_NE(basis_other, basis);
+    EXPECT_EQ(soap::BasisCache::size(), 2);
+    for (int i = 0; i < 3; ++i) soap::BasisCache::release(basis);
+    soap::BasisCache::release(basis_other);
+}
+
+TEST_F(TestBasisCache, ClearKeepsBasesInUse) {
+    soap::Basis *basis = soap::BasisCache::get(_options);
+    soap::Options other = _options;
+    other.set("angularbasis.L", 3);
+    soap::BasisCache::release(soap::BasisCache::get(other));
+    EXPECT_EQ(soap::BasisCache::clear(), 1);
+    EXPECT_EQ(soap::BasisCache::size(), 1);
+    EXPECT_EQ(soap::BasisCache::get(_options), basis);
+    EXPECT_EQ(basis->getRadBasis()->N(), 6);
+    soap::BasisCache::release(basis);
+    soap::BasisCache::release(basis);
+    EXPECT_EQ(soap::BasisCache::clear(), 0);
+    EXPECT_EQ(soap::BasisCache::size(), 0);
+}
+
+TEST_F(TestBasisCache, KeepsOnlyBasisOptions) {
+    _options.set("spectrum.gradients", true);
+    _options.set("spectrum.memory_budget", 64.);
+    soap::Basis *basis = soap::BasisCache::get(_options);
+    soap::Options *cached = basis->getOptions();
+    EXPECT_EQ(cached->get<int>("radialbasis.N"), 6);
+    EXPECT_EQ(cached->get<std::string>("radialcutoff.Rc"), _options.get<std::string>("radialcutoff.Rc"));
+    // Not the first caller's spectrum options
+    EXPECT_EQ(cached->get<bool>("spectrum.gradients"), false);
+    EXPECT_DOUBLE_EQ(cached->get<double>("spectrum.memory_budget"), 0.);
+    soap::BasisCache::release(basis);
+}
+
+TEST_F(TestBasisCache, OnDiskCache) {
+    char dir_template[] = "/tmp/soap_basis_cache_XXXXXX";
+    std::string dir = mkdtemp(dir_template);
+    soap::BasisCache::setDirectory(dir);
+    soap::Basis *basis_cold = soap::BasisCache::get(_options);
+    std::string file = (boost::format("%1$s/basis-%2$016x.arch")
+        % dir % std::hash<std::string>()(soap::BasisCache::key(*basis_cold->getOptions()))).str();
+    soap::vec d(0.3, -0.4, 0.5);
+    double r = soap::linalg::abs(d);
+    d = d/r;
+    soap::BasisExpansion q_cold(basis_cold);
+    q_cold.computeCoefficients(r, d, 1., 1., 0.5, true);
+    // Loaded from the archive after the in-memory cache is gone
+    soap::BasisCache::release(basis_cold);
+    EXPECT_EQ(soap::BasisCache::clear(), 0);
+    soap::Options options;
+    options.set("radialbasis.mode", "adaptive");
+    options.set("radialbasis.N", 6);
+    options.set("angularbasis.L", 4);
+    soap::Basis *basis_warm = soap::BasisCache::get(options);
+    EXPECT_EQ(options.get<std::string>("radialcutoff.Rc"), _options.get<std::string>("radialcutoff.Rc"));
+    soap::BasisExpansion q_warm(basis_warm);
+    q_warm.computeCoefficients(r, d, 1., 1., 0.5, true);
+    for (int k = 0; k < q_cold.getCoefficients().data().size(); ++k) {
+        EXPECT_EQ(q_warm.getCoefficients().data()[k], q_cold.getCoefficients().data()[k]);
+        EXPECT_EQ(q_warm.getCoefficientsGradZ().data()[k], q_cold.getCoefficientsGradZ().data()[k]);
+    }
+    soap::BasisCache::release(basis_warm);
+    std::remove(file.c_str());
+    std::remove(dir.c_str());
+}
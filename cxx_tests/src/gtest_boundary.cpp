@@ -0,0 +1,96 @@
+#include <cmath>
+#include <sstream>
+#include <vector>
+#include <gtest/gtest.h>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <soap/boundary.hpp>
+#include "gtest_defines.hpp"
+
+class TestBoundary : public ::testing::Test
+{
+public:
+
+    std::vector<soap::vec> _r_i;
+    std::vector<soap::vec> _r_j;
+    virtual void SetUp() {
+        // Deterministic pseudo-random positions, partly outside the cell
+        unsigned int seed = 12345;
+        for (int k = 0; k < 101; ++k) {
+            double xyz[6];
+            for (int d = 0; d < 6; ++d) {
+                seed = 1103515245*seed + 12345;
+                xyz[d] = -5. + 20.*((seed >> 8) % 100000)/100000.;
+            }
+            _r_i.push_back(soap::vec(xyz[0], xyz[1], xyz[2]));
+            _r_j.push_back(soap::vec(xyz[3], xyz[4], xyz[5]));
+        }
+    }
+
+    double bruteForceDistance(soap::Boundary &boundary, const soap::vec &r_i, const soap::vec &r_j) {
+        soap::vec a = boundary.getBox().getCol(0);
+        soap::vec b = boundary.getBox().getCol(1);
+        soap::vec c = boundary.getBox().getCol(2);
+        double d_min = soap::linalg::abs(r_j - r_i);
+        for (int i = -8; i <= 8; ++i) {
+        for (int j = -8; j <= 8; ++j) {
+        for (int k = -8; k <= 8; ++k) {
+            double d = soap::linalg::abs(r_j - r_i + i*a + j*b + k*c);
+            if (d < d_min) d_min = d;
+        }}}
+        return d_min;
+    }
+
+    void compareBatched(soap::Boundary &boundary, bool periodic) {
+        int n = _r_i.size();
+        std::vector<soap::vec> dr_many(n);
+        std::vector<soap::vec> dr_pairs(n);
+        std::vector<double> d2_many(n);
+        std::vector<double> d2_pairs(n);
+        boundary.connectMany(_r_i[0], _r_j.data(), n, dr_many.data(), d2_many.data());
+        boundary.connectPairs(_r_i.data(), _r_j.data(), n, dr_pairs.data(), d2_pairs.data());
+        for (int k = 0; k < n; ++k) {
+            soap::vec dr = boundary.connect(_r_i[0], _r_j[k]);
+            EXPECT_EQ(dr_many[k], dr);
+            EXPECT_DOUBLE_EQ(d2_many[k], dr*dr);
+            dr = boundary.connect(_r_i[k], _r_j[k]);
+            EXPECT_EQ(dr_pairs[k], dr);
+            EXPECT_DOUBLE_EQ(d2_pairs[k], dr*dr);
+            double d_ref = (periodic) ?
+                this->bruteForceDistance(boundary, _r_i[k], _r_j[k]) : soap::linalg::abs(_r_j[k] - _r_i[k]);
+            EXPECT_NEAR(std::sqrt(d2_pairs[k]), d_ref, 1e-10);
+        }
+    }
+};
+
+TEST_F(TestBoundary, Open) {
+    soap::BoundaryOpen boundary;
+    this->compareBatched(boundary, false);
+}
+
+TEST_F(TestBoundary, Orthorhombic) {
+    soap::BoundaryOrthorhombic boundary(soap::matrix(
+        soap::vec(4., 0., 0.), soap::vec(0., 5., 0.), soap::vec(0., 0., 6.)));
+    this->compareBatched(boundary, true);
+}
+
+TEST_F(TestBoundary, Triclinic) {
+    soap::BoundaryTriclinic boundary(soap::matrix(
+        soap::vec(5., 0., 0.), soap::vec(1.5, 4.5, 0.), soap::vec(-1., 1., 5.5)));
+    this->compareBatched(boundary, true);
+
+    // The inverse box is restored on load
+    std::stringstream buffer;
+    {
+        boost::archive::binary_oarchive arch(buffer);
+        arch << boundary;
+    }
+    soap::BoundaryTriclinic loaded;
+    {
+        boost::archive::binary_iarchive arch(buffer);
+        arch >> loaded;
+    }
+    for (int k = 0; k < _r_i.size(); ++k) {
+        EXPECT_EQ(loaded.connect(_r_i[k], _r_j[k]), boundary.connect(_r_i[k], _r_j[k]));
+    }
+}
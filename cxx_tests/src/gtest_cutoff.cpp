@@ -147,6 +147,28 @@ TEST_F(TestCutoffShiftedCosine, GradientWeight) {
     */
 }
 
+TEST_F(TestCutoffShiftedCosine, BatchMatchesScalar) {
+    std::vector<double> d2;
+    for (int k = 0; k < 50; ++k) {
+        double r = 0.1*k;
+        d2.push_back(r*r);
+    }
+    int n = d2.size();
+    std::vector<int> idx(n);
+    std::vector<double> r(n), w(n), dw_dr(n);
+    int m = _cutoff->computeWeights(n, d2.data(), idx.data(), r.data(), w.data(), dw_dr.data());
+    // r = 0, 0.1, ..., 4.0 (inclusive) are within the cutoff
+    ASSERT_EQ(m, 41);
+    soap::vec d(0.,1.,0.);
+    for (int j = 0; j < m; ++j) {
+        EXPECT_EQ(idx[j], j);
+        EXPECT_DOUBLE_EQ(r[j], std::sqrt(d2[j]));
+        EXPECT_TRUE(_cutoff->isWithinCutoff(r[j]));
+        EXPECT_DOUBLE_EQ(w[j], _cutoff->calculateWeight(r[j]));
+        EXPECT_DOUBLE_EQ(dw_dr[j], _cutoff->calculateGradientWeight(r[j], d).getY());
+    }
+}
+
 class TestCutoffHeaviside : public ::testing::Test
 {
 public:
@@ -0,0 +1,64 @@
+#ifndef _SOAP_GTEST_FIXTURES_HPP
+#define _SOAP_GTEST_FIXTURES_HPP
+
+#include <string>
+#include <tuple>
+#include <vector>
+#include <gtest/gtest.h>
+#include <soap/spectrum.hpp>
+#include <soap/options.hpp>
+
+// Small open C/O/H/H molecule with a compact basis (N=5, L=3, Rc=4),
+// shared by the spectrum-level tests. Derived fixtures adjust _options or
+// _structure in their SetUp after calling this one.
+class TestSmallMolecule : public ::testing::Test
+{
+public:
+
+    soap::Options _options;
+    soap::Structure *_structure;
+
+    virtual void SetUp() {
+
+	    _options.set("radialbasis.type", "gaussian");
+	    _options.set("radialbasis.mode", "equispaced");
+	    _options.set("radialbasis.N", 5);
+	    _options.set("radialbasis.sigma", 0.5);
+	    _options.set("radialbasis.integration_steps", 15);
+	    _options.set("radialcutoff.type", "shifted-cosine");
+	    _options.set("radialcutoff.Rc", 4.);
+	    _options.set("radialcutoff.Rc_width", 0.5);
+	    _options.set("radialcutoff.center_weight", 1.);
+	    _options.set("angularbasis.type", "spherical-harmonic");
+	    _options.set("angularbasis.L", 3);
+	    _options.set("spectrum.2l1_norm", true);
+
+        soap::RadialBasisFactory::registerAll();
+        soap::AngularBasisFactory::registerAll();
+        soap::CutoffFunctionFactory::registerAll();
+
+        typedef std::tuple<std::string, double, double, double> txyz_t;
+        std::vector<txyz_t> txyz_list = {
+            txyz_t{"C", 0., 0., 0.},
+            txyz_t{"O", 1.2, 0.1, -0.2},
+            txyz_t{"H", -0.6, 0.9, 0.3},
+            txyz_t{"H", -0.5, -0.9, 0.4}
+        };
+        _structure = new soap::Structure("test");
+        soap::Segment &segment = _structure->addSegment();
+        for (auto it = txyz_list.begin(); it != txyz_list.end(); ++it) {
+            soap::Particle &particle = _structure->addParticle(segment);
+            particle.setType(std::get<0>(*it));
+            particle.setPos(std::get<1>(*it), std::get<2>(*it), std::get<3>(*it));
+            particle.setWeight(1.);
+            particle.setSigma(0.5);
+        }
+    }
+
+    virtual void TearDown() {
+        delete _structure;
+        _structure = NULL;
+    }
+};
+
+#endif
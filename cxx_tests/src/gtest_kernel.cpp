@@ -0,0 +1,83 @@
+#include <iostream>
+#include <vector>
+#include <gtest/gtest.h>
+#include <soap/kernel.hpp>
+#include <soap/spectrum.hpp>
+#include <soap/options.hpp>
+#include "gtest_defines.hpp"
+#include "gtest_fixtures.hpp"
+
+class TestKernelDotQnlm : public TestSmallMolecule
+{
+public:
+
+    virtual void SetUp() {
+        TestSmallMolecule::SetUp();
+        _options.set("radialbasis.N", 6);
+        _options.set("angularbasis.L", 4);
+    }
+};
+
+TEST_F(TestKernelDotQnlm, MatchesPowerSpectrumDot) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+    spectrum.computePower();
+
+    soap::Options kernel_options;
+    kernel_options.set("kernel.qnlm.type", "specific");
+    kernel_options.set("kernel.qnlm.normalize", false);
+    kernel_options.set("kernel.qnlm.threads", 2);
+    soap::KernelDotQnlm kernel(kernel_options);
+    soap::KernelDotQnlm::kernel_t kmat;
+    kernel.compute(spectrum, spectrum, kmat);
+    ::testing::internal::GetCapturedStdout();
+
+    int i = 0;
+    for (auto a = spectrum.beginAtomic(); a != spectrum.endAtomic(); ++a, ++i) {
+        int j = 0;
+        for (auto b = spectrum.beginAtomic(); b != spectrum.endAtomic(); ++b, ++j) {
+            // Reference: explicit dot product over all shared type pairs
+            double k_ref = 0.;
+            soap::AtomicSpectrum::map_xnkl_t &map_a = (*a)->getXnklMap();
+            soap::AtomicSpectrum::map_xnkl_t &map_b = (*b)->getXnklMap();
+            for (auto it = map_a.begin(); it != map_a.end(); ++it) {
+                auto jt = map_b.find(it->first);
+                if (jt == map_b.end()) continue;
+                soap::PowerExpansion::coeff_t &xa = it->second->getCoefficients();
+                soap::PowerExpansion::coeff_t &xb = jt->second->getCoefficients();
+                for (int nk = 0; nk < xa.size1(); ++nk) {
+                    for (int l = 0; l < xa.size2(); ++l) {
+                        k_ref += xa(nk,l).real()*xb(nk,l).real();
+                    }
+                }
+            }
+            EXPECT_NEAR_RELATIVE(kmat(i,j), k_ref, 1e-10);
+        }
+    }
+}
+
+TEST_F(TestKernelDotQnlm, SinglePrecisionMatchesDouble) {
+    ::testing::internal::CaptureStdout();
+    soap::Spectrum spectrum(*_structure, _options);
+    spectrum.compute();
+
+    soap::Options kernel_options;
+    kernel_options.set("kernel.qnlm.type", "specific");
+    kernel_options.set("kernel.qnlm.normalize", true);
+    soap::KernelDotQnlm kernel_double(kernel_options);
+    soap::KernelDotQnlm::kernel_t kmat_double;
+    kernel_double.compute(spectrum, spectrum, kmat_double);
+
+    kernel_options.set("kernel.qnlm.precision", "single");
+    soap::KernelDotQnlm kernel_single(kernel_options);
+    soap::KernelDotQnlm::kernel_t kmat_single;
+    kernel_single.compute(spectrum, spectrum, kmat_single);
+    ::testing::internal::GetCapturedStdout();
+
+    for (int i = 0; i < kmat_double.size1(); ++i) {
+        for (int j = 0; j < kmat_double.size2(); ++j) {
+            EXPECT_NEAR(kmat_single(i,j), kmat_double(i,j), 1e-5);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <soap/globals.hpp>
+
+static int n_evaluated = 0;
+
+static int evaluate() {
+    return ++n_evaluated;
+}
+
+TEST(TestLogger, DisabledLevelsAreNotFormatted) {
+    n_evaluated = 0;
+    ::testing::internal::CaptureStdout();
+    // Compiled out (SOAP_LOG_LEVEL_COMPILE = logINFO)
+    GLOG_DEBUG() << evaluate() << std::endl;
+    // Above the runtime level
+    soap::GLOG.setReportLevel(soap::logWARNING);
+    GLOG_AT(soap::logINFO) << evaluate() << std::endl;
+    soap::GLOG.setReportLevel(soap::logINFO);
+    GLOG_AT(soap::logINFO) << evaluate() << std::endl;
+    std::string output = ::testing::internal::GetCapturedStdout();
+    EXPECT_EQ(n_evaluated, 1);
+    EXPECT_EQ(output, "1\n");
+}
+
+TEST(TestLogger, ThreadMessagesDoNotInterleave) {
+    int n_threads = 4;
+    int n_lines = 200;
+    ::testing::internal::CaptureStdout();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+        threads.push_back(std::thread([t, n_lines]() {
+            for (int i = 0; i < n_lines; ++i) {
+                GLOG_AT(soap::logINFO) << "thread " << t << " line " << i << std::flush;
+                GLOG_AT(soap::logINFO) << " done" << std::endl;
+            }
+        }));
+    }
+    for (auto &th : threads) th.join();
+    std::string output = ::testing::internal::GetCapturedStdout();
+
+    std::istringstream lines(output);
+    std::string line;
+    std::vector<int> count(n_threads, 0);
+    while (std::getline(lines, line)) {
+        std::istringstream words(line);
+        std::string w_thread, w_line, w_done;
+        int t = -1;
+        int i = -1;
+        words >> w_thread >> t >> w_line >> i >> w_done;
+        ASSERT_EQ(w_thread, "thread") << line;
+        ASSERT_EQ(w_done, "done") << line;
+        ASSERT_TRUE(t >= 0 && t < n_threads) << line;
+        EXPECT_EQ(i, count[t]) << line;
+        count[t] += 1;
+    }
+    for (int t = 0; t < n_threads; ++t) EXPECT_EQ(count[t], n_lines);
+}
+
+TEST(TestLogger, LegacyCallsFromThreads) {
+    int n_threads = 4;
+    int n_lines = 200;
+    ::testing::internal::CaptureStdout();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+        threads.push_back(std::thread([t, n_lines]() {
+            for (int i = 0; i < n_lines; ++i) {
+                soap::GLOG() << "thread " << t << " line " << i << std::endl;
+                soap::GLOG(soap::logDEBUG) << "debug " << t << std::endl;
+            }
+        }));
+    }
+    for (auto &th : threads) th.join();
+    std::string output = ::testing::internal::GetCapturedStdout();
+    // Disabled levels print nothing, and the shared stream keeps its state
+    EXPECT_TRUE(soap::GLOG.good());
+    std::istringstream lines(output);
+    std::string line;
+    int n_read = 0;
+    while (std::getline(lines, line)) {
+        EXPECT_EQ(line.compare(0, 7, "thread "), 0) << line;
+        ++n_read;
+    }
+    EXPECT_EQ(n_read, n_threads*n_lines);
+}
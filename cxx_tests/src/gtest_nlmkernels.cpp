@@ -0,0 +1,83 @@
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <gtest/gtest.h>
+#include <soap/nlmkernels.hpp>
+
+typedef std::complex<double> cmplx_t;
+
+static void fill(std::vector<double> &v, unsigned int seed) {
+    for (int i = 0; i < v.size(); ++i) {
+        seed = 1103515245*seed + 12345;
+        v[i] = -1. + 2.*((seed >> 8) % 100000)/100000.;
+    }
+}
+
+static void fill(std::vector<cmplx_t> &v, unsigned int seed) {
+    std::vector<double> re(v.size()), im(v.size());
+    fill(re, seed);
+    fill(im, seed+1);
+    for (int i = 0; i < v.size(); ++i) v[i] = cmplx_t(re[i], im[i]);
+}
+
+TEST(TestNlmKernels, Dispatch) {
+    EXPECT_EQ(soap::nlm_kernels_resolve(9, 6)->N, 9);
+    EXPECT_EQ(soap::nlm_kernels_resolve(12, 9)->L, 9);
+    EXPECT_EQ(soap::nlm_kernels_resolve(7, 5), soap::nlm_kernels_generic());
+}
+
+TEST(TestNlmKernels, SpecializedMatchesGeneric) {
+    int N = 9;
+    int L = 6;
+    int LM = (L+1)*(L+1);
+    const soap::nlm_kernels_t *spec = soap::nlm_kernels_resolve(N, L);
+    const soap::nlm_kernels_t *gen = soap::nlm_kernels_generic();
+    ASSERT_NE(spec, gen);
+
+    std::vector<double> radial(N*(L+1)), dradial(N*(L+1)), prefac(L+1);
+    std::vector<cmplx_t> angular(LM), dangular(LM);
+    fill(radial, 1);
+    fill(dradial, 2);
+    fill(angular, 3);
+    fill(dangular, 5);
+    for (int l = 0; l <= L; ++l) prefac[l] = 1./std::sqrt(2.*l+1);
+
+    // Merge
+    std::vector<cmplx_t> q_spec(N*LM), q_gen(N*LM), dq_spec(N*LM), dq_gen(N*LM);
+    spec->merge(N, L, radial.data(), angular.data(), 0.7, q_spec.data());
+    gen->merge(N, L, radial.data(), angular.data(), 0.7, q_gen.data());
+    spec->merge_grad(N, L, radial.data(), dradial.data(), angular.data(), dangular.data(), 0.9, 0.7, -0.2, dq_spec.data());
+    gen->merge_grad(N, L, radial.data(), dradial.data(), angular.data(), dangular.data(), 0.9, 0.7, -0.2, dq_gen.data());
+    for (int n = 0; n < N; ++n) {
+        for (int l = 0; l <= L; ++l) {
+            for (int m = -l; m <= l; ++m) {
+                int i = n*LM+l*l+l+m;
+                EXPECT_EQ(q_spec[i], q_gen[i]);
+                EXPECT_EQ(dq_spec[i], dq_gen[i]);
+                cmplx_t ref = radial[n*(L+1)+l]*angular[l*l+l+m]*0.7;
+                EXPECT_NEAR(std::abs(q_gen[i]-ref), 0., 1e-14);
+            }
+        }
+    }
+
+    // Power
+    std::vector<cmplx_t> x_spec(N*N*(L+1)), x_gen(N*N*(L+1));
+    spec->power(N, L, q_gen.data(), dq_gen.data(), prefac.data(), 2., false, x_spec.data());
+    gen->power(N, L, q_gen.data(), dq_gen.data(), prefac.data(), 2., false, x_gen.data());
+    spec->power(N, L, dq_gen.data(), q_gen.data(), prefac.data(), 1., true, x_spec.data());
+    gen->power(N, L, dq_gen.data(), q_gen.data(), prefac.data(), 1., true, x_gen.data());
+    for (int n = 0; n < N; ++n) {
+        for (int k = 0; k < N; ++k) {
+            for (int l = 0; l <= L; ++l) {
+                int i = (n*N+k)*(L+1)+l;
+                EXPECT_EQ(x_spec[i], x_gen[i]);
+                cmplx_t ref = 0.;
+                for (int m = -l; m <= l; ++m) {
+                    ref += 2.*q_gen[n*LM+l*l+l+m]*std::conj(dq_gen[k*LM+l*l+l+m])
+                         + dq_gen[n*LM+l*l+l+m]*std::conj(q_gen[k*LM+l*l+l+m]);
+                }
+                EXPECT_NEAR(std::abs(x_gen[i]-prefac[l]*ref), 0., 1e-12);
+            }
+        }
+    }
+}
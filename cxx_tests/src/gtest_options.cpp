@@ -58,3 +58,38 @@ TEST_F(TestOptions, InterpretBoolean) {
     }
 }
 
+TEST_F(TestOptions, ResolveConfig) {
+    _options.set("radialbasis.mode", "equispaced");
+    _options.set("radialbasis.N", 5);
+    _options.set("angularbasis.L", 3);
+    _options.set("spectrum.gradients", true);
+    soap::SpectrumConfig config;
+    config.resolve(_options);
+    EXPECT_EQ(config.N, 5);
+    EXPECT_EQ(config.L, 3);
+    EXPECT_EQ(config.integration_steps, 15);
+    EXPECT_DOUBLE_EQ(config.Rc, 4.);
+    EXPECT_DOUBLE_EQ(config.Rc_width, 0.5);
+    EXPECT_DOUBLE_EQ(config.sigma, 0.5);
+    EXPECT_EQ(config.radialbasis_type, "gaussian");
+    EXPECT_EQ(config.cutoff_type, "shifted-cosine");
+    EXPECT_EQ(config.gradients, true);
+    EXPECT_EQ(config.sqrt_2l1_norm, true);
+    EXPECT_EQ(config.arena, true);
+    EXPECT_DOUBLE_EQ(config.memory_budget, 0.);
+    EXPECT_EQ(config.basis_cache, false);
+    EXPECT_EQ(config.exclude_centers, false);
+    EXPECT_EQ(config.exclude_targets, false);
+
+    // Snapshot is taken once the basis has been configured
+    soap::RadialBasisFactory::registerAll();
+    soap::AngularBasisFactory::registerAll();
+    soap::CutoffFunctionFactory::registerAll();
+    ::testing::internal::CaptureStdout();
+    soap::Basis basis(&_options);
+    ::testing::internal::GetCapturedStdout();
+    EXPECT_EQ(basis.getConfig().N, 5);
+    EXPECT_EQ(basis.getConfig().L, 3);
+    EXPECT_DOUBLE_EQ(basis.getConfig().Rc, _options.get<double>("radialcutoff.Rc"));
+    EXPECT_EQ(basis.getConfig().gradients, true);
+}
@@ -0,0 +1,79 @@
+#include <map>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <soap/base/profile.hpp>
+#include <soap/spectrum.hpp>
+#include <soap/options.hpp>
+
+static std::map<std::string, soap::base::profile_record_t> profile_by_name() {
+    std::map<std::string, soap::base::profile_record_t> records;
+    std::vector<soap::base::profile_record_t> report = soap::base::Profiler::report();
+    for (auto it = report.begin(); it != report.end(); ++it) records[it->name] = *it;
+    return records;
+}
+
+TEST(TestProfile, TimersAndCountersAggregateAcrossThreads) {
+    soap::base::ProfileEntry &timer = soap::base::Profiler::entry("test.timer");
+    soap::base::ProfileEntry &counter = soap::base::Profiler::entry("test.counter");
+    EXPECT_EQ(&soap::base::Profiler::entry("test.timer"), &timer);
+    soap::base::Profiler::reset();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread([&timer, &counter]() {
+            for (int i = 0; i < 1000; ++i) {
+                soap::base::ScopedTimer scoped(timer);
+                counter.add(3);
+            }
+        }));
+    }
+    for (auto it = threads.begin(); it != threads.end(); ++it) it->join();
+    auto records = profile_by_name();
+    EXPECT_EQ(records["test.timer"].calls, 4000);
+    EXPECT_GT(records["test.timer"].time, 0.);
+    EXPECT_EQ(records["test.counter"].count, 12000);
+    soap::base::Profiler::reset();
+    records = profile_by_name();
+    EXPECT_EQ(records["test.timer"].calls, 0);
+    EXPECT_EQ(records["test.counter"].count, 0);
+}
+
+TEST(TestProfile, SpectrumPhases) {
+    soap::RadialBasisFactory::registerAll();
+    soap::AngularBasisFactory::registerAll();
+    soap::CutoffFunctionFactory::registerAll();
+    soap::Options options;
+    options.set("radialbasis.N", 4);
+    options.set("angularbasis.L", 3);
+    options.set("spectrum.gradients", true);
+    soap::Structure structure("test");
+    soap::Segment &segment = structure.addSegment();
+    double xyz[4][3] = { {0.,0.,0.}, {1.2,0.1,-0.2}, {-0.6,0.9,0.3}, {-0.5,-0.9,0.4} };
+    for (int i = 0; i < 4; ++i) {
+        soap::Particle &particle = structure.addParticle(segment);
+        particle.setType((i == 0) ? "C" : "H");
+        particle.setPos(xyz[i][0], xyz[i][1], xyz[i][2]);
+        particle.setWeight(1.);
+        particle.setSigma(0.5);
+    }
+    soap::base::Profiler::reset();
+    soap::Spectrum spectrum(structure, options);
+    spectrum.compute();
+    spectrum.computePower();
+    spectrum.computePowerGradients();
+    auto records = profile_by_name();
+    if (!soap::base::Profiler::isEnabled()) {
+        EXPECT_EQ(records["spectrum.compute"].calls, 0);
+        return;
+    }
+    EXPECT_EQ(records["spectrum.compute"].calls, 1);
+    EXPECT_EQ(records["spectrum.neighbours"].calls, 4);
+    EXPECT_EQ(records["spectrum.power"].calls, 1);
+    EXPECT_EQ(records["spectrum.power_gradients"].calls, 1);
+    // All pairs within the cutoff, including the centers themselves
+    EXPECT_EQ(records["spectrum.pairs_accepted"].count, 16);
+    EXPECT_GE(records["spectrum.pairs_visited"].count, 16);
+    EXPECT_EQ(records["basis.expansions"].count, 16);
+    EXPECT_EQ(records["basis.expansions_with_gradients"].count, 12);
+    EXPECT_GE(records["spectrum.compute"].time, records["spectrum.expansions"].time);
+}
@@ -0,0 +1,16 @@
+#include <gtest/gtest.h>
+#include <boost/python/numpy.hpp>
+
+// Options and structures hold python objects, so the interpreter has to be
+// up before the first fixture is constructed
+class PythonEnvironment : public ::testing::Environment
+{
+public:
+    virtual void SetUp() {
+        Py_Initialize();
+        boost::python::numpy::initialize();
+    }
+};
+
+static ::testing::Environment *const python_environment =
+    ::testing::AddGlobalTestEnvironment(new PythonEnvironment());
@@ -0,0 +1,139 @@
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include <soap/base/queue.hpp>
+
+TEST(TestBoundedQueue, PushBlocksAtCapacity) {
+    soap::base::BoundedQueue<int> queue(2);
+    ASSERT_TRUE(queue.push(0));
+    ASSERT_TRUE(queue.push(1));
+    std::atomic<bool> pushed(false);
+    std::thread producer([&]() {
+        queue.push(2);
+        pushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(pushed);
+    int item = -1;
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 0);
+    producer.join();
+    EXPECT_TRUE(pushed);
+    // FIFO
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 1);
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 2);
+}
+
+TEST(TestBoundedQueue, PopBlocksWhileEmpty) {
+    soap::base::BoundedQueue<int> queue(2);
+    std::atomic<int> popped(-1);
+    std::thread consumer([&]() {
+        int item = -1;
+        if (queue.pop(item)) popped = item;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(popped, -1);
+    queue.push(7);
+    consumer.join();
+    EXPECT_EQ(popped, 7);
+}
+
+TEST(TestBoundedQueue, CloseDrainsAndRefuses) {
+    soap::base::BoundedQueue<int> queue(4);
+    queue.push(0);
+    queue.push(1);
+    queue.close();
+    EXPECT_FALSE(queue.push(2));
+    int item = -1;
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 0);
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 1);
+    EXPECT_FALSE(queue.pop(item));
+}
+
+TEST(TestBoundedQueue, CloseWakesBlockedThreads) {
+    soap::base::BoundedQueue<int> full(1);
+    soap::base::BoundedQueue<int> empty(1);
+    full.push(0);
+    bool pushed = true;
+    bool popped = true;
+    std::thread producer([&]() { pushed = full.push(1); });
+    std::thread consumer([&]() { int item; popped = empty.pop(item); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    full.close();
+    empty.close();
+    producer.join();
+    consumer.join();
+    EXPECT_FALSE(pushed);
+    EXPECT_FALSE(popped);
+}
+
+struct counted_t
+{
+    counted_t(int i, std::atomic<int> &alive) : value(i), _alive(alive) { ++_alive; }
+   ~counted_t() { --_alive; }
+    int value;
+    std::atomic<int> &_alive;
+};
+
+TEST(TestPipeline, ConsumesInOrder) {
+    std::atomic<int> alive(0);
+    std::vector<int> consumed;
+    soap::base::run_pipeline<counted_t>(100, 4,
+        [&](int i) { return new counted_t(i, alive); },
+        [&](counted_t &item, int w) {
+            // Uneven work, so that items finish out of order
+            std::this_thread::sleep_for(std::chrono::microseconds(100*((item.value*7) % 5)));
+            item.value *= 2;
+        },
+        [&](counted_t &item) { consumed.push_back(item.value); });
+    ASSERT_EQ(consumed.size(), 100);
+    for (int i = 0; i < 100; ++i) EXPECT_EQ(consumed[i], 2*i);
+    EXPECT_EQ(alive, 0);
+}
+
+TEST(TestPipeline, PropagatesWorkerException) {
+    std::atomic<int> alive(0);
+    std::atomic<int> produced(0);
+    std::vector<int> consumed;
+    EXPECT_THROW(soap::base::run_pipeline<counted_t>(1000, 3,
+        [&](int i) { ++produced; return new counted_t(i, alive); },
+        [&](counted_t &item, int w) {
+            if (item.value == 10 || item.value == 20) throw std::runtime_error("worker");
+        },
+        [&](counted_t &item) { consumed.push_back(item.value); }), std::runtime_error);
+    // Everything before the first failure written, production stopped, nothing leaked
+    ASSERT_EQ(consumed.size(), 10);
+    for (int i = 0; i < 10; ++i) EXPECT_EQ(consumed[i], i);
+    EXPECT_LT(produced, 1000);
+    EXPECT_EQ(alive, 0);
+}
+
+TEST(TestPipeline, PropagatesProducerAndConsumerExceptions) {
+    std::atomic<int> alive(0);
+    int n_consumed = 0;
+    EXPECT_THROW(soap::base::run_pipeline<counted_t>(50, 2,
+        [&](int i) {
+            if (i == 5) throw std::invalid_argument("producer");
+            return new counted_t(i, alive);
+        },
+        [&](counted_t &item, int w) { ; },
+        [&](counted_t &item) { ++n_consumed; }), std::invalid_argument);
+    EXPECT_EQ(n_consumed, 5);
+    n_consumed = 0;
+    EXPECT_THROW(soap::base::run_pipeline<counted_t>(50, 2,
+        [&](int i) { return new counted_t(i, alive); },
+        [&](counted_t &item, int w) { ; },
+        [&](counted_t &item) {
+            if (item.value == 3) throw std::logic_error("consumer");
+            ++n_consumed;
+        }), std::logic_error);
+    EXPECT_EQ(n_consumed, 3);
+    EXPECT_EQ(alive, 0);
+}
@@ -0,0 +1,208 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <gtest/gtest.h>
+#include <boost/python/numpy.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/vector.hpp>
+#include <soap/structure.hpp>
+#include "gtest_defines.hpp"
+
+class TestStructure : public ::testing::Test
+{
+public:
+
+    soap::Structure *_structure;
+    virtual void SetUp() {
+        _structure = new soap::Structure("gtest");
+        soap::Segment &seg = _structure->addSegment();
+        for (int i = 0; i < 5; ++i) {
+            soap::Particle &part = _structure->addParticle(seg);
+            part.setPos(i, 2.*i, 3.*i);
+            part.setType((i % 2) ? "H" : "C");
+            part.setTypeId(i % 2);
+            part.setWeight(1.+i);
+            part.setSigma(0.5);
+        }
+    }
+
+    virtual void TearDown() {
+        delete _structure;
+    }
+};
+
+TEST_F(TestStructure, ParticleArrays) {
+    // Particles are views onto contiguous arrays
+    double *xyz = reinterpret_cast<double*>(_structure->getPositions());
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_DOUBLE_EQ(xyz[3*i+0], i);
+        EXPECT_DOUBLE_EQ(xyz[3*i+1], 2.*i);
+        EXPECT_DOUBLE_EQ(xyz[3*i+2], 3.*i);
+        EXPECT_EQ(_structure->getTypeIds()[i], i % 2);
+        EXPECT_DOUBLE_EQ(_structure->getWeights()[i], 1.+i);
+        EXPECT_DOUBLE_EQ(_structure->getSigmas()[i], 0.5);
+    }
+    // Bulk update is seen by the particles
+    std::vector<double> update(15);
+    for (int i = 0; i < 15; ++i) update[i] = -1.*i;
+    _structure->setPositions(update.data());
+    for (int i = 0; i < 5; ++i) {
+        soap::vec &pos = _structure->getParticle(i+1)->getPos();
+        EXPECT_DOUBLE_EQ(pos.x(), -3.*i);
+        EXPECT_DOUBLE_EQ(pos.y(), -3.*i-1.);
+        EXPECT_DOUBLE_EQ(pos.z(), -3.*i-2.);
+    }
+}
+
+TEST_F(TestStructure, ModelAndSerialize) {
+    soap::Structure copy("copy");
+    copy.model(*_structure);
+    EXPECT_NE(copy.getPositions(), _structure->getPositions());
+
+    std::stringstream buffer;
+    {
+        boost::archive::binary_oarchive arch(buffer);
+        arch << copy;
+    }
+    soap::Structure loaded;
+    {
+        boost::archive::binary_iarchive arch(buffer);
+        arch >> loaded;
+    }
+    ASSERT_EQ(loaded.getNumberOfParticles(), 5);
+    for (int i = 0; i < 5; ++i) {
+        soap::Particle *part = loaded.getParticle(i+1);
+        EXPECT_EQ(&part->getPos(), loaded.getPositions()+i);
+        EXPECT_DOUBLE_EQ(part->getPos().y(), 2.*i);
+        EXPECT_EQ(part->getTypeId(), i % 2);
+        EXPECT_DOUBLE_EQ(part->getWeight(), 1.+i);
+        EXPECT_EQ(part->getType(), (i % 2) ? "H" : "C");
+    }
+}
+
+TEST(TestStructureBulk, AddParticles) {
+    double xyz[9] = { 0.,0.,0., 1.,0.,0., 0.,1.,0. };
+    int z[3] = { 8, 1, 1 };
+    double weights[3] = { 2., 1., 1. };
+    double box[9] = { 5.,0.,0., 0.,5.,0., 0.,0.,5. };
+    bool pbc[3] = { true, true, true };
+    soap::Structure structure("water");
+    structure.setBoundary(box, pbc);
+    structure.addParticles(3, xyz, NULL, z, weights, NULL);
+    ASSERT_EQ(structure.getNumberOfParticles(), 3);
+    EXPECT_EQ(structure.getParticle(1)->getType(), "O");
+    EXPECT_EQ(structure.getParticle(2)->getType(), "H");
+    EXPECT_EQ(structure.getParticle(2)->getTypeId(), 1);
+    EXPECT_NEAR(structure.getParticle(1)->getMass(), 15.9994, 1e-6);
+    EXPECT_DOUBLE_EQ(structure.getParticle(1)->getWeight(), 2.);
+    EXPECT_DOUBLE_EQ(structure.getParticle(3)->getSigma(), 0.5);
+    EXPECT_DOUBLE_EQ(structure.getParticle(2)->getPos().x(), 1.);
+    EXPECT_DOUBLE_EQ(structure.getBoundary()->getBox().get(1,1), 5.);
+
+    std::string types[2] = { "C", "X" };
+    bool open[3] = { false, false, false };
+    structure.setBoundary(box, open);
+    structure.addParticles(2, xyz, types, NULL, NULL, NULL);
+    EXPECT_EQ(structure.getNumberOfParticles(), 5);
+    EXPECT_EQ(structure.getParticle(4)->getTypeId(), 6);
+    EXPECT_EQ(structure.getParticle(5)->getType(), "X");
+    EXPECT_EQ(structure.getParticle(5)->getTypeId(), 0);
+    EXPECT_DOUBLE_EQ(structure.getBoundary()->getBox().get(1,1), 0.);
+    bool partial[3] = { true, false, true };
+    EXPECT_THROW(structure.setBoundary(box, partial), soap::base::NotImplemented);
+}
+
+class TestStructureArrays : public ::testing::Test
+{
+public:
+
+    // Two structures packed as arrays: water (periodic box) and methane (open)
+    boost::python::list _labels;
+    boost::python::object _positions;
+    boost::python::object _species;
+    boost::python::object _boxes;
+    boost::python::object _pbc;
+
+    virtual void SetUp() {
+        namespace np = boost::python::numpy;
+        Py_Initialize();
+        np::initialize();
+        _labels.append("water");
+        _labels.append("methane");
+        double xyz[24] = {
+            0.,0.,0., 0.96,0.,0., -0.24,0.93,0.,
+            0.,0.,0., 0.63,0.63,0.63, -0.63,-0.63,0.63, -0.63,0.63,-0.63, 0.63,-0.63,-0.63 };
+        np::ndarray positions = np::empty(boost::python::make_tuple(8, 3), np::dtype::get_builtin<double>());
+        std::copy(xyz, xyz+24, reinterpret_cast<double*>(positions.get_data()));
+        _positions = positions;
+        long z[8] = { 8, 1, 1, 6, 1, 1, 1, 1 }; // <- int64, as from ASE
+        np::ndarray species = np::empty(boost::python::make_tuple(8), np::dtype::get_builtin<long>());
+        std::copy(z, z+8, reinterpret_cast<long*>(species.get_data()));
+        _species = species;
+        np::ndarray boxes = np::zeros(boost::python::make_tuple(2, 3, 3), np::dtype::get_builtin<double>());
+        double *box = reinterpret_cast<double*>(boxes.get_data());
+        box[0] = 5.; box[4] = 6.; box[8] = 7.;
+        _boxes = boxes;
+        np::ndarray pbc = np::zeros(boost::python::make_tuple(2, 3), np::dtype::get_builtin<bool>());
+        bool *periodic = reinterpret_cast<bool*>(pbc.get_data());
+        periodic[0] = periodic[1] = periodic[2] = true;
+        _pbc = pbc;
+    }
+
+    std::vector<soap::Structure*> create(boost::python::object labels, boost::python::object offsets) {
+        boost::python::object none;
+        return soap::Structure::createFromArraysPacked(labels, _positions, _species, offsets,
+            none, none, _boxes, _pbc, none);
+    }
+};
+
+TEST_F(TestStructureArrays, Packed) {
+    boost::python::list offsets;
+    offsets.append(0);
+    offsets.append(3);
+    offsets.append(8);
+    std::vector<soap::Structure*> structures = this->create(_labels, offsets);
+    ASSERT_EQ(structures.size(), 2);
+    soap::Structure *water = structures[0];
+    soap::Structure *methane = structures[1];
+    EXPECT_EQ(water->getLabel(), "water");
+    EXPECT_EQ(methane->getLabel(), "methane");
+    ASSERT_EQ(water->getNumberOfParticles(), 3);
+    ASSERT_EQ(methane->getNumberOfParticles(), 5);
+    EXPECT_EQ(water->getParticle(1)->getType(), "O");
+    EXPECT_EQ(methane->getParticle(1)->getType(), "C");
+    EXPECT_EQ(methane->getParticle(5)->getType(), "H");
+    EXPECT_DOUBLE_EQ(water->getParticle(3)->getPos().y(), 0.93);
+    EXPECT_DOUBLE_EQ(methane->getParticle(2)->getPos().x(), 0.63);
+    EXPECT_DOUBLE_EQ(methane->getParticle(5)->getPos().z(), -0.63);
+    EXPECT_EQ(methane->getParticle(1)->getId(), 1);
+    // Per-structure boundaries
+    EXPECT_DOUBLE_EQ(water->getBoundary()->getBox().get(0,0), 5.);
+    EXPECT_DOUBLE_EQ(water->getBoundary()->getBox().get(2,2), 7.);
+    EXPECT_DOUBLE_EQ(methane->getBoundary()->getBox().get(1,1), 0.);
+    for (auto it = structures.begin(); it != structures.end(); ++it) delete *it;
+}
+
+TEST_F(TestStructureArrays, PackedRejectsBadOffsets) {
+    // Leaks on these paths are checked by test_structure_leaks.exe
+    int bad_offsets[3][3] = {
+        { 0, 5, 3 }, // <- not ascending
+        { -1, 3, 8 }, // <- negative
+        { 0, 3, 9 } }; // <- beyond the particle arrays
+    for (int c = 0; c < 3; ++c) {
+        boost::python::list offsets;
+        for (int s = 0; s < 3; ++s) offsets.append(bad_offsets[c][s]);
+        EXPECT_THROW(this->create(_labels, offsets), soap::base::APIError) << "case " << c;
+    }
+    // Fails on the label of the second structure, after the first one has been built
+    boost::python::list labels;
+    labels.append("water");
+    labels.append(1);
+    boost::python::list offsets;
+    offsets.append(0);
+    offsets.append(3);
+    offsets.append(8);
+    EXPECT_THROW(this->create(labels, offsets), boost::python::error_already_set);
+    PyErr_Clear();
+}
@@ -0,0 +1,77 @@
+#include <complex>
+#include <sstream>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/io.hpp>
+#include <boost/serialization/complex.hpp>
+#include <soap/linalg/tensor.hpp>
+
+typedef std::complex<double> cmplx_t;
+typedef soap::linalg::aligned_matrix<cmplx_t> matrix_t;
+typedef soap::linalg::aligned_zero_matrix<cmplx_t> zero_matrix_t;
+
+TEST(TestAlignedMatrix, ZeroAssignReusesStorage) {
+    matrix_t m = zero_matrix_t(4, 9);
+    ASSERT_EQ(m.size1(), 4);
+    ASSERT_EQ(m.size2(), 9);
+    const cmplx_t *ptr = &m.data()[0];
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % soap::linalg::aligned_array<cmplx_t>::ALIGNMENT, 0);
+    m(3, 8) = cmplx_t(1., -1.);
+    m = zero_matrix_t(3, 9);
+    EXPECT_EQ(&m.data()[0], ptr);
+    EXPECT_EQ(m.data().size(), 27);
+    for (int i = 0; i < m.data().size(); ++i) EXPECT_EQ(m.data()[i], cmplx_t(0., 0.));
+}
+
+TEST(TestAlignedMatrix, FusedOperations) {
+    matrix_t a(3, 4), b(3, 4);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            a(i, j) = cmplx_t(i+0.5, -j);
+            b(i, j) = cmplx_t(0.25*j, i-1.);
+        }
+    }
+    matrix_t c = a;
+    c.axpy(-2., b);
+    c += b;
+    c.scale(0.5);
+    cmplx_t ref_dot = 0.;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            EXPECT_EQ(c(i, j), 0.5*(a(i, j) - b(i, j)));
+            ref_dot += a(i, j)*std::conj(b(i, j));
+        }
+    }
+    cmplx_t dot = soap::linalg::conj_dot(a, b);
+    EXPECT_DOUBLE_EQ(dot.real(), ref_dot.real());
+    EXPECT_DOUBLE_EQ(dot.imag(), ref_dot.imag());
+    c = a;
+    c.conjugate();
+    EXPECT_EQ(c(2, 3), std::conj(a(2, 3)));
+}
+
+TEST(TestAlignedMatrix, SerializesLikeUblas) {
+    // Archives of ublas::matrix coefficients load into aligned_matrix
+    boost::numeric::ublas::matrix<cmplx_t> u(2, 5);
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 5; ++j) u(i, j) = cmplx_t(i, 0.1*j);
+    }
+    std::stringstream buffer;
+    {
+        boost::archive::binary_oarchive arch(buffer);
+        arch << u;
+    }
+    matrix_t m;
+    {
+        boost::archive::binary_iarchive arch(buffer);
+        arch >> m;
+    }
+    ASSERT_EQ(m.size1(), 2);
+    ASSERT_EQ(m.size2(), 5);
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 5; ++j) EXPECT_EQ(m(i, j), u(i, j));
+    }
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <vector>
+#include <gtest/gtest.h>
+#include <soap/xyz.hpp>
+#include "gtest_defines.hpp"
+
+class TestXyzReader : public ::testing::Test
+{
+public:
+
+    std::string _filename;
+    virtual void SetUp() {
+        _filename = "gtest_xyz.xyz";
+        std::ofstream ofs(_filename.c_str());
+        ofs << "3\n"
+            << "Lattice=\"5.0 0.0 0.0 0.0 6.0 0.0 0.0 0.0 7.0\" Properties=id:I:1:species:S:1:pos:R:3 label=water energy=-1.5\n"
+            << "1 O 0.0 0.0 0.0\n"
+            << "2 H 0.9 0.1 0.0\n"
+            << "3 H -0.2 0.9 0.0\n"
+            << "2\n"
+            << "gdb 57\t1.5\n"
+            << "C\t 0.5\t-1.0\t2.0\t-0.48\n"
+            << "N\t 1.5\t-1.0\t2.0\t-0.12\n"
+            << "\n";
+        for (int f = 0; f < 4; ++f) {
+            ofs << "1\n" << "label=frame" << f << " pbc=\"F F F\"\n" << "H " << f << " 0 0\n";
+        }
+        ofs << "2\n" << "label=truncated\n" << "H 0 0 0";
+    }
+
+    virtual void TearDown() {
+        std::remove(_filename.c_str());
+    }
+};
+
+TEST_F(TestXyzReader, IndexAndParse) {
+    std::ofstream ofs(_filename.c_str(), std::ios::app);
+    ofs << "\nH 1 0 0\n";
+    ofs.close();
+    soap::XyzReader reader(_filename);
+    ASSERT_EQ(reader.nFrames(), 7);
+
+    std::map<std::string, std::string> info = reader.getInfo(0);
+    EXPECT_EQ(info["label"], "water");
+    EXPECT_EQ(info["energy"], "-1.5");
+
+    soap::Structure *water = reader.read(0);
+    EXPECT_EQ(water->getLabel(), "water");
+    ASSERT_EQ(water->getNumberOfParticles(), 3);
+    EXPECT_EQ(water->getParticle(1)->getType(), "O");
+    EXPECT_EQ(water->getParticle(2)->getTypeId(), 1);
+    EXPECT_DOUBLE_EQ(water->getParticle(3)->getPos().x(), -0.2);
+    EXPECT_DOUBLE_EQ(water->getParticle(3)->getPos().y(), 0.9);
+    EXPECT_DOUBLE_EQ(water->getBoundary()->getBox().get(1,1), 6.);
+    delete water;
+
+    // Plain XYZ comment, tab-separated columns
+    soap::Structure *gdb = reader.read(1);
+    EXPECT_EQ(gdb->getLabel(), "?");
+    EXPECT_EQ(gdb->getParticle(2)->getType(), "N");
+    EXPECT_DOUBLE_EQ(gdb->getParticle(2)->getPos().x(), 1.5);
+    EXPECT_DOUBLE_EQ(gdb->getParticle(2)->getPos().z(), 2.0);
+    EXPECT_DOUBLE_EQ(gdb->getBoundary()->getBox().get(0,0), 0.);
+    delete gdb;
+
+    std::vector<soap::Structure*> structures;
+    reader.readChunk(2, 5, 3, structures);
+    ASSERT_EQ(structures.size(), 5);
+    for (int f = 0; f < 4; ++f) {
+        EXPECT_EQ(structures[f]->getLabel(), "frame" + std::to_string(f));
+        EXPECT_DOUBLE_EQ(structures[f]->getParticle(1)->getPos().x(), f);
+    }
+    EXPECT_EQ(structures[4]->getNumberOfParticles(), 2);
+    for (auto it = structures.begin(); it != structures.end(); ++it) delete *it;
+    EXPECT_THROW(reader.read(7), soap::base::OutOfRange);
+}
+
+TEST_F(TestXyzReader, RejectsTruncatedFrame) {
+    EXPECT_THROW(soap::XyzReader reader(_filename), soap::base::IOError);
+}
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <boost/format.hpp>
+#include <boost/python/numpy.hpp>
+#include <soap/structure.hpp>
+
+// Checks that failed Structure::createFromArraysPacked calls leave no heap
+// blocks behind. Blocks alive are counted through the global operator new
+// (as in bench_spectrum_alloc), hence a separate executable rather than a
+// test in test.exe. Exits nonzero on a leak.
+
+static std::atomic<long> n_alive(0);
+
+void *operator new(std::size_t size) {
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    ++n_alive;
+    return ptr;
+}
+void operator delete(void *ptr) noexcept { if (ptr) { --n_alive; std::free(ptr); } }
+void operator delete(void *ptr, std::size_t) noexcept { operator delete(ptr); }
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { operator delete(ptr); }
+
+namespace bp = boost::python;
+namespace np = boost::python::numpy;
+
+struct packed_arrays_t
+{
+    // Water (periodic box) and methane (open), as in gtest_structure
+    packed_arrays_t() {
+        double xyz[24] = {
+            0.,0.,0., 0.96,0.,0., -0.24,0.93,0.,
+            0.,0.,0., 0.63,0.63,0.63, -0.63,-0.63,0.63, -0.63,0.63,-0.63, 0.63,-0.63,-0.63 };
+        np::ndarray pos = np::empty(bp::make_tuple(8, 3), np::dtype::get_builtin<double>());
+        std::copy(xyz, xyz+24, reinterpret_cast<double*>(pos.get_data()));
+        positions = pos;
+        long z[8] = { 8, 1, 1, 6, 1, 1, 1, 1 };
+        np::ndarray spec = np::empty(bp::make_tuple(8), np::dtype::get_builtin<long>());
+        std::copy(z, z+8, reinterpret_cast<long*>(spec.get_data()));
+        species = spec;
+        np::ndarray box = np::zeros(bp::make_tuple(2, 3, 3), np::dtype::get_builtin<double>());
+        double *b = reinterpret_cast<double*>(box.get_data());
+        b[0] = 5.; b[4] = 6.; b[8] = 7.;
+        boxes = box;
+        np::ndarray periodic = np::zeros(bp::make_tuple(2, 3), np::dtype::get_builtin<bool>());
+        bool *p = reinterpret_cast<bool*>(periodic.get_data());
+        p[0] = p[1] = p[2] = true;
+        pbc = periodic;
+    }
+    bp::object positions;
+    bp::object species;
+    bp::object boxes;
+    bp::object pbc;
+};
+
+static bool create_fails(packed_arrays_t &arrays, bp::object labels, bp::object offsets) {
+    bp::object none;
+    try {
+        soap::Structure::createFromArraysPacked(labels, arrays.positions, arrays.species, offsets,
+            none, none, arrays.boxes, arrays.pbc, none);
+    }
+    catch (soap::base::APIError &err) {
+        return true;
+    }
+    catch (bp::error_already_set &err) {
+        PyErr_Clear();
+        return true;
+    }
+    return false;
+}
+
+static int check_round(packed_arrays_t &arrays, bool count) {
+    int n_failed = 0;
+    int bad_offsets[4][3] = {
+        { 0, 5, 3 }, // <- not ascending
+        { -1, 3, 8 }, // <- negative
+        { 0, 3, 9 }, // <- beyond the particle arrays
+        { 0, 3, 8 } }; // <- valid, with a bad second label below
+    for (int c = 0; c < 4; ++c) {
+        bp::list labels;
+        labels.append("water");
+        if (c < 3) labels.append("methane");
+        else labels.append(1); // <- fails after the first structure has been built
+        bp::list offsets;
+        for (int s = 0; s < 3; ++s) offsets.append(bad_offsets[c][s]);
+        long n_alive_0 = n_alive;
+        bool failed = create_fails(arrays, labels, offsets);
+        long n_leaked = n_alive - n_alive_0;
+        if (!failed || (count && n_leaked != 0)) {
+            std::cout << boost::format("case %1$d: %2$s, %3$d blocks leaked")
+                % c % (failed ? "rejected" : "accepted") % n_leaked << std::endl;
+            ++n_failed;
+        }
+    }
+    return n_failed;
+}
+
+int main() {
+    std::cout << "soapxx/test/structure_leaks" << std::endl;
+    Py_Initialize();
+    np::initialize();
+    packed_arrays_t arrays;
+    check_round(arrays, false); // <- registers the converters and caches that python allocates lazily
+    int n_failed = check_round(arrays, true);
+    std::cout << ((n_failed) ? "FAILED" : "OK") << std::endl;
+    return (n_failed) ? 1 : 0;
+}
@@ -10,7 +10,7 @@ import io
 import unittest
 
 from momo import osio, endl, flush
-from kernel import KernelPotential, TrajectoryLogger
+from kernel import KernelPotential, TrajectoryLogger, KernelAdaptorFactory
 from kernel import perturb_positions, random_positions
 from kernel import evaluate_energy, evaluate_energy_gradient
 
@@ -162,6 +162,31 @@ class TestGlobalGenericKernelGradient(TestGlobalGeneric):
         self.assertEqual(output_str.split(), output_ref_str.split())
         return
 
+class TestKernelForcesAdjoint(TestGlobalGeneric):
+    def computeForces(self, adaptor):
+        self.options.set('kernel.adaptor', adaptor)
+        self.setUp_Kernel(self.options, self.structure)
+        positions = np.array(self.positions_0)
+        positions[2] += np.array([0.1, -0.2, 0.05])
+        self.structure.positions = positions
+        forces = np.array(self.kernelpot.computeForces(self.structure))
+        forces_adjoint = np.array(self.kernelpot.computeForcesAdjoint(self.structure))
+        return forces, forces_adjoint
+    def test_Generic(self):
+        forces, forces_adjoint = self.computeForces('generic')
+        self.assertGreater(np.abs(forces).max(), 1e-3)
+        self.assertTrue(np.allclose(forces_adjoint, forces, rtol=0., atol=1e-10))
+    def test_GlobalGeneric(self):
+        forces, forces_adjoint = self.computeForces('global-generic')
+        self.assertGreater(np.abs(forces).max(), 1e-3)
+        self.assertTrue(np.allclose(forces_adjoint, forces, rtol=0., atol=1e-10))
+    def test_SpecificRefused(self):
+        # Type-resolved adaptors need the global types, which KernelPotential does not pass
+        self.options.set('kernel.adaptor', 'specific')
+        self.kernelpot.adaptor = KernelAdaptorFactory['specific'](self.options, ['C'])
+        with self.assertRaises(NotImplementedError):
+            self.kernelpot.computeForcesAdjoint(self.structure)
+
 if __name__ == "__main__":
     unittest.main()
 
@@ -0,0 +1,95 @@
+#! /usr/bin/env python
+import soap
+
+import gc
+import numpy as np
+import unittest
+
+soap.silence()
+
+class TestSpectrumArrayViews(unittest.TestCase):
+    def setUp(self):
+        options = soap.Options()
+        options.excludeCenters([])
+        options.excludeTargets([])
+        options.excludeCenterIds([])
+        options.excludeTargetIds([])
+        options.set('radialbasis.type', 'gaussian')
+        options.set('radialbasis.mode', 'adaptive')
+        options.set('radialbasis.N', 4)
+        options.set('radialbasis.sigma', 0.5)
+        options.set('radialbasis.integration_steps', 15)
+        options.set('radialcutoff.Rc', 4.)
+        options.set('radialcutoff.Rc_width', 0.5)
+        options.set('radialcutoff.type', 'heaviside')
+        options.set('radialcutoff.center_weight', 1.)
+        options.set('angularbasis.type', 'spherical-harmonic')
+        options.set('angularbasis.L', 3)
+        options.set('spectrum.gradients', True)
+        self.options = options
+        self.structure = soap.structure_from_arrays('views',
+            np.array([[0.,0.,0.], [1.2,0.1,-0.2], [-0.6,0.9,0.3]]), ['C', 'O', 'H'])
+        self.spectrum = soap.Spectrum(self.structure, options)
+        self.spectrum.compute()
+        self.spectrum.computePower()
+        self.spectrum.computePowerGradients()
+    def test_views_share_storage(self):
+        atomic = self.spectrum.getAtomic(0, 'C')
+        grad = atomic.getPowerGradGenericArray()
+        self.assertEqual(grad.shape[0], len(atomic.getNeighbourPids()))
+        self.assertFalse(grad.flags['OWNDATA'])
+        value = grad[0,0,0,0]
+        self.assertEqual(atomic.getPowerGradGenericArray()[0,0,0,0], value)
+        grad[0,0,0,0] = value + 1.
+        self.assertEqual(atomic.getPowerGradGenericArray()[0,0,0,0], value + 1.)
+    def test_virial_views(self):
+        atomic = self.spectrum.getAtomic(0, 'C')
+        virial = atomic.getPowerVirialArray()
+        virial_gc = atomic.getPowerVirialGenericArray()
+        self.assertEqual(virial.shape[:2], (3, 3))
+        self.assertFalse(virial.flags['OWNDATA'])
+        self.assertFalse(virial_gc.flags['OWNDATA'])
+        del virial
+        with self.assertRaises(Exception):
+            self.spectrum.computePowerGradients()
+        del virial_gc
+        self.spectrum.computePowerGradients()
+    def test_linear_grad_view(self):
+        atomic = self.spectrum.getAtomic(0, 'C')
+        dqnlm = atomic.getLinearGradArray()
+        self.assertEqual(dqnlm.shape[:2], (len(atomic.getNeighbourPids()), 3))
+        self.assertFalse(dqnlm.flags['OWNDATA'])
+        expected = dqnlm.copy()
+        del atomic
+        with self.assertRaises(Exception):
+            self.spectrum.clean()
+        self.assertTrue(np.array_equal(dqnlm, expected))
+        del dqnlm
+        self.spectrum.clean()
+    def test_view_keeps_spectrum_alive(self):
+        grad = self.spectrum.getAtomic(0, 'C').getPowerGradArray()
+        expected = grad.copy()
+        del self.spectrum
+        gc.collect()
+        self.assertTrue(np.array_equal(grad, expected))
+    def test_recompute_refused_while_views_alive(self):
+        grad = self.spectrum.getAtomic(0, 'C').getPowerGradArray()
+        sub = grad[1:]
+        del grad
+        with self.assertRaises(Exception):
+            self.spectrum.clean()
+        with self.assertRaises(Exception):
+            self.spectrum.computePowerGradients()
+        self.assertEqual(len(self.spectrum), 3)
+        # Derived views hold the owner as well
+        del sub
+        gc.collect()
+        self.spectrum.computePowerGradients()
+        # Copies do not
+        copy = self.spectrum.getAtomic(0, 'C').getPowerGradArray().copy()
+        self.spectrum.clean()
+        self.assertEqual(len(self.spectrum), 0)
+        self.assertEqual(copy.shape[1], 3)
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,48 @@
+#! /usr/bin/env python
+import soap
+import soap.tools
+
+import numpy as np
+import unittest
+
+try:
+    import ase
+except ImportError:
+    ase = None
+
+soap.silence()
+
+@unittest.skipIf(ase is None, "requires ase")
+class TestSetupStructureAse(unittest.TestCase):
+    def setUp(self):
+        # get_atomic_numbers() is int64, masses include a custom isotope
+        self.config = ase.Atoms('CO2H2',
+            positions=[[0.,0.,0.], [1.2,0.1,-0.2], [-1.2,0.,0.1], [-0.6,0.9,0.3], [-0.5,-0.9,0.4]],
+            cell=np.diag([10.,10.,10.]), pbc=True)
+        masses = self.config.get_masses()
+        masses[3] = 2.014
+        self.config.set_masses(masses)
+    def test_default_topology_matches_particle_path(self):
+        fast = soap.tools.setup_structure_ase('fast', self.config)
+        slow = soap.tools.setup_structure_ase('slow', self.config, top=[('segment', 1, len(self.config))])
+        self.assertEqual(fast.n_particles, len(self.config))
+        for p_fast, p_slow in zip(fast.particles, slow.particles):
+            self.assertEqual(p_fast.type, p_slow.type)
+            self.assertEqual(p_fast.name, p_slow.name)
+            self.assertEqual(p_fast.type_id, p_slow.type_id)
+            self.assertAlmostEqual(p_fast.mass, p_slow.mass)
+            self.assertAlmostEqual(p_fast.weight, p_slow.weight)
+            self.assertAlmostEqual(p_fast.sigma, p_slow.sigma)
+            np.testing.assert_allclose(p_fast.pos, p_slow.pos)
+        np.testing.assert_allclose(fast.box, slow.box)
+    def test_integer_widths(self):
+        positions = self.config.get_positions()
+        for dtype in [np.int64, np.int32, np.uint8]:
+            z = self.config.get_atomic_numbers().astype(dtype)
+            structure = soap.structure_from_arrays('z', positions, z)
+            self.assertEqual(list(structure.type_ids), list(self.config.get_atomic_numbers()))
+        with self.assertRaises(Exception):
+            soap.structure_from_arrays('z', positions, self.config.get_atomic_numbers().astype(float))
+
+if __name__ == "__main__":
+    unittest.main()
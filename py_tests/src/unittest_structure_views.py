@@ -0,0 +1,49 @@
+#! /usr/bin/env python
+import soap
+
+import gc
+import numpy as np
+import unittest
+
+soap.silence()
+
+class TestParticleArrayViews(unittest.TestCase):
+    def setUp(self):
+        self.structure = soap.structure_from_arrays('views',
+            np.array([[0.,0.,0.], [1.2,0.1,-0.2], [-0.6,0.9,0.3]]), ['C', 'O', 'H'])
+    def test_views_write_through(self):
+        positions = self.structure.positions
+        positions[1,0] = 2.
+        self.assertAlmostEqual(self.structure.getParticle(2).pos[0], 2.)
+        self.structure.weights[2] = 0.5
+        self.assertAlmostEqual(self.structure.getParticle(3).weight, 0.5)
+    def test_growth_refused_while_views_alive(self):
+        segment = self.structure.getSegment(1)
+        positions = self.structure.positions
+        sub = positions[1:]
+        del positions
+        with self.assertRaises(Exception):
+            self.structure.addParticle(segment)
+        # Derived views hold the owner as well
+        del sub
+        gc.collect()
+        self.structure.addParticle(segment)
+        self.assertEqual(self.structure.positions.shape, (4, 3))
+        # Copies do not
+        copy = self.structure.positions.copy()
+        self.structure.addParticle(segment)
+        self.assertEqual(copy.shape, (4, 3))
+    def test_set_positions_any_layout(self):
+        target = np.array([[0.5,0.,0.], [1.,2.,3.], [-1.,-2.,-3.]])
+        self.structure.positions = np.asfortranarray(target, dtype=np.float32)
+        self.assertTrue(np.allclose(self.structure.positions, target))
+        self.structure.positions = np.ascontiguousarray(target.T).T
+        self.assertTrue(np.allclose(self.structure.positions, target))
+    def test_view_keeps_structure_alive(self):
+        positions = self.structure.positions
+        del self.structure
+        gc.collect()
+        self.assertAlmostEqual(positions[1,0], 1.2)
+
+if __name__ == "__main__":
+    unittest.main()
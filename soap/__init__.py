@@ -0,0 +1,5 @@
+from _soapxx import *
+from linalg import *
+from . import soapy
+from . import tools
+
@@ -0,0 +1,280 @@
+#ifndef _SOAP_ATOMICSPECTRUM_HPP
+#define _SOAP_ATOMICSPECTRUM_HPP
+
+#include <assert.h>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/complex.hpp>
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/version.hpp>
+
+#include "soap/base/logger.hpp"
+#include "soap/base/arena.hpp"
+#include "soap/types.hpp"
+#include "soap/globals.hpp"
+#include "soap/options.hpp"
+#include "soap/structure.hpp"
+#include "soap/basis.hpp"
+#include "soap/power.hpp"
+
+
+namespace soap {
+
+
+class SpectrumArchive;
+
+// Bytes of coefficient storage by category, as held (getMemoryUsage)
+// or predicted (estimateMemory) for atomic spectra
+struct spectrum_memory_t
+{
+    spectrum_memory_t() : density(0), power(0), density_gradients(0), power_gradients(0) {;}
+    size_t total() const { return density+power+density_gradients+power_gradients; }
+    spectrum_memory_t &operator+=(const spectrum_memory_t &other);
+    boost::python::dict toPython() const;
+
+    size_t density; // <- qnlm, type-resolved and generic
+    size_t power; // <- xnkl, type-resolved and generic
+    size_t density_gradients; // <- dqnlm/dr_j blocks and density virials
+    size_t power_gradients; // <- dxnkl/dr_j tensors, power virials and their PowerExpansion views
+};
+
+class AtomicSpectrum : public std::map<std::string, BasisExpansion*>
+{
+    friend class SpectrumArchive;
+    friend class SpectrumArrayOwner;
+public:
+    // EXPANSION TYPES
+	typedef BasisExpansion qnlm_t;
+	typedef PowerExpansion xnkl_t;
+	typedef std::pair<std::string, std::string> type_pair_t;
+	typedef std::complex<double> cmplx_t;
+
+	// CONTAINERS FOR STORING SCALAR FIELDS
+	typedef std::map<std::string, qnlm_t*, std::less<std::string>,
+	    base::ArenaAllocator<std::pair<const std::string, qnlm_t*> > > map_qnlm_t; // <- key: center type, e.g. 'C'
+	typedef std::map<type_pair_t, xnkl_t*, std::less<type_pair_t>,
+	    base::ArenaAllocator<std::pair<const type_pair_t, xnkl_t*> > > map_xnkl_t; // <- key: type string pair, e.g. ('C','H')
+
+	// CONTAINERS FOR STORING GRADIENTS
+	typedef std::map<int, std::pair<std::string,qnlm_t*> > map_pid_qnlm_t; // <- id=>(type;qnlm), legacy archives only
+	typedef std::vector<cmplx_t, base::ArenaAllocator<cmplx_t> > qnlm_grad_t; // <- dense, see _qnlm_grad
+	typedef std::map<int, map_xnkl_t> map_pid_xnkl_t; // <- id=>type=>xnkl
+	typedef std::map<int, xnkl_t*> map_pid_xnkl_gc_t; // <- id=>xnkl_generic_coherent
+	typedef std::vector<cmplx_t, base::ArenaAllocator<cmplx_t> > xnkl_grad_t; // <- dense, see _xnkl_grad & _xnkl_grad_gc
+	typedef std::vector<cmplx_t> qnlm_virial_t; // <- dense (3, 3, N, (L+1)^2)
+	typedef std::map<std::string, qnlm_virial_t> map_qnlm_virial_t;
+
+	// With an arena, expansions, map nodes and the dense gradient tensors are placed
+	// in the arena, which must outlive this object
+	AtomicSpectrum(Particle *center, Basis *basis, base::Arena *arena = NULL);
+	AtomicSpectrum(Basis *basis, base::Arena *arena = NULL);
+	AtomicSpectrum() { this->null(); }
+   ~AtomicSpectrum();
+    void null();
+    void prunePidData();
+    // Throws if numpy views onto the gradient & virial tensors are alive
+    // (see SpectrumArrayOwner), before these are reallocated or released
+    void assertNoArrayViews();
+    void write(std::ostream &ofs);
+    void invert(map_xnkl_t &map_xnkl, xnkl_t *xnkl_generic_coherent, std::string type1, std::string type2);
+    void invert(xnkl_t *xnkl, std::string type1, std::string type2);
+
+    // CENTER & BASIS METHODS
+    Particle *getCenter() { return _center; }
+    int getCenterId() { return _center_id; }
+	std::string &getCenterType() { return _center_type; }
+	vec &getCenterPos() { return _center_pos; }
+	Basis *getBasis() { return _basis; }
+	// QNLM METHODS
+    void addQnlm(std::string type, qnlm_t &nb_expansion);
+    // <nb_index>: pid => index into the neighbour list or -1, scratch shared
+    // by the caller (see Spectrum::computeAtomic) and cleared with releaseNeighbourIndex
+    void addQnlmNeighbour(Particle *nb, qnlm_t &nb_expansion, vec dr, std::vector<int> *nb_index = NULL);
+    void releaseNeighbourIndex(std::vector<int> &nb_index);
+    // Sets the capacity for the gradient blocks of <n_nb> neighbours in total,
+    // once their number is known, so that _qnlm_grad does not grow by doubling
+    void reserveNeighbours(int n_nb);
+    qnlm_t *getQnlm(std::string type);
+    qnlm_t *getQnlmGeneric() { return _qnlm_generic; }
+    map_qnlm_t &getQnlmMap() { return _map_qnlm; }
+    std::vector<int> &getQnlmGradPids() { return _nb_pids; }
+    std::vector<std::string> &getQnlmGradTypes() { return _nb_types; }
+    qnlm_grad_t &getQnlmGrad() { return _qnlm_grad; }
+    cmplx_t *qnlmGradSlot(int nb_idx, int dim) {
+        int N = _basis->getRadBasis()->N();
+        int L = _basis->getAngBasis()->L();
+        return &_qnlm_grad[(nb_idx*3+dim)*N*(L+1)*(L+1)];
+    }
+    void mergeQnlm(AtomicSpectrum *other, double scale, bool gradients, std::vector<int> *nb_index = NULL);
+    // XNKL METHODS
+    void computePower();
+    void computePowerGradients();
+    xnkl_t *getPower(std::string type1, std::string type2);
+    xnkl_t *getPowerGradGeneric(int pid);
+    xnkl_grad_t &getPowerGrad() { return _xnkl_grad; }
+    xnkl_grad_t &getPowerGradGenericTensor() { return _xnkl_grad_gc; }
+    std::vector<int> &getPowerGradPids() { return _grad_pids; }
+    std::vector<type_pair_t> &getPowerGradTypePairs() { return _grad_type_pairs; }
+    int getPowerGradPidIndex(int pid);
+    void computeQnlmSensitivity(const double *dE_dX, BasisExpansion::coeff_t &lambda);
+    void computeForcesAdjoint(const double *dE_dX, ub::matrix<double> &forces);
+    xnkl_grad_t &getPowerVirial() { return _xnkl_virial; }
+    xnkl_grad_t &getPowerVirialGenericTensor() { return _xnkl_virial_gc; }
+    xnkl_t *getXnkl(type_pair_t &types);
+    map_xnkl_t &getXnklMap() { return _map_xnkl; }
+    xnkl_t *getXnklGenericCoherent() { return _xnkl_generic_coherent; }
+    xnkl_t *getXnklGenericIncoherent() { return _xnkl_generic_incoherent; }
+    // MEMORY
+    spectrum_memory_t getMemoryUsage();
+    // Footprint after computePower (& computePowerGradients if <power_gradients>) of a
+    // spectrum with <n_types> density types, <n_pids> neighbours with gradients, and
+    // <n_virial_types> types of neighbours with gradients (incl. images of the center)
+    static spectrum_memory_t estimateMemory(int N, int L, int n_types, int n_pids, int n_virial_types,
+        bool gradients, bool power_gradients);
+
+    boost::python::list getTypes();
+    boost::python::list getNeighbourPids();
+    boost::python::list getPowerGradTypePairsPython();
+    boost::python::dict getMemoryUsagePython() { return this->getMemoryUsage().toPython(); }
+    static boost::python::object getQnlmGradNumpy(boost::python::object self);
+    static boost::python::object getPowerGradNumpy(boost::python::object self);
+    static boost::python::object getPowerGradGenericNumpy(boost::python::object self);
+    static boost::python::object getPowerVirialNumpy(boost::python::object self);
+    static boost::python::object getPowerVirialGenericNumpy(boost::python::object self);
+    static void registerPython();
+
+    template<class Archive>
+    void serialize(Archive &arch, const unsigned int version) {
+    	// Center & basis
+    	arch & _center;
+    	arch & _center_id;
+    	arch & _center_pos;
+    	arch & _center_type;
+    	arch & _basis;
+    	// Qnlm's
+    	arch & _map_qnlm;
+    	arch & _qnlm_generic;
+    	// Xnkl's
+    	arch & _map_xnkl;
+    	arch & _xnkl_generic_coherent;
+    	arch & _xnkl_generic_incoherent;
+    	// PID-resolved
+    	if (version < 3) {
+    	    map_pid_qnlm_t map_pid_qnlm;
+    	    arch & map_pid_qnlm;
+    	    this->packQnlmGradients(map_pid_qnlm);
+    	}
+    	else {
+    	    arch & _nb_pids;
+    	    arch & _nb_types;
+    	    arch & _qnlm_grad;
+    	}
+    	if (version < 1) {
+    	    // Legacy archives store one PowerExpansion per pid and type pair
+    	    map_pid_xnkl_t map_pid_xnkl;
+    	    map_pid_xnkl_gc_t map_pid_xnkl_gc;
+    	    arch & map_pid_xnkl;
+    	    arch & map_pid_xnkl_gc;
+    	    this->packPowerGradients(map_pid_xnkl, map_pid_xnkl_gc);
+    	}
+    	else {
+    	    arch & _grad_pids;
+    	    arch & _grad_types;
+    	    arch & _grad_type_pairs;
+    	    arch & _xnkl_grad;
+    	    arch & _xnkl_grad_gc;
+    	}
+    	if (version >= 2) {
+    	    arch & _map_qnlm_virial;
+    	    arch & _qnlm_virial_generic;
+    	    arch & _xnkl_virial;
+    	    arch & _xnkl_virial_gc;
+    	}
+    	return;
+    }
+protected:
+    template<class expansion_t>
+    expansion_t *createExpansion() {
+        if (_arena) return new (_arena->allocate<expansion_t>(1)) expansion_t(_basis, _arena);
+        return new expansion_t(_basis);
+    }
+    template<class expansion_t>
+    void destroyExpansion(expansion_t *expansion) {
+        if (!expansion) return;
+        if (_arena) expansion->~expansion_t(); // <- storage is released with the arena
+        else delete expansion;
+    }
+    void clearPowerGradients();
+    void packQnlmGradients(map_pid_qnlm_t &map_pid_qnlm);
+    int findOrAddNeighbour(int pid, const std::string &type, std::vector<int> *nb_index);
+    int addNeighbour(int pid, const std::string &type);
+    void packPowerGradients(map_pid_xnkl_t &map_pid_xnkl, map_pid_xnkl_gc_t &map_pid_xnkl_gc);
+    void addQnlmVirial(qnlm_virial_t &virial, qnlm_t &nb_expansion, vec &dr, double scale);
+    void computePowerVirial();
+    cmplx_t *gradSlot(int pid_idx, int dim, int pair_idx) {
+        int N = _basis->getRadBasis()->N();
+        int L = _basis->getAngBasis()->L();
+        return &_xnkl_grad[((pid_idx*3+dim)*_grad_type_pairs.size()+pair_idx)*N*N*(L+1)];
+    }
+    cmplx_t *gradSlotGeneric(int pid_idx, int dim) {
+        int N = _basis->getRadBasis()->N();
+        int L = _basis->getAngBasis()->L();
+        return &_xnkl_grad_gc[(pid_idx*3+dim)*N*N*(L+1)];
+    }
+
+    // CENTER & BASIS LINKS
+	Particle *_center;
+	int _center_id;
+	vec _center_pos;
+	std::string _center_type;
+	Basis *_basis;
+	base::Arena *_arena; // <- not owned, NULL: heap
+
+	// DENSITY EXPANSION
+	map_qnlm_t _map_qnlm;
+	qnlm_t *_qnlm_generic;
+
+	// POWER DENSITY EXPANSION
+	map_xnkl_t _map_xnkl;
+	xnkl_t *_xnkl_generic_coherent;
+	xnkl_t *_xnkl_generic_incoherent;
+
+	// PID-RESOLVED (GRADIENTS)
+	// Density gradients wrt the positions of the neighbours with global ids _nb_pids,
+	// one contiguous block per neighbour: _qnlm_grad (n_nb, 3, N, (L+1)^2). Images
+	// of the same particle share a block. Together with the neighbour lists
+	// of all other centers, these form the rows of a block-CSR matrix.
+	std::vector<int> _nb_pids;
+	std::vector<std::string> _nb_types;
+	qnlm_grad_t _qnlm_grad;
+	// Power-spectrum gradients, stored densely & row-major as
+	// o _xnkl_grad    (n_pids, 3, n_type_pairs, N*N, L+1)
+	// o _xnkl_grad_gc (n_pids, 3, N*N, L+1) (generic-coherent)
+	// with pids ordered as in _grad_pids and type pairs (t1,t2) at
+	// index i1*n_types+i2, with i1, i2 indices into _grad_types.
+	std::vector<int> _grad_pids;
+	std::vector<std::string> _grad_types;
+	std::vector<type_pair_t> _grad_type_pairs;
+	xnkl_grad_t _xnkl_grad;
+	xnkl_grad_t _xnkl_grad_gc;
+	std::vector<std::pair<int,int> > _grad_pid_index; // <- (pid, index into _grad_pids), sorted, built on demand
+	map_pid_xnkl_gc_t _map_pid_xnkl_gc; // <- PowerExpansion views, created on demand
+
+	// VIRIALS sum_j r_j (x) dQ/dr_j and sum_j r_j (x) dX/dr_j, accumulated
+	// alongside the gradients (per image, with r_j the connection vector)
+	// o _map_qnlm_virial, _qnlm_virial_generic (3, 3, N, (L+1)^2)
+	// o _xnkl_virial (3, 3, n_type_pairs, N*N, L+1)
+	// o _xnkl_virial_gc (3, 3, N*N, L+1)
+	map_qnlm_virial_t _map_qnlm_virial;
+	qnlm_virial_t _qnlm_virial_generic;
+	xnkl_grad_t _xnkl_virial;
+	xnkl_grad_t _xnkl_virial_gc;
+	int _n_array_views; // <- numpy views onto the tensors above
+};
+
+
+}
+
+BOOST_CLASS_VERSION(soap::AtomicSpectrum, 3)
+
+#endif /* _SOAP_ATOMICSPECTRUM_HPP_ */
@@ -0,0 +1,338 @@
+#ifndef _SOAP_LOGGER_H
+#define	_SOAP_LOGGER_H
+
+#include <sstream>
+#include <iostream>
+#include <mutex>
+#include <atomic>
+
+namespace soap {
+
+
+
+enum TLogLevel {logERROR, logWARNING, logINFO, logDEBUG};
+
+/*
+ * Macros to use the Logger: LOG(level,logger) << message
+ */
+#define LOGIF(level, log) \
+if ( &log != NULL && level > (log).getReportLevel() ) ; \
+else (log)(level)
+
+#define LOG(plog) \
+if (plog == NULL) ; \
+else (*plog)()
+
+/*
+ * Messages above this level are compiled out, see GLOG_AT
+ */
+#ifndef SOAP_LOG_LEVEL_COMPILE
+#define SOAP_LOG_LEVEL_COMPILE soap::logINFO
+#endif
+
+/*
+ * Custom buffer to store messages
+ */
+class LogBuffer : public std::stringbuf {
+
+public:
+	LogBuffer() : std::stringbuf(), _silent(false),
+                _errorPreface("ERROR "), _warnPreface("WARNING "),
+                _infoPreface(""), _dbgPreface("DEBUG "),
+                _writePreface(true) {}
+
+    void silence() { _silent = true; }
+
+        // sets the log level (needed for output)
+	void setLogLevel(TLogLevel LogLevel) { _LogLevel = LogLevel; }
+
+        // sets Multithreading (buffering required)
+        void setMultithreading( bool maverick ) { _maverick = maverick; }
+
+        // sets preface strings for logERROR, logWARNING, ...
+        void setPreface(TLogLevel level, std::string preface) {
+            switch ( level )
+            {
+
+                case logERROR:
+                    _errorPreface = preface;
+                    break;
+                case logWARNING:
+                    _warnPreface = preface;
+                    break;
+                case logINFO:
+                    _infoPreface = preface;
+                    break;
+                case logDEBUG:
+                    _dbgPreface = preface;
+                    break;
+            }
+        }
+
+        std::string getPreface(TLogLevel level) {
+            if (!_writePreface) return "";
+            switch ( level )
+            {
+                case logERROR: return _errorPreface;
+                case logWARNING: return _warnPreface;
+                case logINFO: return _infoPreface;
+                case logDEBUG: return _dbgPreface;
+            }
+            return "";
+        }
+
+        void EnablePreface() { _writePreface = true; }
+        void DisablePreface() { _writePreface = false; }
+
+        // flushes all collected messages
+        void FlushBuffer(){ std::cout << _stringStream.str(); _stringStream.str(""); }
+
+        // returns the pointer to the collected messages
+        std::string Messages() {
+            std::string _messages = _stringStream.str();
+            _stringStream.str("");
+            return _messages;
+        }
+
+private:
+
+  // Log Level (WARNING, INFO, etc)
+  TLogLevel _LogLevel;
+
+  // temporary buffer to store messages
+  std::ostringstream _stringStream;
+
+  // Multithreading
+  bool _maverick;
+  bool _writePreface;
+  bool _silent;
+
+  std::string _timePreface;
+  std::string _errorPreface;
+  std::string _warnPreface;
+  std::string _infoPreface;
+  std::string _dbgPreface;
+
+
+protected:
+	virtual int sync() {
+            if (_silent) return 0;
+
+            std::ostringstream _message;
+
+            if (_writePreface) {
+                switch ( _LogLevel )
+                {
+                    case logERROR:
+                        _message << _errorPreface;
+                        break;
+                    case logWARNING:
+                        _message << _warnPreface;
+                        break;
+                    case logINFO:
+                        _message << _infoPreface;
+                        break;
+                    case logDEBUG:
+                        _message << _dbgPreface;
+                        break;
+                }
+            }
+
+            if ( !_maverick ) {
+                // collect all messages of one thread
+                _stringStream << _message.str()  << "" << str();
+            } else {
+                // if only one thread outputs, flush immediately
+                std::cout << _message.str() << "" << str() << std::flush;
+            }
+            _message.str("");
+	    str("");
+	    return 0;
+	}
+
+};
+
+
+/*
+ * Per-thread buffer: messages are collected until a line is complete and
+ * then written to std::cout under a lock, so that lines from concurrent
+ * threads do not interleave. Partial lines (std::flush) are held back.
+ */
+class ThreadLogBuffer : public std::stringbuf {
+
+public:
+    ThreadLogBuffer() : std::stringbuf() {}
+   ~ThreadLogBuffer() {
+        std::string rest = str();
+        if (rest.size()) this->emit(rest + "\n");
+    }
+
+    void setPreface(const std::string &preface) { _preface = preface; }
+
+    static std::mutex &outputMutex() {
+        static std::mutex output_mutex;
+        return output_mutex;
+    }
+
+protected:
+    virtual int sync() {
+        std::string message = str();
+        size_t end = message.rfind('\n');
+        if (end != std::string::npos) {
+            this->emit(message.substr(0, end+1));
+            str(message.substr(end+1));
+        }
+        return 0;
+    }
+
+    void emit(const std::string &lines) {
+        std::lock_guard<std::mutex> lock(outputMutex());
+        std::cout << _preface << lines << std::flush;
+    }
+
+    std::string _preface;
+};
+
+
+/** \class Logger
+*   \brief Logger is used for thread-safe output of messages
+*
+*  Logger writes messages into LogBuffer.
+*  Inheritance from ostream allows to use overloaded << and >> for writing.
+*  Example:
+*
+*  \code
+*  #include <votca/ctp/logger.h>
+*  Logger* log = new Logger(); // create a logger object
+*  log->setReportLevel(logDEBUG); // output only log messages starting from a DEBUG level
+*  LOG(logERROR,*log) << "Error detected" << flush; // write to the logger at an ERROR level
+*  cout << log; // output logger content to standard output
+*  \endcode
+*
+*  Logger has four predefined log levels: logERROR, logWARNING, logINFO, logDEBUG.
+*/
+class Logger : public std::ostream {
+
+       friend std::ostream& operator<<( std::ostream& out, Logger&  logger ) {
+           out << logger.Messages();
+           return out;
+       }
+
+public:
+	Logger( TLogLevel ReportLevel) : std::ostream(new LogBuffer()) {
+            _ReportLevel = ReportLevel;
+            _maverick = true;
+            _silent = false;
+            _verbose = false;
+     }
+
+	 Logger() : std::ostream(new LogBuffer()) {
+		 _ReportLevel = logINFO;
+		 _maverick = true;
+		 _silent = false;
+		 _verbose = false;
+		 dynamic_cast<LogBuffer *>( rdbuf() )->setMultithreading(_maverick);
+	 }
+
+	~Logger() {
+            //dynamic_cast<LogBuffer *>( rdbuf())->FlushBuffer();
+            delete rdbuf();
+            rdbuf(NULL);
+	}
+
+	// Stream of the calling thread (see threadStream), or for messages above the
+	// report level a failed one that formats nothing. The shared stream is left
+	// untouched, since GLOG() is also called from worker threads.
+	std::ostream &operator()( TLogLevel LogLevel = logINFO) {
+		if (this->isEnabled(LogLevel)) return this->threadStream(LogLevel);
+		static thread_local std::ostream dropped(NULL); // <- no buffer: badbit
+		return dropped;
+	}
+
+        void setReportLevel( TLogLevel ReportLevel ) { _ReportLevel = ReportLevel; }
+        void silence() {
+            _silent = true;
+            dynamic_cast<LogBuffer*>(rdbuf())->silence();
+            // Failed stream: operator<< returns before formatting anything
+            setstate(std::ios::badbit);
+        }
+        bool isEnabled(TLogLevel level) { return !_silent && level <= _ReportLevel; }
+
+        // Stream of the calling thread, see ThreadLogBuffer and GLOG_AT
+        std::ostream &threadStream(TLogLevel level) {
+            static thread_local ThreadLogBuffer buffer;
+            static thread_local std::ostream stream(&buffer);
+            buffer.setPreface(dynamic_cast<LogBuffer *>( rdbuf() )->getPreface(level));
+            return stream;
+        }
+        void setVerbose(bool verbose) {
+            _verbose = verbose;
+        }
+        bool verbose() { return _verbose; }
+        void setMultithreading( bool maverick ) {
+            _maverick = maverick;
+            dynamic_cast<LogBuffer *>( rdbuf() )->setMultithreading( _maverick );
+        }
+        bool isMaverick() { return _maverick; }
+
+        TLogLevel getReportLevel( ) { return _ReportLevel; }
+        std::string getPreface(TLogLevel level) {
+            return dynamic_cast<LogBuffer *>( rdbuf() )->getPreface(level);
+        }
+
+        void setPreface(TLogLevel level, std::string preface) {
+            dynamic_cast<LogBuffer *>( rdbuf() )->setPreface(level, preface);
+        }
+
+        void EnablePreface() {
+            dynamic_cast<LogBuffer *>( rdbuf() )->EnablePreface();
+        }
+
+        void DisablePreface() {
+            dynamic_cast<LogBuffer *>( rdbuf() )->DisablePreface();
+        }
+
+private:
+    // at what level of detail output messages
+    std::atomic<TLogLevel> _ReportLevel;
+
+    // if true, only a single processor job is executed
+    bool      _maverick;
+    std::atomic<bool> _silent;
+    bool      _verbose;
+
+    std::string Messages() {
+        return dynamic_cast<LogBuffer *>( rdbuf() )->Messages();
+    }
+
+};
+
+/**
+*   \brief Timestamp returns the current time as a string
+*  Example: cout << TimeStamp()
+*/
+class TimeStamp
+{
+  public:
+    friend std::ostream & operator<<(std::ostream &os, const TimeStamp& ts)
+    {
+        time_t rawtime;
+        tm * timeinfo;
+        time(&rawtime);
+        timeinfo = localtime( &rawtime );
+        os  << (timeinfo->tm_year)+1900
+            << "-" << timeinfo->tm_mon + 1
+            << "-" << timeinfo->tm_mday
+            << " " << timeinfo->tm_hour
+            << ":" << timeinfo->tm_min
+            << ":"  << timeinfo->tm_sec;
+         return os;
+    }
+
+    explicit TimeStamp() {};
+
+};
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef _SOAP_QUEUE_HPP
+#define	_SOAP_QUEUE_HPP
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+
+namespace soap { namespace base {
+
+// Blocking FIFO of limited capacity, for pipelines of producer and consumer
+// threads: push blocks while the queue is full, pop while it is empty. Once
+// closed, push is refused and pop drains the remaining items.
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : _capacity(capacity), _closed(false) { ; }
+
+    bool push(const T &item) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv_push.wait(lock, [this]() { return _closed || _items.size() < _capacity; });
+        if (_closed) return false;
+        _items.push_back(item);
+        _cv_pop.notify_one();
+        return true;
+    }
+    // False if closed and drained
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv_pop.wait(lock, [this]() { return _closed || !_items.empty(); });
+        if (_items.empty()) return false;
+        item = _items.front();
+        _items.pop_front();
+        _cv_push.notify_one();
+        return true;
+    }
+    void close() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _cv_push.notify_all();
+        _cv_pop.notify_all();
+    }
+
+private:
+    size_t _capacity;
+    bool _closed;
+    std::deque<T> _items;
+    std::mutex _mutex;
+    std::condition_variable _cv_push;
+    std::condition_variable _cv_pop;
+};
+
+// Runs items 0..n_items-1 through three overlapped stages connected by
+// bounded queues:
+// o producer thread: item = produce(i), a new T
+// o n_workers worker threads: work(*item, w), w the worker index
+// o consumer thread: consume(*item), in item order, then deletes the item
+// The first exception thrown by any stage for any item (first in item order)
+// stops production, the items in flight are deleted without being consumed,
+// and the exception is rethrown once all threads have joined. Items before
+// the failing one have all been consumed.
+template<typename T, typename Produce, typename Work, typename Consume>
+void run_pipeline(int n_items, int n_workers, Produce produce, Work work, Consume consume) {
+    struct job_t
+    {
+        int index;
+        T *item;
+        std::exception_ptr error;
+    };
+    BoundedQueue<job_t*> produced(2*n_workers);
+    BoundedQueue<job_t*> worked(2*n_workers);
+    // Items between producer and consumer, bounds the reorder buffer of the consumer
+    BoundedQueue<int> in_flight(4*n_workers);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < n_items; ++i) {
+            if (!in_flight.push(i)) break;
+            job_t *job = new job_t();
+            job->index = i;
+            job->item = NULL;
+            try {
+                job->item = produce(i);
+            }
+            catch (...) {
+                job->error = std::current_exception();
+            }
+            if (!produced.push(job)) {
+                delete job->item;
+                delete job;
+                break;
+            }
+        }
+        produced.close();
+    });
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < n_workers; ++w) {
+        workers.push_back(std::thread([&, w]() {
+            job_t *job = NULL;
+            while (produced.pop(job)) {
+                if (!job->error && !failed) {
+                    try {
+                        work(*job->item, w);
+                    }
+                    catch (...) {
+                        job->error = std::current_exception();
+                    }
+                }
+                worked.push(job);
+            }
+        }));
+    }
+
+    std::thread consumer([&]() {
+        std::map<int, job_t*> pending;
+        int next = 0;
+        job_t *job = NULL;
+        while (worked.pop(job)) {
+            pending[job->index] = job;
+            while (pending.count(next)) {
+                job = pending[next];
+                pending.erase(next);
+                if (!job->error && !error) {
+                    try {
+                        consume(*job->item);
+                    }
+                    catch (...) {
+                        job->error = std::current_exception();
+                    }
+                }
+                if (job->error && !error) {
+                    // Stop producing, drain the pipeline
+                    error = job->error;
+                    failed = true;
+                    in_flight.close();
+                }
+                delete job->item;
+                delete job;
+                int index;
+                in_flight.pop(index);
+                ++next;
+            }
+        }
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            delete it->second->item;
+            delete it->second;
+        }
+    });
+
+    producer.join();
+    for (auto it = workers.begin(); it != workers.end(); ++it) it->join();
+    worked.close();
+    consumer.join();
+    if (error) std::rethrow_exception(error);
+}
+
+}}
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef _SOAP_BASIS_HPP
+#define _SOAP_BASIS_HPP
+
+#include <string>
+#include <math.h>
+#include <vector>
+#include <fstream>
+
+#include "soap/base/exceptions.hpp"
+#include "soap/options.hpp"
+#include "soap/globals.hpp"
+#include "soap/structure.hpp"
+#include "soap/angularbasis.hpp"
+#include "soap/radialbasis.hpp"
+#include "soap/cutoff.hpp"
+#include "soap/nlmkernels.hpp"
+
+namespace soap {
+
+namespace ub = boost::numeric::ublas;
+
+class Basis
+{
+public:
+	Basis(Options *options);
+	Basis() : _options(NULL), _kernels(NULL), _radbasis(NULL), _angbasis(NULL), _cutoff(NULL) {;}
+	~Basis();
+
+	RadialBasis *getRadBasis() { return _radbasis; }
+	AngularBasis *getAngBasis() { return _angbasis; }
+	CutoffFunction *getCutoff() { return _cutoff; }
+	Options *getOptions() { return _options; }
+	const SpectrumConfig &getConfig() { return _config; }
+	const nlm_kernels_t *getKernels() { return _kernels; }
+	const double *getPowerPrefactors() { return &_power_prefactors[0]; } // <- per-l normalization of the power spectrum
+	const int &N() { return _radbasis->N(); }
+	const int &L() { return _angbasis->L(); }
+
+	static void registerPython();
+
+	template<class Archive>
+	void serialize(Archive &arch, const unsigned int version) {
+		arch & _options;
+		arch & _radbasis;
+		arch & _angbasis;
+		arch & _cutoff;
+		if (Archive::is_loading::value && _options) _config.resolve(*_options);
+		if (Archive::is_loading::value && _radbasis && _angbasis) _kernels = nlm_kernels_resolve(N(), L());
+		if (Archive::is_loading::value && _options && _angbasis) this->resolvePowerPrefactors();
+		return;
+	}
+private:
+	void resolvePowerPrefactors();
+
+	Options *_options;
+	SpectrumConfig _config; // <- resolved after the basis has been configured
+	const nlm_kernels_t *_kernels; // <- (N, L)-specialized if available
+	std::vector<double> _power_prefactors; // <- normalization of the contraction over m, per l
+	RadialBasis *_radbasis;
+	AngularBasis *_angbasis;
+	CutoffFunction *_cutoff;
+};
+
+// Process-wide, thread-safe registry of configured bases: identical basis
+// options (radialbasis.*, angularbasis.*, radialcutoff.*, spectrum.2l1_norm)
+// give back the same Basis, configured once. Adjustments made while
+// configuring (e.g., the cutoff of an adaptive radial basis) are written back
+// to the options passed in, as with Basis(options). A cached basis keeps only
+// these basis options (getOptions() has defaults otherwise). Bases handed out
+// are shared and must not be modified; they live until clear(), which is why
+// spectra only use the cache with spectrum.basis_cache=true (opt-in).
+// With a cache directory (setDirectory, or $SOAP_BASIS_CACHE), bases are also
+// archived there and loaded instead of configured on a cold start.
+class BasisCache
+{
+public:
+	static Basis *get(Options &options); // <- in use until handed back through release
+	static void release(Basis *basis);
+	static std::string key(Options &options);
+	static int size();
+	static int clear(); // <- frees the bases not in use, returns the number kept
+	static void setDirectory(std::string dir); // <- empty: no on-disk cache
+	static std::string getDirectory();
+	static void registerPython();
+};
+
+
+class BasisExpansion
+{
+public:
+	typedef linalg::aligned_matrix< std::complex<double> > coeff_t;
+	typedef linalg::aligned_zero_matrix< std::complex<double> > coeff_zero_t;
+
+	BasisExpansion(Basis *basis, base::Arena *arena = NULL); // <- coefficient storage from arena if given
+	BasisExpansion() : _basis(NULL), _radbasis(NULL), _angbasis(NULL), _has_scalars(false), _has_gradients(false) {;}
+    ~BasisExpansion();
+
+    Basis *getBasis() { return _basis; }
+    coeff_t &getCoefficients() { return _coeff; }
+    coeff_t &getCoefficientsGradX() { return _coeff_grad_x; }
+    coeff_t &getCoefficientsGradY() { return _coeff_grad_y; }
+    coeff_t &getCoefficientsGradZ() { return _coeff_grad_z; }
+    RadialBasis::radcoeff_t &getRadCoeffs() { return _radcoeff; }
+	AngularBasis::angcoeff_t &getAngCoeffs() { return _angcoeff; }
+
+	void computeCoefficients(double r, vec d);
+    void computeCoefficients(double r, vec d, double weight, double weight_scale, double sigma, bool gradients);
+    // With the gradient of the weight scale given (see CutoffFunction::computeWeights)
+    void computeCoefficients(double r, vec d, double weight, double weight_scale, const vec &weight_scale_grad,
+        double sigma, bool gradients);
+    bool hasScalars() { return _has_scalars; }
+    bool hasGradients() { return _has_gradients; }
+    void add(BasisExpansion &other) { _coeff += other._coeff; }
+    void add(BasisExpansion &other, double scale) { _coeff.axpy(scale, other._coeff); }
+    // The expansion of <other> seen from the opposite end of the pair (dr -> -dr),
+    // with Y_lm(-d) = (-1)^l Y_lm(d): Q_nlm = scale*(-1)^l Q'_nlm and, as the
+    // gradients are taken wrt the other particle, dQ_nlm = scale*(-1)^(l+1) dQ'_nlm
+    void assignInverted(BasisExpansion &other, double scale);
+    void addGradient(BasisExpansion &other);
+    void zeroGradient();
+    void conjugate();
+    size_t getMemoryUsage(); // <- bytes of coefficient storage
+    void writeDensity(std::string filename, Options *options,
+        	Structure *structure, Particle *center);
+    void writeDensityOnGrid(std::string filename, Options *options,
+    	Structure *structure, Particle *center, bool fromExpansion);
+
+    void setCoefficientsNumpy(boost::python::object &array);
+    boost::python::object getCoefficientsNumpy();
+    static void registerPython();
+
+    template<class Archive>
+    void serialize(Archive &arch, const unsigned int version) {
+    	arch & _basis;
+    	arch & _radbasis;
+    	arch & _angbasis;
+
+    	arch & _has_scalars;
+    	arch & _coeff;
+
+    	arch & _has_gradients;
+    	arch & _coeff_grad_x;
+    	arch & _coeff_grad_y;
+    	arch & _coeff_grad_z;
+    }
+
+private:
+    Basis *_basis;
+	RadialBasis *_radbasis;
+	AngularBasis *_angbasis;
+
+	bool _has_scalars;
+	RadialBasis::radcoeff_t _radcoeff; // access via (n,l)
+	AngularBasis::angcoeff_t _angcoeff; // access via (l*l+l+m)
+	coeff_t _coeff; // access via (n, l*l+l+m)
+
+	bool _has_gradients;
+	vec _weight_scale_grad;
+	RadialBasis::radcoeff_t _radcoeff_grad_x;
+	RadialBasis::radcoeff_t _radcoeff_grad_y;
+	RadialBasis::radcoeff_t _radcoeff_grad_z;
+	AngularBasis::angcoeff_t _angcoeff_grad_x;
+	AngularBasis::angcoeff_t _angcoeff_grad_y;
+	AngularBasis::angcoeff_t _angcoeff_grad_z;
+	coeff_t _coeff_grad_x;
+	coeff_t _coeff_grad_y;
+	coeff_t _coeff_grad_z;
+};
+
+}
+
+#endif
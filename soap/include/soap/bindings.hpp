@@ -0,0 +1,18 @@
+#ifndef _SOAP_LINALG_BINDINGS_H
+#define	_SOAP_LINALG_BINDINGS_H
+#include <boost/python.hpp>
+#include "soap/structure.hpp"
+#include "soap/options.hpp"
+#include "soap/spectrum.hpp"
+#include "soap/contraction.hpp"
+#include "soap/mol2d.hpp"
+#include "soap/kernel.hpp"
+#include "soap/archive.hpp"
+#include "soap/xyz.hpp"
+
+namespace soap {
+
+}
+
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef _SOAP_BOUNDARY_HPP
+#define	_SOAP_BOUNDARY_HPP
+
+#include <cmath>
+
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/export.hpp>
+
+#include "soap/types.hpp"
+#include "soap/base/exceptions.hpp"
+
+namespace soap {
+
+class BoundaryOpen;
+class BoundaryOrthorhombic;
+class BoundaryTriclinic;
+
+class Boundary
+{
+public:
+
+	enum eBoxType {
+		typeOpen = 0, typeOrthorhombic, typeTriclinic
+	};
+
+	Boundary() {
+		_type = Boundary::typeOpen;
+		_box.ZeroMatrix();
+	}
+    virtual ~Boundary() {;}
+
+    void setBox(const matrix &box) {
+        _box = box;
+    }
+
+    const matrix &getBox() { return _box; };
+    virtual double BoxVolume() {
+		vec a = _box.getCol(0);
+		vec b = _box.getCol(1);
+		vec c = _box.getCol(2);
+		return (a^b)*c;
+    }
+    virtual vec connect(const vec &r_i, const vec &r_j) const {
+    	return r_j - r_i;
+    }
+    // Batched connect, one-to-many: dr[k] = connect(r_i, r_j[k]), d2[k] = |dr[k]|^2
+    // for k < n (d2 may be NULL). Overridden with vectorizable kernels below.
+    virtual void connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+    // Batched connect, pairwise: dr[k] = connect(r_i[k], r_j[k])
+    virtual void connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+
+    virtual std::vector<int> calculateRepetitions(double cutoff) {
+        std::vector<int> na_nb_nc = { 0, 0, 0 };
+        return na_nb_nc;
+    }
+
+    virtual eBoxType getBoxType() { return _type; }
+
+    template<class Archive>
+    void serialize(Archive &arch, const unsigned int version) {
+    	arch & _box;
+    	arch & _type;
+    }
+
+protected:
+    matrix _box;
+    eBoxType _type;
+};
+
+
+class BoundaryOpen : public Boundary
+{
+public:
+	BoundaryOpen(const matrix &box) {
+		 _type = Boundary::typeOpen;
+		 _box = box;
+	}
+	BoundaryOpen() {
+		_type = Boundary::typeOpen;
+		_box.ZeroMatrix();
+	}
+    vec connect(const vec &r_i, const vec &r_j) const {
+    	return r_j - r_i;
+    }
+    void connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+    void connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+    template<class Archive>
+	void serialize(Archive &arch, const unsigned int version) {
+		arch & boost::serialization::base_object<Boundary>(*this);
+	}
+};
+
+class BoundaryOrthorhombic : public Boundary
+{
+public:
+	BoundaryOrthorhombic(const matrix &box) {
+		 _type = Boundary::typeOrthorhombic;
+		 _box = box;
+	}
+	BoundaryOrthorhombic() {
+		_type = Boundary::typeOrthorhombic;
+		_box.UnitMatrix();
+	}
+	vec connect(const vec &r_i, const vec &r_j) const;
+	void connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+	void connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+
+	virtual std::vector<int> calculateRepetitions(double cutoff);
+
+	template<class Archive>
+	void serialize(Archive &arch, const unsigned int version) {
+		arch & boost::serialization::base_object<Boundary>(*this);
+	}
+};
+
+class BoundaryTriclinic : public Boundary
+{
+public:
+	BoundaryTriclinic(const matrix &box) {
+		_type = Boundary::typeTriclinic;
+		_box = box;
+		this->setupInverseBox();
+	}
+	BoundaryTriclinic() {
+		_type = Boundary::typeTriclinic;
+		_box.UnitMatrix();
+	}
+	virtual vec connect(const vec &r_i, const vec &r_j) const;
+	void connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+	void connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+
+	virtual std::vector<int> calculateRepetitions(double cutoff);
+
+	template<class Archive>
+	void serialize(Archive &arch, const unsigned int version) {
+		arch & boost::serialization::base_object<Boundary>(*this);
+		// The inverse box is not archived
+		if (Archive::is_loading::value) this->setupInverseBox();
+	}
+private:
+    void setupInverseBox();
+    matrix _inv_box;
+};
+
+}
+
+BOOST_CLASS_EXPORT_KEY(soap::Boundary);
+BOOST_CLASS_EXPORT_KEY(soap::BoundaryOpen);
+BOOST_CLASS_EXPORT_KEY(soap::BoundaryOrthorhombic);
+BOOST_CLASS_EXPORT_KEY(soap::BoundaryTriclinic);
+
+#endif
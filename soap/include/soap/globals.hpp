@@ -0,0 +1,31 @@
+#ifndef _SOAP_GLOBALS_H
+#define	_SOAP_GLOBALS_H
+
+#include "soap/base/logger.hpp"
+
+/*
+ * Leveled, thread-safe logging: GLOG_AT(soap::logINFO) << ... << std::endl;
+ * The message is neither formatted nor evaluated if its level exceeds
+ * SOAP_LOG_LEVEL_COMPILE (constant, the branch is removed by the compiler)
+ * or the runtime report level of GLOG, or if GLOG is silenced.
+ */
+#define GLOG_AT(level) \
+if ((level) > SOAP_LOG_LEVEL_COMPILE || !soap::GLOG.isEnabled(level)) ; \
+else soap::GLOG.threadStream(level)
+
+#define GLOG_DEBUG() GLOG_AT(soap::logDEBUG)
+
+namespace soap {
+
+    extern Logger GLOG;
+    void GLOG_SILENCE();
+    void GLOG_VERBOSE(bool verbose);
+    void GLOG_SET_LEVEL(std::string level);
+
+    namespace constants {
+        const double ANGSTROM_TO_BOHR = 1./0.52917721067;
+    }
+
+}
+
+#endif
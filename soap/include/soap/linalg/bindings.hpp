@@ -0,0 +1,12 @@
+#ifndef _SOAP_LINALG_BINDINGS_H
+#define	_SOAP_LINALG_BINDINGS_H
+#include "soap/linalg/vec.hpp"
+#include "soap/linalg/matrix.hpp"
+
+namespace soap { namespace linalg {
+
+}}
+
+
+#endif
+
@@ -0,0 +1,10 @@
+#ifndef _SOAP_LINALG_TYPES_H
+#define	_SOAP_LINALG_TYPES_H
+
+#include "soap/linalg/vec.hpp"
+
+namespace soap { namespace linalg {
+
+}}
+
+#endif
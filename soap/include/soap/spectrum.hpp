@@ -0,0 +1,297 @@
+#ifndef _SOAP_SPECTRUM_HPP
+#define _SOAP_SPECTRUM_HPP
+
+#include <assert.h>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/complex.hpp>
+#include <boost/serialization/base_object.hpp>
+
+#include "soap/base/logger.hpp"
+#include "soap/types.hpp"
+#include "soap/globals.hpp"
+#include "soap/options.hpp"
+#include "soap/structure.hpp"
+#include "soap/basis.hpp"
+#include "soap/power.hpp"
+#include "soap/atomicspectrum.hpp"
+
+
+namespace soap {
+
+struct neighbour_list_t;
+
+// TODO Spectrum(System1, System2, options) where Sys1 <> Sources, Sys2 <> Targets
+class Spectrum
+{
+public:
+	typedef std::vector<AtomicSpectrum*> atomspec_array_t;
+	typedef std::vector<AtomicSpectrum*>::iterator atomic_it_t;
+	typedef std::map<std::string, atomspec_array_t> map_atomspec_array_t;
+
+    Spectrum();
+	Spectrum(std::string archfile);
+	Spectrum(Structure &structure, Options &options);
+	Spectrum(Structure &structure, Options &options, Basis &basis);
+   ~Spectrum();
+
+    Structure *getStructure() { return _structure; }
+    Options *getOptions() { return _options; }
+    Basis *getBasis() { return _basis; }
+
+    atomic_it_t beginAtomic() { return _atomspec_array.begin(); }
+    atomic_it_t endAtomic() { return _atomspec_array.end(); }
+
+	void saveAndClean() { std::cout << "spectrum::save&clean" << std::endl; }
+	void save(std::string archfile);
+    std::string saves(bool prune = true);
+	void load(std::string archfile);
+    Spectrum &loads(std::string bstr);
+	void clean(); // <- deletes all atomic spectra, releases the arena
+    int length() { return _atomspec_array.size(); }
+
+	void compute();
+    void compute(Segment *centers);
+	void compute(Segment *centers, Segment *targets);
+	void compute(Structure::particle_array_t &sources, Structure::particle_array_t &targets);
+	AtomicSpectrum *computeAtomic(Particle *center);
+	AtomicSpectrum *computeAtomic(Particle *center, Structure::particle_array_t &targets);
+    AtomicSpectrum *computeGlobal();
+	void deleteGlobal();
+	void addAtomic(AtomicSpectrum *atomspec);
+	AtomicSpectrum *getAtomic(int slot_idx, std::string center_type);
+	AtomicSpectrum *getGlobal() { assert(_global_atomic && "Compute first"); return _global_atomic; }
+	void writeDensityOnGrid(int slot_idx, std::string center_type, std::string density_type);
+    void writeDensityCubeFile(int atom_idx, std::string density_type, std::string filename, bool from_expansion);
+	void writeDensityOnGridInverse(int slot_idx, std::string center_type, std::string type1, std::string type2);
+	void writeDensity(int slot_idx, std::string center_type, std::string density_type);
+	void writePowerDensity(int slot_idx, std::string center_type, std::string type1, std::string type2);
+
+	void computePower();
+	void computePowerGradients();
+	void computeLinear();
+	// MEMORY
+	// Coefficient storage held by the atomic & global spectra
+	spectrum_memory_t getMemoryUsage();
+	// Predicted footprint of compute & computePower (+ computePowerGradients, + computeGlobal)
+	// from the neighbours within the cutoff, without expanding any densities
+	static spectrum_memory_t estimateMemory(Structure &structure, Options &options,
+	    bool power_gradients, bool global);
+	static spectrum_memory_t estimateMemory(Structure &structure, Options &options,
+	    Structure::particle_array_t &centers, Structure::particle_array_t &targets,
+	    bool power_gradients, bool global);
+	boost::python::dict getMemoryUsagePython();
+	static boost::python::dict estimateMemoryPython(Structure &structure, Options &options,
+	    bool power_gradients, bool global);
+	void computeForcesAdjoint(ub::matrix<double> &dE_dX, bool global, ub::matrix<double> &forces);
+	boost::python::object computeForcesAdjointNumpy(boost::python::object &dE_dX, bool global);
+	boost::python::tuple getLinearGradBSR();
+
+	static void registerPython();
+
+	template<class Archive>
+	void serialize(Archive &arch, const unsigned int version) {
+		arch & _options;
+		arch & _structure;
+		arch & _basis;
+
+		arch & _atomspec_array;
+		arch & _map_atomspec_array;
+
+		arch & _global_atomic;
+		if (Archive::is_loading::value && _options) _config.resolve(*_options);
+		if (Archive::is_loading::value) _targets_valid = false; // <- not archived
+		return;
+	}
+
+private:
+	// Throws MemoryBudgetExceeded if <bytes> exceed spectrum.memory_budget (if any)
+	void checkMemoryBudget(size_t bytes, std::string where);
+	// Neighbour images of <center> among <targets> within the cutoff, with their weights
+	void findNeighbours(Particle *center, Structure::particle_array_t &targets, neighbour_list_t &nbs);
+	// Expansion of the j-th neighbour image within the cutoff into <nb_expansion>
+	void computeNeighbourExpansion(Structure::particle_array_t &targets, neighbour_list_t &nbs,
+	    int j, bool gradients, BasisExpansion &nb_expansion);
+	// Adds -Re sum_nlm dQ_nlm/dr_j conj(<lambda>_nlm) to the force on each neighbour j
+	// of <center>, recomputing dQ/dr_j image by image rather than reading stored blocks
+	void addForcesAdjoint(Particle *center, BasisExpansion::coeff_t &lambda, ub::matrix<double> &forces);
+	// <budget_bytes>: bytes held & predicted so far, grown by the footprint of each
+	// center as its neighbours are found and checked against spectrum.memory_budget
+	AtomicSpectrum *computeAtomic(Particle *center, Structure::particle_array_t &targets, size_t *budget_bytes);
+	// All <particles> as centers and targets, visiting each pair once (spectrum.half_neighbour_list)
+	void computeHalf(Structure::particle_array_t &particles, size_t *budget_bytes);
+	// Deletes the atomic spectra beyond the first <n_keep>
+	void removeAtomics(int n_keep);
+	// Throws if numpy views onto any atomic spectrum are alive (see AtomicSpectrum::assertNoArrayViews)
+	void assertNoArrayViews();
+
+	Logger *_log;
+	Options *_options;
+	SpectrumConfig _config;
+    Structure *_structure;
+    Basis *_basis;
+    bool _own_basis;
+    bool _cached_basis; // <- acquired from BasisCache, released on destruction
+    // Backs the expansions of the atomic spectra computed here (if _config.arena),
+    // so these are released in one go rather than expansion by expansion
+    base::Arena *_arena;
+    // Pid => neighbour index of the atomic spectrum under construction (or -1),
+    // reset after each (see AtomicSpectrum::releaseNeighbourIndex)
+    std::vector<int> _nb_index;
+
+    atomspec_array_t _atomspec_array;
+    map_atomspec_array_t _map_atomspec_array;
+
+    AtomicSpectrum *_global_atomic;
+    // Targets of compute, which computeForcesAdjoint recomputes the neighbour
+    // expansions over (without spectrum.gradients). Valid only if all atomic
+    // spectra were computed here over the same targets.
+    Structure::particle_array_t _targets;
+    bool _targets_valid;
+};
+
+
+class PairSpectrum
+{
+public:
+	PairSpectrum(
+	    Structure &struct1,
+        Structure &struct2,
+		Options &options)
+        : _struct1(&struct1), _struct2(&struct2), _options(&options) {}
+
+	void compute() {
+        return;
+	}
+	void saveAndClean() { std::cout << "pairspectrum::save&clean" << std::endl; }
+	static void registerPython() {
+		using namespace boost::python;
+		class_<PairSpectrum>("PairSpectrum",
+		    init<Structure &, Structure &, Options &>())
+			.def("compute", &PairSpectrum::compute)
+			.def("saveAndClean", &PairSpectrum::saveAndClean);
+	}
+
+private:
+    Structure *_struct1;
+	Structure *_struct2;
+	Options *_options;
+};
+
+class SpectrumOverlap
+{
+	SpectrumOverlap() {}
+};
+
+
+
+
+
+/* STORAGE, BASIS, COMPUTATION, PARALLELIZATION */
+/*
+ *
+ * Spectrum, PowerSpectrum
+ * SpectrumK, PowerSpectrumK
+ * StructureK, ParticleK (with weight, type)
+ *
+ * Basis
+ * BasisFactory
+ *
+ * RadialBasis
+ * RadialBasisLegendre
+ * RadialBasisGaussian
+ * RadialBasisHermite
+ *
+ * AngularBasis
+ * AngularBasisHarmonic
+ */
+
+
+/*
+ * Parallelization
+ *     based on centers
+ *     based on wavevectors
+ */
+
+/*
+ * Spectrum->Setup(system, options)
+ *     -> Basis->Setup()
+ * Compute(patterns)
+ *     for pattern in patterns:
+ *        single out neighbours that match pattern
+ *        for each neighbour:
+ *            -> Compute(pos, refpos)
+ */
+
+/*
+ * PowerSpectrum->Setup(Expansion)
+ *      [a][b][n][n'][l] = sum{m} [a][nlm]*[b][n'lm]
+ *
+ * Spectrum in linear storage:
+ * Start n at offset_n = (n-1)*(L+1)^2
+ *     Start l at offset_l = offset_n + l^2
+ *         Start m at offset_m = offset_l + (m+l)
+ *
+ * PowerSpectrum in linear storage:
+ * Start n at offset_n = (n-1)*N*(L+1)
+ *     Start n' at offset_n' = offset_n + (n'-1)*(L+1)
+ *         Start l at offset_l = offset_n'
+ *
+ * map< pattern1, spectrum  >
+ * for (nit in spectrum)
+ *     for (lit in nit)
+ *         for (mit in lit)
+ *             nit->n
+ *             lit->l
+ *             mit->m
+ *
+ *
+ */
+
+/*
+ * Storage:
+ *     -> Serialize()
+ *     For each center:
+ *         for each pattern:
+ *             [n][l][m]
+ *     Store [n] and [l][m] separately?
+ *
+ *     -> PowerSerialize()
+ *     For each center:
+ *         for each pair of patterns:
+ *             [n][n'][l]
+ */
+
+/*
+ *
+ * Types of basis functions: Legendre, Hermite, Gaussian*
+ * Make sure to include appropriate n-factors, e.g. sqrt(2*n+1) for Legendre
+ * Normalized on which interval?
+ *
+ * e.g. RadialBasisLegendre : RadialBasis
+ *
+ * RadialBasis->Setup()
+ *     -> Orthogonalize()
+ * RadialBasis -> EvaluateAt(radius)
+ *     -> AtomicBasis->EvaluateAt(radius)
+ *     -> Transform coefficients
+ *     -> Return coefficients (N-vector)
+ * RadialBasis->Iterator() ?
+ *
+ */
+
+/*
+ * AngularBasis->Setup()
+ * AngularBasis->EvaluateAt(direction)
+ *     -> AtomicBasisL->EvaluateAt(radius)
+ *          -> AtomicBasisLM -> EvaluateAt(radius)
+ *     -> Return coefficients (L*M-vector)
+ * AngularBasis->Iterator()
+ */
+
+
+
+}
+
+
+#endif /* _SOAP_RADIALBASIS_HPP_ */
@@ -0,0 +1,65 @@
+#ifndef _SOAP_XYZ_HPP
+#define _SOAP_XYZ_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <boost/python.hpp>
+
+#include "soap/base/exceptions.hpp"
+#include "soap/structure.hpp"
+
+namespace soap {
+
+// Reader for multi-frame (extended) XYZ files. The file is memory-mapped and
+// the frame offsets indexed in a single pass on construction, frames are only
+// parsed into structures on access. Recognized header keys:
+// o Lattice="ax ay az bx by bz cx cy cz" (cell vectors as rows)
+// o pbc="T T T" (defaults to periodic if a lattice is given)
+// o Properties=species:S:1:pos:R:3:... (columns of species and positions,
+//   defaults to species in the first and positions in the next three columns)
+// o label=... (structure label)
+// Other key=value pairs are available via getInfo. Headers without key=value
+// pairs (plain XYZ comments) are accepted.
+
+struct xyz_frame_t
+{
+    size_t offset_header; // <- comment line
+    size_t offset_atoms; // <- first atom line
+    int n_atoms;
+};
+
+class XyzReader
+{
+public:
+    XyzReader(std::string filename);
+   ~XyzReader();
+
+    int nFrames() { return _frames.size(); }
+    const xyz_frame_t &getFrame(int frame);
+    // Header key-value pairs, flags without value map onto "T"
+    std::map<std::string, std::string> getInfo(int frame);
+    // New structure (owned by the caller)
+    Structure *read(int frame);
+    // New structures from frames [first, first+n), parsed by <n_threads> threads
+    void readChunk(int first, int n, int n_threads, std::vector<Structure*> &structures);
+
+    boost::python::dict getInfoPython(int frame);
+    boost::python::list readChunkPython(int first, int n, int n_threads);
+    static void registerPython();
+
+private:
+    void index();
+    const char *lineEnd(const char *p) const;
+    void parseHeader(int frame, std::map<std::string, std::string> &info);
+
+    std::string _filename;
+    int _fd;
+    const char *_data;
+    size_t _size;
+    std::vector<xyz_frame_t> _frames;
+};
+
+}
+
+#endif /* _SOAP_XYZ_HPP */
@@ -0,0 +1,3 @@
+from _linalg import *
+from permanent import *
+
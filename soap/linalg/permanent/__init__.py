@@ -0,0 +1,2 @@
+__all__= [ "permanent_mc", "permanent_ryser", "regmatch" ]
+from _permanent import *
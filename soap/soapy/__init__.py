@@ -0,0 +1,11 @@
+from kernel import *
+from simspace import *
+from dimred import *
+from pca import *
+from util import *
+from math import *
+from elements import *
+import learn
+import lamatch
+import graph
+
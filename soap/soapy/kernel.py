@@ -0,0 +1,1108 @@
+#! /usr/bin/env python
+import soap
+import soap.tools
+
+import os
+import numpy as np
+import logging
+from momo import osio, endl, flush
+
+# TODO Unit test for global spectrum                                    REMARK ~ok, automatize
+# TODO Check outer kernel derivative                                    REMARK ~ok, automatize
+# TODO Check normalization derivative (compute on C++ level already)    REMARK ~ok, -> C++
+
+# TODO PCA + identification of eigenstructures
+# TODO Sample Bethe tree
+
+class DescriptorMap(object):
+    """
+    Structured data type that stores
+    descriptors as key-value pairs
+    and emulates basic algebraic properties
+    """
+    def __init__(self):
+        self.dmap = {}
+        #self.T = self # Transpose
+    @property
+    def T(self):
+        return self
+    def dot(self, other):
+        dot = 0.0
+        for key in self.dmap:
+            if key in other.dmap:
+                dot += self[key].dot(other[key])
+        return dot
+    def add(self, other):
+        for key in other:
+            if key in self:
+                self.dmap[key] = self.dmap[key] + other[key]
+            else:
+                self.dmap[key] = other[key]
+        return
+    def normalise(self):
+        norm = self.dot(self)**0.5
+        for key in self.dmap:
+            self.dmap[key] = self.dmap[key] / norm
+        return
+    def __div__(self, scalar):
+        for k in self:
+            self[k] = self[k]/scalar
+        return self
+    def __mul__(self, scalar):
+        for k in self:
+            self[k] = self[k]*scalar
+        return self
+    def __getitem__(self, key):
+        return self.dmap[key]
+    def __setitem__(self, key, value):
+        self.dmap[key] = value
+    def __iter__(self):
+        return iter(self.dmap)
+    def __len__(self):
+        return len(self.dmap)
+    def __contains__(self, key):
+        return key in self.dmap
+
+class DescriptorMapMatrix(object):
+    """
+    List of <DescriptorMap>s
+    """
+    def __init__(self):
+        self.mat = []
+        self.T = self # Transpose
+    def append(self, other):
+        self.mat.append(other)
+    def dot(self, other, dtype='float64'):
+        n = len(self)
+        m = len(other)
+        k = np.zeros((n,m), dtype=dtype)
+        for i in range(n):
+            for j in range(m):
+                k[i,j] = self[i].dot(other[j])
+        return k
+    def sum(self, axis=0):
+        assert axis == 0
+        dmap_summed = soap.soapy.DescriptorMap()
+        for dmap in self:
+            dmap_summed.add(dmap)
+        return dmap_summed
+    def __len__(self):
+        return len(self.mat)
+    def __getitem__(self, i):
+        return self.mat[i]
+    def __iter__(self):
+        return iter(self.mat)
+
+class TrajectoryLogger(object):
+    def __init__(self, outfile, mode='w'):
+        self.ofs = open(outfile, mode)
+    def logFrame(self, structure):
+        # Write first frame
+        self.ofs.write('%d\n\n' % structure.n_particles)
+        for p in structure.particles:
+            r = p.pos
+            self.ofs.write('%s %+1.7f %+1.7f %+1.7f\n' % (p.type, r[0], r[1], r[2]))
+        return
+    def close(self):
+        self.ofs.close()
+        return
+
+class KernelAdaptorFTD(object):
+    def __init__(self, options, types_global):
+        self.types = types_global
+        self.S = len(types_global)
+        return
+    def adapt(self, spectrum, return_pos_matrix=False):
+        IX = np.zeros((0,0), dtype='float64') # feature matrix
+        dimX = -1
+        IR = np.zeros((0,0), dtype='float64') # position matrix
+        types = []
+        for atomic_i in spectrum:
+            Xi_unnorm, Xi_norm = self.adaptScalar(atomic_i)
+            Ri = atomic_i.getCenter().pos
+            types.append(atomic_i.getCenter().type)
+            dimX = Xi_norm.shape[0]
+            if not IX.any():
+                IX = np.copy(Xi_norm) # TODO Is this necessary?
+                IX.resize((1, dimX))
+                IR = np.copy(Ri)
+                IR.resize((1, 3))
+            else:
+                i = IX.shape[0]
+                IX.resize((i+1, dimX))
+                IX[-1,:] = Xi_norm
+                IR.resize((i+1, 3))
+                IR[-1,:] = Ri
+        if return_pos_matrix:
+            return IX, IR, types
+        else:
+            return IX
+    def adaptScalar(self, atomic, epsilon=1e-20):
+        X = self.reduce(atomic, self.types)
+        X_mag = np.dot(X,X)**0.5
+        if X_mag < epsilon:
+            X_mag = 1.
+        X_norm = X/X_mag
+        return X, X_norm
+    def reduce(self, atomic, types_global, verbose=False):
+        types_atomic = atomic.getTypes()
+        S = len(types_global)
+        SS = S*S
+        S_atomic = len(types_atomic)
+        X = None
+        dim_ab = -1
+        dim_total = -1
+        # Channel - type a
+        for i in range(S_atomic):
+            a = types_atomic[i]
+            sa = types_global.index(a)
+            # Channel - type b
+            for j in range(S_atomic):
+                b = types_atomic[j]
+                sb = types_global.index(b)
+                x = atomic.getPower(a,b)
+                # Initialize aggregated array
+                if i == 0 and j == 0:
+                    dim_ab = x.shape[0]*x.shape[1]
+                    dim_total = SS*dim_ab
+                    X = np.zeros((dim_total,), dtype='float64')
+                # Locate in super-array X
+                i0 = (sa*S+sb)*dim_ab
+                i1 = i0 + dim_ab
+                X[i0:i1] = x.flatten()
+        return X
+
+class Xnklab(object):
+    def __init__(self, atomic, types_global):
+        self.types_global = types_global
+        self.S = len(types_global)
+        self.N = atomic.basis.N
+        self.L = atomic.basis.L
+        # Descriptor dimension
+        self.dim_linear_xnklab = (self.S*self.S+self.S)/2*(self.N*self.N*(self.L+1))
+        self.dim_linear_xnkl = self.N*self.N*(self.L+1)
+        S = self.S
+        N = self.N
+        L = self.L
+        # Setup
+        self.X = np.zeros((S*N*N,S*(L+1)))
+        types_atomic = atomic.getTypes()
+        S_atomic = len(types_atomic)
+        for i in range(S_atomic):
+            a = types_atomic[i]
+            sa = types_global.index(a)
+            for j in range(S_atomic):
+                b = types_atomic[j]
+                sb = types_global.index(b)
+                xnklab = atomic.getPower(a,b).array
+                r1 = sa*N*N
+                r2 = r1+N*N
+                c1 = sb*(L+1)
+                c2 = c1+(L+1)
+                self.X[r1:r2,c1:c2] = xnklab.real
+                #print a, b, sa, sb
+                #print self.X
+                #raw_input('...')
+        #print "DONE"
+        return
+    def reduce(self):
+        dim_linear_xnklab = self.dim_linear_xnklab
+        dim_linear_xnkl = self.dim_linear_xnkl
+        self.X_linear = np.zeros((dim_linear_xnklab))
+        for sa in range(self.S):
+            for sb in range(sa,self.S):
+                # Find slice in matrix X
+                r1 = sa*self.N*self.N
+                r2 = r1+self.N*self.N
+                c1 = sb*(self.L+1)
+                c2 = c1+(self.L+1)
+                xnkl_linear = self.X[r1:r2,c1:c2].reshape((dim_linear_xnkl))
+                # Map to vector
+                sab = self.S*sa - (sa*sa-sa)/2 + (sb-sa) # Linear summation over upper triagonal section
+                idx0 = sab*dim_linear_xnkl
+                idx1 = (sab+1)*dim_linear_xnkl
+                self.X_linear[idx0:idx1] = xnkl_linear
+                #print sa, sb, sab, idx0, idx1
+                #print self.X_linear
+                #raw_input('...')
+        return self.X_linear
+
+def reduce_xnklab_atomic(atomic, types_global, verbose=False):
+    types_atomic = atomic.getTypes()
+    N = atomic.basis.N
+    L = atomic.basis.L
+    S = len(types_global)
+    S_atomic = len(types_atomic)
+
+    # ORGANIZATION:
+    # | <-        dim_aa_sum = off_ab -> | <-    dim_ab_sum                 -> |
+    # | 11 <- dim_aa_red -> 22 <- ... -> | 12,21 <- dim_ab_red -> 13,31 ... -> |
+    dim_aa_red = (N*N+N)/2*(L+1)
+    dim_aa_sum = S*dim_aa_red
+
+    off_ab = dim_aa_sum
+    dim_ab_red = N*N*(L+1)
+    dim_ab_sum = (S*S-S)/2*dim_ab_red
+
+    X = np.zeros((dim_aa_sum+dim_ab_sum))
+
+    if verbose:
+        print "Global types:", types_global
+        print "Local types: ", types_atomic
+        print "Dim. aa (one pair  a=b) ", dim_aa_red
+        print "Dim. aa (all pairs a=b) ", dim_aa_sum
+        print "Dim. ab (one pair  a!=b)", dim_ab_red
+        print "Dim. ab (all pairs a<b)", dim_ab_sum
+
+    # SPECIES a = b
+    for i in range(S_atomic):
+        a = types_atomic[i]
+        xnklaa = atomic.getPower(a,a).array.real
+        xnklaa_red = np.zeros(((N*N+N)/2, L+1))
+        # Select where n <= k
+        for i in range(N):
+            for j in range(i, N):
+                ij_red = i*N - (i*i-i)/2 + j-i
+                xnklaa_red[ij_red] = xnklaa[i*N+j]
+        # Locate in global array
+        sa = types_global.index(a)
+        i0 = sa*dim_aa_red
+        i1 = i0 + dim_aa_red
+        X[i0:i1] = xnklaa_red.flatten()
+        #print a,X
+        #raw_input('...')
+        #print a,sa,i0,i1
+
+    # SPECIES a != b
+    for i in range(S_atomic):
+        for j in range(i+1, S_atomic):
+            # Select all
+            a = types_atomic[i]
+            b = types_atomic[j]
+            xnklab = atomic.getPower(a,b).array.real
+            xnklab_red = xnklab
+            # Locate in global array
+            sa = types_global.index(a)
+            sb = types_global.index(b)
+            if sa > sb:
+                stmp = sa
+                sa = sb
+                sb = stmp
+            i0 = off_ab + (sa*S - (sa*sa+sa)/2 + sb-sa-1)*dim_ab_red
+            i1 = i0 + dim_ab_red
+            X[i0:i1] = xnklab.flatten()
+            #print a,b,X
+            #raw_input('...')
+            #print a,b,sa,sb,i0,i1
+    return X
+
+class KernelAdaptorSpecificUniqueDMap(object):
+    def __init__(self, options, types_global=None):
+        return
+    def adapt(self, spectrum, return_pos_matrix=False):
+        IDMap = DescriptorMapMatrix() # List of <DescriptorMaps>
+        dimX = -1
+        IR = np.zeros((len(spectrum),3), dtype='float64') # position matrix
+        types = []
+        for idx, atomic_i in enumerate(spectrum):
+            IDMap.append(self.adaptScalar(atomic_i))
+            Ri = atomic_i.getCenter().pos
+            types.append(atomic_i.getCenter().type)
+            IR[idx,:] = Ri
+        if return_pos_matrix:
+            return IDMap, IR, types
+        else:
+            return IDMap
+    def adaptScalar(self, atomic, epsilon=1e-20):
+        dmap = DescriptorMap()
+        types_atomic = atomic.getTypes()
+        S = len(types_atomic)
+        N = atomic.basis.N
+        L = atomic.basis.L
+        # SPECIES a = b
+        for i in range(S):
+            a = types_atomic[i]
+            xnklaa = atomic.getPower(a,a).array.real
+            xnklaa_red = np.zeros(((N*N+N)/2, L+1))
+            # Select where n <= k
+            for i in range(N):
+                for j in range(i, N):
+                    ij_red = i*N - (i*i-i)/2 + j-i
+                    xnklaa_red[ij_red] = xnklaa[i*N+j]
+            dmap['%s:%s' % (a,a)] = xnklaa_red.flatten()
+        # SPECIES a != b
+        for i in range(S):
+            for j in range(i+1, S):
+                # Select all
+                a = types_atomic[i]
+                b = types_atomic[j]
+                xnklab = atomic.getPower(a,b).array.real
+                xnklab_red = xnklab
+                pair_ab = '%s:%s' % ((a,b) if a < b else (b,a))
+                dmap[pair_ab] = xnklab_red.flatten()
+        dmap.normalise()
+        return dmap
+
+class KernelAdaptorSpecificUnique(object):
+    """
+    Extracts Xnklab from spectrum, while removing duplicates
+    resulting from elements that are identical by symmetry:
+    e.g., Xnklab and Xknlba, and Xnklab and Xknlab if a=b
+    """
+    def __init__(self, options, types_global):
+        self.types = types_global
+        self.S = len(types_global)
+        return
+    def adapt(self, spectrum, return_pos_matrix=False):
+        IX = np.zeros((0,0), dtype='float64') # feature matrix
+        dimX = -1
+        IR = np.zeros((0,0), dtype='float64') # position matrix
+        types = []
+        for atomic_i in spectrum:
+            Xi_unnorm, Xi_norm = self.adaptScalar(atomic_i)
+            Ri = atomic_i.getCenter().pos
+            types.append(atomic_i.getCenter().type)
+            dimX = Xi_norm.shape[0]
+            if not IX.any():
+                IX = np.copy(Xi_norm) # TODO Is this necessary?
+                IX.resize((1, dimX))
+                IR = np.copy(Ri)
+                IR.resize((1, 3))
+            else:
+                i = IX.shape[0]
+                IX.resize((i+1, dimX))
+                IX[-1,:] = Xi_norm
+                IR.resize((i+1, 3))
+                IR[-1,:] = Ri
+        if return_pos_matrix:
+            return IX, IR, types
+        else:
+            return IX
+    def adaptScalar(self, atomic, epsilon=1e-20):
+        X = reduce_xnklab_atomic(atomic, self.types)
+        X_mag = np.dot(X,X)**0.5
+        if X_mag < epsilon:
+            X_mag = 1.
+        X_norm = X/X_mag
+        return X, X_norm
+
+class KernelAdaptorSpecific(object):
+    """
+    WARNING: Duplicate components in Xnklab are not removed
+    """
+    def __init__(self, options, types_global):
+        self.types = types_global
+        self.S = len(types_global)
+        return
+    def adapt(self, spectrum):
+        IX = np.zeros((0,0), dtype='float64')
+        dimX = -1
+        for atomic_i in spectrum:
+            Xi_unnorm, Xi_norm = self.adaptScalar(atomic_i)
+            dimX = Xi_norm.shape[0]
+            if not IX.any():
+                IX = np.copy(Xi_norm) # TODO Is this necessary?
+                IX.resize((1, dimX))
+            else:
+                i = IX.shape[0]
+                IX.resize((i+1, dimX))
+                IX[-1,:] = Xi_norm
+        return IX
+    def adaptScalar(self, atomic):
+        xnklab_atomic = Xnklab(atomic, self.types)
+        X = xnklab_atomic.reduce()
+        X_norm = X/np.dot(X,X)**0.5
+        return X, X_norm
+
+class KernelAdaptorGlobalSpecificEnergy(object):
+    def __init__(self, options, types_global):
+        self.types_global = types_global
+        return
+    def adapt(self, energy_spectrum, return_pos_matrix=False, dtype='float64'):
+        dim_linear_ab = None
+        dim_linear_total = None
+        S = len(self.types_global)
+        X = None
+        for sa in self.types_global:
+            for sb in self.types_global:
+                powspec_ab = energy_spectrum.getPowerGlobal(sa, sb)
+                if powspec_ab != None:
+                    xab = powspec_ab.array.real.flatten()
+                    if not dim_linear_ab:
+                        dim_linear_ab = xab.shape[0]
+                        dim_linear_total = S**2*dim_linear_ab
+                        X = np.zeros((S, S*dim_linear_ab), dtype=dtype)
+                    else: assert dim_linear_ab == xab.shape[0]
+                    isa = self.types_global.index(sa)
+                    isb = self.types_global.index(sb)
+                    i0 = isa
+                    i1 = isa+1
+                    j0 = isb*dim_linear_ab
+                    j1 = j0+dim_linear_ab
+                    X[i0:i1,j0:j1] = xab
+        X = X.flatten()
+        X = X/np.dot(X,X)**0.5
+        if return_pos_matrix:
+            return X, np.array([[0.,0.,0.]]), ["global"]
+        else: return X
+
+class KernelAdaptorGlobalSpecific(object):
+    def __init__(self, options, types_global=None):
+        self.types = types_global
+        self.S = len(types_global)
+        return
+    def getListAtomic(self, spectrum):
+        return [ spectrum.getGlobal() ]
+    def adapt(self, spectrum, return_pos_matrix=False):
+        # EXTRACT A SET OF CENTER-BASED POWER EXPANSIONS
+        # Here: only global
+        IX = np.zeros((0,0), dtype='complex128')
+        dimX = -1
+        atomic_global = spectrum.getGlobal()
+        Xi_unnorm, Xi_norm = self.adaptScalar(atomic_global)
+        dimX = Xi_norm.shape[0]
+        IX = np.copy(Xi_norm)
+        IX.resize((1,dimX))
+        if return_pos_matrix:
+            return IX, np.array([0.,0.,0.]), ["global"]
+        else: return IX
+    def adaptScalar(self, atomic):
+        xnklab_atomic = Xnklab(atomic, self.types)
+        X = xnklab_atomic.reduce()
+        X_norm = X/np.dot(X,X)**0.5
+        return X, X_norm
+
+class KernelAdaptorGlobalSpecificDMap(object):
+    def __init__(self, options, types_global=None):
+        return
+    def adapt(self, spectrum, return_pos_matrix=False):
+        IDMap = DescriptorMapMatrix() # List of <DescriptorMaps>
+        dimX = -1
+        IR = np.zeros((1,3), dtype='float64') # position matrix
+        types = []
+        atomic_i = spectrum.getGlobal()
+        IDMap.append(self.adaptScalar(atomic_i))
+        Ri = np.array([0., 0., 0.])
+        types.append("global")
+        IR[0,:] = Ri
+        if return_pos_matrix:
+            return IDMap, IR, types
+        else:
+            return IDMap
+    def adaptScalar(self, atomic, epsilon=1e-20):
+        dmap = DescriptorMap()
+        types_atomic = atomic.getTypes()
+        S = len(types_atomic)
+        N = atomic.basis.N
+        L = atomic.basis.L
+        # SPECIES a = b
+        for i in range(S):
+            a = types_atomic[i]
+            xnklaa = atomic.getPower(a,a).array.real
+            xnklaa_red = np.zeros(((N*N+N)/2, L+1))
+            # Select where n <= k
+            for i in range(N):
+                for j in range(i, N):
+                    ij_red = i*N - (i*i-i)/2 + j-i
+                    xnklaa_red[ij_red] = xnklaa[i*N+j]
+            dmap['%s:%s' % (a,a)] = xnklaa_red.flatten()
+        # SPECIES a != b
+        for i in range(S):
+            for j in range(i+1, S):
+                # Select all
+                a = types_atomic[i]
+                b = types_atomic[j]
+                xnklab = atomic.getPower(a,b).array.real
+                xnklab_red = xnklab
+                pair_ab = '%s:%s' % ((a,b) if a < b else (b,a))
+                dmap[pair_ab] = xnklab_red.flatten()
+        dmap.normalise()
+        return dmap
+
+class KernelAdaptorGeneric(object):
+    def __init__(self, options, types_global=None):
+        return
+    def getListAtomic(self, spectrum):
+        return spectrum
+    def adapt(self, spectrum):
+        # IX = [
+        #    X1 ->,
+        #    X2 ->,
+        #    ...
+        # ]
+        IX = np.zeros((0,0), dtype='complex128')
+        dimX = -1
+        # TODO More adaptors:
+        # TODO Particle ID mask, center-type mask
+        # TODO For type-resolved adaptors, increase dimensionality accordingly
+        for atomic_i in spectrum:
+            #print atomic_i.getCenter().pos
+            #if pid_list:
+            #    pid = atomic_i.getCenter().id
+            #    if not pid in pid_list:
+            #        logging.debug("Skip, adapt atomic, pid = %d" % pid)
+            #        continue
+
+            Xi_unnorm, Xi_norm = self.adaptScalar(atomic_i)
+            dimX = Xi_norm.shape[0]
+            #Xi = np.real(atomic_i.getPower("","").array)
+            #dimX = Xi.shape[0]*Xi.shape[1]
+            #Xi = Xi.reshape((dimX))
+
+            #print "dim(X) =", dimX
+            if not IX.any():
+                IX = np.copy(Xi_norm) # TODO Is this necessary?
+                IX.resize((1, dimX))
+            else:
+                i = IX.shape[0]
+                IX.resize((i+1, dimX))
+                IX[-1,:] = Xi_norm
+            #print IX
+        return IX
+    def adaptScalar(self, atomic):
+        X = np.real(atomic.getPower("","").array)
+        dimX = X.shape[0]*X.shape[1]
+        X = np.real(X.reshape((dimX)))
+        # Normalize
+        X_norm = X/np.dot(X,X)**0.5
+        return X, X_norm
+    def adaptGradients(self, atomic, nb_pid, X):
+        # NOTE X must not be normalized (=> X = X')
+        dxnkl_pid = atomic.getPowerGradGeneric(nb_pid)
+        dX_dx = dxnkl_pid.getArrayGradX()
+        dX_dy = dxnkl_pid.getArrayGradY()
+        dX_dz = dxnkl_pid.getArrayGradZ()
+        dimX = dX_dx.shape[0]*dX_dx.shape[1]
+        dX_dx = np.real(dX_dx.reshape((dimX)))
+        dX_dy = np.real(dX_dy.reshape((dimX)))
+        dX_dz = np.real(dX_dz.reshape((dimX)))
+        # Normalize
+        mag_X = np.dot(X,X)**0.5
+        dX_dx = dX_dx/mag_X - np.dot(X, dX_dx)/mag_X**3 * X
+        dX_dy = dX_dy/mag_X - np.dot(X, dX_dy)/mag_X**3 * X
+        dX_dz = dX_dz/mag_X - np.dot(X, dX_dz)/mag_X**3 * X
+        return dX_dx, dX_dy, dX_dz
+    def adaptSensitivities(self, X, dE_dX_norm):
+        # NOTE X is not normalized (=> X = X'); returns dE/dX'
+        mag_X = np.dot(X,X)**0.5
+        return dE_dX_norm/mag_X - np.dot(X, dE_dX_norm)/mag_X**3 * X
+
+class KernelAdaptorGlobalGeneric(object):
+    def __init__(self, options, types_global=None):
+        return
+    def getListAtomic(self, spectrum):
+        return [ spectrum.getGlobal() ]
+    def adapt(self, spectrum):
+        # EXTRACT A SET OF CENTER-BASED POWER EXPANSIONS
+        # Here: only global
+        IX = np.zeros((0,0), dtype='complex128')
+        dimX = -1
+        atomic_global = spectrum.getGlobal()
+        Xi_unnorm, Xi_norm = self.adaptScalar(atomic_global)
+        dimX = Xi_norm.shape[0]
+        IX = np.copy(Xi_norm)
+        IX.resize((1,dimX))
+        return IX
+    def adaptScalar(self, atomic):
+        # EXTRACT POWER EXPANSION FROM ATOMIC SPECTRUM
+        # Here: type "":"" (= generic)
+        X = np.real(atomic.getPower("","").array)
+        dimX = X.shape[0]*X.shape[1]
+        X = np.real(X.reshape((dimX)))
+        # Normalize
+        X_norm = X/np.dot(X,X)**0.5
+        return X, X_norm
+    def adaptGradients(self, atomic, nb_pid, X):
+        # NOTE X is not normalized (=> X = X')
+        dxnkl_pid = atomic.getPowerGradGeneric(nb_pid)
+        dX_dx = dxnkl_pid.getArrayGradX()
+        dX_dy = dxnkl_pid.getArrayGradY()
+        dX_dz = dxnkl_pid.getArrayGradZ()
+        dimX = dX_dx.shape[0]*dX_dx.shape[1]
+        dX_dx = np.real(dX_dx.reshape((dimX)))
+        dX_dy = np.real(dX_dy.reshape((dimX)))
+        dX_dz = np.real(dX_dz.reshape((dimX)))
+        # Normalize
+        mag_X = np.dot(X,X)**0.5
+        dX_dx = dX_dx/mag_X - np.dot(X, dX_dx)/mag_X**3 * X
+        dX_dy = dX_dy/mag_X - np.dot(X, dX_dy)/mag_X**3 * X
+        dX_dz = dX_dz/mag_X - np.dot(X, dX_dz)/mag_X**3 * X
+        return dX_dx, dX_dy, dX_dz
+    def adaptSensitivities(self, X, dE_dX_norm):
+        # NOTE X is not normalized (=> X = X'); returns dE/dX'
+        mag_X = np.dot(X,X)**0.5
+        return dE_dX_norm/mag_X - np.dot(X, dE_dX_norm)/mag_X**3 * X
+
+class KernelFunctionGaussianDiff(object):
+    def __init__(self, options):
+        self.delta = float(options['kernel.gaussian_delta'])
+        self.sigma = float(options['kernel.gaussian_sigma'])
+    def evaluate(self, IX, IY):
+        #res = np.zeros((IX.shape[0],IY.shape[0]))
+        #for i in range(IX.shape[0]):
+        #    for j in range(IY.shape[0]):
+        #        res[i][j] = self.delta**2 * np.exp(-0.5/(self.sigma)**2 * (IX[i]-IY[j]).dot(IX[i]-IY[j]))
+        #return res
+        return self.delta**2 * np.exp(-(1. - IX.dot(IY.T))/self.sigma**2)
+
+class KernelFunctionDotShifted(object):
+    """
+    For descriptors X,Y where X.dot(Y) e [-1,+1]
+    => k e [0,1]
+    """
+    def __init__(self, options):
+        self.delta = float(options['kernel.delta'])
+        self.xi = float(options['kernel.xi'])
+        return
+    def evaluate(self, IX, IY):
+        k = 0.5*(1.+IX.dot(IY.T))
+        return self.delta**2 * k**self.xi
+
+class KernelFunctionDot(object):
+    def __init__(self, options):
+        if (type(options) == dict):
+            self.delta = float(options['kernel.delta'])
+            self.xi = float(options['kernel.xi'])
+        else:
+            self.delta = float(options.get('kernel.delta'))
+            self.xi = float(options.get('kernel.xi'))
+        return
+    def evaluate(self, IX, IY):
+        return self.delta**2 * IX.dot(IY.T)**self.xi
+    def computeDot(self, IX, X, xi, delta):
+        return delta**2 * np.dot(IX,X)**xi
+    def compute(self, IX, X):
+        return self.computeDot(IX, X, self.xi, self.delta)
+    def computeDerivativeOuter(self, IX, X):
+        c = self.computeDot(IX, X, self.xi-1, self.delta)
+        return self.xi*np.diag(c).dot(IX)
+    def computeBlock(self, IX, return_distance=False):
+        # Order such that: IX[i] => fingerprint observation i
+        K = self.delta**2 * IX.dot(IX.T)**self.xi
+        if return_distance:
+            return (abs(1.-K))**0.5
+        else:
+            return K
+    def computeBlockDot(self, IX, return_distance=False):
+        return self.computeBlock(IX, return_distance)
+
+class KernelFunctionDotHarmonic(object):
+    """
+    C_i = ( d^2 [ IX.X ]^xi - mu_i )^2
+    """
+    def __init__(self, options):
+        self.delta = float(options.get('kernel.delta'))
+        self.xi = float(options.get('kernel.xi'))
+        self.mu = float(options.get('kernel.mu'))
+        self.kfctdot = KernelFunctionDot(options)
+        return
+    def compute(self, IX, X):
+        if type(self.mu) == float:
+            mu = np.zeros((IX.shape[0]))
+            mu.fill(self.mu)
+            self.mu = mu
+        C = self.kfctdot.compute(IX, X)
+        return (C-self.mu)**2
+    def computeDerivativeOuter(self, IX, X):
+        if type(self.mu) == float:
+            mu = np.zeros((IX.shape[0]))
+            mu.fill(self.mu)
+            self.mu = mu
+        C = self.kfctdot.compute(IX, X)
+        IC = self.kfctdot.computeDerivativeOuter(IX, X)
+        return 2*(C-self.mu)*IC
+    def computeBlockDot(self, IX, return_distance=False):
+        return self.kfctdot.computeBlock(IX, return_distance)
+
+class KernelFunctionDotHarmonicDist(object):
+    def __init__(self, options):
+        self.d0 = float(options.get('kernel.dotharmdist_d0'))
+        self.eps = float(options.get('kernel.dotharmdist_eps'))
+        self.kfctdot = KernelFunctionDot(options)
+        return
+    def compute(self, IX, X):
+        C = self.kfctdot.compute(IX, X)
+        D = (1.-C+self.eps)**0.5
+        return (D-self.d0)**2
+    def computeDerivativeOuter(self, IX, X):
+        C = self.kfctdot.compute(IX, X)
+        D = (1.-C+self.eps)**0.5
+        IC = self.kfctdot.computeDerivativeOuter(IX, X)
+        return 2*(D-self.d0)*0.5/D*(-1.)*IC
+
+class KernelFunctionDotLj(object):
+    def __init__(self, options):
+        self.sigma = float(options.get('kernel.lj_sigma'))
+        self.eps_cap = float(options.get('kernel.lj_eps_cap'))
+        self.kfctdot = KernelFunctionDot(options)
+    def compute(self, IX, X):
+        C = self.kfctdot.compute(IX, X)
+        D = (1.-C+self.eps_cap)**0.5
+        return (self.sigma/D)**12 - (self.sigma/D)**6
+    def computeDerivativeOuter(self, IX, X):
+        C = self.kfctdot.compute(IX, X)
+        D = (1.-C+self.eps_cap)**0.5
+        IC = self.kfctdot.computeDerivativeOuter(IX, X)
+        return (-6.*self.sigma**12*(1./D)**7 + 3.*self.sigma**6*(1./D)**4)*IC
+    def computeBlockDot(self, IX, return_distance=False):
+        return self.kfctdot.computeBlock(IX, return_distance)
+
+class KernelFunctionDot3Harmonic(object):
+    def __init__(self, options):
+        self.kfctdot = KernelFunctionDot(options)
+    def compute(self, IX_A, IX_B, X):
+        C_A = self.kfctdot.compute(IX_A, X)
+        C_B = self.kfctdot.compute(IX_B, X)
+        # TODO Generalize this to multi-environment representation:
+        assert IX_A.shape[0] == 1
+        assert IX_B.shape[0] == 1
+        C_AB = self.kfctdot.compute(IX_A, IX_B[0])
+        return (C_A - C_B)**2 + (C_A - C_AB)**2 + (C_B - C_AB)**2
+    def computeDerivativeOuter(self, IX_A, IX_B, X):
+        C_A = self.kfctdot.compute(IX_A, X)
+        C_B = self.kfctdot.compute(IX_B, X)
+        # TODO Generalize this to multi-environment representation:
+        assert IX_A.shape[0] == 1
+        assert IX_B.shape[0] == 1
+        C_AB = self.kfctdot.compute(IX_A, IX_B[0])
+        IC_A = self.kfctdot.computeDerivativeOuter(IX_A, X)
+        IC_B = self.kfctdot.computeDerivativeOuter(IX_B, X)
+        return 2*(C_A - C_B)*(IC_A - IC_B) + 2*(C_A - C_AB)*IC_A + 2*(C_B - C_AB)*IC_B
+
+class KernelFunctionDot3HarmonicDist(object):
+    def __init__(self, options):
+        self.kfctdot = KernelFunctionDot(options)
+        self.d0 = float(options.get('kernel.dot3harmdist_d0'))
+        self.eps = float(options.get('kernel.dot3harmdist_eps'))
+    def compute(self, IX_A, IX_B, X):
+        C_A = self.kfctdot.compute(IX_A, X)
+        C_B = self.kfctdot.compute(IX_B, X)
+        # TODO Generalize this to multi-environment representation:
+        assert IX_A.shape[0] == 1
+        assert IX_B.shape[0] == 1
+        C_AB = self.kfctdot.compute(IX_A, IX_B[0])
+        D_A = (1. - C_A + self.eps)**0.5
+        D_B = (1. - C_B + self.eps)**0.5
+        D_AB = (1. - C_AB + self.eps)**0.5
+        return (D_A - D_B)**2 + (D_A - D_AB)**2 + (D_B - D_AB)**2 + (D_A - self.d0)**2 + (D_B - self.d0)**2
+    def computeDerivativeOuter(self, IX_A, IX_B, X):
+        C_A = self.kfctdot.compute(IX_A, X)
+        C_B = self.kfctdot.compute(IX_B, X)
+        # TODO Generalize this to multi-environment representation:
+        assert IX_A.shape[0] == 1
+        assert IX_B.shape[0] == 1
+        C_AB = self.kfctdot.compute(IX_A, IX_B[0])
+        D_A = (1. - C_A + self.eps)**0.5
+        D_B = (1. - C_B + self.eps)**0.5
+        D_AB = (1. - C_AB + self.eps)**0.5
+        IC_A = self.kfctdot.computeDerivativeOuter(IX_A, X)
+        IC_B = self.kfctdot.computeDerivativeOuter(IX_B, X)
+        return 2*(D_A - D_B)*(0.5/D_A*(-1.)*IC_A - 0.5/D_B*(-1.)*IC_B) + 2*(D_A - D_AB)*0.5/D_A*(-1.)*IC_A + 2*(D_B - D_AB)*0.5/D_B*(-1.)*IC_B + 2*(D_A-self.d0)*1./D_A*(-1.)*IC_A + 2*(D_B-self.d0)*1./D_B*(-1.)*IC_B
+
+KernelAdaptorFactory = {
+    'generic': KernelAdaptorGeneric,
+    'specific': KernelAdaptorSpecific,
+    'specific-unique': KernelAdaptorSpecificUnique,
+    'specific-unique-dmap': KernelAdaptorSpecificUniqueDMap,
+    'global-generic': KernelAdaptorGlobalGeneric,
+    'global-specific': KernelAdaptorGlobalSpecific,
+    'global-specific-dmap': KernelAdaptorGlobalSpecificDMap,
+    'global-specific-energy': KernelAdaptorGlobalSpecificEnergy,
+    'ftd-specific': KernelAdaptorFTD
+}
+
+KernelFunctionFactory = {
+    'gaussian-diff': KernelFunctionGaussianDiff,
+    'dot': KernelFunctionDot,
+    'dot-shifted': KernelFunctionDotShifted,
+    'dot-harmonic': KernelFunctionDotHarmonic,
+    'dot-harmonic-dist': KernelFunctionDotHarmonicDist,
+    'dot-lj': KernelFunctionDotLj,
+    'dot-3-harmonic': KernelFunctionDot3Harmonic,
+    'dot-3-harmonic-dist': KernelFunctionDot3HarmonicDist
+}
+
+class KernelPotential(object):
+    def __init__(self, options):
+        logging.info("Construct kernel potential ...")
+        self.basis = soap.Basis(options)
+        self.options = options
+        # CORE DATA
+        self.IX = None
+        self.alpha = None
+        self.dimX = None # <- Also used as flag set by first ::acquire call
+        self.labels = []
+        # KERNEL
+        logging.info("Choose kernel function ...")
+        self.kernelfct = KernelFunctionFactory[options.get('kernel.type')](options)
+        # ADAPTOR
+        logging.info("Choose adaptor ...")
+        self.adaptor = KernelAdaptorFactory[options.get('kernel.adaptor')](options)
+        self.use_global_spectrum = True if options.get('kernel.adaptor') == 'global-generic' else False
+        # INCLUSIONS / EXCLUSIONS
+        # -> Already be enforced when computing spectra
+        return
+    def computeKernelMatrix(self, return_distance=False):
+        return self.kernelfct.computeBlock(self.IX, return_distance)
+    def computeDotKernelMatrix(self, return_distance=False):
+        # Even if the, e.g., dot-harmonic kernel is used for optimization,
+        # the dot-product based kernel matrix may still be relevant
+        return self.kernelfct.computeBlockDot(self.IX, return_distance)
+    def nConfigs(self):
+        return self.IX.shape[0]
+    def importAcquire(self, IX_acqu, alpha):
+        n_acqu = IX_acqu.shape[0]
+        dim_acqu = IX_acqu.shape[1]
+        alpha_acqu = np.zeros((n_acqu))
+        alpha_acqu.fill(alpha)
+        if not self.dimX:
+            # First time ...
+            self.dimX = dim_acqu
+            self.IX = IX_acqu
+            self.alpha = alpha_acqu
+        else:
+            # Check and extend ...
+            assert self.dimX == dim_acqu # Acquired descr. should match linear dim. of previous descr.'s
+            I = self.IX.shape[0]
+            self.IX.resize((I+n_acqu, self.dimX))
+            self.IX[I:I+n_acqu,:] = IX_acqu
+            self.alpha.resize((I+n_acqu))
+            self.alpha[I:I+n_acqu] = alpha_acqu
+        #print self.alpha
+        #print self.IX
+        logging.info("Imported %d environments." % n_acqu)
+        return
+    def acquire(self, structure, alpha, label=None):
+        logging.info("Acquire ...")
+        spectrum = soap.Spectrum(structure, self.options, self.basis)
+        spectrum.compute()
+        spectrum.computePower()
+        spectrum.computePowerGradients()
+        if self.use_global_spectrum:
+            spectrum.computeGlobal()
+        # New X's
+        logging.info("Adapt spectrum ...")
+        IX_acqu = self.adaptor.adapt(spectrum)
+        n_acqu = IX_acqu.shape[0]
+        dim_acqu = IX_acqu.shape[1]
+        # New alpha's
+        alpha_acqu = np.zeros((n_acqu))
+        alpha_acqu.fill(alpha)
+        # Labels
+        labels = [ label for i in range(n_acqu) ]
+        self.labels = self.labels + labels
+        if not self.dimX:
+            # First time ...
+            self.dimX = dim_acqu
+            self.IX = IX_acqu
+            self.alpha = alpha_acqu
+        else:
+            # Check and extend ...
+            assert self.dimX == dim_acqu # Acquired descr. should match linear dim. of previous descr.'s
+            I = self.IX.shape[0]
+            self.IX.resize((I+n_acqu, self.dimX))
+            self.IX[I:I+n_acqu,:] = IX_acqu
+            self.alpha.resize((I+n_acqu))
+            self.alpha[I:I+n_acqu] = alpha_acqu
+        #print self.alpha
+        #print self.IX
+        logging.info("Acquired %d environments." % n_acqu)
+        return
+    def computeEnergy(self, structure, return_prj_mat=False):
+        logging.info("Start energy ...")
+        energy = 0.0
+        spectrum = soap.Spectrum(structure, self.options, self.basis)
+        spectrum.compute()
+        spectrum.computePower()
+        spectrum.computePowerGradients()
+        # TODO The kernel policy should take care of this:
+        if self.use_global_spectrum:
+            spectrum.computeGlobal()
+        IX_acqu = self.adaptor.adapt(spectrum)
+        n_acqu = IX_acqu.shape[0]
+        dim_acqu = IX_acqu.shape[1]
+        logging.info("Compute energy from %d atomic environments ..." % n_acqu)
+        projection_matrix = []
+        for n in range(n_acqu):
+            X = IX_acqu[n]
+            #print "X_MAG", np.dot(X,X)
+            ic = self.kernelfct.compute(self.IX, X)
+            energy += self.alpha.dot(ic)
+            #print "Projection", ic
+            projection_matrix.append(ic)
+        if return_prj_mat:
+            return energy, projection_matrix
+        else:
+            return energy
+    def computeForces(self, structure, verbose=False):
+        logging.info("Start forces ...")
+        if verbose:
+            for p in structure: print p.pos
+        forces = [ np.zeros((3)) for i in range(structure.n_particles) ]
+        logging.info("Compute forces on %d particles ..." % structure.n_particles)
+        # Compute X's, dX's
+        spectrum = soap.Spectrum(structure, self.options, self.basis)
+        spectrum.compute()
+        spectrum.computePower()
+        spectrum.computePowerGradients()
+        if self.use_global_spectrum:
+            atomic_global = spectrum.computeGlobal()
+            spectrum_iter = [ atomic_global ]
+        else:
+            spectrum_iter = spectrum
+        # Extract & compute force
+        for atomic in spectrum_iter:
+            pid = atomic.getCenter().id if not self.use_global_spectrum else -1
+            #if not pid in self.pid_list_force:
+            #    logging.debug("Skip forces derived from environment with pid = %d" % pid)
+            #    continue
+            #if pid != 1: continue
+            nb_pids = atomic.getNeighbourPids()
+            logging.info("  Center %d" % (pid))
+            # neighbour-pid-independent kernel "prevector" (outer derivative)
+            X_unnorm, X_norm = self.adaptor.adaptScalar(atomic)
+            dIC = self.kernelfct.computeDerivativeOuter(self.IX, X_norm)
+            alpha_dIC = self.alpha.dot(dIC)
+            for nb_pid in nb_pids:
+                # Force on neighbour
+                logging.info("    -> Nb %d" % (nb_pid))
+                dX_dx, dX_dy, dX_dz = self.adaptor.adaptGradients(atomic, nb_pid, X_unnorm)
+
+                force_x = -alpha_dIC.dot(dX_dx)
+                force_y = -alpha_dIC.dot(dX_dy)
+                force_z = -alpha_dIC.dot(dX_dz)
+
+                forces[nb_pid-1][0] += force_x
+                forces[nb_pid-1][1] += force_y
+                forces[nb_pid-1][2] += force_z
+                #print forces
+                #raw_input('...')
+        return forces
+
+    def computeForcesAdjoint(self, structure):
+        # Same as ::computeForces, but contracts dE/dX with the density gradients
+        # in C++ rather than materializing the power-spectrum gradients. The
+        # spectrum is computed without density gradients: these are recomputed
+        # neighbour by neighbour in the backward pass and never stored.
+        # Only the generic-coherent power spectrum has sensitivities in C++.
+        if not hasattr(self.adaptor, 'adaptSensitivities'):
+            raise NotImplementedError("Adjoint forces require the 'generic' or 'global-generic' adaptor, not '%s'" \
+                % self.options.get('kernel.adaptor'))
+        logging.info("Compute forces (adjoint) on %d particles ..." % structure.n_particles)
+        gradients = self.options.get('spectrum.gradients')
+        self.options.set('spectrum.gradients', False)
+        try:
+            spectrum = soap.Spectrum(structure, self.options, self.basis)
+        finally:
+            self.options.set('spectrum.gradients', gradients)
+        spectrum.compute()
+        spectrum.computePower()
+        if self.use_global_spectrum:
+            atomic_global = spectrum.computeGlobal()
+            spectrum_iter = [ atomic_global ]
+        else:
+            spectrum_iter = spectrum
+        dE_dX = []
+        for atomic in spectrum_iter:
+            X_unnorm, X_norm = self.adaptor.adaptScalar(atomic)
+            dIC = self.kernelfct.computeDerivativeOuter(self.IX, X_norm)
+            alpha_dIC = self.alpha.dot(dIC)
+            dE_dX.append(self.adaptor.adaptSensitivities(X_unnorm, alpha_dIC))
+        forces = spectrum.computeForcesAdjoint(np.array(dE_dX), self.use_global_spectrum)
+        return [ forces[i] for i in range(structure.n_particles) ]
+
+def restore_positions(structure, positions):
+    structure.setPositions(np.array(positions))
+    return [ part.pos for part in structure ]
+
+def perturb_positions(structure, exclude_pid=[]):
+    for part in structure:
+        if part.id in exclude_pid: continue
+        dx = np.random.uniform(-1.,1.)
+        dy = np.random.uniform(-1.,1.)
+        dz = np.random.uniform(-1.,1.)
+        part.pos = part.pos + 0.1*np.array([dx,dy,dz])
+    return [ part.pos for part in structure ]
+
+def random_positions(structure, exclude_pid=[], b0=-1., b1=1., x=True, y=True, z=True):
+    for part in structure:
+        if part.id in exclude_pid: continue
+        dx = np.random.uniform(b0,b1) if x else 0.
+        dy = np.random.uniform(b0,b1) if y else 0.
+        dz = np.random.uniform(b0,b1) if z else 0.
+        part.pos = np.array([dx,dy,dz])
+    return [ part.pos for part in structure ]
+
+def apply_force_step(structure, forces, scale, constrain_particles=[]):
+    max_step = 0.05
+    max_f = 0.0
+    for f in forces:
+        df = scale*np.dot(f,f)**0.5
+        if df > max_f: max_f = df
+    if max_f > max_step: scale = scale*max_step/max_f
+    else: pass
+    #print "Scale =", scale
+    step = scale*np.array(forces)
+    for pid in constrain_particles:
+        print "Skip force step, pid =", pid
+        step[pid-1] = 0.
+    structure.setPositions(structure.positions + step)
+    return [ part.pos for part in structure ]
+
+def apply_force_norm_step(structure, forces, scale, constrain_particles=[]):
+    min_step = 0.5
+    max_f = 0.0
+    for f in forces:
+        df = np.dot(f,f)**0.5
+        if df > max_f: max_f = df
+    scale = min_step/max_f
+    idx = -1
+    for part in structure:
+        idx += 1
+        if part.id in constrain_particles:
+            print "Skip force step, pid =", part.id
+            continue
+        #if np.random.uniform(0.,1.) > 0.5: continue
+        part.pos = part.pos + scale*forces[idx]
+    return [ part.pos for part in structure ]
+
+def evaluate_energy(positions, structure, kernelpot, opt_pids, verbose=False, ofs=None, average=False):
+    if verbose: print "Energy"
+    # Impose positions
+    pid_pos = positions.reshape((opt_pids.shape[0],3))
+    for pidx, pid in enumerate(opt_pids):
+        pos = pid_pos[pidx,:]
+        particle = structure.getParticle(pid)
+        particle.pos = pos
+    for part in structure:
+        if verbose: print part.id, part.type, part.pos
+    # Evaluate energy function
+    energy = kernelpot.computeEnergy(structure)
+    if average: energy /= kernelpot.nConfigs()
+    # Log
+    if ofs: ofs.logFrame(structure)
+    if verbose: print energy
+    print energy
+    return energy
+
+def evaluate_energy_gradient(positions, structure, kernelpot, opt_pids, verbose=False, ofs=None, average=False):
+    if verbose: print "Forces"
+    # Adjust positions
+    pid_pos = positions.reshape((opt_pids.shape[0],3))
+    for pidx, pid in enumerate(opt_pids):
+        pos = pid_pos[pidx,:]
+        particle = structure.getParticle(pid)
+        particle.pos = pos
+    for part in structure:
+        if verbose: print part.id, part.type, part.pos
+    # Evaluate forces
+    forces = kernelpot.computeForces(structure)
+    gradients = -1.*np.array(forces)
+    opt_pidcs = opt_pids-1
+    gradients_short = gradients[opt_pidcs]
+    gradients_short = gradients_short.flatten()
+    if average:
+        gradients_short /= kernelpot.nConfigs()
+    if verbose: print gradients_short
+    #forces[2] = 0. # CONSTRAIN TO Z=0 PLANE
+    return gradients_short
@@ -0,0 +1,7 @@
+from loadwrite import *
+from inverse import *
+from extract import *
+import partition
+import transformations
+from ase_io import io
+
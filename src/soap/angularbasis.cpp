@@ -48,7 +48,8 @@ void AngularBasis::computeCoefficients(
             for (int l = 0; l <= _L; ++l) {
                 for (int m = -l; m <= l; ++m) {
                     int lm = l*l+l+m;
-                    std::vector<std::complex<double> > dYlm = GradSphericalYlm::eval(l, m, dr);
+                    std::complex<double> dYlm[3];
+                    GradSphericalYlm::eval(l, m, dr, dYlm);
                     (*dYlm_dx)(lm) = dYlm[0];
                     (*dYlm_dy)(lm) = dYlm[1];
                     (*dYlm_dz)(lm) = dYlm[2];
@@ -9,6 +9,7 @@
 #include "soap/base/objectfactory.hpp"
 #include "soap/options.hpp"
 #include "soap/functions.hpp"
+#include "soap/linalg/tensor.hpp"
 
 namespace soap {
 
@@ -18,8 +19,8 @@ namespace ub = boost::numeric::ublas;
 class AngularBasis
 {
 public:
-	typedef ub::vector< std::complex<double> > angcoeff_t;
-	typedef ub::zero_vector< std::complex<double> > angcoeff_zero_t;
+	typedef linalg::aligned_vector< std::complex<double> > angcoeff_t;
+	typedef linalg::aligned_zero_vector< std::complex<double> > angcoeff_zero_t;
 
 	AngularBasis() : _type("spherical-harmonic"), _L(0) {;}
 	virtual ~AngularBasis() {;}
@@ -0,0 +1,206 @@
+#include <Python.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <boost/lexical_cast.hpp>
+
+#include "soap/globals.hpp"
+#include "soap/options.hpp"
+#include "soap/basis.hpp"
+#include "soap/spectrum.hpp"
+#include "soap/archive.hpp"
+#include "soap/xyz.hpp"
+#include "soap/base/queue.hpp"
+
+// soapxx-compute: spectra of all frames of an (extended) XYZ file, written to
+// a spectrum archive (see archive.hpp), without a python driver. Three stages
+// connected by bounded queues (soap::base::run_pipeline) keep parsing,
+// computing and writing overlapped:
+// o parser thread: frames -> structures (XyzReader)
+// o compute workers: structures -> spectra (Spectrum::compute, computePower),
+//   each with its own options and basis
+// o writer thread: spectra -> archive, in input order
+
+using namespace soap;
+
+struct frame_t
+{
+    frame_t() : structure(NULL), spectrum(NULL) { ; }
+   ~frame_t() {
+        delete spectrum;
+        delete structure;
+    }
+    int index;
+    Structure *structure;
+    Spectrum *spectrum;
+};
+
+static void usage(std::ostream &os) {
+    os << "Usage: soapxx-compute -i <input.xyz> -o <output.soapxx> -s <species,...> [options]" << std::endl
+       << "  -i <file>          input, multi-frame (extended) XYZ" << std::endl
+       << "  -o <file>          output spectrum archive" << std::endl
+       << "  -s <A,B,...>       species of the archive" << std::endl
+       << "  -c <file>          options, one 'key value' per line (keys as in soap.Options)," << std::endl
+       << "                     exclude_centers/exclude_targets take a list of types" << std::endl
+       << "  -j <n>             compute workers (default: hardware threads)" << std::endl
+       << "  --power            store power spectra" << std::endl
+       << "  --dtype <dtype>    complex128 (default), complex64, qint16 or qint8" << std::endl
+       << "  --chunk-size <n>   write compressed chunks of whole structures, >= <n> centers each" << std::endl
+       << "  --log <level>      error, warning (default), info or debug" << std::endl;
+}
+
+static void read_options(const std::string &filename, Options &options) {
+    std::ifstream ifs(filename.c_str());
+    if (!ifs) throw soap::base::IOError("Bad file handle: " + filename);
+    std::string line;
+    while (std::getline(ifs, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream iss(line);
+        std::string key;
+        if (!(iss >> key)) continue;
+        std::vector<std::string> values;
+        std::string value;
+        while (iss >> value) {
+            if (value != "=") values.push_back(value);
+        }
+        if (key == "exclude_centers" || key == "exclude_targets") {
+            boost::python::list types;
+            for (auto it = values.begin(); it != values.end(); ++it) types.append(*it);
+            if (key == "exclude_centers") options.excludeCenters(types);
+            else options.excludeTargets(types);
+        }
+        else if (values.size() == 1) {
+            options.set(key, values[0]);
+        }
+        else {
+            throw soap::base::APIError("Options file " + filename + ": expected '" + key + " <value>'");
+        }
+    }
+}
+
+static int run(const std::string &input, const std::string &output, const std::vector<std::string> &species,
+    const std::string &options_file, int n_workers, bool with_power, const std::string &dtype, int chunk_size) {
+    RadialBasisFactory::registerAll();
+    AngularBasisFactory::registerAll();
+    CutoffFunctionFactory::registerAll();
+    Options options;
+    if (options_file != "") read_options(options_file, options);
+    bool with_gradients = options.get<bool>("spectrum.gradients");
+    XyzReader reader(input);
+    SpectrumArchiveWriter writer(output, species, with_power, dtype, with_gradients, chunk_size);
+    // Each worker gets its own copy of the options, made here rather than in the
+    // workers: Options::get inserts missing keys, and copies touch python lists.
+    // Bases are configured up front (which may adjust the options), then only read
+    std::vector<Options*> worker_options;
+    std::vector<Basis*> bases;
+    for (int w = 0; w < n_workers; ++w) {
+        worker_options.push_back(new Options(options));
+        bases.push_back(new Basis(worker_options[w]));
+    }
+    std::string error = "";
+    int n_written = 0;
+    try {
+        soap::base::run_pipeline<frame_t>(reader.nFrames(), n_workers,
+            [&](int f) {
+                frame_t *frame = new frame_t();
+                frame->index = f;
+                try {
+                    frame->structure = reader.read(f);
+                }
+                catch (...) {
+                    delete frame;
+                    throw;
+                }
+                return frame;
+            },
+            [&](frame_t &frame, int w) {
+                frame.spectrum = new Spectrum(*frame.structure, *worker_options[w], *bases[w]);
+                frame.spectrum->compute();
+                if (with_power) frame.spectrum->computePower();
+            },
+            [&](frame_t &frame) {
+                std::string label = frame.structure->getLabel();
+                if (label == "?") label = boost::lexical_cast<std::string>(frame.index);
+                writer.add(*frame.spectrum, label);
+                ++n_written;
+            });
+    }
+    catch (const std::exception &e) {
+        // Frames are written in order, up to the first that failed
+        error = "Frame " + boost::lexical_cast<std::string>(n_written) + ": " + e.what();
+    }
+    writer.close();
+    for (auto it = bases.begin(); it != bases.end(); ++it) delete *it;
+    for (auto it = worker_options.begin(); it != worker_options.end(); ++it) delete *it;
+    if (error != "") {
+        std::cerr << "soapxx-compute: " << error << std::endl;
+        return 1;
+    }
+    GLOG_AT(logINFO) << "Wrote " << n_written << " spectra to '" << output << "'" << std::endl;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    std::string input = "";
+    std::string output = "";
+    std::string options_file = "";
+    std::string dtype = "complex128";
+    std::string log_level = "warning";
+    std::vector<std::string> species;
+    int n_workers = std::thread::hardware_concurrency();
+    bool with_power = false;
+    int chunk_size = 0;
+    try {
+        for (int a = 1; a < argc; ++a) {
+            std::string arg = argv[a];
+            if (arg == "-h" || arg == "--help") {
+                usage(std::cout);
+                return 0;
+            }
+            if (arg == "--power") {
+                with_power = true;
+                continue;
+            }
+            if (a+1 >= argc) throw soap::base::APIError("Missing value for " + arg);
+            std::string value = argv[++a];
+            if (arg == "-i") input = value;
+            else if (arg == "-o") output = value;
+            else if (arg == "-c") options_file = value;
+            else if (arg == "-j") n_workers = boost::lexical_cast<int>(value);
+            else if (arg == "--dtype") dtype = value;
+            else if (arg == "--chunk-size") chunk_size = boost::lexical_cast<int>(value);
+            else if (arg == "--log") log_level = value;
+            else if (arg == "-s") {
+                std::istringstream iss(value);
+                std::string type;
+                while (std::getline(iss, type, ',')) if (type != "") species.push_back(type);
+            }
+            else throw soap::base::APIError("Unknown argument " + arg);
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "soapxx-compute: " << e.what() << std::endl;
+        usage(std::cerr);
+        return 1;
+    }
+    if (input == "" || output == "" || species.size() == 0) {
+        usage(std::cerr);
+        return 1;
+    }
+    if (n_workers < 1) n_workers = 1;
+    // No python code runs, but options hold python containers (exclusion lists)
+    Py_Initialize();
+    int status = 1;
+    try {
+        GLOG_SET_LEVEL(log_level);
+        status = run(input, output, species, options_file, n_workers, with_power, dtype, chunk_size);
+    }
+    catch (const std::exception &e) {
+        std::cerr << "soapxx-compute: " << e.what() << std::endl;
+    }
+    return status;
+}
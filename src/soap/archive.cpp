@@ -0,0 +1,1084 @@
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sstream>
+#include <boost/lexical_cast.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <zlib.h>
+
+#include "soap/archive.hpp"
+
+namespace soap {
+
+archive_dtype_t archive_dtype_from_string(const std::string &dtype) {
+    if (dtype == "complex128") return ARCHIVE_COMPLEX128;
+    else if (dtype == "complex64") return ARCHIVE_COMPLEX64;
+    else if (dtype == "qint16") return ARCHIVE_QINT16;
+    else if (dtype == "qint8") return ARCHIVE_QINT8;
+    throw soap::base::APIError("Unknown archive dtype '" + dtype + "'");
+}
+
+std::string archive_dtype_to_string(uint32_t dtype) {
+    switch (dtype) {
+        case ARCHIVE_COMPLEX128: return "complex128";
+        case ARCHIVE_COMPLEX64: return "complex64";
+        case ARCHIVE_QINT16: return "qint16";
+        case ARCHIVE_QINT8: return "qint8";
+    }
+    throw soap::base::APIError("Unknown archive dtype " + boost::lexical_cast<std::string>(dtype));
+}
+
+int archive_dtype_size(uint32_t dtype) {
+    switch (dtype) {
+        case ARCHIVE_COMPLEX128: return sizeof(double);
+        case ARCHIVE_COMPLEX64: return sizeof(float);
+        case ARCHIVE_QINT16: return sizeof(int16_t);
+        case ARCHIVE_QINT8: return sizeof(int8_t);
+    }
+    throw soap::base::APIError("Unknown archive dtype " + boost::lexical_cast<std::string>(dtype));
+}
+
+void archive_blocks(int n_species, int N, int L, bool with_power, std::vector<int> &blocks) {
+    blocks.clear();
+    int offset = 0;
+    for (int s = 0; s < n_species; ++s, offset += N*(L+1)*(L+1)) blocks.push_back(offset);
+    if (with_power) {
+        for (int p = 0; p < n_species*n_species+1; ++p, offset += N*N*(L+1)) blocks.push_back(offset);
+    }
+    blocks.push_back(offset);
+}
+
+static bool archive_is_quantized(uint32_t dtype) {
+    return dtype == ARCHIVE_QINT16 || dtype == ARCHIVE_QINT8;
+}
+
+// Byte offset of the block scales within a record
+static uint64_t archive_scales_offset(uint32_t dtype, int n_elements) {
+    uint64_t size_values = 2*n_elements*archive_dtype_size(dtype);
+    return ((size_values + sizeof(float) - 1)/sizeof(float))*sizeof(float);
+}
+
+static uint64_t archive_record_size(uint32_t dtype, const std::vector<int> &blocks) {
+    int n_elements = blocks.back();
+    uint64_t record_size = (archive_is_quantized(dtype)) ?
+        archive_scales_offset(dtype, n_elements) + (blocks.size()-1)*sizeof(float) :
+        2*uint64_t(n_elements)*archive_dtype_size(dtype);
+    return ((record_size + 7)/8)*8;
+}
+
+// Bytes of a gradient payload with <n_nb> neighbours (see SpectrumArchiveWriter::addGradients)
+static uint64_t archive_gradient_size(uint64_t n_nb, int N, int L) {
+    return (2*n_nb + (2*n_nb)%4)*sizeof(int32_t) + n_nb*3*N*(L+1)*(L+1)*sizeof(std::complex<double>);
+}
+
+// Whether <count> items of <size_item> bytes starting at <offset> lie within <size> bytes
+static bool archive_fits(uint64_t offset, uint64_t count, uint64_t size_item, uint64_t size) {
+    return offset <= size && (size_item == 0 || count <= (size - offset)/size_item);
+}
+
+// ============================
+// SpectrumArchiveWriter
+// ============================
+
+SpectrumArchiveWriter::SpectrumArchiveWriter(std::string filename, std::vector<std::string> species, bool with_power,
+        std::string dtype, bool with_gradients, int chunk_size) :
+    _is_open(false), _species(species) {
+    this->open(filename, with_power, dtype, with_gradients, chunk_size);
+}
+
+SpectrumArchiveWriter::SpectrumArchiveWriter(std::string filename, boost::python::list species, bool with_power,
+        std::string dtype, bool with_gradients, int chunk_size) :
+    _is_open(false) {
+    for (int i = 0; i < boost::python::len(species); ++i) {
+        _species.push_back(boost::python::extract<std::string>(species[i]));
+    }
+    this->open(filename, with_power, dtype, with_gradients, chunk_size);
+}
+
+SpectrumArchiveWriter::~SpectrumArchiveWriter() {
+    try {
+        if (_is_open) this->close();
+    }
+    catch (std::exception &e) {
+        GLOG() << "SpectrumArchiveWriter: " << e.what() << std::endl;
+    }
+}
+
+void SpectrumArchiveWriter::open(std::string filename, bool with_power, std::string dtype, bool with_gradients, int chunk_size) {
+    _filename = filename;
+    archive_dtype_t archive_dtype = archive_dtype_from_string(dtype);
+    _ofs.open(filename.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!_ofs.is_open()) {
+        throw soap::base::IOError("Bad file handle: " + filename);
+    }
+    for (auto it = _species.begin(); it != _species.end(); ++it) {
+        if (it->size() >= 16) throw soap::base::APIError("<SpectrumArchiveWriter> Species name too long: '" + *it + "'");
+    }
+    _is_open = true;
+    std::memset(&_header, 0, sizeof(_header));
+    std::memcpy(_header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    _header.version = ARCHIVE_VERSION;
+    _header.byte_order = ARCHIVE_BYTE_ORDER;
+    _header.flags = (with_power) ? ARCHIVE_WITH_POWER : 0;
+    _chunk_size = chunk_size;
+    _chunk_first = 0;
+    _chunk_first_structure = 0;
+    _stop = false;
+    if (_chunk_size > 0) _header.flags |= ARCHIVE_CHUNKED;
+    if (with_gradients) _header.flags |= ARCHIVE_WITH_GRADIENTS;
+    if (with_gradients && _chunk_size <= 0) {
+        _grad_fs.open((filename + ".grad").c_str(),
+            std::fstream::in | std::fstream::out | std::fstream::binary | std::fstream::trunc);
+        if (!_grad_fs.is_open()) throw soap::base::IOError("Bad file handle: " + filename + ".grad");
+    }
+    _header.dtype = archive_dtype;
+    _header.N = -1;
+    _header.L = -1;
+    _header.n_species = _species.size();
+    // Header (provisional), species table
+    _ofs.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+    this->pad();
+    _header.offset_species = _ofs.tellp();
+    for (auto it = _species.begin(); it != _species.end(); ++it) {
+        char name[16];
+        std::memset(name, 0, sizeof(name));
+        std::strncpy(name, it->c_str(), sizeof(name)-1);
+        _ofs.write(name, sizeof(name));
+    }
+    this->pad();
+    _header.offset_records = _ofs.tellp();
+    if (_header.flags & ARCHIVE_CHUNKED) {
+        _worker = std::thread(&SpectrumArchiveWriter::flushWorker, this);
+    }
+}
+
+void SpectrumArchiveWriter::pad() {
+    uint64_t pos = _ofs.tellp();
+    uint64_t n_pad = (ARCHIVE_ALIGN - pos % ARCHIVE_ALIGN) % ARCHIVE_ALIGN;
+    std::vector<char> zeros(n_pad, 0);
+    if (n_pad) _ofs.write(&zeros[0], n_pad);
+}
+
+int SpectrumArchiveWriter::speciesIndex(const std::string &type) {
+    auto it = std::find(_species.begin(), _species.end(), type);
+    if (it == _species.end()) {
+        throw soap::base::APIError("<SpectrumArchiveWriter> Species '" + type + "' not in species table.");
+    }
+    return it - _species.begin();
+}
+
+void SpectrumArchiveWriter::add(Spectrum &spectrum, std::string label) {
+    std::lock_guard<std::mutex> lock(_mutex_add);
+    if (!_is_open) throw soap::base::APIError("<SpectrumArchiveWriter::add> Archive already closed.");
+    {
+        std::lock_guard<std::mutex> lock_queue(_mutex_queue);
+        if (_worker_error != "") throw soap::base::IOError(_worker_error);
+    }
+    int N = spectrum.getBasis()->getRadBasis()->N();
+    int L = spectrum.getBasis()->getAngBasis()->L();
+    if (_header.N >= 0 && (_header.N != N || _header.L != L)) {
+        throw soap::base::APIError("<SpectrumArchiveWriter::add> Spectrum expanded in incompatible basis.");
+    }
+    // Validate all centers before anything is written or recorded, so that
+    // a failing add leaves the archive as it was
+    for (auto it = spectrum.beginAtomic(); it != spectrum.endAtomic(); ++it) {
+        this->speciesIndex((*it)->getCenterType());
+        AtomicSpectrum::map_qnlm_t &map_qnlm = (*it)->getQnlmMap();
+        for (auto jt = map_qnlm.begin(); jt != map_qnlm.end(); ++jt) this->speciesIndex(jt->first);
+        if (_header.flags & ARCHIVE_WITH_POWER) {
+            if ((*it)->getXnklGenericCoherent() == NULL) {
+                throw soap::base::APIError("<SpectrumArchiveWriter::add> Power spectrum missing, call computePower first.");
+            }
+            AtomicSpectrum::map_xnkl_t &map_xnkl = (*it)->getXnklMap();
+            for (auto jt = map_xnkl.begin(); jt != map_xnkl.end(); ++jt) {
+                this->speciesIndex(jt->first.first);
+                this->speciesIndex(jt->first.second);
+            }
+        }
+        if (_header.flags & ARCHIVE_WITH_GRADIENTS) {
+            std::vector<std::string> &types = (*it)->getQnlmGradTypes();
+            for (auto jt = types.begin(); jt != types.end(); ++jt) this->speciesIndex(*jt);
+        }
+    }
+    if (_header.N < 0) {
+        // First spectrum fixes the basis dimensions & record size
+        _header.N = N;
+        _header.L = L;
+        archive_blocks(_species.size(), N, L, _header.flags & ARCHIVE_WITH_POWER, _blocks);
+        int n_elements = _blocks.back();
+        _header.record_size = archive_record_size(_header.dtype, _blocks);
+        _record.resize(n_elements);
+        _buffer.resize(_header.record_size);
+        // Basis options, to reconstruct atomic spectra on access
+        std::stringstream bstream;
+        boost::archive::binary_oarchive arch(bstream);
+        arch << (*spectrum.getOptions());
+        _options = bstream.str();
+        if (_header.flags & ARCHIVE_CHUNKED) {
+            // Ahead of the chunks, with a header that makes them readable
+            // if close() is never reached. No chunk is pending yet.
+            _header.offset_options = _ofs.tellp();
+            _header.size_options = _options.size();
+            _ofs.write(_options.c_str(), _options.size());
+            this->pad();
+            _header.offset_records = _ofs.tellp();
+            _ofs.seekp(0);
+            _ofs.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+            _ofs.seekp(_header.offset_records);
+        }
+    }
+    int S = _species.size();
+    int size_qnlm = N*(L+1)*(L+1);
+    int size_xnkl = N*N*(L+1);
+
+    archive_structure_t structure;
+    std::memset(&structure, 0, sizeof(structure));
+    structure.first_center = _centers.size();
+    structure.n_centers = spectrum.length();
+    structure.n_particles = spectrum.getStructure()->particles().size();
+    std::strncpy(structure.label, label.c_str(), sizeof(structure.label)-1);
+
+    for (auto it = spectrum.beginAtomic(); it != spectrum.endAtomic(); ++it) {
+        std::fill(_record.begin(), _record.end(), cmplx_t(0.,0.));
+        // Q_nlm
+        AtomicSpectrum::map_qnlm_t &map_qnlm = (*it)->getQnlmMap();
+        for (auto jt = map_qnlm.begin(); jt != map_qnlm.end(); ++jt) {
+            BasisExpansion::coeff_t &qnlm = jt->second->getCoefficients();
+            std::copy(&qnlm.data()[0], &qnlm.data()[0]+size_qnlm, &_record[this->speciesIndex(jt->first)*size_qnlm]);
+        }
+        // X_nkl
+        if (_header.flags & ARCHIVE_WITH_POWER) {
+            cmplx_t *xnkl_out = &_record[S*size_qnlm];
+            AtomicSpectrum::map_xnkl_t &map_xnkl = (*it)->getXnklMap();
+            for (auto jt = map_xnkl.begin(); jt != map_xnkl.end(); ++jt) {
+                int s1 = this->speciesIndex(jt->first.first);
+                int s2 = this->speciesIndex(jt->first.second);
+                PowerExpansion::coeff_t &xnkl = jt->second->getCoefficients();
+                std::copy(&xnkl.data()[0], &xnkl.data()[0]+size_xnkl, xnkl_out+(s1*S+s2)*size_xnkl);
+            }
+            PowerExpansion::coeff_t &xnkl_gc = (*it)->getXnklGenericCoherent()->getCoefficients();
+            std::copy(&xnkl_gc.data()[0], &xnkl_gc.data()[0]+size_xnkl, xnkl_out+S*S*size_xnkl);
+        }
+        // Convert
+        std::fill(_buffer.begin(), _buffer.end(), 0);
+        int n_elements = _blocks.back();
+        switch (_header.dtype) {
+            case ARCHIVE_COMPLEX128:
+                this->encode<double>(&_record[0], n_elements, &_buffer[0]);
+                break;
+            case ARCHIVE_COMPLEX64:
+                this->encode<float>(&_record[0], n_elements, &_buffer[0]);
+                break;
+            case ARCHIVE_QINT16:
+            case ARCHIVE_QINT8: {
+                float *scales = reinterpret_cast<float*>(&_buffer[archive_scales_offset(_header.dtype, n_elements)]);
+                int size = archive_dtype_size(_header.dtype);
+                for (int b = 0; b < _blocks.size()-1; ++b) {
+                    char *dest = &_buffer[2*_blocks[b]*size];
+                    if (_header.dtype == ARCHIVE_QINT16) {
+                        this->quantize<int16_t>(&_record[_blocks[b]], _blocks[b+1]-_blocks[b], dest, scales+b);
+                    }
+                    else {
+                        this->quantize<int8_t>(&_record[_blocks[b]], _blocks[b+1]-_blocks[b], dest, scales+b);
+                    }
+                }
+                break;
+            }
+        }
+        if (_header.flags & ARCHIVE_CHUNKED) {
+            _chunk_records.insert(_chunk_records.end(), _buffer.begin(), _buffer.end());
+            if (_header.flags & ARCHIVE_WITH_GRADIENTS) this->addGradients(*it, _chunk_grads);
+        }
+        else {
+            _ofs.write(&_buffer[0], _header.record_size);
+            if (_header.flags & ARCHIVE_WITH_GRADIENTS) this->addGradients(*it, _grad_fs);
+        }
+
+        archive_center_t center;
+        std::memset(&center, 0, sizeof(center));
+        center.structure = _structures.size();
+        center.center_id = (*it)->getCenterId();
+        center.species = this->speciesIndex((*it)->getCenterType());
+        center.pos[0] = (*it)->getCenterPos().getX();
+        center.pos[1] = (*it)->getCenterPos().getY();
+        center.pos[2] = (*it)->getCenterPos().getZ();
+        _centers.push_back(center);
+    }
+    _structures.push_back(structure);
+    if ((_header.flags & ARCHIVE_CHUNKED) && _centers.size()-_chunk_first >= _chunk_size) this->flushChunk();
+    if (!(_header.flags & ARCHIVE_CHUNKED) && !_ofs.good()) throw soap::base::IOError("Write failed: " + _filename);
+    return;
+}
+
+void SpectrumArchiveWriter::flushChunk() {
+    // Hand the pending records, gradient payloads and the table entries of
+    // the pending structures to the worker, blocking while
+    // ARCHIVE_MAX_PENDING_CHUNKS are still queued
+    uint64_t n_centers = _centers.size()-_chunk_first;
+    if (n_centers == 0) return;
+    chunk_job_t *job = new chunk_job_t();
+    job->first_center = _chunk_first;
+    job->n_centers = n_centers;
+    job->n_structures = _structures.size()-_chunk_first_structure;
+    job->raw.swap(_chunk_records);
+    std::string grads = _chunk_grads.str();
+    job->raw.insert(job->raw.end(), grads.begin(), grads.end());
+    job->offset_tables = job->raw.size();
+    const char *centers = reinterpret_cast<const char*>(&_centers[_chunk_first]);
+    job->raw.insert(job->raw.end(), centers, centers + n_centers*sizeof(archive_center_t));
+    if (_header.flags & ARCHIVE_WITH_GRADIENTS) {
+        for (uint64_t c = _chunk_first; c < _centers.size(); ++c) {
+            _gradients[c].offset += n_centers*_header.record_size;
+        }
+        const char *gradients = reinterpret_cast<const char*>(&_gradients[_chunk_first]);
+        job->raw.insert(job->raw.end(), gradients, gradients + n_centers*sizeof(archive_gradient_t));
+    }
+    const char *structures = reinterpret_cast<const char*>(&_structures[_chunk_first_structure]);
+    job->raw.insert(job->raw.end(), structures, structures + job->n_structures*sizeof(archive_structure_t));
+    _chunk_records.clear();
+    _chunk_grads.str("");
+    _chunk_grads.clear();
+    _chunk_first = _centers.size();
+    _chunk_first_structure = _structures.size();
+
+    std::unique_lock<std::mutex> lock(_mutex_queue);
+    _cv_queue.wait(lock, [this]() { return _queue.size() < ARCHIVE_MAX_PENDING_CHUNKS; });
+    _queue.push_back(job);
+    _cv_queue.notify_all();
+    return;
+}
+
+void SpectrumArchiveWriter::flushWorker() {
+    while (true) {
+        chunk_job_t *job = NULL;
+        bool failed = false;
+        {
+            std::unique_lock<std::mutex> lock(_mutex_queue);
+            _cv_queue.wait(lock, [this]() { return _stop || !_queue.empty(); });
+            if (_queue.empty()) return; // <- _stop and nothing left
+            job = _queue.front();
+            failed = (_worker_error != "");
+        }
+        if (failed) {
+            // After the first error only drain the queue, chunks must not leave gaps
+            delete job;
+            std::lock_guard<std::mutex> lock(_mutex_queue);
+            _queue.pop_front();
+            _cv_queue.notify_all();
+            continue;
+        }
+        uLongf size_compressed = compressBound(job->raw.size());
+        std::vector<Bytef> compressed(size_compressed);
+        int status = compress2(&compressed[0], &size_compressed,
+            reinterpret_cast<const Bytef*>(job->raw.data()), job->raw.size(), Z_DEFAULT_COMPRESSION);
+        archive_chunk_t chunk;
+        chunk.first_center = job->first_center;
+        chunk.n_centers = job->n_centers;
+        chunk.size_raw = job->raw.size();
+        chunk.size_compressed = size_compressed;
+        chunk.offset_tables = job->offset_tables;
+        chunk.n_structures = job->n_structures;
+        chunk.offset = uint64_t(_ofs.tellp()) + sizeof(archive_chunk_t);
+        if (status == Z_OK) {
+            _ofs.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+            _ofs.write(reinterpret_cast<const char*>(&compressed[0]), size_compressed);
+            _ofs.flush();
+        }
+        delete job;
+        std::lock_guard<std::mutex> lock(_mutex_queue);
+        _queue.pop_front();
+        if (status != Z_OK) _worker_error = "Compression failed: " + _filename;
+        else if (!_ofs.good()) _worker_error = "Write failed: " + _filename;
+        else _chunks.push_back(chunk);
+        _cv_queue.notify_all();
+    }
+}
+
+void SpectrumArchiveWriter::addGradients(AtomicSpectrum *atomic, std::ostream &out) {
+    // Payload offsets are relative to the gradient section (chunk) until close() (flushChunk())
+    archive_gradient_t gradient;
+    gradient.offset = out.tellp();
+    gradient.n_neighbours = atomic->getQnlmGradPids().size();
+    int n_nb = gradient.n_neighbours;
+    if (n_nb > 0) {
+        std::vector<int32_t> ids(2*n_nb + (2*n_nb)%4, 0);
+        for (int i = 0; i < n_nb; ++i) {
+            ids[i] = atomic->getQnlmGradPids()[i];
+            ids[n_nb+i] = this->speciesIndex(atomic->getQnlmGradTypes()[i]);
+        }
+        AtomicSpectrum::qnlm_grad_t &grad = atomic->getQnlmGrad();
+        out.write(reinterpret_cast<const char*>(&ids[0]), ids.size()*sizeof(int32_t));
+        out.write(reinterpret_cast<const char*>(&grad[0]), grad.size()*sizeof(cmplx_t));
+    }
+    _gradients.push_back(gradient);
+    return;
+}
+
+template<typename T>
+void SpectrumArchiveWriter::encode(const cmplx_t *values, int n_values, char *dest) {
+    T *out = reinterpret_cast<T*>(dest);
+    for (int i = 0; i < n_values; ++i) {
+        out[2*i] = values[i].real();
+        out[2*i+1] = values[i].imag();
+    }
+}
+
+template<typename T>
+void SpectrumArchiveWriter::quantize(const cmplx_t *values, int n_values, char *dest, float *scale) {
+    // Symmetric quantization, one scale per block: value ~ q*scale, |q| <= max(T)
+    double max_abs = 0.;
+    for (int i = 0; i < n_values; ++i) {
+        max_abs = std::max(max_abs, std::max(std::abs(values[i].real()), std::abs(values[i].imag())));
+    }
+    double q_max = std::numeric_limits<T>::max();
+    *scale = max_abs/q_max;
+    T *out = reinterpret_cast<T*>(dest);
+    if (*scale == 0.) return;
+    double inv_scale = 1./(*scale);
+    for (int i = 0; i < n_values; ++i) {
+        out[2*i] = static_cast<T>(std::max(-q_max, std::min(q_max, std::round(values[i].real()*inv_scale))));
+        out[2*i+1] = static_cast<T>(std::max(-q_max, std::min(q_max, std::round(values[i].imag()*inv_scale))));
+    }
+}
+
+void SpectrumArchiveWriter::close() {
+    std::lock_guard<std::mutex> lock(_mutex_add);
+    if (!_is_open) return;
+    // Remaining chunks
+    if (_header.flags & ARCHIVE_CHUNKED) {
+        this->flushChunk();
+        {
+            std::lock_guard<std::mutex> lock_queue(_mutex_queue);
+            _stop = true;
+            _cv_queue.notify_all();
+        }
+        _worker.join();
+        if (_worker_error != "") {
+            _ofs.close();
+            _is_open = false;
+            throw soap::base::IOError(_worker_error);
+        }
+    }
+    // Gradient payloads
+    else if (_header.flags & ARCHIVE_WITH_GRADIENTS) {
+        this->pad();
+        uint64_t offset_payloads = _ofs.tellp();
+        _grad_fs.flush();
+        _grad_fs.seekg(0);
+        std::vector<char> chunk(1<<20);
+        while (_grad_fs.read(&chunk[0], chunk.size()) || _grad_fs.gcount() > 0) {
+            _ofs.write(&chunk[0], _grad_fs.gcount());
+        }
+        _grad_fs.close();
+        std::remove((_filename + ".grad").c_str());
+        for (auto it = _gradients.begin(); it != _gradients.end(); ++it) it->offset += offset_payloads;
+    }
+    // Tables
+    this->pad();
+    _header.offset_structures = _ofs.tellp();
+    if (_structures.size()) {
+        _ofs.write(reinterpret_cast<const char*>(&_structures[0]), _structures.size()*sizeof(archive_structure_t));
+    }
+    this->pad();
+    _header.offset_centers = _ofs.tellp();
+    if (_centers.size()) {
+        _ofs.write(reinterpret_cast<const char*>(&_centers[0]), _centers.size()*sizeof(archive_center_t));
+    }
+    if (_header.flags & ARCHIVE_WITH_GRADIENTS) {
+        this->pad();
+        _header.offset_gradients = _ofs.tellp();
+        if (_gradients.size()) {
+            _ofs.write(reinterpret_cast<const char*>(&_gradients[0]), _gradients.size()*sizeof(archive_gradient_t));
+        }
+    }
+    if (_header.flags & ARCHIVE_CHUNKED) {
+        this->pad();
+        _header.offset_chunks = _ofs.tellp();
+        _header.n_chunks = _chunks.size();
+        if (_chunks.size()) {
+            _ofs.write(reinterpret_cast<const char*>(&_chunks[0]), _chunks.size()*sizeof(archive_chunk_t));
+        }
+    }
+    if (_options.size() && !(_header.flags & ARCHIVE_CHUNKED)) {
+        this->pad();
+        _header.offset_options = _ofs.tellp();
+        _header.size_options = _options.size();
+        _ofs.write(_options.c_str(), _options.size());
+    }
+    this->pad();
+    _header.size_file = _ofs.tellp();
+    _header.n_structures = _structures.size();
+    _header.n_centers = _centers.size();
+    // Final header
+    _ofs.seekp(0);
+    _ofs.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+    _ofs.close();
+    _is_open = false;
+    if (_ofs.fail()) throw soap::base::IOError("Write failed: " + _filename);
+    return;
+}
+
+void SpectrumArchiveWriter::registerPython() {
+    using namespace boost::python;
+    class_<SpectrumArchiveWriter, boost::noncopyable>("SpectrumArchiveWriter",
+            init<std::string, boost::python::list, bool, optional<std::string, bool, int> >())
+        .def("add", &SpectrumArchiveWriter::add)
+        .def("close", &SpectrumArchiveWriter::close);
+}
+
+// ============================
+// SpectrumArchive
+// ============================
+
+SpectrumArchive::SpectrumArchive(std::string filename) :
+    _filename(filename), _fd(-1), _data(NULL), _size(0), _header(NULL), _structures(NULL), _centers(NULL),
+    _gradients(NULL), _options(NULL), _basis(NULL), _chunks(NULL), _recovered(false), _cached_chunk(-1) {
+    _fd = ::open(filename.c_str(), O_RDONLY);
+    if (_fd < 0) throw soap::base::IOError("Bad file handle: " + filename);
+    struct stat st;
+    if (::fstat(_fd, &st) != 0 || st.st_size < sizeof(archive_header_t)) {
+        ::close(_fd);
+        throw soap::base::IOError("Not a spectrum archive: " + filename);
+    }
+    _size = st.st_size;
+    void *data = ::mmap(NULL, _size, PROT_READ, MAP_SHARED, _fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(_fd);
+        throw soap::base::IOError("Could not map file: " + filename);
+    }
+    _data = static_cast<const char*>(data);
+    _header = reinterpret_cast<const archive_header_t*>(_data);
+    // Validate
+    std::string error = "";
+    if (std::memcmp(_header->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0) error = "not a spectrum archive";
+    else if (_header->byte_order != ARCHIVE_BYTE_ORDER) error = "incompatible byte order";
+    else if (_header->version > ARCHIVE_VERSION) error = "unsupported version " + boost::lexical_cast<std::string>(_header->version);
+    else if (_header->dtype > ARCHIVE_QINT8) error = "unknown dtype";
+    else if (_header->flags & ~(ARCHIVE_WITH_POWER | ARCHIVE_WITH_GRADIENTS | ARCHIVE_CHUNKED)) error = "unknown flags";
+    else if (this->isChunked() && _header->version < 3) error = "chunked archives before version 3 are not supported";
+    else if (this->isChunked() && _header->size_file == 0) error = this->recover();
+    else if (_header->size_file != _size) error = "truncated or not closed";
+    if (error == "") error = this->validate();
+    if (error != "") {
+        ::munmap(const_cast<char*>(_data), _size);
+        ::close(_fd);
+        throw soap::base::IOError("Spectrum archive " + filename + ": " + error);
+    }
+}
+
+std::string SpectrumArchive::recover() {
+    // Tables of all complete chunks, which follow the options back to back
+    _recovered_header = *_header;
+    archive_header_t &h = _recovered_header;
+    uint64_t pos = h.offset_records;
+    if (h.N >= 0 && (h.offset_options == 0 || !archive_fits(h.offset_options, h.size_options, 1, _size)
+            || h.offset_records < h.offset_options + h.size_options)) {
+        return "options out of bounds";
+    }
+    bool with_gradients = this->hasGradients();
+    uint64_t size_center = sizeof(archive_center_t) + ((with_gradients) ? sizeof(archive_gradient_t) : 0);
+    std::vector<char> raw;
+    while (h.N >= 0 && archive_fits(pos, 1, sizeof(archive_chunk_t), _size)) {
+        archive_chunk_t chunk;
+        std::memcpy(&chunk, _data + pos, sizeof(chunk));
+        if (chunk.offset != pos + sizeof(chunk) || chunk.first_center != _recovered_centers.size()
+            || !archive_fits(chunk.offset, chunk.size_compressed, 1, _size)
+            || chunk.size_raw/ARCHIVE_MAX_INFLATE_RATIO > chunk.size_compressed
+            || !archive_fits(chunk.offset_tables, chunk.n_centers, size_center, chunk.size_raw)
+            || !archive_fits(chunk.offset_tables + chunk.n_centers*size_center, chunk.n_structures,
+                sizeof(archive_structure_t), chunk.size_raw)) break;
+        raw.resize(chunk.size_raw);
+        uLongf size_raw = chunk.size_raw;
+        int status = uncompress(reinterpret_cast<Bytef*>(&raw[0]), &size_raw,
+            reinterpret_cast<const Bytef*>(_data + chunk.offset), chunk.size_compressed);
+        if (status != Z_OK || size_raw != chunk.size_raw) break; // <- torn by the interrupted writer
+        const char *tables = &raw[chunk.offset_tables];
+        uint64_t n = chunk.n_centers;
+        _recovered_centers.resize(_recovered_centers.size() + n);
+        std::memcpy(&*(_recovered_centers.end() - n), tables, n*sizeof(archive_center_t));
+        tables += n*sizeof(archive_center_t);
+        if (with_gradients) {
+            _recovered_gradients.resize(_recovered_gradients.size() + n);
+            std::memcpy(&*(_recovered_gradients.end() - n), tables, n*sizeof(archive_gradient_t));
+            tables += n*sizeof(archive_gradient_t);
+        }
+        n = chunk.n_structures;
+        _recovered_structures.resize(_recovered_structures.size() + n);
+        if (n > 0) std::memcpy(&*(_recovered_structures.end() - n), tables, n*sizeof(archive_structure_t));
+        _recovered_chunks.push_back(chunk);
+        pos = chunk.offset + chunk.size_compressed;
+    }
+    h.n_structures = _recovered_structures.size();
+    h.n_centers = _recovered_centers.size();
+    h.n_chunks = _recovered_chunks.size();
+    h.size_file = _size;
+    _header = &_recovered_header;
+    _structures = _recovered_structures.data();
+    _centers = _recovered_centers.data();
+    _gradients = _recovered_gradients.data();
+    _chunks = _recovered_chunks.data();
+    _recovered = true;
+    return "";
+}
+
+std::string SpectrumArchive::validate() {
+    // Tables
+    const archive_header_t &h = *_header;
+    if (!archive_fits(h.offset_species, h.n_species, 16, _size)) return "species table out of bounds";
+    if (h.offset_options > 0 && !archive_fits(h.offset_options, h.size_options, 1, _size)) return "options out of bounds";
+    if (!_recovered) {
+        if (!archive_fits(h.offset_structures, h.n_structures, sizeof(archive_structure_t), _size)) return "structure table out of bounds";
+        if (!archive_fits(h.offset_centers, h.n_centers, sizeof(archive_center_t), _size)) return "center table out of bounds";
+        if (this->hasGradients() && !archive_fits(h.offset_gradients, h.n_centers, sizeof(archive_gradient_t), _size)) return "gradient table out of bounds";
+        if (this->isChunked() && !archive_fits(h.offset_chunks, h.n_chunks, sizeof(archive_chunk_t), _size)) return "chunk table out of bounds";
+        _structures = reinterpret_cast<const archive_structure_t*>(_data + h.offset_structures);
+        _centers = reinterpret_cast<const archive_center_t*>(_data + h.offset_centers);
+        if (this->hasGradients()) _gradients = reinterpret_cast<const archive_gradient_t*>(_data + h.offset_gradients);
+        if (this->isChunked()) _chunks = reinterpret_cast<const archive_chunk_t*>(_data + h.offset_chunks);
+    }
+    const char *species = _data + h.offset_species;
+    for (uint64_t s = 0; s < h.n_species; ++s) {
+        _species.push_back(std::string(species + 16*s, strnlen(species + 16*s, 16)));
+    }
+    // Records: basis dimensions fix the record size
+    if (h.n_centers == 0 && h.N < 0) {
+        _blocks.assign(1, 0);
+        return "";
+    }
+    if (h.N < 1 || h.N > 1024 || h.L < 0 || h.L > 1024 || h.n_species > 1024) return "bad basis dimensions";
+    uint64_t n_elements = h.n_species*(uint64_t(h.N)*(h.L+1)*(h.L+1)
+        + ((this->hasPower()) ? h.n_species*uint64_t(h.N)*h.N*(h.L+1) : 0))
+        + ((this->hasPower()) ? uint64_t(h.N)*h.N*(h.L+1) : 0);
+    if (n_elements > _size || n_elements > uint64_t(std::numeric_limits<int>::max())) return "records out of bounds";
+    archive_blocks(_species.size(), this->N(), this->L(), this->hasPower(), _blocks);
+    if (h.record_size != archive_record_size(h.dtype, _blocks)) return "inconsistent record size";
+    uint64_t size_payloads = _size; // <- bound on gradient offsets, per chunk if chunked
+    if (!this->isChunked()) {
+        if (!archive_fits(h.offset_records, h.n_centers, h.record_size, _size)) return "records out of bounds";
+    }
+    else {
+        uint64_t n_centers = 0;
+        for (uint64_t k = 0; k < h.n_chunks; ++k) {
+            const archive_chunk_t &chunk = _chunks[k];
+            if (chunk.first_center != n_centers || chunk.n_centers == 0 || chunk.n_centers > h.n_centers - n_centers) return "inconsistent chunk table";
+            if (!archive_fits(chunk.offset, chunk.size_compressed, 1, _size)) return "chunk out of bounds";
+            if (!archive_fits(0, chunk.n_centers, h.record_size, chunk.size_raw)
+                || chunk.size_raw/ARCHIVE_MAX_INFLATE_RATIO > chunk.size_compressed) return "inconsistent chunk size";
+            n_centers += chunk.n_centers;
+        }
+        if (n_centers != h.n_centers) return "inconsistent chunk table";
+    }
+    // Structures, centers & gradient payloads
+    for (uint64_t s = 0; s < h.n_structures; ++s) {
+        if (_structures[s].first_center > h.n_centers || _structures[s].n_centers > h.n_centers - _structures[s].first_center) {
+            return "inconsistent structure table";
+        }
+    }
+    uint64_t k = 0;
+    for (uint64_t c = 0; c < h.n_centers; ++c) {
+        if (_centers[c].structure >= h.n_structures || _centers[c].species < 0 || _centers[c].species >= h.n_species) {
+            return "inconsistent center table";
+        }
+        if (!this->hasGradients()) continue;
+        if (this->isChunked()) {
+            while (c >= _chunks[k].first_center + _chunks[k].n_centers) ++k;
+            size_payloads = _chunks[k].size_raw;
+        }
+        const archive_gradient_t &gradient = _gradients[c];
+        uint64_t size_nb = archive_gradient_size(1, this->N(), this->L());
+        if (gradient.n_neighbours > size_payloads/size_nb
+            || !archive_fits(gradient.offset, archive_gradient_size(gradient.n_neighbours, this->N(), this->L()), 1, size_payloads)) {
+            return "gradients out of bounds";
+        }
+    }
+    return "";
+}
+
+const char *SpectrumArchive::record(int c) {
+    if (!this->isChunked()) return _data + _header->offset_records + c*_header->record_size;
+    // Chunk holding center c, by bisection over the first centers
+    int k0 = 0;
+    int k1 = _header->n_chunks;
+    while (k1 - k0 > 1) {
+        int k = (k0+k1)/2;
+        if (_chunks[k].first_center <= c) k0 = k;
+        else k1 = k;
+    }
+    return this->chunk(k0) + (c-_chunks[k0].first_center)*_header->record_size;
+}
+
+const char *SpectrumArchive::chunk(int k) {
+    if (k != _cached_chunk) {
+        const archive_chunk_t &chunk = _chunks[k];
+        _chunk_cache.resize(chunk.size_raw);
+        uLongf size_raw = chunk.size_raw;
+        int status = uncompress(reinterpret_cast<Bytef*>(&_chunk_cache[0]), &size_raw,
+            reinterpret_cast<const Bytef*>(_data + chunk.offset), chunk.size_compressed);
+        if (status != Z_OK || size_raw != chunk.size_raw) {
+            _cached_chunk = -1;
+            throw soap::base::IOError("Spectrum archive " + _filename + ": corrupt chunk "
+                + boost::lexical_cast<std::string>(k));
+        }
+        _cached_chunk = k;
+    }
+    return &_chunk_cache[0];
+}
+
+SpectrumArchive::~SpectrumArchive() {
+    delete _basis;
+    _basis = NULL;
+    delete _options;
+    _options = NULL;
+    if (_data) ::munmap(const_cast<char*>(_data), _size);
+    if (_fd >= 0) ::close(_fd);
+    _data = NULL;
+    _fd = -1;
+}
+
+const archive_structure_t &SpectrumArchive::getStructure(int s) {
+    if (s < 0 || s >= _header->n_structures) throw soap::base::OutOfRange("SpectrumArchive: structure index");
+    return _structures[s];
+}
+
+const archive_center_t &SpectrumArchive::getCenter(int c) {
+    if (c < 0 || c >= _header->n_centers) throw soap::base::OutOfRange("SpectrumArchive: center index");
+    return _centers[c];
+}
+
+const SpectrumArchive::cmplx_t *SpectrumArchive::getQnlm(int c) {
+    this->getCenter(c);
+    if (this->dtype() != ARCHIVE_COMPLEX128) {
+        throw soap::base::APIError("SpectrumArchive: direct access requires complex128 records, use decode");
+    }
+    return reinterpret_cast<const cmplx_t*>(this->record(c));
+}
+
+const SpectrumArchive::cmplx_t *SpectrumArchive::getXnkl(int c) {
+    if (!this->hasPower()) throw soap::base::APIError("SpectrumArchive: archive stores no power spectra");
+    return this->getQnlm(c) + _species.size()*this->N()*(this->L()+1)*(this->L()+1);
+}
+
+const SpectrumArchive::cmplx_t *SpectrumArchive::getXnklGeneric(int c) {
+    return this->getXnkl(c) + _species.size()*_species.size()*this->N()*this->N()*(this->L()+1);
+}
+
+std::vector<int> SpectrumArchive::findCenters(std::string type) {
+    std::vector<int> centers;
+    int species = -1;
+    if (type != "") {
+        auto it = std::find(_species.begin(), _species.end(), type);
+        if (it == _species.end()) return centers;
+        species = it - _species.begin();
+    }
+    for (int c = 0; c < this->nCenters(); ++c) {
+        if (species < 0 || _centers[c].species == species) centers.push_back(c);
+    }
+    return centers;
+}
+
+int SpectrumArchive::findCenter(int s, int center_id) {
+    const archive_structure_t &structure = this->getStructure(s);
+    for (int c = structure.first_center; c < structure.first_center+structure.n_centers; ++c) {
+        if (_centers[c].center_id == center_id) return c;
+    }
+    return -1;
+}
+
+Basis *SpectrumArchive::getBasis() {
+    if (!_basis) {
+        if (_header->offset_options == 0) {
+            throw soap::base::APIError("SpectrumArchive: archive stores no basis options");
+        }
+        std::stringstream bstream;
+        bstream.write(_data + _header->offset_options, _header->size_options);
+        boost::archive::binary_iarchive arch(bstream);
+        _options = new Options();
+        arch >> (*_options);
+        _basis = new Basis(_options);
+    }
+    return _basis;
+}
+
+AtomicSpectrum *SpectrumArchive::getAtomicSpectrum(int c, bool gradients) {
+    const archive_center_t &center = this->getCenter(c);
+    Basis *basis = this->getBasis();
+    AtomicSpectrum *atomic = new AtomicSpectrum(basis);
+    atomic->_center_id = center.center_id;
+    atomic->_center_type = _species[center.species];
+    atomic->_center_pos = vec(center.pos[0], center.pos[1], center.pos[2]);
+    // Densities & power spectra, blocks of absent species (pairs) are zero
+    std::vector<cmplx_t> rec;
+    this->decode(c, rec);
+    int S = _species.size();
+    for (int b = 0; b < this->nBlocks(); ++b) {
+        bool is_zero = true;
+        for (int i = _blocks[b]; i < _blocks[b+1] && is_zero; ++i) is_zero = (rec[i] == cmplx_t(0.,0.));
+        if (is_zero && b != S+S*S) continue;
+        if (b < S) {
+            BasisExpansion qnlm(basis);
+            std::copy(&rec[_blocks[b]], &rec[_blocks[b+1]], &qnlm.getCoefficients().data()[0]);
+            atomic->addQnlm(_species[b], qnlm);
+        }
+        else {
+            PowerExpansion *xnkl = new PowerExpansion(basis);
+            std::copy(&rec[_blocks[b]], &rec[_blocks[b+1]], &xnkl->getCoefficients().data()[0]);
+            if (b < S+S*S) {
+                int s1 = (b-S)/S;
+                int s2 = (b-S)%S;
+                atomic->_map_xnkl[AtomicSpectrum::type_pair_t(_species[s1], _species[s2])] = xnkl;
+            }
+            else atomic->_xnkl_generic_coherent = xnkl;
+        }
+    }
+    // Neighbour density gradients, decoded on request only
+    if (gradients && _gradients) {
+        const archive_gradient_t &gradient = _gradients[c];
+        int n_nb = gradient.n_neighbours;
+        if (n_nb > 0) {
+            // Chunked: offset into the chunk of center c, which record() has just decompressed
+            const char *base = (this->isChunked()) ?
+                this->record(c) - (c-_chunks[_cached_chunk].first_center)*_header->record_size : _data;
+            const int32_t *ids = reinterpret_cast<const int32_t*>(base + gradient.offset);
+            const cmplx_t *grad = reinterpret_cast<const cmplx_t*>(ids + 2*n_nb + (2*n_nb)%4);
+            for (int i = 0; i < n_nb; ++i) {
+                if (ids[n_nb+i] < 0 || ids[n_nb+i] >= S) {
+                    delete atomic;
+                    throw soap::base::IOError("Spectrum archive " + _filename + ": corrupt gradients of center "
+                        + boost::lexical_cast<std::string>(c));
+                }
+                atomic->_nb_pids.push_back(ids[i]);
+                atomic->_nb_types.push_back(_species[ids[n_nb+i]]);
+            }
+            int size_nb = 3*this->N()*(this->L()+1)*(this->L()+1);
+            atomic->_qnlm_grad.assign(grad, grad+n_nb*size_nb);
+        }
+    }
+    return atomic;
+}
+
+void SpectrumArchive::decode(int c, std::vector<cmplx_t> &out) {
+    this->getCenter(c);
+    const char *rec = this->record(c);
+    int n_elements = _blocks.back();
+    out.resize(n_elements);
+    switch (this->dtype()) {
+        case ARCHIVE_COMPLEX128: {
+            const double *in = reinterpret_cast<const double*>(rec);
+            for (int i = 0; i < n_elements; ++i) out[i] = cmplx_t(in[2*i], in[2*i+1]);
+            break;
+        }
+        case ARCHIVE_COMPLEX64: {
+            const float *in = reinterpret_cast<const float*>(rec);
+            for (int i = 0; i < n_elements; ++i) out[i] = cmplx_t(in[2*i], in[2*i+1]);
+            break;
+        }
+        case ARCHIVE_QINT16:
+        case ARCHIVE_QINT8: {
+            const float *scales = reinterpret_cast<const float*>(rec + archive_scales_offset(this->dtype(), n_elements));
+            const int16_t *in16 = reinterpret_cast<const int16_t*>(rec);
+            const int8_t *in8 = reinterpret_cast<const int8_t*>(rec);
+            bool is_16 = (this->dtype() == ARCHIVE_QINT16);
+            for (int b = 0; b < this->nBlocks(); ++b) {
+                double scale = scales[b];
+                for (int i = _blocks[b]; i < _blocks[b+1]; ++i) {
+                    out[i] = (is_16) ?
+                        cmplx_t(in16[2*i]*scale, in16[2*i+1]*scale) :
+                        cmplx_t(in8[2*i]*scale, in8[2*i+1]*scale);
+                }
+            }
+            break;
+        }
+    }
+    return;
+}
+
+boost::python::object SpectrumArchive::decodeNumpy(int c) {
+    std::vector<cmplx_t> out;
+    this->decode(c, out);
+#if BOOST_VERSION >= 106400
+    namespace np = boost::python::numpy;
+    np::ndarray arr = np::empty(boost::python::make_tuple(out.size()), np::dtype::get_builtin<cmplx_t>());
+    std::copy(out.begin(), out.end(), reinterpret_cast<cmplx_t*>(arr.get_data()));
+    return arr;
+#else
+    throw soap::base::NotImplemented("SpectrumArchive::decodeNumpy requires boost >= 1.64");
+#endif
+}
+
+boost::python::list SpectrumArchive::findCentersPython(std::string type) {
+    std::vector<int> centers = this->findCenters(type);
+    boost::python::list py_centers;
+    for (auto it = centers.begin(); it != centers.end(); ++it) py_centers.append(*it);
+    return py_centers;
+}
+
+boost::python::list SpectrumArchive::getSpeciesPython() {
+    boost::python::list species;
+    for (auto it = _species.begin(); it != _species.end(); ++it) species.append(*it);
+    return species;
+}
+
+boost::python::tuple SpectrumArchive::getStructureCenters(int s) {
+    const archive_structure_t &structure = this->getStructure(s);
+    return boost::python::make_tuple(structure.first_center, structure.n_centers);
+}
+
+std::string SpectrumArchive::getStructureLabel(int s) {
+    return std::string(this->getStructure(s).label);
+}
+
+boost::python::object SpectrumArchive::getCenterIdsNumpy() {
+#if BOOST_VERSION >= 106400
+    namespace np = boost::python::numpy;
+    np::ndarray ids = np::empty(boost::python::make_tuple(this->nCenters()), np::dtype::get_builtin<int>());
+    int *ptr = reinterpret_cast<int*>(ids.get_data());
+    for (int c = 0; c < this->nCenters(); ++c) ptr[c] = _centers[c].center_id;
+    return ids;
+#else
+    throw soap::base::NotImplemented("SpectrumArchive::getCenterIdsNumpy requires boost >= 1.64");
+#endif
+}
+
+boost::python::object SpectrumArchive::getCenterSpeciesNumpy() {
+#if BOOST_VERSION >= 106400
+    namespace np = boost::python::numpy;
+    np::ndarray species = np::empty(boost::python::make_tuple(this->nCenters()), np::dtype::get_builtin<int>());
+    int *ptr = reinterpret_cast<int*>(species.get_data());
+    for (int c = 0; c < this->nCenters(); ++c) ptr[c] = _centers[c].species;
+    return species;
+#else
+    throw soap::base::NotImplemented("SpectrumArchive::getCenterSpeciesNumpy requires boost >= 1.64");
+#endif
+}
+
+boost::python::object SpectrumArchive::getCenterStructuresNumpy() {
+#if BOOST_VERSION >= 106400
+    namespace np = boost::python::numpy;
+    np::ndarray structures = np::empty(boost::python::make_tuple(this->nCenters()), np::dtype::get_builtin<int>());
+    int *ptr = reinterpret_cast<int*>(structures.get_data());
+    for (int c = 0; c < this->nCenters(); ++c) ptr[c] = _centers[c].structure;
+    return structures;
+#else
+    throw soap::base::NotImplemented("SpectrumArchive::getCenterStructuresNumpy requires boost >= 1.64");
+#endif
+}
+
+boost::python::object SpectrumArchive::getBlockViewNumpy(boost::python::object self, int first_block, std::vector<int> dims) {
+    // Read-only view of the mapped file, shape (n_centers, dims...), kept alive by <self>.
+    // Complex dtypes map onto complex numpy types, quantized ones get a trailing (re,im) axis.
+#if BOOST_VERSION >= 106400
+    namespace np = boost::python::numpy;
+    SpectrumArchive &archive = boost::python::extract<SpectrumArchive&>(self);
+    if (archive.isChunked()) throw soap::base::APIError("SpectrumArchive: chunked archives have no array views, use decode");
+    uint32_t dtype = archive.dtype();
+    int size = archive_dtype_size(dtype);
+    np::dtype np_dtype = np::dtype::get_builtin<cmplx_t>();
+    if (dtype == ARCHIVE_COMPLEX64) np_dtype = np::dtype::get_builtin<std::complex<float> >();
+    else if (dtype == ARCHIVE_QINT16) np_dtype = np::dtype::get_builtin<int16_t>();
+    else if (dtype == ARCHIVE_QINT8) np_dtype = np::dtype::get_builtin<int8_t>();
+    if (archive_is_quantized(dtype)) dims.push_back(2);
+    else size *= 2;
+    std::vector<Py_intptr_t> shape(1, archive.nCenters());
+    std::vector<Py_intptr_t> strides(1, archive._header->record_size);
+    shape.insert(shape.end(), dims.begin(), dims.end());
+    strides.resize(shape.size());
+    strides.back() = size;
+    for (int d = shape.size()-2; d > 0; --d) strides[d] = strides[d+1]*shape[d+1];
+    const char *ptr = archive._data + archive._header->offset_records
+        + archive._blocks[first_block]*2*archive_dtype_size(dtype);
+    boost::python::list py_shape, py_strides;
+    for (int d = 0; d < shape.size(); ++d) {
+        py_shape.append(shape[d]);
+        py_strides.append(strides[d]);
+    }
+    return np::from_data(static_cast<const void*>(ptr), np_dtype,
+        boost::python::tuple(py_shape), boost::python::tuple(py_strides), self);
+#else
+    throw soap::base::NotImplemented("SpectrumArchive::getBlockViewNumpy requires boost >= 1.64");
+#endif
+}
+
+boost::python::object SpectrumArchive::getQnlmNumpy(boost::python::object self) {
+    // (n_centers, n_species, N, (L+1)^2)
+    SpectrumArchive &archive = boost::python::extract<SpectrumArchive&>(self);
+    int L = archive.L();
+    std::vector<int> dims = { archive.nSpecies(), archive.N(), (L+1)*(L+1) };
+    return getBlockViewNumpy(self, 0, dims);
+}
+
+boost::python::object SpectrumArchive::getXnklNumpy(boost::python::object self) {
+    // (n_centers, n_species^2, N*N, L+1)
+    SpectrumArchive &archive = boost::python::extract<SpectrumArchive&>(self);
+    if (!archive.hasPower()) throw soap::base::APIError("SpectrumArchive: archive stores no power spectra");
+    int S = archive.nSpecies();
+    int N = archive.N();
+    std::vector<int> dims = { S*S, N*N, archive.L()+1 };
+    return getBlockViewNumpy(self, S, dims);
+}
+
+boost::python::object SpectrumArchive::getXnklGenericNumpy(boost::python::object self) {
+    // (n_centers, N*N, L+1)
+    SpectrumArchive &archive = boost::python::extract<SpectrumArchive&>(self);
+    if (!archive.hasPower()) throw soap::base::APIError("SpectrumArchive: archive stores no power spectra");
+    int S = archive.nSpecies();
+    int N = archive.N();
+    std::vector<int> dims = { N*N, archive.L()+1 };
+    return getBlockViewNumpy(self, S+S*S, dims);
+}
+
+boost::python::object SpectrumArchive::getScalesNumpy(boost::python::object self) {
+    // Block scales of quantized archives, (n_centers, n_blocks) float32: blocks are
+    // ordered as species (Q_nlm), species pairs (X_nkl) and g/c (X_nkl^gc)
+#if BOOST_VERSION >= 106400
+    namespace np = boost::python::numpy;
+    SpectrumArchive &archive = boost::python::extract<SpectrumArchive&>(self);
+    if (!archive_is_quantized(archive.dtype())) {
+        throw soap::base::APIError("SpectrumArchive: no scales, archive is not quantized");
+    }
+    if (archive.isChunked()) throw soap::base::APIError("SpectrumArchive: chunked archives have no array views, use decode");
+    const char *ptr = archive._data + archive._header->offset_records
+        + archive_scales_offset(archive.dtype(), archive._blocks.back());
+    return np::from_data(static_cast<const void*>(ptr), np::dtype::get_builtin<float>(),
+        boost::python::make_tuple(archive.nCenters(), archive.nBlocks()),
+        boost::python::make_tuple(archive._header->record_size, sizeof(float)), self);
+#else
+    throw soap::base::NotImplemented("SpectrumArchive::getScalesNumpy requires boost >= 1.64");
+#endif
+}
+
+void SpectrumArchive::registerPython() {
+    using namespace boost::python;
+    class_<SpectrumArchive, boost::noncopyable>("SpectrumArchive", init<std::string>())
+        .add_property("N", &SpectrumArchive::N)
+        .add_property("L", &SpectrumArchive::L)
+        .add_property("dtype", &SpectrumArchive::getDtypeString)
+        .add_property("basis", make_function(&SpectrumArchive::getBasis, return_value_policy<reference_existing_object>()))
+        .def("__len__", &SpectrumArchive::nCenters)
+        .def("nStructures", &SpectrumArchive::nStructures)
+        .def("nCenters", &SpectrumArchive::nCenters)
+        .def("hasPower", &SpectrumArchive::hasPower)
+        .def("hasGradients", &SpectrumArchive::hasGradients)
+        .def("findCenters", &SpectrumArchive::findCentersPython)
+        .def("findCenter", &SpectrumArchive::findCenter)
+        .def("getAtomic", &SpectrumArchive::getAtomicSpectrum,
+            return_value_policy<manage_new_object, with_custodian_and_ward_postcall<0,1> >())
+        .def("getSpecies", &SpectrumArchive::getSpeciesPython)
+        .def("getStructureCenters", &SpectrumArchive::getStructureCenters)
+        .def("getStructureLabel", &SpectrumArchive::getStructureLabel)
+        .def("getCenterIds", &SpectrumArchive::getCenterIdsNumpy)
+        .def("getCenterSpecies", &SpectrumArchive::getCenterSpeciesNumpy)
+        .def("getCenterStructures", &SpectrumArchive::getCenterStructuresNumpy)
+        .def("getLinearArray", &SpectrumArchive::getQnlmNumpy)
+        .def("getPowerArray", &SpectrumArchive::getXnklNumpy)
+        .def("getPowerGenericArray", &SpectrumArchive::getXnklGenericNumpy)
+        .def("getScalesArray", &SpectrumArchive::getScalesNumpy)
+        .def("decode", &SpectrumArchive::decodeNumpy);
+}
+
+}
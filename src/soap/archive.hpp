@@ -0,0 +1,298 @@
+#ifndef _SOAP_ARCHIVE_HPP
+#define _SOAP_ARCHIVE_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <complex>
+#include <sstream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include <boost/python.hpp>
+
+#include "soap/base/exceptions.hpp"
+#include "soap/options.hpp"
+#include "soap/spectrum.hpp"
+
+namespace soap {
+
+// Flat, versioned binary format for collections of spectra, designed to be
+// memory-mapped rather than deserialized. File layout:
+// o header (archive_header_t)
+// o species table: n_species x char[16]
+// o center records, one per atomic spectrum, each of fixed size record_size:
+//     Q_nlm   (n_species, N, (L+1)^2)
+//     X_nkl   (n_species^2, N*N, L+1)    (if ARCHIVE_WITH_POWER)
+//     X_nkl^gc (N*N, L+1)                (if ARCHIVE_WITH_POWER)
+//   type pairs (s1,s2) at index s1*n_species+s2. Each of these blocks
+//   (one per species, species pair and g/c) is stored as
+//     complex128 or complex64, or
+//     (re,im) pairs of int16 or int8, value = q*scale, where the float32
+//     scales of all blocks follow the values at the end of the record.
+// o neighbour gradients (if ARCHIVE_WITH_GRADIENTS), one variable-size
+//   payload per center, located via the gradient table (archive_gradient_t):
+//     pids    int32[n_nb], species int32[n_nb] (padded to 16 bytes)
+//     dQ_nlm  complex128 (n_nb, 3, N, (L+1)^2)
+// o structure table (archive_structure_t)
+// o center table (archive_center_t)
+// o gradient table (archive_gradient_t, if ARCHIVE_WITH_GRADIENTS)
+// o options (boost binary archive of the basis options)
+// Sections start at ARCHIVE_ALIGN boundaries. All offsets are absolute.
+// Since records have a fixed size, they can be appended while writing and
+// exposed as strided arrays when reading. Atomic spectra are only
+// reconstructed (and payloads decoded) on access, see SpectrumArchive.
+//
+// Chunked archives (ARCHIVE_CHUNKED) instead group whole structures, at
+// least chunk_size centers each, into zlib-compressed chunks holding
+//     records, gradient payloads, center table, gradient table, structure table
+// of these centers. Gradient offsets are then relative to the uncompressed
+// chunk. Each chunk is preceded by its archive_chunk_t entry, and the
+// options are written ahead of the first chunk, so that the archive grows
+// by appending only. close() appends the full tables and the final header
+// as for plain archives. An archive that was never closed (size_file == 0)
+// is recovered on open by scanning the chunk entries, up to the first
+// incomplete chunk. Chunks are compressed and written by a background
+// thread, so that the writer holds at most a few chunks in memory, and
+// decompressed by the reader one at a time.
+
+static const char ARCHIVE_MAGIC[8] = {'S','O','A','P','X','X','A','\0'};
+static const uint32_t ARCHIVE_VERSION = 3;
+static const uint32_t ARCHIVE_BYTE_ORDER = 0x01020304;
+static const uint64_t ARCHIVE_ALIGN = 64;
+static const uint32_t ARCHIVE_WITH_POWER = 0x1;
+static const uint32_t ARCHIVE_WITH_GRADIENTS = 0x2;
+static const uint32_t ARCHIVE_CHUNKED = 0x4;
+static const int ARCHIVE_MAX_PENDING_CHUNKS = 2;
+static const uint64_t ARCHIVE_MAX_INFLATE_RATIO = 1032; // <- zlib bound, limits the raw size a chunk may claim
+
+enum archive_dtype_t
+{
+    ARCHIVE_COMPLEX128 = 0,
+    ARCHIVE_COMPLEX64 = 1,
+    ARCHIVE_QINT16 = 2,
+    ARCHIVE_QINT8 = 3
+};
+
+archive_dtype_t archive_dtype_from_string(const std::string &dtype);
+std::string archive_dtype_to_string(uint32_t dtype);
+// Bytes per (real or imaginary) component
+int archive_dtype_size(uint32_t dtype);
+// Element offsets of the blocks within a record, followed by the total element count
+void archive_blocks(int n_species, int N, int L, bool with_power, std::vector<int> &blocks);
+
+struct archive_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t flags;
+    uint32_t dtype;
+    int32_t N;
+    int32_t L;
+    uint64_t n_species;
+    uint64_t n_structures;
+    uint64_t n_centers;
+    uint64_t record_size;
+    uint64_t offset_species;
+    uint64_t offset_records;
+    uint64_t offset_structures;
+    uint64_t offset_centers;
+    uint64_t size_file;
+    uint64_t offset_options; // <- 0 if absent
+    uint64_t size_options;
+    uint64_t offset_gradients; // <- gradient table, 0 if absent
+    uint64_t offset_chunks; // <- chunk table, 0 if not chunked
+    uint64_t n_chunks;
+    uint64_t reserved[1];
+};
+
+struct archive_structure_t
+{
+    uint64_t first_center;
+    uint64_t n_centers;
+    uint64_t n_particles;
+    char label[40];
+};
+
+struct archive_center_t
+{
+    uint64_t structure;
+    int32_t center_id;
+    int32_t species;
+    double pos[3];
+};
+
+struct archive_gradient_t
+{
+    uint64_t offset;
+    uint64_t n_neighbours;
+};
+
+struct archive_chunk_t
+{
+    uint64_t offset; // <- of the compressed data
+    uint64_t first_center;
+    uint64_t n_centers;
+    uint64_t size_raw;
+    uint64_t size_compressed;
+    uint64_t offset_tables; // <- of the center table within the uncompressed chunk
+    uint64_t n_structures;
+};
+
+
+class SpectrumArchiveWriter
+{
+public:
+    typedef std::complex<double> cmplx_t;
+
+    SpectrumArchiveWriter(std::string filename, std::vector<std::string> species, bool with_power,
+        std::string dtype = "complex128", bool with_gradients = false, int chunk_size = 0);
+    SpectrumArchiveWriter(std::string filename, boost::python::list species, bool with_power,
+        std::string dtype = "complex128", bool with_gradients = false, int chunk_size = 0);
+   ~SpectrumArchiveWriter();
+
+    // Thread-safe: spectra may be appended from several compute threads
+    void add(Spectrum &spectrum, std::string label);
+    void close();
+    static void registerPython();
+
+private:
+    void open(std::string filename, bool with_power, std::string dtype, bool with_gradients, int chunk_size);
+    void addGradients(AtomicSpectrum *atomic, std::ostream &out);
+    void flushChunk();
+    void flushWorker();
+    int speciesIndex(const std::string &type);
+    void pad();
+    template<typename T>
+    void encode(const cmplx_t *values, int n_values, char *dest);
+    template<typename T>
+    void quantize(const cmplx_t *values, int n_values, char *dest, float *scale);
+
+    std::string _filename;
+    std::ofstream _ofs;
+    std::fstream _grad_fs; // <- gradient payloads, spliced in on close
+    bool _is_open;
+    std::mutex _mutex_add;
+    archive_header_t _header;
+    std::vector<std::string> _species;
+    std::vector<archive_structure_t> _structures;
+    std::vector<archive_center_t> _centers;
+    std::vector<archive_gradient_t> _gradients;
+    std::string _options;
+    std::vector<int> _blocks; // <- block offsets (in elements) into record, plus end
+    std::vector<cmplx_t> _record;
+    std::vector<char> _buffer;
+
+    // CHUNKING
+    struct chunk_job_t
+    {
+        uint64_t first_center;
+        uint64_t n_centers;
+        uint64_t offset_tables;
+        uint64_t n_structures;
+        std::vector<char> raw;
+    };
+    int _chunk_size;
+    uint64_t _chunk_first;
+    uint64_t _chunk_first_structure;
+    std::vector<char> _chunk_records;
+    std::stringstream _chunk_grads;
+    std::vector<archive_chunk_t> _chunks;
+    std::deque<chunk_job_t*> _queue;
+    std::mutex _mutex_queue;
+    std::condition_variable _cv_queue;
+    std::thread _worker;
+    bool _stop;
+    std::string _worker_error;
+};
+
+
+class SpectrumArchive
+{
+public:
+    typedef std::complex<double> cmplx_t;
+
+    SpectrumArchive(std::string filename);
+   ~SpectrumArchive();
+
+    // Lookup: archive center indices c by center species (all if empty),
+    // or of center <center_id> within structure s (-1 if absent)
+    std::vector<int> findCenters(std::string type);
+    int findCenter(int s, int center_id);
+    // New atomic spectrum (owned by the caller, linked to getBasis()) from record c
+    AtomicSpectrum *getAtomicSpectrum(int c, bool gradients = true);
+    Basis *getBasis();
+
+    int N() { return _header->N; }
+    int L() { return _header->L; }
+    int nSpecies() { return _species.size(); }
+    int nStructures() { return _header->n_structures; }
+    int nCenters() { return _header->n_centers; }
+    bool hasPower() { return _header->flags & ARCHIVE_WITH_POWER; }
+    bool hasGradients() { return _header->flags & ARCHIVE_WITH_GRADIENTS; }
+    uint32_t dtype() { return _header->dtype; }
+    int nBlocks() { return _blocks.size()-1; }
+    uint64_t recordSize() { return _header->record_size; }
+    std::vector<std::string> &getSpecies() { return _species; }
+    const archive_structure_t &getStructure(int s);
+    const archive_center_t &getCenter(int c);
+    const cmplx_t *getQnlm(int c);
+    const cmplx_t *getXnkl(int c);
+    const cmplx_t *getXnklGeneric(int c);
+    // Record c converted to complex128, in the layout of the record
+    void decode(int c, std::vector<cmplx_t> &out);
+
+    boost::python::list getSpeciesPython();
+    boost::python::tuple getStructureCenters(int s);
+    std::string getStructureLabel(int s);
+    std::string getDtypeString() { return archive_dtype_to_string(this->dtype()); }
+    boost::python::object decodeNumpy(int c);
+    boost::python::list findCentersPython(std::string type);
+    boost::python::object getCenterIdsNumpy();
+    boost::python::object getCenterSpeciesNumpy();
+    boost::python::object getCenterStructuresNumpy();
+    static boost::python::object getQnlmNumpy(boost::python::object self);
+    static boost::python::object getXnklNumpy(boost::python::object self);
+    static boost::python::object getXnklGenericNumpy(boost::python::object self);
+    static boost::python::object getScalesNumpy(boost::python::object self);
+    static void registerPython();
+
+private:
+    // Checks header, tables and payload extents against the mapped size, "" if consistent
+    std::string validate();
+    // Rebuilds the tables of an unclosed chunked archive from its chunks, "" on success
+    std::string recover();
+    const char *record(int c);
+    const char *chunk(int k);
+    bool isChunked() { return _header->flags & ARCHIVE_CHUNKED; }
+    static boost::python::object getBlockViewNumpy(boost::python::object self, int first_block, std::vector<int> dims);
+
+    std::string _filename;
+    int _fd;
+    const char *_data;
+    size_t _size;
+    const archive_header_t *_header;
+    const archive_structure_t *_structures;
+    const archive_center_t *_centers;
+    std::vector<std::string> _species;
+    std::vector<int> _blocks;
+    const archive_gradient_t *_gradients;
+    Options *_options; // <- created with _basis on first access
+    Basis *_basis;
+    const archive_chunk_t *_chunks;
+    bool _recovered; // <- tables below replace those of the (unclosed) file
+    archive_header_t _recovered_header;
+    std::vector<archive_structure_t> _recovered_structures;
+    std::vector<archive_center_t> _recovered_centers;
+    std::vector<archive_gradient_t> _recovered_gradients;
+    std::vector<archive_chunk_t> _recovered_chunks;
+    int _cached_chunk; // <- single decompressed chunk, invalidates previously returned pointers
+    std::vector<char> _chunk_cache;
+};
+
+}
+
+#endif /* _SOAP_ARCHIVE_HPP */
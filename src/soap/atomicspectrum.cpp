@@ -1,52 +1,80 @@
 #include <fstream>
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 
 #include "soap/atomicspectrum.hpp"
+#include "soap/linalg/operations.hpp"
+#include "soap/base/profile.hpp"
 
 namespace soap {
 
-AtomicSpectrum::AtomicSpectrum(Particle *center, Basis *basis) {
+spectrum_memory_t &spectrum_memory_t::operator+=(const spectrum_memory_t &other) {
+    density += other.density;
+    power += other.power;
+    density_gradients += other.density_gradients;
+    power_gradients += other.power_gradients;
+    return *this;
+}
+
+boost::python::dict spectrum_memory_t::toPython() const {
+    boost::python::dict usage;
+    usage["density"] = density;
+    usage["power"] = power;
+    usage["density_gradients"] = density_gradients;
+    usage["power_gradients"] = power_gradients;
+    usage["total"] = this->total();
+    return usage;
+}
+
+AtomicSpectrum::AtomicSpectrum(Particle *center, Basis *basis, base::Arena *arena) :
+    _map_qnlm(map_qnlm_t::key_compare(), map_qnlm_t::allocator_type(arena)),
+    _map_xnkl(map_xnkl_t::key_compare(), map_xnkl_t::allocator_type(arena)),
+    _qnlm_grad(qnlm_grad_t::allocator_type(arena)),
+    _xnkl_grad(xnkl_grad_t::allocator_type(arena)),
+    _xnkl_grad_gc(xnkl_grad_t::allocator_type(arena)) {
     this->null();
     _center = center;
     _center_id = center->getId();
     _center_pos = center->getPos();
     _center_type = center->getType();
     _basis = basis;
-    _qnlm_generic = new BasisExpansion(_basis);
+    _arena = arena;
+    _qnlm_generic = this->createExpansion<qnlm_t>();
 }
 
-AtomicSpectrum::AtomicSpectrum(Basis *basis) {
+AtomicSpectrum::AtomicSpectrum(Basis *basis, base::Arena *arena) :
+    _map_qnlm(map_qnlm_t::key_compare(), map_qnlm_t::allocator_type(arena)),
+    _map_xnkl(map_xnkl_t::key_compare(), map_xnkl_t::allocator_type(arena)),
+    _qnlm_grad(qnlm_grad_t::allocator_type(arena)),
+    _xnkl_grad(xnkl_grad_t::allocator_type(arena)),
+    _xnkl_grad_gc(xnkl_grad_t::allocator_type(arena)) {
     this->null();
     _basis = basis;
-    _qnlm_generic = new BasisExpansion(_basis);
+    _arena = arena;
+    _qnlm_generic = this->createExpansion<qnlm_t>();
 }
 
 AtomicSpectrum::~AtomicSpectrum() {
     // CLEAN QNLM'S
     // ... Summed density expansions
-    for (auto it = _map_qnlm.begin(); it != _map_qnlm.end(); ++it) delete it->second;
+    for (auto it = _map_qnlm.begin(); it != _map_qnlm.end(); ++it) this->destroyExpansion(it->second);
     _map_qnlm.clear();
     // ... Generic density
-    if (_qnlm_generic) {
-        delete _qnlm_generic;
-        _qnlm_generic = NULL;
-    }
+    this->destroyExpansion(_qnlm_generic);
+    _qnlm_generic = NULL;
     // CLEAN XNKL'S
     // ... Scalar spectra
-    for (auto it = _map_xnkl.begin(); it != _map_xnkl.end(); ++it) delete it->second;
+    for (auto it = _map_xnkl.begin(); it != _map_xnkl.end(); ++it) this->destroyExpansion(it->second);
     _map_xnkl.clear();
 
     // ... Generic power spectra
-    if (_xnkl_generic_coherent) {
-        delete _xnkl_generic_coherent;
-        _xnkl_generic_coherent = NULL;
-    }
-    if (_xnkl_generic_incoherent) {
-        delete _xnkl_generic_incoherent;
-        _xnkl_generic_incoherent = NULL;
-    }
+    this->destroyExpansion(_xnkl_generic_coherent);
+    _xnkl_generic_coherent = NULL;
+    this->destroyExpansion(_xnkl_generic_incoherent);
+    _xnkl_generic_incoherent = NULL;
     // CLEAN PID-RESOLVED GRADIENTS
     this->prunePidData();
 }
@@ -57,28 +85,42 @@ void AtomicSpectrum::null() {
     _center_pos = vec(0,0,0);
     _center_type = "?";
     _basis = NULL;
+    _arena = NULL;
     _qnlm_generic = NULL;
     _xnkl_generic_coherent = NULL;
     _xnkl_generic_incoherent = NULL;
+    _n_array_views = 0;
+}
+
+void AtomicSpectrum::assertNoArrayViews() {
+    if (_n_array_views > 0) {
+        throw soap::base::APIError("AtomicSpectrum: cannot recompute or release the gradients while views onto "
+            "the gradient or virial arrays are alive, copy or delete them first");
+    }
 }
 
 void AtomicSpectrum::prunePidData() {
     // CLEAN PID-RESOLVED GRADIENTS
-    // ... Neighbour density expansions with gradients
-    for (auto it = _map_pid_qnlm.begin(); it != _map_pid_qnlm.end(); ++it) delete it->second.second;
-    _map_pid_qnlm.clear();
+    // ... Neighbour density gradients
+    _nb_pids.clear();
+    _nb_types.clear();
+    qnlm_grad_t(_qnlm_grad.get_allocator()).swap(_qnlm_grad); // <- keeps the arena
     // ... Xnkl gradients
-    for (auto it = _map_pid_xnkl.begin(); it != _map_pid_xnkl.end(); ++it) {
-        for (auto jt = (*it).second.begin(); jt != (*it).second.end(); ++jt) {
-            delete (*jt).second;
-        }
-        (*it).second.clear();
-    }
-    _map_pid_xnkl.clear();
-    // ... Gradients (generic-coherent)
+    this->clearPowerGradients();
+}
+
+void AtomicSpectrum::clearPowerGradients() {
+    _grad_pids.clear();
+    _grad_types.clear();
+    _grad_type_pairs.clear();
+    xnkl_grad_t(_xnkl_grad.get_allocator()).swap(_xnkl_grad);
+    xnkl_grad_t(_xnkl_grad_gc.get_allocator()).swap(_xnkl_grad_gc);
+    std::vector<std::pair<int,int> >().swap(_grad_pid_index);
+    // ... Gradients (generic-coherent), PowerExpansion views
     for (auto it = _map_pid_xnkl_gc.begin(); it != _map_pid_xnkl_gc.end(); ++it) {
-        delete it->second;
+        this->destroyExpansion(it->second);
     }
+    _map_pid_xnkl_gc.clear();
 }
 
 void AtomicSpectrum::invert(map_xnkl_t &map_xnkl, xnkl_t *xnkl_generic_coherent, std::string type1, std::string type2) {
@@ -137,7 +179,7 @@ void AtomicSpectrum::addQnlm(std::string type, qnlm_t &nb_expansion) {
         "Should not sum expansions linked against different bases.");
     map_qnlm_t::iterator it = _map_qnlm.find(type);
     if (it == _map_qnlm.end()) {
-        _map_qnlm[type] = new BasisExpansion(_basis);
+        _map_qnlm[type] = this->createExpansion<qnlm_t>();
         it = _map_qnlm.find(type);
     }
     it->second->add(nb_expansion);
@@ -145,36 +187,126 @@ void AtomicSpectrum::addQnlm(std::string type, qnlm_t &nb_expansion) {
     return;
 }
 
-void AtomicSpectrum::addQnlmNeighbour(Particle *nb, qnlm_t *nb_expansion) {
+void AtomicSpectrum::addQnlmNeighbour(Particle *nb, qnlm_t &nb_expansion, vec dr, std::vector<int> *nb_index) {
+    // Copies what is needed out of <nb_expansion>, which the caller may reuse
     std::string type = nb->getType();
     int id = nb->getId();
-    this->addQnlm(type, *nb_expansion);
+    this->addQnlm(type, nb_expansion);
+    if (nb_expansion.hasGradients()) {
+        this->addQnlmVirial(_map_qnlm_virial[type], nb_expansion, dr, 1.);
+        this->addQnlmVirial(_qnlm_virial_generic, nb_expansion, dr, 1.);
+    }
+
+    if (nb != this->getCenter() && nb_expansion.hasGradients()) {
+        // Images of a particle already listed add to the existing block
+        int idx = this->findOrAddNeighbour(id, type, nb_index);
+        BasisExpansion::coeff_t *dq[3] = {
+            &nb_expansion.getCoefficientsGradX(),
+            &nb_expansion.getCoefficientsGradY(),
+            &nb_expansion.getCoefficientsGradZ() };
+        for (int d = 0; d < 3; ++d) {
+            linalg::axpy(dq[d]->data().size(), 1., &dq[d]->data()[0], this->qnlmGradSlot(idx, d));
+        }
+    }
+    return;
+}
 
-    if (nb == this->getCenter()) {
-        delete nb_expansion; // <- gradients should be zero, do not store
-        //std::cout << "DO NOT STORE" << std::endl;
+int AtomicSpectrum::findOrAddNeighbour(int pid, const std::string &type, std::vector<int> *nb_index) {
+    // Images of a particle are added back to back, hence the last block is
+    // tried first. Otherwise, if given, <nb_index> is used and updated; without
+    // one, the neighbour list is scanned.
+    if (pid < 0) throw soap::base::OutOfRange("<AtomicSpectrum::findOrAddNeighbour> Particle id");
+    int idx = -1;
+    if (_nb_pids.size() && _nb_pids.back() == pid) {
+        idx = _nb_pids.size()-1;
+    }
+    else if (nb_index) {
+        if (pid >= nb_index->size()) nb_index->resize(pid+1, -1);
+        idx = (*nb_index)[pid];
     }
     else {
-        auto it = _map_pid_qnlm.find(id);
-        if (it != _map_pid_qnlm.end()) {
-
-            // There is already an entry for this pid - hence, this must be an image of the actual particle.
-            // Add coefficients & gradients to existing density expansion.
-            // This sanity check is no longer adequate:
-            // throw soap::base::SanityCheckFailed("<AtomicSpectrum::addQnlm> Already have entry for pid.");
-            _map_pid_qnlm[id].second->add(*nb_expansion);
-            if (nb_expansion->hasGradients()) {
-                _map_pid_qnlm[id].second->addGradient(*nb_expansion);
+        auto it = std::find(_nb_pids.begin(), _nb_pids.end(), pid);
+        if (it != _nb_pids.end()) idx = it - _nb_pids.begin();
+    }
+    if (idx < 0) {
+        idx = this->addNeighbour(pid, type);
+        if (nb_index) (*nb_index)[pid] = idx;
+    }
+    return idx;
+}
+
+int AtomicSpectrum::addNeighbour(int pid, const std::string &type) {
+    int N = _basis->getRadBasis()->N();
+    int L = _basis->getAngBasis()->L();
+    _nb_pids.push_back(pid);
+    _nb_types.push_back(type);
+    _qnlm_grad.resize(_qnlm_grad.size()+3*N*(L+1)*(L+1), cmplx_t(0.,0.));
+    return _nb_pids.size()-1;
+}
+
+void AtomicSpectrum::reserveNeighbours(int n_nb) {
+    int N = _basis->getRadBasis()->N();
+    int L = _basis->getAngBasis()->L();
+    _nb_pids.reserve(n_nb);
+    _nb_types.reserve(n_nb);
+    size_t size_grad = n_nb*3*N*(L+1)*(L+1);
+    if (size_grad < _qnlm_grad.size() || size_grad == _qnlm_grad.capacity()) return;
+    // Blocks added before (see Spectrum::computeHalf) may have left spare capacity
+    qnlm_grad_t qnlm_grad(_qnlm_grad.get_allocator());
+    qnlm_grad.reserve(size_grad);
+    qnlm_grad.assign(_qnlm_grad.begin(), _qnlm_grad.end());
+    _qnlm_grad.swap(qnlm_grad);
+}
+
+void AtomicSpectrum::releaseNeighbourIndex(std::vector<int> &nb_index) {
+    // Resets the entries set by findOrAddNeighbour, so that <nb_index> can serve the next spectrum
+    for (auto it = _nb_pids.begin(); it != _nb_pids.end(); ++it) {
+        if (*it < nb_index.size()) nb_index[*it] = -1;
+    }
+}
+
+void AtomicSpectrum::packQnlmGradients(map_pid_qnlm_t &map_pid_qnlm) {
+    // Converts per-pid BasisExpansions (as stored by legacy archives) into
+    // the block layout. Takes ownership of the expansions.
+    _nb_pids.clear();
+    _nb_types.clear();
+    _qnlm_grad.clear();
+    for (auto it = map_pid_qnlm.begin(); it != map_pid_qnlm.end(); ++it) {
+        qnlm_t *pid_qnlm = it->second.second;
+        if (pid_qnlm->hasGradients()) {
+            int idx = this->addNeighbour(it->first, it->second.first); // <- keys are unique
+            BasisExpansion::coeff_t *dq[3] = {
+                &pid_qnlm->getCoefficientsGradX(),
+                &pid_qnlm->getCoefficientsGradY(),
+                &pid_qnlm->getCoefficientsGradZ() };
+            for (int d = 0; d < 3; ++d) {
+                std::copy(&dq[d]->data()[0], &dq[d]->data()[0]+dq[d]->data().size(), this->qnlmGradSlot(idx, d));
             }
         }
-        else {
-            _map_pid_qnlm[id] = std::pair<std::string,qnlm_t*>(type, nb_expansion);
+        delete pid_qnlm;
+    }
+    return;
+}
+
+void AtomicSpectrum::addQnlmVirial(qnlm_virial_t &virial, qnlm_t &nb_expansion, vec &dr, double scale) {
+    // virial_{ab,nlm} += scale * dr_a * dQ_{nlm}/dr_b
+    int N = _basis->getRadBasis()->N();
+    int LM = (_basis->getAngBasis()->L()+1)*(_basis->getAngBasis()->L()+1);
+    if (virial.size() == 0) virial.assign(9*N*LM, cmplx_t(0.,0.));
+    BasisExpansion::coeff_t *dq[3] = {
+        &nb_expansion.getCoefficientsGradX(),
+        &nb_expansion.getCoefficientsGradY(),
+        &nb_expansion.getCoefficientsGradZ() };
+    double r[3] = { dr.getX(), dr.getY(), dr.getZ() };
+    for (int a = 0; a < 3; ++a) {
+        for (int b = 0; b < 3; ++b) {
+            linalg::axpy(N*LM, scale*r[a], &dq[b]->data()[0], &virial[(a*3+b)*N*LM]);
         }
     }
     return;
 }
 
-void AtomicSpectrum::mergeQnlm(AtomicSpectrum *other, double scale, bool gradients) {
+void AtomicSpectrum::mergeQnlm(AtomicSpectrum *other, double scale, bool gradients, std::vector<int> *nb_index) {
     // Function used to construct global spectrum as sum over atomic spectra.
     // The result is itself an "atomic" spectrum (as data fields are largely identical,
     // except for the fact that this summed spectrum does not have a well-defined center.
@@ -194,30 +326,31 @@ void AtomicSpectrum::mergeQnlm(AtomicSpectrum *other, double scale, bool gradien
         // Already have density of this type?
         auto mit = _map_qnlm.find(density_type);
         if (mit == _map_qnlm.end()) {
-            _map_qnlm[density_type] = new qnlm_t(_basis);
+            _map_qnlm[density_type] = this->createExpansion<qnlm_t>();
             mit = _map_qnlm.find(density_type);
         }
         // Add ...
         mit->second->add(*density, scale);
     }
-    // Particle-ID-resolved gradients
+    // Particle-ID-resolved gradients: scatter-add blocks via the pid index
     if (gradients) {
-        map_pid_qnlm_t &map_pid_qnlm_other = other->getPidQnlmMap();
-        for (auto it = map_pid_qnlm_other.begin(); it != map_pid_qnlm_other.end(); ++it) {
-            int pid = it->first;
-            std::string pid_type = it->second.first;
-            qnlm_t *density_grad = it->second.second;
-            // Already have density gradient for this particle?
-            auto mit = _map_pid_qnlm.find(pid);
-            if (mit == _map_pid_qnlm.end()) {
-                qnlm_t *qnlm = new qnlm_t(_basis);
-                // Remember to setup zero matrices to store gradient ...
-                qnlm->zeroGradient();
-                _map_pid_qnlm[pid] = std::pair<std::string,qnlm_t*>(pid_type, qnlm);
-                mit = _map_pid_qnlm.find(pid);
-            }
-            // Add gradients ...
-            mit->second.second->addGradient(*density_grad);
+        int size_block = 3*_basis->getRadBasis()->N()*(_basis->getAngBasis()->L()+1)*(_basis->getAngBasis()->L()+1);
+        for (int j = 0; j < other->_nb_pids.size(); ++j) {
+            int idx = this->findOrAddNeighbour(other->_nb_pids[j], other->_nb_types[j], nb_index);
+            cmplx_t *block = &_qnlm_grad[idx*size_block];
+            const cmplx_t *block_other = &other->_qnlm_grad[j*size_block];
+            for (int i = 0; i < size_block; ++i) block[i] += block_other[i];
+        }
+        // Virials are strain derivatives of the qnlm, hence scale these as the qnlm
+        map_qnlm_virial_t &map_virial_other = other->_map_qnlm_virial;
+        for (auto it = map_virial_other.begin(); it != map_virial_other.end(); ++it) {
+            qnlm_virial_t &virial = _map_qnlm_virial[it->first];
+            if (virial.size() == 0) virial.assign(it->second.size(), cmplx_t(0.,0.));
+            for (int i = 0; i < virial.size(); ++i) virial[i] += scale*it->second[i];
+        }
+        if (other->_qnlm_virial_generic.size()) {
+            if (_qnlm_virial_generic.size() == 0) _qnlm_virial_generic.assign(other->_qnlm_virial_generic.size(), cmplx_t(0.,0.));
+            for (int i = 0; i < _qnlm_virial_generic.size(); ++i) _qnlm_virial_generic[i] += scale*other->_qnlm_virial_generic[i];
         }
     }
     return;
@@ -237,62 +370,268 @@ AtomicSpectrum::qnlm_t *AtomicSpectrum::getQnlm(std::string type) {
 }
 
 void AtomicSpectrum::computePowerGradients() {
-    GLOG() << "CID " << _center_id << ": " << std::endl;
-    for (auto it1 = _map_pid_qnlm.begin(); it1 != _map_pid_qnlm.end(); ++it1) {
-        // Derivatives are taken with respect to the coordinates of this neighbour particle
-        int pi_id = it1->first;
-        std::string pi_type = it1->second.first;
-        qnlm_t *pi_qnlm = it1->second.second;
-        // Check and prepare storage in map
-        auto it = _map_pid_xnkl.find(pi_id);
-        if (it != _map_pid_xnkl.end()) {
-            soap::base::SanityCheckFailed("<AtomicSpectrum::computePowerGradients> Already have entry for pid.");
+    // Computes the derivatives of X_{nkl}^{munu} wrt the positions of all neighbour
+    // particles j. With G^{j,nu}_{nk,l} = sum_m dQ^{mu}_{nlm}(j) conj(Q^{nu}_{klm}) and
+    // mu the type of j,
+    //   d X^{munu}_{nkl} = c_l G_{nk}            (mu != nu)
+    //   d X^{numu}_{nkl} = c_l conj(G_{kn})      (mu != nu)
+    //   d X^{mumu}_{nkl} = c_l (G_{nk} + conj(G_{kn}))
+    // For a given nu and l, G is obtained for all neighbours and components at
+    // once from a single complex GEMM of the stacked dQ's with Q^{nu}.
+    int N = _basis->getRadBasis()->N();
+    int L = _basis->getAngBasis()->L();
+    int NN = N*N;
+    int LM = (L+1)*(L+1);
+    bool with_sqrt_2l_1_norm = _basis->getConfig().sqrt_2l1_norm;
+    this->assertNoArrayViews();
+    this->clearPowerGradients();
+
+    // INDEX PIDS, TYPES & TYPE PAIRS
+    std::map<std::string, int> type_idx;
+    for (auto it = _map_qnlm.begin(); it != _map_qnlm.end(); ++it) {
+        type_idx[it->first] = _grad_types.size();
+        _grad_types.push_back(it->first);
+    }
+    int n_types = _grad_types.size();
+    for (int i1 = 0; i1 < n_types; ++i1) {
+        for (int i2 = 0; i2 < n_types; ++i2) {
+            _grad_type_pairs.push_back(type_pair_t(_grad_types[i1], _grad_types[i2]));
+        }
+    }
+    int n_pairs = _grad_type_pairs.size();
+    int n_pids = _nb_pids.size();
+    std::vector<int> pid_type_idx;
+    _grad_pids = _nb_pids;
+    for (auto it = _nb_types.begin(); it != _nb_types.end(); ++it) {
+        auto tit = type_idx.find(*it);
+        if (tit == type_idx.end()) {
+            throw soap::base::SanityCheckFailed("<AtomicSpectrum::computePowerGradients> No density for neighbour type.");
+        }
+        pid_type_idx.push_back(tit->second);
+    }
+    GLOG_DEBUG() << "CID " << _center_id << ": " << n_pids << " neighbours, " << n_pairs << " type pairs" << std::endl;
+    _xnkl_grad.assign(n_pids*3*n_pairs*NN*(L+1), cmplx_t(0.,0.));
+    _xnkl_grad_gc.assign(n_pids*3*NN*(L+1), cmplx_t(0.,0.));
+    this->computePowerVirial();
+    if (n_pids == 0) return;
+    SOAP_PROFILE_COUNT("power.gradient_neighbours", n_pids);
+
+    // dQ's ARE STACKED ALREADY: ROW (pid_idx*3+dim)*N+n, COLUMN lm
+    int n_rows = n_pids*3*N;
+    const cmplx_t *dqnlm = &_qnlm_grad[0];
+    int a = 0;
+
+    // ONE GEMM PER DENSITY TYPE (+ GENERIC) AND l, THEN SCATTER INTO TENSORS
+    std::vector<cmplx_t> gmat(n_rows*N);
+    for (int nu = 0; nu <= n_types; ++nu) {
+        bool generic = (nu == n_types);
+        qnlm_t *qnlm_nu = (generic) ? _qnlm_generic : _map_qnlm[_grad_types[nu]];
+        if (generic && !_qnlm_generic) break;
+        const cmplx_t *q = &qnlm_nu->getCoefficients().data()[0];
+        for (int l = 0; l <= L; ++l) {
+            double c_l = (with_sqrt_2l_1_norm) ? 2.*sqrt(2.)*M_PI/sqrt(2.*l+1) : 1.; // Normalization = sqrt(8\pi^2/(2l+1))
+            soap::linalg::linalg_zgemm_conj_trans(n_rows, N, 2*l+1,
+                &dqnlm[l*l], LM, q+l*l, LM, &gmat[0], N);
+            for (a = 0; a < n_pids; ++a) {
+                int mu = pid_type_idx[a];
+                for (int d = 0; d < 3; ++d) {
+                    const cmplx_t *g = &gmat[(a*3+d)*N*N];
+                    if (generic || mu == nu) {
+                        cmplx_t *x = (generic) ? gradSlotGeneric(a, d) : gradSlot(a, d, mu*n_types+mu);
+                        for (int n = 0; n < N; ++n) {
+                            for (int k = 0; k < N; ++k) {
+                                x[(n*N+k)*(L+1)+l] = c_l*(g[n*N+k] + std::conj(g[k*N+n]));
+                            }
+                        }
+                    }
+                    else {
+                        cmplx_t *x_munu = gradSlot(a, d, mu*n_types+nu);
+                        cmplx_t *x_numu = gradSlot(a, d, nu*n_types+mu);
+                        for (int n = 0; n < N; ++n) {
+                            for (int k = 0; k < N; ++k) {
+                                x_munu[(n*N+k)*(L+1)+l] = c_l*g[n*N+k];
+                                x_numu[(k*N+n)*(L+1)+l] = c_l*std::conj(g[n*N+k]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return;
+}
+
+void AtomicSpectrum::computePowerVirial() {
+    // Strain derivatives of X_{nkl}^{munu} from those of the densities, W^mu = sum_j r_j (x) dQ^mu/dr_j:
+    //   V^{munu}_{ab,nkl} = c_l (H^{nu,mu}_{ab,nk} + conj(H^{mu,nu}_{ab,kn})),  H^{nu,mu}_ab = W^mu_ab (Q^nu)^+
+    // Types and type pairs are indexed as for the gradients (see computePowerGradients).
+    int N = _basis->getRadBasis()->N();
+    int L = _basis->getAngBasis()->L();
+    int NN = N*N;
+    int LM = (L+1)*(L+1);
+    int n_types = _grad_types.size();
+    int n_pairs = _grad_type_pairs.size();
+    bool with_sqrt_2l_1_norm = _basis->getConfig().sqrt_2l1_norm;
+    if (_qnlm_virial_generic.size() == 0) {
+        xnkl_grad_t().swap(_xnkl_virial);
+        xnkl_grad_t().swap(_xnkl_virial_gc);
+        return;
+    }
+    _xnkl_virial.assign(9*n_pairs*NN*(L+1), cmplx_t(0.,0.));
+    _xnkl_virial_gc.assign(9*NN*(L+1), cmplx_t(0.,0.));
+
+    // STACK W's: ROW ((mu*9+ab)*N+n) FOR TYPE mu, GENERIC LAST
+    int n_rows_type = 9*N;
+    std::vector<cmplx_t> wnlm((n_types+1)*n_rows_type*LM, cmplx_t(0.,0.));
+    for (int mu = 0; mu < n_types; ++mu) {
+        auto it = _map_qnlm_virial.find(_grad_types[mu]);
+        if (it == _map_qnlm_virial.end()) continue;
+        std::copy(it->second.begin(), it->second.end(), &wnlm[mu*n_rows_type*LM]);
+    }
+    std::copy(_qnlm_virial_generic.begin(), _qnlm_virial_generic.end(), &wnlm[n_types*n_rows_type*LM]);
+
+    std::vector<cmplx_t> hmat(n_types*n_types*n_rows_type*N); // <- (nu, mu, ab, n, k)
+    std::vector<cmplx_t> hmat_gc(n_rows_type*N);
+    for (int l = 0; l <= L; ++l) {
+        double c_l = (with_sqrt_2l_1_norm) ? 2.*sqrt(2.)*M_PI/sqrt(2.*l+1) : 1.; // Normalization = sqrt(8\pi^2/(2l+1))
+        for (int nu = 0; nu < n_types; ++nu) {
+            const cmplx_t *q = &_map_qnlm[_grad_types[nu]]->getCoefficients().data()[0];
+            soap::linalg::linalg_zgemm_conj_trans(n_types*n_rows_type, N, 2*l+1,
+                &wnlm[l*l], LM, q+l*l, LM, &hmat[nu*n_types*n_rows_type*N], N);
         }
-        _map_pid_xnkl[pi_id] = map_xnkl_t();
-        map_xnkl_t &xnkl_map = _map_pid_xnkl[pi_id];
-        // Compute for all type pairs
-        GLOG() << "    NID " << pi_id << " " << std::flush;
-        for (auto it2 = _map_qnlm.begin(); it2 != _map_qnlm.end(); ++it2) {
-            std::string type_other = it2->first;
-            qnlm_t *sum_qnlm_type_other = it2->second;
-            if (pi_type == type_other) {
-                // Type 1 == type 2
-                GLOG() << pi_type << "=" << type_other << " " << std::flush;
-                PowerExpansion *powex = new PowerExpansion(_basis);
-                powex->computeCoefficientsGradients(pi_qnlm, sum_qnlm_type_other, true);
-                // Store ...
-                type_pair_t types(pi_type, type_other);
-                auto it = xnkl_map.find(types);
-                assert(it == xnkl_map.end());
-                xnkl_map[types] = powex;
+        soap::linalg::linalg_zgemm_conj_trans(n_rows_type, N, 2*l+1,
+            &wnlm[n_types*n_rows_type*LM+l*l], LM, &_qnlm_generic->getCoefficients().data()[l*l], LM, &hmat_gc[0], N);
+        for (int ab = 0; ab < 9; ++ab) {
+            for (int mu = 0; mu < n_types; ++mu) {
+                for (int nu = 0; nu < n_types; ++nu) {
+                    const cmplx_t *h_numu = &hmat[((nu*n_types+mu)*9+ab)*NN];
+                    const cmplx_t *h_munu = &hmat[((mu*n_types+nu)*9+ab)*NN];
+                    cmplx_t *v = &_xnkl_virial[(ab*n_pairs+mu*n_types+nu)*NN*(L+1)];
+                    for (int n = 0; n < N; ++n) {
+                        for (int k = 0; k < N; ++k) {
+                            v[(n*N+k)*(L+1)+l] = c_l*(h_numu[n*N+k] + std::conj(h_munu[k*N+n]));
+                        }
+                    }
+                }
             }
-            else {
-                // Type 1 != type 2
-                GLOG() << pi_type << ":" << type_other << " " << std::flush;
-                PowerExpansion *powex_12 = new PowerExpansion(_basis);
-                powex_12->computeCoefficientsGradients(pi_qnlm, sum_qnlm_type_other, false);
-                GLOG() << type_other << ":" << pi_type << " " << std::flush;
-                PowerExpansion *powex_21 = new PowerExpansion(_basis);
-                powex_21->computeCoefficientsGradients(sum_qnlm_type_other, pi_qnlm, false);
-                // Store ...
-                type_pair_t types_12(pi_type, type_other);
-                type_pair_t types_21(type_other, pi_type);
-                auto it12 = xnkl_map.find(types_12);
-                auto it21 = xnkl_map.find(types_21);
-                assert(it12 == xnkl_map.end() && it21 == xnkl_map.end());
-                xnkl_map[types_12] = powex_12;
-                xnkl_map[types_21] = powex_21;
+            const cmplx_t *h = &hmat_gc[ab*NN];
+            cmplx_t *v = &_xnkl_virial_gc[ab*NN*(L+1)];
+            for (int n = 0; n < N; ++n) {
+                for (int k = 0; k < N; ++k) {
+                    v[(n*N+k)*(L+1)+l] = c_l*(h[n*N+k] + std::conj(h[k*N+n]));
+                }
+            }
+        }
+    }
+    return;
+}
+
+void AtomicSpectrum::packPowerGradients(map_pid_xnkl_t &map_pid_xnkl, map_pid_xnkl_gc_t &map_pid_xnkl_gc) {
+    // Converts per-pid PowerExpansion gradients (as stored by legacy archives)
+    // into the dense tensors. Takes ownership of the expansions.
+    this->clearPowerGradients();
+    int N = _basis->getRadBasis()->N();
+    int L = _basis->getAngBasis()->L();
+    int size_slot = N*N*(L+1);
+    for (auto it = _map_qnlm.begin(); it != _map_qnlm.end(); ++it) _grad_types.push_back(it->first);
+    for (auto it1 = _grad_types.begin(); it1 != _grad_types.end(); ++it1) {
+        for (auto it2 = _grad_types.begin(); it2 != _grad_types.end(); ++it2) {
+            _grad_type_pairs.push_back(type_pair_t(*it1, *it2));
+        }
+    }
+    for (auto it = map_pid_xnkl_gc.begin(); it != map_pid_xnkl_gc.end(); ++it) _grad_pids.push_back(it->first);
+    int n_pairs = _grad_type_pairs.size();
+    _xnkl_grad.assign(_grad_pids.size()*3*n_pairs*size_slot, cmplx_t(0.,0.));
+    _xnkl_grad_gc.assign(_grad_pids.size()*3*size_slot, cmplx_t(0.,0.));
+    for (int a = 0; a < _grad_pids.size(); ++a) {
+        xnkl_t *xnkl_gc = map_pid_xnkl_gc[_grad_pids[a]];
+        std::copy(&xnkl_gc->getCoefficientsGradX().data()[0], &xnkl_gc->getCoefficientsGradX().data()[0]+size_slot, gradSlotGeneric(a, 0));
+        std::copy(&xnkl_gc->getCoefficientsGradY().data()[0], &xnkl_gc->getCoefficientsGradY().data()[0]+size_slot, gradSlotGeneric(a, 1));
+        std::copy(&xnkl_gc->getCoefficientsGradZ().data()[0], &xnkl_gc->getCoefficientsGradZ().data()[0]+size_slot, gradSlotGeneric(a, 2));
+        map_xnkl_t &map_xnkl = map_pid_xnkl[_grad_pids[a]];
+        for (int p = 0; p < n_pairs; ++p) {
+            auto jt = map_xnkl.find(_grad_type_pairs[p]);
+            if (jt == map_xnkl.end()) continue;
+            std::copy(&jt->second->getCoefficientsGradX().data()[0], &jt->second->getCoefficientsGradX().data()[0]+size_slot, gradSlot(a, 0, p));
+            std::copy(&jt->second->getCoefficientsGradY().data()[0], &jt->second->getCoefficientsGradY().data()[0]+size_slot, gradSlot(a, 1, p));
+            std::copy(&jt->second->getCoefficientsGradZ().data()[0], &jt->second->getCoefficientsGradZ().data()[0]+size_slot, gradSlot(a, 2, p));
+        }
+    }
+    for (auto it = map_pid_xnkl.begin(); it != map_pid_xnkl.end(); ++it) {
+        for (auto jt = it->second.begin(); jt != it->second.end(); ++jt) delete jt->second;
+    }
+    for (auto it = map_pid_xnkl_gc.begin(); it != map_pid_xnkl_gc.end(); ++it) delete it->second;
+    return;
+}
+
+int AtomicSpectrum::getPowerGradPidIndex(int pid) {
+    if (_grad_pid_index.size() != _grad_pids.size()) {
+        _grad_pid_index.clear();
+        for (int a = 0; a < _grad_pids.size(); ++a) _grad_pid_index.push_back(std::pair<int,int>(_grad_pids[a], a));
+        std::sort(_grad_pid_index.begin(), _grad_pid_index.end());
+    }
+    auto it = std::lower_bound(_grad_pid_index.begin(), _grad_pid_index.end(), std::pair<int,int>(pid, -1));
+    if (it == _grad_pid_index.end() || it->first != pid) {
+        throw soap::base::OutOfRange("AtomicSpectrum: No gradients for pid " + boost::lexical_cast<std::string>(pid));
+    }
+    return it->second;
+}
+
+AtomicSpectrum::xnkl_t *AtomicSpectrum::getPowerGradGeneric(int pid) {
+    // Copies the generic-coherent gradients for this pid out of the dense
+    // tensor into a PowerExpansion, kept until the pid data are pruned
+    auto it = _map_pid_xnkl_gc.find(pid);
+    if (it != _map_pid_xnkl_gc.end()) return it->second;
+    int a = this->getPowerGradPidIndex(pid);
+    xnkl_t *xnkl = this->createExpansion<xnkl_t>();
+    xnkl->zeroGradient();
+    int size_slot = xnkl->getCoefficientsGradX().data().size();
+    std::copy(gradSlotGeneric(a, 0), gradSlotGeneric(a, 0)+size_slot, &xnkl->getCoefficientsGradX().data()[0]);
+    std::copy(gradSlotGeneric(a, 1), gradSlotGeneric(a, 1)+size_slot, &xnkl->getCoefficientsGradY().data()[0]);
+    std::copy(gradSlotGeneric(a, 2), gradSlotGeneric(a, 2)+size_slot, &xnkl->getCoefficientsGradZ().data()[0]);
+    _map_pid_xnkl_gc[pid] = xnkl;
+    return xnkl;
+}
+
+void AtomicSpectrum::computeQnlmSensitivity(const double *dE_dX, BasisExpansion::coeff_t &lambda) {
+    // Back-propagates the sensitivities g_nkl = dE/dRe(X_nkl) of the generic-coherent
+    // spectrum (row-major, index (n*N+k)*(L+1)+l) to the density: since
+    //   dE = Re sum_nlm dQ_nlm conj(Lambda_nlm),
+    //   Lambda_nlm = c_l sum_k (g_nkl + g_knl) Q_klm,
+    // the power-spectrum gradients need not be computed.
+    int N = _basis->getRadBasis()->N();
+    int L = _basis->getAngBasis()->L();
+    const double *prefac = _basis->getPowerPrefactors();
+    BasisExpansion::coeff_t &qnlm = _qnlm_generic->getCoefficients();
+    lambda = BasisExpansion::coeff_zero_t(N, (L+1)*(L+1));
+    for (int l = 0; l <= L; ++l) {
+        double c_l = prefac[l];
+        for (int n = 0; n < N; ++n) {
+            for (int k = 0; k < N; ++k) {
+                double g_nk = c_l*(dE_dX[(n*N+k)*(L+1)+l] + dE_dX[(k*N+n)*(L+1)+l]);
+                if (g_nk == 0.) continue;
+                linalg::axpy(2*l+1, g_nk, &qnlm(k, l*l), &lambda(n, l*l));
             }
         }
-        if (_qnlm_generic) {
-            auto it = _map_pid_xnkl_gc.find(pi_id);
-            if (it != _map_pid_xnkl_gc.end()) assert(false && "Already have Xnkl_gc gradients for pid.");
-            GLOG() << "*:* " << std::flush;
-            PowerExpansion *powex = new PowerExpansion(_basis);
-            powex->computeCoefficientsGradients(pi_qnlm, _qnlm_generic, true);
-            _map_pid_xnkl_gc[pi_id] = powex;
+    }
+    return;
+}
+
+void AtomicSpectrum::computeForcesAdjoint(const double *dE_dX, ub::matrix<double> &forces) {
+    // Adds the forces -dE/dr_j on all neighbour particles j (row j-1 of <forces>)
+    // from the stored density gradients, see computeQnlmSensitivity
+    BasisExpansion::coeff_t lambda;
+    this->computeQnlmSensitivity(dE_dX, lambda);
+    const cmplx_t *lambda_d = &lambda.data()[0];
+    for (int j = 0; j < _nb_pids.size(); ++j) {
+        int pid = _nb_pids[j];
+        if (pid < 1 || pid > forces.size1()) {
+            throw soap::base::OutOfRange("<AtomicSpectrum::computeForcesAdjoint> Particle id");
+        }
+        for (int d = 0; d < 3; ++d) {
+            double dE = linalg::conj_dot(lambda.data().size(), this->qnlmGradSlot(j, d), lambda_d).real();
+            forces(pid-1, d) -= dE;
         }
-        GLOG() << std::endl;
     }
     return;
 }
@@ -306,26 +645,72 @@ void AtomicSpectrum::computePower() {
     for (it1 = _map_qnlm.begin(); it1 != _map_qnlm.end(); ++it1) {
         for (it2 = _map_qnlm.begin(); it2 != _map_qnlm.end(); ++it2) {
             type_pair_t types(it1->first, it2->first);
-            GLOG() << " " << types.first << ":" << types.second << std::flush;
-            PowerExpansion *powex = new PowerExpansion(_basis);
+            GLOG_DEBUG() << " " << types.first << ":" << types.second << std::flush;
+            PowerExpansion *powex = this->createExpansion<xnkl_t>();
             powex->computeCoefficients(it1->second, it2->second);
             _map_xnkl[types] = powex;
         }
     }
     // Generic coherent
-    GLOG() << " g/c" << std::flush;
-    if (_xnkl_generic_coherent) delete _xnkl_generic_coherent;
-    _xnkl_generic_coherent = new PowerExpansion(_basis);
+    GLOG_DEBUG() << " g/c" << std::flush;
+    this->destroyExpansion(_xnkl_generic_coherent);
+    _xnkl_generic_coherent = this->createExpansion<xnkl_t>();
     _xnkl_generic_coherent->computeCoefficients(_qnlm_generic, _qnlm_generic);
     // Generic incoherent
-    GLOG() << " g/i" << std::flush;
-    if (_xnkl_generic_incoherent) delete _xnkl_generic_incoherent;
-    _xnkl_generic_incoherent = new PowerExpansion(_basis);
+    GLOG_DEBUG() << " g/i" << std::flush;
+    SOAP_PROFILE_COUNT("power.expansions", _map_xnkl.size()+2);
+    this->destroyExpansion(_xnkl_generic_incoherent);
+    _xnkl_generic_incoherent = this->createExpansion<xnkl_t>();
     map_xnkl_t::iterator it;
     for (it = _map_xnkl.begin(); it != _map_xnkl.end(); ++it) {
         _xnkl_generic_incoherent->add(it->second);
     }
-    GLOG() << std::endl;
+    GLOG_DEBUG() << std::endl;
+}
+
+spectrum_memory_t AtomicSpectrum::getMemoryUsage() {
+    spectrum_memory_t usage;
+    for (auto it = _map_qnlm.begin(); it != _map_qnlm.end(); ++it) usage.density += it->second->getMemoryUsage();
+    if (_qnlm_generic) usage.density += _qnlm_generic->getMemoryUsage();
+    for (auto it = _map_xnkl.begin(); it != _map_xnkl.end(); ++it) usage.power += it->second->getMemoryUsage();
+    if (_xnkl_generic_coherent) usage.power += _xnkl_generic_coherent->getMemoryUsage();
+    if (_xnkl_generic_incoherent) usage.power += _xnkl_generic_incoherent->getMemoryUsage();
+    // Dense tensors by size, but _qnlm_grad by capacity as it grows by neighbour
+    usage.density_gradients += _qnlm_grad.capacity()*sizeof(cmplx_t);
+    for (auto it = _map_qnlm_virial.begin(); it != _map_qnlm_virial.end(); ++it) {
+        usage.density_gradients += it->second.size()*sizeof(cmplx_t);
+    }
+    usage.density_gradients += _qnlm_virial_generic.size()*sizeof(cmplx_t);
+    usage.power_gradients += (_xnkl_grad.size() + _xnkl_grad_gc.size()
+        + _xnkl_virial.size() + _xnkl_virial_gc.size())*sizeof(cmplx_t);
+    // ... and what getPowerGradGeneric creates on demand
+    for (auto it = _map_pid_xnkl_gc.begin(); it != _map_pid_xnkl_gc.end(); ++it) {
+        usage.power_gradients += it->second->getMemoryUsage();
+    }
+    usage.power_gradients += _grad_pid_index.capacity()*sizeof(std::pair<int,int>);
+    return usage;
+}
+
+spectrum_memory_t AtomicSpectrum::estimateMemory(int N, int L, int n_types, int n_pids, int n_virial_types,
+        bool gradients, bool power_gradients) {
+    // Mirrors the allocations of addQnlmNeighbour, computePower & computePowerGradients:
+    // o one BasisExpansion per type + generic, with radial (N, L+1) and angular ((L+1)^2) scratch
+    // o one PowerExpansion per type pair + generic coherent & incoherent
+    // o dense gradient blocks per neighbour pid, density virials per type (+ generic),
+    //   power virials per type pair (+ generic)
+    size_t LM = (L+1)*(L+1);
+    size_t size_qnlm = N*LM*sizeof(cmplx_t);
+    size_t size_xnkl = N*N*(L+1)*sizeof(cmplx_t);
+    size_t n_pairs = n_types*n_types;
+    spectrum_memory_t usage;
+    usage.density = (n_types+1)*(size_qnlm + N*(L+1)*sizeof(double) + LM*sizeof(cmplx_t));
+    usage.power = (n_pairs+2)*size_xnkl;
+    if (gradients) {
+        int n_virials = (n_virial_types > 0) ? n_virial_types+1 : 0;
+        usage.density_gradients = (3*n_pids + 9*n_virials)*size_qnlm;
+        if (power_gradients) usage.power_gradients = (3*n_pids + 9)*(n_pairs+1)*size_xnkl;
+    }
+    return usage;
 }
 
 void AtomicSpectrum::write(std::ostream &ofs) {
@@ -378,12 +763,131 @@ boost::python::list AtomicSpectrum::getTypes() {
 
 boost::python::list AtomicSpectrum::getNeighbourPids() {
     boost::python::list pids;
-    for (auto it = _map_pid_xnkl_gc.begin(); it != _map_pid_xnkl_gc.end(); ++it) {
-        pids.append(it->first);
+    for (auto it = _nb_pids.begin(); it != _nb_pids.end(); ++it) {
+        pids.append(*it);
     }
     return pids;
 }
 
+class SpectrumArrayOwner
+{
+public:
+    // Base object of the numpy views onto the gradient & virial tensors of an
+    // atomic spectrum: keeps the atomic spectrum (and, through its wrapper, the
+    // owning Spectrum) alive, and recomputation or release of the tensors
+    // refused, for as long as any view exists
+    SpectrumArrayOwner(boost::python::object self) : _self(self) {
+        _atomic = boost::python::extract<AtomicSpectrum*>(self);
+        ++_atomic->_n_array_views;
+    }
+   ~SpectrumArrayOwner() { --_atomic->_n_array_views; }
+    static void registerPython() {
+        boost::python::class_<SpectrumArrayOwner, boost::noncopyable>("_SpectrumArrayOwner", boost::python::no_init);
+    }
+private:
+    boost::python::object _self;
+    AtomicSpectrum *_atomic;
+};
+
+#if BOOST_VERSION >= 106400
+static boost::python::object spectrum_array_view(boost::python::object self, AtomicSpectrum::cmplx_t *data,
+    boost::python::tuple shape, boost::python::tuple strides) {
+    // Writable view onto a tensor of <self> (see SpectrumArrayOwner)
+    namespace np = boost::python::numpy;
+    boost::python::manage_new_object::apply<SpectrumArrayOwner*>::type convert;
+    boost::python::object owner(boost::python::handle<>(convert(new SpectrumArrayOwner(self))));
+    return np::from_data(data, np::dtype::get_builtin<AtomicSpectrum::cmplx_t>(), shape, strides, owner);
+}
+#endif
+
+boost::python::object AtomicSpectrum::getQnlmGradNumpy(boost::python::object self) {
+    // Zero-copy view of shape (n_nb, 3, N, (L+1)^2), neighbours as in getNeighbourPids
+#if BOOST_VERSION >= 106400
+    AtomicSpectrum &atomic = boost::python::extract<AtomicSpectrum&>(self);
+    int N = atomic._basis->getRadBasis()->N();
+    int LM = (atomic._basis->getAngBasis()->L()+1)*(atomic._basis->getAngBasis()->L()+1);
+    int s = sizeof(cmplx_t);
+    boost::python::tuple shape = boost::python::make_tuple(atomic._nb_pids.size(), 3, N, LM);
+    boost::python::tuple strides = boost::python::make_tuple(3*N*LM*s, N*LM*s, LM*s, s);
+    return spectrum_array_view(self, atomic._qnlm_grad.data(), shape, strides);
+#else
+    throw soap::base::NotImplemented("AtomicSpectrum::getQnlmGradNumpy requires boost >= 1.64");
+#endif
+}
+
+boost::python::list AtomicSpectrum::getPowerGradTypePairsPython() {
+    boost::python::list pairs;
+    for (auto it = _grad_type_pairs.begin(); it != _grad_type_pairs.end(); ++it) {
+        pairs.append(boost::python::make_tuple(it->first, it->second));
+    }
+    return pairs;
+}
+
+boost::python::object AtomicSpectrum::getPowerGradNumpy(boost::python::object self) {
+    // Zero-copy view of shape (n_pids, 3, n_type_pairs, N*N, L+1)
+#if BOOST_VERSION >= 106400
+    AtomicSpectrum &atomic = boost::python::extract<AtomicSpectrum&>(self);
+    int N = atomic._basis->getRadBasis()->N();
+    int L = atomic._basis->getAngBasis()->L();
+    int s = sizeof(cmplx_t);
+    int n_pairs = atomic._grad_type_pairs.size();
+    boost::python::tuple shape = boost::python::make_tuple(atomic._grad_pids.size(), 3, n_pairs, N*N, L+1);
+    boost::python::tuple strides = boost::python::make_tuple(3*n_pairs*N*N*(L+1)*s, n_pairs*N*N*(L+1)*s, N*N*(L+1)*s, (L+1)*s, s);
+    return spectrum_array_view(self, atomic._xnkl_grad.data(), shape, strides);
+#else
+    throw soap::base::NotImplemented("AtomicSpectrum::getPowerGradNumpy requires boost >= 1.64");
+#endif
+}
+
+boost::python::object AtomicSpectrum::getPowerVirialNumpy(boost::python::object self) {
+    // Zero-copy view of shape (3, 3, n_type_pairs, N*N, L+1)
+#if BOOST_VERSION >= 106400
+    AtomicSpectrum &atomic = boost::python::extract<AtomicSpectrum&>(self);
+    int N = atomic._basis->getRadBasis()->N();
+    int L = atomic._basis->getAngBasis()->L();
+    int s = sizeof(cmplx_t);
+    int n_pairs = (atomic._xnkl_virial.size()) ? atomic._grad_type_pairs.size() : 0;
+    boost::python::tuple shape = boost::python::make_tuple(3, 3, n_pairs, N*N, L+1);
+    boost::python::tuple strides = boost::python::make_tuple(3*n_pairs*N*N*(L+1)*s, n_pairs*N*N*(L+1)*s, N*N*(L+1)*s, (L+1)*s, s);
+    return spectrum_array_view(self, atomic._xnkl_virial.data(), shape, strides);
+#else
+    throw soap::base::NotImplemented("AtomicSpectrum::getPowerVirialNumpy requires boost >= 1.64");
+#endif
+}
+
+boost::python::object AtomicSpectrum::getPowerVirialGenericNumpy(boost::python::object self) {
+    // Zero-copy view of shape (3, 3, N*N, L+1)
+#if BOOST_VERSION >= 106400
+    AtomicSpectrum &atomic = boost::python::extract<AtomicSpectrum&>(self);
+    if (atomic._xnkl_virial_gc.size() == 0) {
+        throw soap::base::APIError("<AtomicSpectrum::getPowerVirialGeneric> No virial, compute power gradients first.");
+    }
+    int N = atomic._basis->getRadBasis()->N();
+    int L = atomic._basis->getAngBasis()->L();
+    int s = sizeof(cmplx_t);
+    boost::python::tuple shape = boost::python::make_tuple(3, 3, N*N, L+1);
+    boost::python::tuple strides = boost::python::make_tuple(3*N*N*(L+1)*s, N*N*(L+1)*s, (L+1)*s, s);
+    return spectrum_array_view(self, atomic._xnkl_virial_gc.data(), shape, strides);
+#else
+    throw soap::base::NotImplemented("AtomicSpectrum::getPowerVirialGenericNumpy requires boost >= 1.64");
+#endif
+}
+
+boost::python::object AtomicSpectrum::getPowerGradGenericNumpy(boost::python::object self) {
+    // Zero-copy view of shape (n_pids, 3, N*N, L+1)
+#if BOOST_VERSION >= 106400
+    AtomicSpectrum &atomic = boost::python::extract<AtomicSpectrum&>(self);
+    int N = atomic._basis->getRadBasis()->N();
+    int L = atomic._basis->getAngBasis()->L();
+    int s = sizeof(cmplx_t);
+    boost::python::tuple shape = boost::python::make_tuple(atomic._grad_pids.size(), 3, N*N, L+1);
+    boost::python::tuple strides = boost::python::make_tuple(3*N*N*(L+1)*s, N*N*(L+1)*s, (L+1)*s, s);
+    return spectrum_array_view(self, atomic._xnkl_grad_gc.data(), shape, strides);
+#else
+    throw soap::base::NotImplemented("AtomicSpectrum::getPowerGradGenericNumpy requires boost >= 1.64");
+#endif
+}
+
 void AtomicSpectrum::registerPython() {
     using namespace boost::python;
 
@@ -400,10 +904,18 @@ void AtomicSpectrum::registerPython() {
         .def("getNeighbourPids", &AtomicSpectrum::getNeighbourPids)
         .def("getPower", &AtomicSpectrum::getPower, return_value_policy<reference_existing_object>())
         .def("getPowerGradGeneric", &AtomicSpectrum::getPowerGradGeneric, return_value_policy<reference_existing_object>())
+        .def("getLinearGradArray", &AtomicSpectrum::getQnlmGradNumpy)
+        .def("getPowerGradArray", &AtomicSpectrum::getPowerGradNumpy)
+        .def("getPowerGradGenericArray", &AtomicSpectrum::getPowerGradGenericNumpy)
+        .def("getPowerGradTypePairs", &AtomicSpectrum::getPowerGradTypePairsPython)
+        .def("getMemoryUsage", &AtomicSpectrum::getMemoryUsagePython)
+        .def("getPowerVirialArray", &AtomicSpectrum::getPowerVirialNumpy)
+        .def("getPowerVirialGenericArray", &AtomicSpectrum::getPowerVirialGenericNumpy)
         .def("getCenter", &AtomicSpectrum::getCenter, return_value_policy<reference_existing_object>())
         .def("getCenterId", &AtomicSpectrum::getCenterId)
         .def("getCenterType", &AtomicSpectrum::getCenterType, return_value_policy<reference_existing_object>())
         .def("getCenterPos", &AtomicSpectrum::getCenterPos, return_value_policy<reference_existing_object>());
+    SpectrumArrayOwner::registerPython();
 }
 
 }
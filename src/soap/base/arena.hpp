@@ -0,0 +1,129 @@
+#ifndef _SOAP_ARENA_HPP
+#define	_SOAP_ARENA_HPP
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <type_traits>
+#include "soap/base/profile.hpp"
+
+namespace soap { namespace base {
+
+// Bump allocator: hands out memory from large chunks and never frees single
+// allocations, all chunks are released together by release() or on
+// destruction. Objects placed in an arena must not outlive it, and are not
+// destroyed by it. Not thread-safe: use one arena per thread or owner.
+class Arena
+{
+public:
+    static const size_t CHUNK_SIZE = 1 << 20;
+    static const size_t ALIGNMENT = 64; // <- alignment of chunks
+
+    explicit Arena(size_t chunk_size = CHUNK_SIZE)
+        : _chunk_size(chunk_size), _head(NULL), _left(0), _n_allocations(0), _bytes_allocated(0), _bytes_reserved(0) { ; }
+   ~Arena() { this->release(); }
+
+    void *allocate(size_t size, size_t alignment) {
+        _n_allocations += 1;
+        _bytes_allocated += size;
+        if (size + alignment > _chunk_size) {
+            // Larger than a chunk: gets a chunk of its own, the current one stays in use
+            char *chunk = this->newChunk(size + alignment);
+            return chunk + (alignment - reinterpret_cast<size_t>(chunk) % alignment) % alignment;
+        }
+        size_t pad = (alignment - reinterpret_cast<size_t>(_head) % alignment) % alignment;
+        if (_head == NULL || pad + size > _left) {
+            _head = this->newChunk(_chunk_size);
+            _left = _chunk_size;
+            pad = (alignment - reinterpret_cast<size_t>(_head) % alignment) % alignment;
+        }
+        char *ptr = _head + pad;
+        _head = ptr + size;
+        _left -= pad + size;
+        return ptr;
+    }
+    template<typename T>
+    T *allocate(size_t n) {
+        return static_cast<T*>(this->allocate(n*sizeof(T), (alignof(T) > 16) ? alignof(T) : 16));
+    }
+    // Frees all chunks at once
+    void release() {
+        for (size_t i = 0; i < _chunks.size(); ++i) std::free(_chunks[i]);
+        _chunks.clear();
+        _head = NULL;
+        _left = 0;
+        _n_allocations = 0;
+        _bytes_allocated = 0;
+        _bytes_reserved = 0;
+    }
+
+    size_t getNumberOfAllocations() const { return _n_allocations; }
+    size_t getNumberOfChunks() const { return _chunks.size(); }
+    size_t getBytesAllocated() const { return _bytes_allocated; }
+    size_t getBytesReserved() const { return _bytes_reserved; } // <- held in chunks
+
+private:
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+    char *newChunk(size_t size) {
+        void *chunk = NULL;
+        if (posix_memalign(&chunk, ALIGNMENT, size) != 0) throw std::bad_alloc();
+        _chunks.push_back(static_cast<char*>(chunk));
+        _bytes_reserved += size;
+        SOAP_PROFILE_COUNT("memory.arena_bytes", size);
+        return static_cast<char*>(chunk);
+    }
+
+    size_t _chunk_size;
+    std::vector<char*> _chunks;
+    char *_head;
+    size_t _left;
+    size_t _n_allocations;
+    size_t _bytes_allocated;
+    size_t _bytes_reserved;
+};
+
+// STL allocator on an Arena, falls back to the heap without one. Copies
+// of a container do not inherit the arena (see
+// select_on_container_copy_construction), moves and swaps carry it along.
+template<typename T>
+struct ArenaAllocator
+{
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    template<typename U> struct rebind { typedef ArenaAllocator<U> other; };
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ArenaAllocator(Arena *arena = NULL) : _arena(arena) { ; }
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : _arena(other._arena) { ; }
+
+    T *allocate(size_t n) {
+        if (_arena) return _arena->allocate<T>(n);
+        return static_cast<T*>(::operator new(n*sizeof(T)));
+    }
+    void deallocate(T *ptr, size_t n) {
+        if (!_arena) ::operator delete(ptr);
+    }
+    ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+    Arena *_arena;
+};
+
+template<typename T, typename U>
+inline bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a._arena == b._arena; }
+template<typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a._arena != b._arena; }
+
+}}
+
+#endif /* _SOAP_ARENA_HPP */
@@ -30,6 +30,12 @@ public:
     explicit APIError(std::string mssg) : std::runtime_error("APIError["+mssg+"]") { ; }
 };
 
+class MemoryBudgetExceeded : public std::runtime_error
+{
+public:
+    explicit MemoryBudgetExceeded(std::string mssg) : std::runtime_error("MemoryBudgetExceeded["+mssg+"]") { ; }
+};
+
 class SanityCheckFailed : public std::runtime_error
 {
 public:
@@ -3,6 +3,8 @@
 
 #include <sstream>
 #include <iostream>
+#include <mutex>
+#include <atomic>
 
 namespace soap {
 
@@ -21,6 +23,13 @@ else (log)(level)
 if (plog == NULL) ; \
 else (*plog)()
 
+/*
+ * Messages above this level are compiled out, see GLOG_AT
+ */
+#ifndef SOAP_LOG_LEVEL_COMPILE
+#define SOAP_LOG_LEVEL_COMPILE soap::logINFO
+#endif
+
 /*
  * Custom buffer to store messages
  */
@@ -60,6 +69,18 @@ public:
             }
         }
 
+        std::string getPreface(TLogLevel level) {
+            if (!_writePreface) return "";
+            switch ( level )
+            {
+                case logERROR: return _errorPreface;
+                case logWARNING: return _warnPreface;
+                case logINFO: return _infoPreface;
+                case logDEBUG: return _dbgPreface;
+            }
+            return "";
+        }
+
         void EnablePreface() { _writePreface = true; }
         void DisablePreface() { _writePreface = false; }
 
@@ -132,6 +153,47 @@ protected:
 };
 
 
+/*
+ * Per-thread buffer: messages are collected until a line is complete and
+ * then written to std::cout under a lock, so that lines from concurrent
+ * threads do not interleave. Partial lines (std::flush) are held back.
+ */
+class ThreadLogBuffer : public std::stringbuf {
+
+public:
+    ThreadLogBuffer() : std::stringbuf() {}
+   ~ThreadLogBuffer() {
+        std::string rest = str();
+        if (rest.size()) this->emit(rest + "\n");
+    }
+
+    void setPreface(const std::string &preface) { _preface = preface; }
+
+    static std::mutex &outputMutex() {
+        static std::mutex output_mutex;
+        return output_mutex;
+    }
+
+protected:
+    virtual int sync() {
+        std::string message = str();
+        size_t end = message.rfind('\n');
+        if (end != std::string::npos) {
+            this->emit(message.substr(0, end+1));
+            str(message.substr(end+1));
+        }
+        return 0;
+    }
+
+    void emit(const std::string &lines) {
+        std::lock_guard<std::mutex> lock(outputMutex());
+        std::cout << _preface << lines << std::flush;
+    }
+
+    std::string _preface;
+};
+
+
 /** \class Logger
 *   \brief Logger is used for thread-safe output of messages
 *
@@ -160,12 +222,15 @@ public:
 	Logger( TLogLevel ReportLevel) : std::ostream(new LogBuffer()) {
             _ReportLevel = ReportLevel;
             _maverick = true;
+            _silent = false;
             _verbose = false;
      }
 
 	 Logger() : std::ostream(new LogBuffer()) {
-		 _ReportLevel = logDEBUG;
+		 _ReportLevel = logINFO;
 		 _maverick = true;
+		 _silent = false;
+		 _verbose = false;
 		 dynamic_cast<LogBuffer *>( rdbuf() )->setMultithreading(_maverick);
 	 }
 
@@ -175,16 +240,30 @@ public:
             rdbuf(NULL);
 	}
 
-	Logger &operator()( TLogLevel LogLevel = logINFO) {
-		//rdbuf()->pubsync();
-		dynamic_cast<LogBuffer *>( rdbuf() )->setLogLevel(LogLevel);
-		return *this;
+	// Stream of the calling thread (see threadStream), or for messages above the
+	// report level a failed one that formats nothing. The shared stream is left
+	// untouched, since GLOG() is also called from worker threads.
+	std::ostream &operator()( TLogLevel LogLevel = logINFO) {
+		if (this->isEnabled(LogLevel)) return this->threadStream(LogLevel);
+		static thread_local std::ostream dropped(NULL); // <- no buffer: badbit
+		return dropped;
 	}
 
         void setReportLevel( TLogLevel ReportLevel ) { _ReportLevel = ReportLevel; }
         void silence() {
             _silent = true;
             dynamic_cast<LogBuffer*>(rdbuf())->silence();
+            // Failed stream: operator<< returns before formatting anything
+            setstate(std::ios::badbit);
+        }
+        bool isEnabled(TLogLevel level) { return !_silent && level <= _ReportLevel; }
+
+        // Stream of the calling thread, see ThreadLogBuffer and GLOG_AT
+        std::ostream &threadStream(TLogLevel level) {
+            static thread_local ThreadLogBuffer buffer;
+            static thread_local std::ostream stream(&buffer);
+            buffer.setPreface(dynamic_cast<LogBuffer *>( rdbuf() )->getPreface(level));
+            return stream;
         }
         void setVerbose(bool verbose) {
             _verbose = verbose;
@@ -197,6 +276,9 @@ public:
         bool isMaverick() { return _maverick; }
 
         TLogLevel getReportLevel( ) { return _ReportLevel; }
+        std::string getPreface(TLogLevel level) {
+            return dynamic_cast<LogBuffer *>( rdbuf() )->getPreface(level);
+        }
 
         void setPreface(TLogLevel level, std::string preface) {
             dynamic_cast<LogBuffer *>( rdbuf() )->setPreface(level, preface);
@@ -212,11 +294,11 @@ public:
 
 private:
     // at what level of detail output messages
-    TLogLevel _ReportLevel;
+    std::atomic<TLogLevel> _ReportLevel;
 
     // if true, only a single processor job is executed
     bool      _maverick;
-    bool      _silent;
+    std::atomic<bool> _silent;
     bool      _verbose;
 
     std::string Messages() {
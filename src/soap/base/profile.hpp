@@ -0,0 +1,94 @@
+#ifndef _SOAP_PROFILE_HPP
+#define	_SOAP_PROFILE_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace soap { namespace base {
+
+// Named timer/counter: calls and nanoseconds are accumulated by ScopedTimer,
+// count by SOAP_PROFILE_COUNT. Updates are relaxed atomics, so entries can
+// be shared between threads; entries are never destroyed.
+struct ProfileEntry
+{
+    explicit ProfileEntry(const std::string &name_) : name(name_), calls(0), nanoseconds(0), count(0) { ; }
+    void addTime(uint64_t ns) {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        nanoseconds.fetch_add(ns, std::memory_order_relaxed);
+    }
+    void add(uint64_t n) { count.fetch_add(n, std::memory_order_relaxed); }
+    void reset() {
+        calls.store(0, std::memory_order_relaxed);
+        nanoseconds.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    const std::string name;
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> nanoseconds;
+    std::atomic<uint64_t> count;
+};
+
+struct profile_record_t
+{
+    std::string name;
+    uint64_t calls;
+    double time; // <- seconds
+    uint64_t count;
+};
+
+// Process-wide registry of ProfileEntry's (see profile.cpp), exposed to
+// Python as soap.profile()
+class Profiler
+{
+public:
+    // Entry of that name, created on first use (thread-safe)
+    static ProfileEntry &entry(const std::string &name);
+    // Snapshot of all entries, sorted by name
+    static std::vector<profile_record_t> report();
+    static void reset();
+    // Whether the library was built with SOAP_PROFILE
+    static bool isEnabled();
+};
+
+class ScopedTimer
+{
+public:
+    typedef std::chrono::steady_clock clock_t;
+    explicit ScopedTimer(ProfileEntry &entry) : _entry(entry), _t0(clock_t::now()) { ; }
+   ~ScopedTimer() {
+        _entry.addTime(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now()-_t0).count());
+    }
+private:
+    ProfileEntry &_entry;
+    clock_t::time_point _t0;
+};
+
+}}
+
+/*
+ * Per-phase timers and counters, compiled in with -DSOAP_PROFILE
+ * (cmake -DSOAP_PROFILE=ON), otherwise removed including their arguments:
+ *   SOAP_PROFILE_SCOPE("spectrum.compute");       // times the enclosing scope
+ *   SOAP_PROFILE_COUNT("spectrum.pairs", n_pairs); // adds n_pairs
+ * The entry is looked up once per call site (function-local static).
+ */
+#define SOAP_PROFILE_CONCAT_(a, b) a##b
+#define SOAP_PROFILE_CONCAT(a, b) SOAP_PROFILE_CONCAT_(a, b)
+
+#ifdef SOAP_PROFILE
+#define SOAP_PROFILE_SCOPE(name) \
+    static soap::base::ProfileEntry &SOAP_PROFILE_CONCAT(_profile_entry_, __LINE__) = soap::base::Profiler::entry(name); \
+    soap::base::ScopedTimer SOAP_PROFILE_CONCAT(_profile_timer_, __LINE__)(SOAP_PROFILE_CONCAT(_profile_entry_, __LINE__))
+#define SOAP_PROFILE_COUNT(name, n) \
+    do { static soap::base::ProfileEntry &_profile_entry = soap::base::Profiler::entry(name); \
+         _profile_entry.add(n); } while (0)
+#else
+#define SOAP_PROFILE_SCOPE(name)
+#define SOAP_PROFILE_COUNT(name, n) do { } while (0)
+#endif
+
+#endif /* _SOAP_PROFILE_HPP */
@@ -1,7 +1,17 @@
 #include <math.h>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <unistd.h>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include "soap/linalg/numpy.hpp"
 #include "soap/basis.hpp"
+#include "soap/base/profile.hpp"
 
 
 namespace soap {
@@ -22,6 +32,10 @@ Basis::Basis(Options *options) :
 	// CONFIGURE CUTOFF FUNCTION
 	_cutoff = CutoffFunctionOutlet().create(_options->get<std::string>("radialcutoff.type"));
 	_cutoff->configure(*options);
+	// RESOLVE OPTIONS (AS ADJUSTED BY THE RADIAL BASIS)
+	_config.resolve(*options);
+	_kernels = nlm_kernels_resolve(_radbasis->N(), _angbasis->L());
+	this->resolvePowerPrefactors();
 }
 
 Basis::~Basis() {
@@ -33,6 +47,13 @@ Basis::~Basis() {
 	_cutoff = NULL;
 }
 
+void Basis::resolvePowerPrefactors() {
+	_power_prefactors.resize(_angbasis->L()+1);
+	for (int l = 0; l <= _angbasis->L(); ++l) {
+		_power_prefactors[l] = (_config.sqrt_2l1_norm) ? 2.*sqrt(2.)*M_PI/sqrt(2.*l+1) : 1.; // Normalization = sqrt(8\pi^2/(2l+1))
+	}
+}
+
 void Basis::registerPython() {
 	using namespace boost::python;
 	class_<Basis, Basis*>("Basis", init<>())
@@ -41,11 +62,222 @@ void Basis::registerPython() {
 		.add_property("L", make_function(&Basis::L, copy_const()));
 }
 
+// ==========
+// BasisCache
+// ==========
+
+namespace {
+
+struct basis_cache_entry_t
+{
+	Options *options; // <- owned, basis options as adjusted by the basis, defaults otherwise
+	Basis *basis;
+	int n_users; // <- acquired through BasisCache::get, not yet released
+};
+
+struct basis_cache_t
+{
+	basis_cache_t() {
+		const char *dir = std::getenv("SOAP_BASIS_CACHE");
+		if (dir) directory = dir;
+	}
+	std::mutex mutex;
+	std::map<std::string, basis_cache_entry_t*> map_key_entry; // <- keys before and after adjustment
+	std::vector<basis_cache_entry_t*> entries;
+	std::string directory;
+};
+
+basis_cache_t &basis_cache() {
+	static basis_cache_t *cache = new basis_cache_t(); // <- bases outlive static destructors
+	return *cache;
+}
+
+bool is_basis_key(const std::string &key) {
+	return key.compare(0, 12, "radialbasis.") == 0
+		|| key.compare(0, 13, "angularbasis.") == 0
+		|| key.compare(0, 13, "radialcutoff.") == 0
+		|| key == "spectrum.2l1_norm";
+}
+
+std::string basis_cache_file(const std::string &directory, const std::string &key) {
+	return (boost::format("%1$s/basis-%2$016x.arch") % directory % std::hash<std::string>()(key)).str();
+}
+
+Basis *basis_cache_load(const std::string &file, const std::string &key) {
+	std::ifstream ifs(file.c_str(), std::ios::binary);
+	if (!ifs) return NULL;
+	try {
+		boost::archive::binary_iarchive arch(ifs);
+		std::string stored_key;
+		arch >> stored_key;
+		if (stored_key != key) return NULL; // <- hash collision
+		Basis *basis = new Basis();
+		arch >> (*basis);
+		return basis;
+	}
+	catch (std::exception &err) {
+		GLOG() << "Ignoring basis cache file '" << file << "': " << err.what() << std::endl;
+	}
+	return NULL;
+}
+
+void basis_cache_save(const std::string &file, const std::string &key, Basis *basis) {
+	// Written under a temporary name and renamed, for concurrent processes
+	std::string tmp = (boost::format("%1$s.%2$d") % file % getpid()).str();
+	{
+		std::ofstream ofs(tmp.c_str(), std::ios::binary);
+		if (!ofs) {
+			GLOG() << "Cannot write basis cache file '" << tmp << "'" << std::endl;
+			return;
+		}
+		boost::archive::binary_oarchive arch(ofs);
+		arch << key;
+		arch << (*basis);
+	}
+	std::rename(tmp.c_str(), file.c_str());
+}
+
+}
+
+std::string BasisCache::key(Options &options) {
+	std::string key;
+	const Options::map_options_t &map = options.getKeyValueMap();
+	for (auto it = map.begin(); it != map.end(); ++it) {
+		if (is_basis_key(it->first)) key += it->first + "=" + it->second + ";";
+	}
+	return key;
+}
+
+Basis *BasisCache::get(Options &options) {
+	basis_cache_t &cache = basis_cache();
+	std::string key = BasisCache::key(options);
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	auto it = cache.map_key_entry.find(key);
+	basis_cache_entry_t *entry = NULL;
+	if (it != cache.map_key_entry.end()) {
+		entry = it->second;
+	}
+	else {
+		entry = new basis_cache_entry_t();
+		entry->basis = NULL;
+		entry->n_users = 0;
+		std::string file = (cache.directory != "") ? basis_cache_file(cache.directory, key) : "";
+		if (file != "") entry->basis = basis_cache_load(file, key);
+		if (entry->basis) {
+			GLOG() << "Loaded basis from '" << file << "'" << std::endl;
+			entry->options = entry->basis->getOptions();
+		}
+		else {
+			// Only the options that define the basis, not those of the first caller's spectrum
+			entry->options = new Options();
+			const Options::map_options_t &map = options.getKeyValueMap();
+			for (auto kt = map.begin(); kt != map.end(); ++kt) {
+				if (is_basis_key(kt->first)) entry->options->set(kt->first, kt->second);
+			}
+			try {
+				entry->basis = new Basis(entry->options);
+			}
+			catch (...) {
+				delete entry->options;
+				delete entry;
+				throw;
+			}
+			if (file != "") basis_cache_save(file, key, entry->basis);
+		}
+		cache.entries.push_back(entry);
+		cache.map_key_entry[key] = entry;
+		cache.map_key_entry[BasisCache::key(*entry->options)] = entry;
+	}
+	// Adjustments made by the basis, as Basis(options) would have made them
+	const Options::map_options_t &map = entry->options->getKeyValueMap();
+	for (auto kt = map.begin(); kt != map.end(); ++kt) {
+		if (is_basis_key(kt->first)) options.set(kt->first, kt->second);
+	}
+	++entry->n_users;
+	return entry->basis;
+}
+
+void BasisCache::release(Basis *basis) {
+	basis_cache_t &cache = basis_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	for (auto it = cache.entries.begin(); it != cache.entries.end(); ++it) {
+		if ((*it)->basis == basis) {
+			assert((*it)->n_users > 0);
+			--(*it)->n_users;
+			return;
+		}
+	}
+	assert(false && "<BasisCache::release> Basis not in cache");
+}
+
+int BasisCache::size() {
+	basis_cache_t &cache = basis_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	return cache.entries.size();
+}
+
+int BasisCache::clear() {
+	basis_cache_t &cache = basis_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	std::vector<basis_cache_entry_t*> in_use;
+	for (auto it = cache.entries.begin(); it != cache.entries.end(); ++it) {
+		if ((*it)->n_users > 0) {
+			in_use.push_back(*it);
+			continue;
+		}
+		for (auto kt = cache.map_key_entry.begin(); kt != cache.map_key_entry.end(); ) {
+			if (kt->second == *it) kt = cache.map_key_entry.erase(kt);
+			else ++kt;
+		}
+		delete (*it)->basis;
+		delete (*it)->options;
+		delete *it;
+	}
+	cache.entries.swap(in_use);
+	return cache.entries.size();
+}
+
+namespace {
+Basis *basis_cache_get_python(Options &options) {
+	// Python holds no release handle, so the basis stays in use (and cached) for good
+	return BasisCache::get(options);
+}
+}
+
+void BasisCache::setDirectory(std::string dir) {
+	basis_cache_t &cache = basis_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.directory = dir;
+}
+
+std::string BasisCache::getDirectory() {
+	basis_cache_t &cache = basis_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	return cache.directory;
+}
+
+void BasisCache::registerPython() {
+	using namespace boost::python;
+	class_<BasisCache>("BasisCache", no_init)
+		.def("get", &basis_cache_get_python, return_value_policy<reference_existing_object>())
+		.staticmethod("get")
+		.def("key", &BasisCache::key)
+		.staticmethod("key")
+		.def("size", &BasisCache::size)
+		.staticmethod("size")
+		.def("clear", &BasisCache::clear)
+		.staticmethod("clear")
+		.def("setDirectory", &BasisCache::setDirectory)
+		.staticmethod("setDirectory")
+		.def("getDirectory", &BasisCache::getDirectory)
+		.staticmethod("getDirectory");
+}
+
 // ==============
 // BasisExpansion
 // ==============
 
-BasisExpansion::BasisExpansion(Basis *basis) :
+BasisExpansion::BasisExpansion(Basis *basis, base::Arena *arena) :
 	_basis(basis),
 	_radbasis(basis->getRadBasis()),
 	_angbasis(basis->getAngBasis()),
@@ -53,6 +285,20 @@ BasisExpansion::BasisExpansion(Basis *basis) :
 	_has_gradients(false) {
     int L = _angbasis->L();
     int N = _radbasis->N();
+    if (arena) {
+        _radcoeff.setArena(arena);
+        _angcoeff.setArena(arena);
+        _coeff.setArena(arena);
+        _radcoeff_grad_x.setArena(arena);
+        _radcoeff_grad_y.setArena(arena);
+        _radcoeff_grad_z.setArena(arena);
+        _angcoeff_grad_x.setArena(arena);
+        _angcoeff_grad_y.setArena(arena);
+        _angcoeff_grad_z.setArena(arena);
+        _coeff_grad_x.setArena(arena);
+        _coeff_grad_y.setArena(arena);
+        _coeff_grad_z.setArena(arena);
+    }
     // ZERO SCALAR-FIELD CONTAINERS
     _has_scalars = true;
     _radcoeff = RadialBasis::radcoeff_zero_t(N,L+1);
@@ -72,17 +318,21 @@ void BasisExpansion::computeCoefficients(double r, vec d) {
     // Corresponds to: weight=weight_scale=1, sigma=0, gradients=false
     _radbasis->computeCoefficients(d, r, 0., _radcoeff, NULL, NULL, NULL);
     _angbasis->computeCoefficients(d, r, 0., _angcoeff, NULL, NULL, NULL);
-    for (int n = 0; n != _radbasis->N(); ++n) {
-        for (int l = 0; l != _angbasis->L()+1; ++l) {
-            for (int m = -l; m != l+1; ++m) {
-                _coeff(n, l*l+l+m) = _radcoeff(n,l)*_angcoeff(l*l+l+m);
-            }
-        }
-    }
+    _basis->getKernels()->merge(_radbasis->N(), _angbasis->L(),
+        &_radcoeff.data()[0], &_angcoeff.data()[0], 1., &_coeff.data()[0]);
     return;
 }
 
 void BasisExpansion::computeCoefficients(double r, vec d, double weight, double weight_scale, double sigma, bool gradients) {
+    vec weight_scale_grad(0.,0.,0.);
+    if (gradients || _has_gradients) {
+        weight_scale_grad = _basis->getCutoff()->calculateGradientWeight(r, d);
+    }
+    this->computeCoefficients(r, d, weight, weight_scale, weight_scale_grad, sigma, gradients);
+}
+
+void BasisExpansion::computeCoefficients(double r, vec d, double weight, double weight_scale, const vec &weight_scale_grad,
+    double sigma, bool gradients) {
     // SETUP STORAGE
     int L = _angbasis->L();
     int N = _radbasis->N();
@@ -107,49 +357,42 @@ void BasisExpansion::computeCoefficients(double r, vec d, double weight, double
     }
     // COMPUTE
     if (_has_scalars && !_has_gradients) {
+        {
+        SOAP_PROFILE_SCOPE("basis.radial");
         _radbasis->computeCoefficients(d, r, sigma, _radcoeff, NULL, NULL, NULL);
+        }
+        SOAP_PROFILE_SCOPE("basis.angular");
         _angbasis->computeCoefficients(d, r, sigma, _angcoeff, NULL, NULL, NULL);
     }
     else if (_has_scalars && _has_gradients) {
         //std::cout << "GRAD" << std::endl;
+        {
+        SOAP_PROFILE_SCOPE("basis.radial_with_gradients");
         _radbasis->computeCoefficients(d, r, sigma, _radcoeff, &_radcoeff_grad_x, &_radcoeff_grad_y, &_radcoeff_grad_z);
+        }
+        SOAP_PROFILE_SCOPE("basis.angular_with_gradients");
         _angbasis->computeCoefficients(d, r, sigma, _angcoeff, &_angcoeff_grad_x, &_angcoeff_grad_y, &_angcoeff_grad_z);
-        _weight_scale_grad = _basis->getCutoff()->calculateGradientWeight(r, d);
+        _weight_scale_grad = weight_scale_grad;
     }
     // MERGE
+    {
+    SOAP_PROFILE_SCOPE("basis.merge");
+    const nlm_kernels_t *kernels = _basis->getKernels();
     if (_has_scalars) {
-        for (int n = 0; n != _radbasis->N(); ++n) {
-            for (int l = 0; l != _angbasis->L()+1; ++l) {
-                for (int m = -l; m != l+1; ++m) {
-                    _coeff(n, l*l+l+m) = _radcoeff(n,l)*_angcoeff(l*l+l+m);
-                }
-            }
-        }
-        _coeff *= weight*weight_scale;
+        kernels->merge(N, L, &_radcoeff.data()[0], &_angcoeff.data()[0],
+            weight*weight_scale, &_coeff.data()[0]);
     }
     if (_has_gradients) {
-        for (int n = 0; n != _radbasis->N(); ++n) {
-            for (int l = 0; l != _angbasis->L()+1; ++l) {
-                for (int m = -l; m != l+1; ++m) {
-                    int lm = l*l+l+m;
-                    _coeff_grad_x(n, lm) = weight*(
-                          weight_scale*_radcoeff(n,l)*_angcoeff_grad_x(lm)
-                        + weight_scale*_radcoeff_grad_x(n,l)*_angcoeff(lm)
-                        + _weight_scale_grad.getX()*_radcoeff(n,l)*_angcoeff(lm)
-                    );
-                    _coeff_grad_y(n, lm) = weight*(
-                          weight_scale*_radcoeff(n,l)*_angcoeff_grad_y(lm)
-                        + weight_scale*_radcoeff_grad_y(n,l)*_angcoeff(lm)
-                        + _weight_scale_grad.getY()*_radcoeff(n,l)*_angcoeff(lm)
-                    );
-                    _coeff_grad_z(n, lm) = weight*(
-                          weight_scale*_radcoeff(n,l)*_angcoeff_grad_z(lm)
-                        + weight_scale*_radcoeff_grad_z(n,l)*_angcoeff(lm)
-                        + _weight_scale_grad.getZ()*_radcoeff(n,l)*_angcoeff(lm)
-                    );
-                } // m
-            } // l
-        } // n
+        kernels->merge_grad(N, L, &_radcoeff.data()[0], &_radcoeff_grad_x.data()[0],
+            &_angcoeff.data()[0], &_angcoeff_grad_x.data()[0],
+            weight, weight_scale, _weight_scale_grad.getX(), &_coeff_grad_x.data()[0]);
+        kernels->merge_grad(N, L, &_radcoeff.data()[0], &_radcoeff_grad_y.data()[0],
+            &_angcoeff.data()[0], &_angcoeff_grad_y.data()[0],
+            weight, weight_scale, _weight_scale_grad.getY(), &_coeff_grad_y.data()[0]);
+        kernels->merge_grad(N, L, &_radcoeff.data()[0], &_radcoeff_grad_z.data()[0],
+            &_angcoeff.data()[0], &_angcoeff_grad_z.data()[0],
+            weight, weight_scale, _weight_scale_grad.getZ(), &_coeff_grad_z.data()[0]);
+    }
     }
 
     // CLEAR INTERMEDIATE STORAGE (NOT REQUIRED LATER)
@@ -167,9 +410,9 @@ void BasisExpansion::computeCoefficients(double r, vec d, double weight, double
 
 void BasisExpansion::addGradient(BasisExpansion &other) {
     assert(_has_gradients);
-    _coeff_grad_x = _coeff_grad_x + other.getCoefficientsGradX();
-    _coeff_grad_y = _coeff_grad_y + other.getCoefficientsGradY();
-    _coeff_grad_z = _coeff_grad_z + other.getCoefficientsGradZ();
+    _coeff_grad_x += other.getCoefficientsGradX();
+    _coeff_grad_y += other.getCoefficientsGradY();
+    _coeff_grad_z += other.getCoefficientsGradZ();
     return;
 }
 
@@ -183,14 +426,43 @@ void BasisExpansion::zeroGradient() {
     return;
 }
 
+void BasisExpansion::assignInverted(BasisExpansion &other, double scale) {
+    int L = _angbasis->L();
+    int N = _radbasis->N();
+    _has_scalars = other._has_scalars;
+    _has_gradients = other._has_gradients;
+    _coeff = other._coeff;
+    if (_has_gradients) {
+        _weight_scale_grad = -other._weight_scale_grad;
+        _coeff_grad_x = other._coeff_grad_x;
+        _coeff_grad_y = other._coeff_grad_y;
+        _coeff_grad_z = other._coeff_grad_z;
+    }
+    for (int n = 0; n < N; ++n) {
+        for (int l = 0; l <= L; ++l) {
+            double s = (l % 2 == 0) ? scale : -scale;
+            linalg::scale(2*l+1, s, &_coeff(n, l*l));
+            if (_has_gradients) {
+                linalg::scale(2*l+1, -s, &_coeff_grad_x(n, l*l));
+                linalg::scale(2*l+1, -s, &_coeff_grad_y(n, l*l));
+                linalg::scale(2*l+1, -s, &_coeff_grad_z(n, l*l));
+            }
+        }
+    }
+    return;
+}
+
 void BasisExpansion::conjugate() {
-	for (int n = 0; n != _radbasis->N(); ++n) {
-		for (int l = 0; l != _angbasis->L()+1; ++l) {
-			for (int m = -l; m != l+1; ++m) {
-				_coeff(n, l*l+l+m) = std::conj(_coeff(n, l*l+l+m));
-			}
-		}
-	}
+	_coeff.conjugate();
+}
+
+size_t BasisExpansion::getMemoryUsage() {
+    size_t n_real = _radcoeff.data().size()
+        + _radcoeff_grad_x.data().size() + _radcoeff_grad_y.data().size() + _radcoeff_grad_z.data().size();
+    size_t n_cmplx = _angcoeff.data().size() + _coeff.data().size()
+        + _angcoeff_grad_x.data().size() + _angcoeff_grad_y.data().size() + _angcoeff_grad_z.data().size()
+        + _coeff_grad_x.data().size() + _coeff_grad_y.data().size() + _coeff_grad_z.data().size();
+    return n_real*sizeof(double) + n_cmplx*sizeof(std::complex<double>);
 }
 
 void BasisExpansion::writeDensity(
@@ -268,11 +540,16 @@ void BasisExpansion::writeDensityOnGrid(
 	ofs << boost::format("%1$d +0.0000 %2$+1.4f +0.0000") % Ny % (dy*conv) << std::endl;
 	ofs << boost::format("%1$d +0.0000 +0.0000 %2$+1.4f") % Nz % (dz*conv) << std::endl;
 
+	// Connections center -> particles do not depend on the voxel, computed once
+	int n_parts = structure->getNumberOfParticles();
+	std::vector<vec> dr_parts(n_parts);
+	structure->connectMany(center->getPos(), structure->getPositions(), n_parts, dr_parts.data(), NULL);
+
 	Structure::particle_it_t pit;
 	for (pit = structure->beginParticles(); pit != structure->endParticles(); ++pit) {
-		 vec dr = structure->connect(center->getPos(), (*pit)->getPos());
+		 const vec &dr = dr_parts[pit-structure->beginParticles()];
 		 ofs << boost::format("%1$d 0.0 %2$+1.4f %3$+1.4f %4$+1.4f\n")
-			 % (*pit)->getTypeId() % (dr.x()*conv) % (dr.y()*conv) % (dr.z()*conv);
+			 % (*pit)->getTypeId() % (dr.getX()*conv) % (dr.getY()*conv) % (dr.getZ()*conv);
 	}
 
 	GLOG() << "'" << filename << "': " << "Fill grid " << std::flush;
@@ -295,27 +572,16 @@ void BasisExpansion::writeDensityOnGrid(
 					BasisExpansion density_exp_dr(_basis);
 					//density_exp_dr.computeCoefficients(r, d, 1., 1., 0., false);
 					density_exp_dr.computeCoefficients(r, d);
-					density_exp_dr.conjugate();
-
-					BasisExpansion::coeff_t &c_nlm_dr = density_exp_dr.getCoefficients();
-					BasisExpansion::coeff_t &c_nlm = this->getCoefficients();
-					// Something like this would be desirable to replace n-l-m loop below:
-					//double density_dr = ub::inner_prod(c_nlm, c_nlm_dr);
-					for (int n = 0; n < _radbasis->N(); ++n) {
-						for (int l = 0; l <= _angbasis->L(); ++l) {
-							for (int m = -l; m <= l; ++m) {
-								double voxel_density_dr = (c_nlm(n, l*l+l+m)*c_nlm_dr(n, l*l+l+m)).real();
-								density_dr += voxel_density_dr;
-								int_density_dr += voxel_density_dr*dx*dy*dz;
-							}
-						}
-					}
+
+					// Re sum_nlm c_nlm*conj(c_nlm(dr))
+					density_dr = linalg::conj_dot(this->getCoefficients(), density_exp_dr.getCoefficients()).real();
+					int_density_dr += density_dr*dx*dy*dz;
 				}
 
 				// DENSITY BASED ON SMEARED PARTICLES
 				else {
 					for (pit = structure->beginParticles(); pit != structure->endParticles(); ++pit) {
-						 vec dr_center_particle = structure->connect(center->getPos(), (*pit)->getPos());
+						 const vec &dr_center_particle = dr_parts[pit-structure->beginParticles()];
 						 vec dr_particle_target = dr - dr_center_particle;
 						 double r_particle_target = soap::linalg::abs(dr_particle_target);
 						 double sigma = (*pit)->getSigma();
@@ -2,9 +2,33 @@
 #include "bindings.hpp"
 #include "coulomb.hpp"
 #include "fieldtensor.hpp"
+#include "soap/base/profile.hpp"
 
 namespace soap {
 
+// soap.profile(reset=False): {"enabled": .., "timers": {name: {"calls": .., "time": ..}},
+// "counters": {name: ..}} accumulated since the last reset, see base/profile.hpp
+boost::python::dict PROFILE(bool reset) {
+    boost::python::dict timers;
+    boost::python::dict counters;
+    std::vector<base::profile_record_t> records = base::Profiler::report();
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        if (it->calls > 0) {
+            boost::python::dict timer;
+            timer["calls"] = it->calls;
+            timer["time"] = it->time;
+            timers[it->name] = timer;
+        }
+        if (it->count > 0) counters[it->name] = it->count;
+    }
+    boost::python::dict profile;
+    profile["enabled"] = base::Profiler::isEnabled();
+    profile["timers"] = timers;
+    profile["counters"] = counters;
+    if (reset) base::Profiler::reset();
+    return profile;
+}
+
 }
 
 BOOST_PYTHON_MODULE(_soapxx)
@@ -22,10 +46,15 @@ BOOST_PYTHON_MODULE(_soapxx)
 
     soap::Spectrum::registerPython();
     soap::Basis::registerPython();
+    soap::BasisCache::registerPython();
     soap::AtomicSpectrum::registerPython();
     soap::BasisExpansion::registerPython();
     soap::PowerExpansion::registerPython();
     soap::Mol2D::registerPython();
+    soap::KernelDotQnlm::registerPython();
+    soap::SpectrumArchiveWriter::registerPython();
+    soap::SpectrumArchive::registerPython();
+    soap::XyzReader::registerPython();
 
     soap::EnergySpectrum::registerPython();
     soap::HierarchicalCoulomb::registerPython();
@@ -40,4 +69,7 @@ BOOST_PYTHON_MODULE(_soapxx)
 
     boost::python::def("silence", &soap::GLOG_SILENCE);
     boost::python::def("verbose", &soap::GLOG_VERBOSE);
+    boost::python::def("setLogLevel", &soap::GLOG_SET_LEVEL);
+    boost::python::def("profile", &soap::PROFILE, (boost::python::arg("reset")=false));
+    boost::python::def("resetProfile", &soap::base::Profiler::reset);
 }
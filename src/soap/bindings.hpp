@@ -6,6 +6,9 @@
 #include "soap/spectrum.hpp"
 #include "soap/contraction.hpp"
 #include "soap/mol2d.hpp"
+#include "soap/kernel.hpp"
+#include "soap/archive.hpp"
+#include "soap/xyz.hpp"
 
 namespace soap {
 
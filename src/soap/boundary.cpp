@@ -8,6 +8,191 @@
 namespace soap {
 
 
+// MINIMUM-IMAGE KERNELS
+// Operate on a single displacement (x,y,z) and are shared by the scalar and
+// the batched connect, which hence agree to the last bit. The batched loops
+// run over contiguous xyz triplets without branches, such that the compiler
+// can vectorize them (with, e.g., -O3 -march=native).
+
+static_assert(sizeof(vec) == 3*sizeof(double), "vec must be three contiguous doubles");
+
+static inline void minimum_image_ortho(const double *box, const double *inv,
+    double &x, double &y, double &z) {
+    // box = (a_x, b_y, c_z), inv = 1/box
+    x -= box[0]*std::nearbyint(x*inv[0]);
+    y -= box[1]*std::nearbyint(y*inv[1]);
+    z -= box[2]*std::nearbyint(z*inv[2]);
+}
+
+static inline void minimum_image_triclinic(const double *box, const double *inv,
+    double &x, double &y, double &z) {
+    // box = (a, b, c), inv = (u, v, w) with u*a = v*b = w*c = 1.
+    // Shift into the first quadrant spanned by a, b, c ...
+    double f;
+    f = std::floor(inv[0]*x + inv[1]*y + inv[2]*z);
+    x -= f*box[0]; y -= f*box[1]; z -= f*box[2];
+    f = std::floor(inv[3]*x + inv[4]*y + inv[5]*z);
+    x -= f*box[3]; y -= f*box[4]; z -= f*box[5];
+    f = std::floor(inv[6]*x + inv[7]*y + inv[8]*z);
+    x -= f*box[6]; y -= f*box[7]; z -= f*box[8];
+    // ... then pick the shortest of the 8 corner images
+    double x_min = x; double y_min = y; double z_min = z;
+    double d2_min = x*x + y*y + z*z;
+    for (int ijk = 1; ijk < 8; ++ijk) {
+        double i = (ijk >> 2) & 1;
+        double j = (ijk >> 1) & 1;
+        double k = ijk & 1;
+        double x_ijk = x - i*box[0] - j*box[3] - k*box[6];
+        double y_ijk = y - i*box[1] - j*box[4] - k*box[7];
+        double z_ijk = z - i*box[2] - j*box[5] - k*box[8];
+        double d2_ijk = x_ijk*x_ijk + y_ijk*y_ijk + z_ijk*z_ijk;
+        bool shorter = (d2_ijk < d2_min);
+        x_min = shorter ? x_ijk : x_min;
+        y_min = shorter ? y_ijk : y_min;
+        z_min = shorter ? z_ijk : z_min;
+        d2_min = shorter ? d2_ijk : d2_min;
+    }
+    x = x_min; y = y_min; z = z_min;
+}
+
+struct minimum_image_open
+{
+    inline void operator()(double &x, double &y, double &z) const { ; }
+};
+
+struct minimum_image_ortho_t
+{
+    double box[3];
+    double inv[3];
+    inline void operator()(double &x, double &y, double &z) const {
+        minimum_image_ortho(box, inv, x, y, z);
+    }
+};
+
+struct minimum_image_triclinic_t
+{
+    double box[9];
+    double inv[9];
+    inline void operator()(double &x, double &y, double &z) const {
+        minimum_image_triclinic(box, inv, x, y, z);
+    }
+};
+
+template<class Kernel>
+static void connect_many(const Kernel &kernel, const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) {
+    const double xi = r_i.getX();
+    const double yi = r_i.getY();
+    const double zi = r_i.getZ();
+    const double *rj = reinterpret_cast<const double*>(r_j);
+    double *out = reinterpret_cast<double*>(dr);
+    for (int k = 0; k < n; ++k) {
+        double x = rj[3*k+0] - xi;
+        double y = rj[3*k+1] - yi;
+        double z = rj[3*k+2] - zi;
+        kernel(x, y, z);
+        out[3*k+0] = x;
+        out[3*k+1] = y;
+        out[3*k+2] = z;
+    }
+    if (d2) {
+        for (int k = 0; k < n; ++k) {
+            d2[k] = out[3*k+0]*out[3*k+0] + out[3*k+1]*out[3*k+1] + out[3*k+2]*out[3*k+2];
+        }
+    }
+}
+
+template<class Kernel>
+static void connect_pairs(const Kernel &kernel, const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) {
+    const double *ri = reinterpret_cast<const double*>(r_i);
+    const double *rj = reinterpret_cast<const double*>(r_j);
+    double *out = reinterpret_cast<double*>(dr);
+    for (int k = 0; k < n; ++k) {
+        double x = rj[3*k+0] - ri[3*k+0];
+        double y = rj[3*k+1] - ri[3*k+1];
+        double z = rj[3*k+2] - ri[3*k+2];
+        kernel(x, y, z);
+        out[3*k+0] = x;
+        out[3*k+1] = y;
+        out[3*k+2] = z;
+    }
+    if (d2) {
+        for (int k = 0; k < n; ++k) {
+            d2[k] = out[3*k+0]*out[3*k+0] + out[3*k+1]*out[3*k+1] + out[3*k+2]*out[3*k+2];
+        }
+    }
+}
+
+static minimum_image_ortho_t ortho_kernel(const matrix &box) {
+    minimum_image_ortho_t kernel;
+    for (int d = 0; d < 3; ++d) {
+        kernel.box[d] = box.get(d,d);
+        kernel.inv[d] = 1./box.get(d,d);
+    }
+    return kernel;
+}
+
+static minimum_image_triclinic_t triclinic_kernel(const matrix &box, const matrix &inv_box) {
+    // Columns of the box (= a, b, c) and inverse box (= u, v, w), flattened
+    minimum_image_triclinic_t kernel;
+    for (int col = 0; col < 3; ++col) {
+        for (int d = 0; d < 3; ++d) {
+            kernel.box[3*col+d] = box.get(d,col);
+            kernel.inv[3*col+d] = inv_box.get(d,col);
+        }
+    }
+    return kernel;
+}
+
+// BOUNDARY
+
+void Boundary::connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const {
+    for (int k = 0; k < n; ++k) {
+        dr[k] = this->connect(r_i, r_j[k]);
+        if (d2) d2[k] = dr[k]*dr[k];
+    }
+}
+
+void Boundary::connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const {
+    for (int k = 0; k < n; ++k) {
+        dr[k] = this->connect(r_i[k], r_j[k]);
+        if (d2) d2[k] = dr[k]*dr[k];
+    }
+}
+
+void BoundaryOpen::connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const {
+    connect_many(minimum_image_open(), r_i, r_j, n, dr, d2);
+}
+
+void BoundaryOpen::connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const {
+    connect_pairs(minimum_image_open(), r_i, r_j, n, dr, d2);
+}
+
+soap::vec BoundaryOrthorhombic::connect(const vec &r_i, const vec &r_j) const {
+    minimum_image_ortho_t kernel = ortho_kernel(_box);
+    vec r_ij = r_j - r_i;
+    kernel(r_ij.x(), r_ij.y(), r_ij.z());
+    return r_ij;
+}
+
+void BoundaryOrthorhombic::connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const {
+    connect_many(ortho_kernel(_box), r_i, r_j, n, dr, d2);
+}
+
+void BoundaryOrthorhombic::connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const {
+    connect_pairs(ortho_kernel(_box), r_i, r_j, n, dr, d2);
+}
+
+void BoundaryTriclinic::setupInverseBox() {
+    vec a = _box.getCol(0);
+    vec b = _box.getCol(1);
+    vec c = _box.getCol(2);
+    double V = this->BoxVolume();
+    vec a_inv = b ^ c / V;
+    vec b_inv = c ^ a / V;
+    vec c_inv = a ^ b / V;
+    _inv_box = matrix(a_inv, b_inv, c_inv);
+}
+
 soap::vec BoundaryTriclinic::connect(const vec &r_i, const vec &r_j) const {
     /*
     // This only works if a = (*,0,0), b = (*,*,0), c = (*,*,*) => e.g., GROMACS
@@ -19,43 +204,18 @@ soap::vec BoundaryTriclinic::connect(const vec &r_i, const vec &r_j) const {
     r_ij = r_sp - a*round(r_sp.getX()/a.getX());
     return r_ij;
     */
-
-    vec a = _box.getCol(0);
-    vec b = _box.getCol(1);
-    vec c = _box.getCol(2);
-    //GLOG() << "Box vectors: " << a << " " << b << " " << c << std::endl;
-
-    vec u = _inv_box.getCol(0);
-    vec v = _inv_box.getCol(1);
-    vec w = _inv_box.getCol(2);
-    //GLOG() << "Inverse box vectors: " << u << " " << v << " " << w << std::endl;
-
+    minimum_image_triclinic_t kernel = triclinic_kernel(_box, _inv_box);
     vec dr = r_j - r_i;
-    //GLOG() << "dr " << dr << std::endl;
-    //GLOG() << "u " << std::floor(u*dr) << std::endl;
-    dr = dr - std::floor(u*dr)*a;
-    //GLOG() << "v " << std::floor(v*dr) << std::endl;
-    dr = dr - std::floor(v*dr)*b;
-    //GLOG() << "w " << std::floor(w*dr) << std::endl;
-    dr = dr - std::floor(w*dr)*c;
-    //GLOG() << "in first quadrant " << dr << std::endl;
-
-    vec dr_min = dr;
-    double d_min = soap::linalg::abs(dr);
-
-    for (int i=0; i < 2; ++i) {
-    for (int j=0; j < 2; ++j) {
-    for (int k=0; k < 2; ++k) {
-        vec dr_ijk = dr - i*a - j*b - k*c;
-        double d_ijk = soap::linalg::abs(dr_ijk);
-        //GLOG() << "ijk " << i << " " << j << " " << k << " " << dr << " " << d_ijk << " " << dr_ijk << std::endl;
-        if (d_ijk < d_min) {
-            d_min = d_ijk;
-            dr_min = dr_ijk;
-        }
-    }}}
+    kernel(dr.x(), dr.y(), dr.z());
+    return dr;
+}
+
+void BoundaryTriclinic::connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const {
+    connect_many(triclinic_kernel(_box, _inv_box), r_i, r_j, n, dr, d2);
+}
 
-    return dr_min;
+void BoundaryTriclinic::connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const {
+    connect_pairs(triclinic_kernel(_box, _inv_box), r_i, r_j, n, dr, d2);
 }
 
 std::vector<int> BoundaryTriclinic::calculateRepetitions(double cutoff) {
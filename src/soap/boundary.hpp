@@ -41,9 +41,13 @@ public:
 		return (a^b)*c;
     }
     virtual vec connect(const vec &r_i, const vec &r_j) const {
-        std::cout << "connect default" << std::endl;
     	return r_j - r_i;
     }
+    // Batched connect, one-to-many: dr[k] = connect(r_i, r_j[k]), d2[k] = |dr[k]|^2
+    // for k < n (d2 may be NULL). Overridden with vectorizable kernels below.
+    virtual void connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+    // Batched connect, pairwise: dr[k] = connect(r_i[k], r_j[k])
+    virtual void connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const;
 
     virtual std::vector<int> calculateRepetitions(double cutoff) {
         std::vector<int> na_nb_nc = { 0, 0, 0 };
@@ -78,6 +82,8 @@ public:
     vec connect(const vec &r_i, const vec &r_j) const {
     	return r_j - r_i;
     }
+    void connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+    void connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const;
     template<class Archive>
 	void serialize(Archive &arch, const unsigned int version) {
 		arch & boost::serialization::base_object<Boundary>(*this);
@@ -95,16 +101,9 @@ public:
 		_type = Boundary::typeOrthorhombic;
 		_box.UnitMatrix();
 	}
-	vec connect(const vec &r_i, const vec &r_j) const {
-	    std::cout << "Connect ortho" << std::endl;
-		vec r_ij;
-		double a = _box.get(0,0); double b = _box.get(1,1); double c = _box.get(2,2);
-		r_ij = r_j - r_i;
-		r_ij.setZ( r_ij.getZ() - c*round(r_ij.getZ()/c) );
-		r_ij.setY( r_ij.getY() - b*round(r_ij.getY()/b) );
-		r_ij.setX( r_ij.getX() - a*round(r_ij.getX()/a) );
-		return r_ij;
-	}
+	vec connect(const vec &r_i, const vec &r_j) const;
+	void connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+	void connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const;
 
 	virtual std::vector<int> calculateRepetitions(double cutoff);
 
@@ -120,30 +119,26 @@ public:
 	BoundaryTriclinic(const matrix &box) {
 		_type = Boundary::typeTriclinic;
 		_box = box;
-
-        // Set-up inverse box
-	    vec a = _box.getCol(0); 
-        vec b = _box.getCol(1); 
-        vec c = _box.getCol(2);
-        double V = this->BoxVolume();
-        vec a_inv = b ^ c / V;
-        vec b_inv = c ^ a / V;
-        vec c_inv = a ^ b / V;
-        _inv_box = matrix(a_inv, b_inv, c_inv);
+		this->setupInverseBox();
 	}
 	BoundaryTriclinic() {
 		_type = Boundary::typeTriclinic;
 		_box.UnitMatrix();
 	}
 	virtual vec connect(const vec &r_i, const vec &r_j) const;
+	void connectMany(const vec &r_i, const vec *r_j, int n, vec *dr, double *d2) const;
+	void connectPairs(const vec *r_i, const vec *r_j, int n, vec *dr, double *d2) const;
 
 	virtual std::vector<int> calculateRepetitions(double cutoff);
 
 	template<class Archive>
 	void serialize(Archive &arch, const unsigned int version) {
 		arch & boost::serialization::base_object<Boundary>(*this);
+		// The inverse box is not archived
+		if (Archive::is_loading::value) this->setupInverseBox();
 	}
 private:
+    void setupInverseBox();
     matrix _inv_box;
 };
 
@@ -1,4 +1,5 @@
 #include "soap/contraction.hpp"
+#include "soap/base/profile.hpp"
 
 namespace soap {
 
@@ -46,6 +47,7 @@ PowerExpansion *EnergySpectrum::getPowerGlobal(std::string s1, std::string s2) {
 }
 
 void EnergySpectrum::compute() {
+    SOAP_PROFILE_SCOPE("energyspectrum.compute");
     GLOG() << "Computing energy spectrum ..." << std::endl;
     // TODO Add images
     double R0 = _options->get<double>("energyspectrum.r0");
@@ -61,23 +63,33 @@ void EnergySpectrum::compute() {
     }
     this->_global_map_powspec = new AtomicSpectrum::map_xnkl_t;
 
+    // Expansion sites (centers may have been excluded, hence gathered)
+    int n_sites = _spectrum->endAtomic()-_spectrum->beginAtomic();
+    std::vector<vec> r_sites(n_sites);
+    for (Spectrum::atomic_it_t it = _spectrum->beginAtomic(); it != _spectrum->endAtomic(); ++it) {
+        r_sites[it-_spectrum->beginAtomic()] = (*it)->getCenterPos();
+    }
+    std::vector<vec> dr_sites(n_sites);
+    std::vector<double> d2_sites(n_sites);
+
     // Loop over pairs of expansion sites ...
     int pair_count = 0;
     double total_weight = 0.;
     for (Spectrum::atomic_it_t it = _spectrum->beginAtomic(); it != _spectrum->endAtomic(); ++it) {
         AtomicSpectrum *aspec = *it;
         AtomicSpectrum::map_qnlm_t map_qnlm_a = aspec->getQnlmMap();
+        _spectrum->getStructure()->connectMany(aspec->getCenterPos(), r_sites.data(), n_sites,
+            dr_sites.data(), d2_sites.data());
         for (Spectrum::atomic_it_t jt = _spectrum->beginAtomic(); jt != _spectrum->endAtomic(); ++jt) {
             AtomicSpectrum *bspec = *jt;
-            AtomicSpectrum::map_qnlm_t map_qnlm_b = bspec->getQnlmMap();
 
             // Distance
-            vec dr_ab = _spectrum->getStructure()->connect(aspec->getCenterPos(), bspec->getCenterPos());
-            double R_ab = soap::linalg::abs(dr_ab) + R0;
+            double R_ab = std::sqrt(d2_sites[jt-_spectrum->beginAtomic()]) + R0;
             // Cut-off check
             if (! _cutoff->isWithinCutoff(R_ab-R0)) continue;
+            AtomicSpectrum::map_qnlm_t map_qnlm_b = bspec->getQnlmMap();
             double weight_scale = _cutoff->calculateWeight(R_ab-R0);
-            GLOG() << aspec->getCenterId() << ":" << bspec->getCenterId() << " R=" << R_ab << " w=" << weight_scale << std::endl;
+            GLOG_DEBUG() << aspec->getCenterId() << ":" << bspec->getCenterId() << " R=" << R_ab << " w=" << weight_scale << std::endl;
             pair_count += 1;
             total_weight += weight_scale;
 
@@ -92,22 +104,22 @@ void EnergySpectrum::compute() {
                     scale *= weight_scale;
                     // Create new pair spectrum or add to existing
                     AtomicSpectrum::type_pair_t types(it1->first, it2->first);
-                    GLOG() << " " << types.first << ":" << types.second << std::flush;
+                    GLOG_DEBUG() << " " << types.first << ":" << types.second << std::flush;
                     auto it = _global_map_powspec->find(types);
                     if (it == _global_map_powspec->end()) {
-                        GLOG() << "*" << std::flush;
+                        GLOG_DEBUG() << "*" << std::flush;
                         (*_global_map_powspec)[types] = new PowerExpansion(_spectrum->getBasis());
                         (*_global_map_powspec)[types]->computeCoefficientsHermConj(it1->second, it2->second, scale);
                     }
                     else {
-                        GLOG() << "+" << std::flush;
+                        GLOG_DEBUG() << "+" << std::flush;
                         PowerExpansion powex(_spectrum->getBasis());
                         powex.computeCoefficientsHermConj(it1->second, it2->second, scale);
                         (*_global_map_powspec)[types]->add(&powex);
                     }
                 }
             }
-            GLOG() << std::endl;
+            GLOG_DEBUG() << std::endl;
         }
     }
     return;
@@ -1,5 +1,6 @@
 #include "soap/coulomb.hpp"
 #include "soap/linalg/numpy.hpp"
+#include "soap/base/profile.hpp"
 
 namespace soap {
 
@@ -102,6 +103,7 @@ HierarchicalCoulomb::~HierarchicalCoulomb() {
 }
 
 void HierarchicalCoulomb::compute() {
+    SOAP_PROFILE_SCOPE("coulomb.compute");
     GLOG() << "Computing HierarchicalCoulomb ..." << std::endl;
 
     // CLEAN EXISTING
@@ -115,6 +117,29 @@ void HierarchicalCoulomb::compute() {
         _atomic_array.push_back(new_atomic);
     }
 
+    // PAIRS WITHIN THE CUTOFF, ONE BATCH PER CENTER (atomic spectra in particle order),
+    // shared by all orders: neighbours nb_idx[nb_ptr[a]:nb_ptr[a+1]] with distance & weight
+    int n_parts = _atomic_array.size();
+    vec *positions = _structure->getPositions();
+    std::vector<vec> dr_row(n_parts);
+    std::vector<double> d2_row(n_parts);
+    std::vector<int> nb_ptr(1, 0);
+    std::vector<int> nb_idx;
+    std::vector<double> nb_R;
+    std::vector<double> nb_w;
+    nb_ptr.reserve(n_parts+1);
+    for (int ia = 0; ia < n_parts; ++ia) {
+        _structure->connectMany(positions[ia], positions, n_parts, dr_row.data(), d2_row.data());
+        for (int ib = 0; ib < n_parts; ++ib) {
+            double R_ab = std::sqrt(d2_row[ib]);
+            if (! _cutoff->isWithinCutoff(R_ab)) continue;
+            nb_idx.push_back(ib);
+            nb_R.push_back(R_ab);
+            nb_w.push_back(_cutoff->calculateWeight(R_ab));
+        }
+        nb_ptr.push_back(nb_idx.size());
+    }
+
     double R0 = _options->get<double>("hierarchicalcoulomb.r0");
     double gamma = _options->get<double>("hierarchicalcoulomb.gamma");
     bool norm = _options->get<bool>("hierarchicalcoulomb.norm");
@@ -125,32 +150,27 @@ void HierarchicalCoulomb::compute() {
         atomic_t *a = *it;
         int sa = a->getTypeIdx();
         double wa = a->getCenter()->getWeight();
-        GLOG() << "    " << a->getCenter()->getId() << std::endl;
+        GLOG_DEBUG() << "    " << a->getCenter()->getId() << std::endl;
         a->_Q0(sa, 0) = wa/pow(R0, gamma);
     }
     if (norm) {
         for (auto it = beginAtomic(); it != endAtomic(); ++it) {
             atomic_t *a = *it;
-            a->_Q0 = a->_Q0/ub::norm_frobenius(a->_Q0);
+            a->_Q0 /= double(ub::norm_frobenius(a->_Q0));
         }
     }
 
     // FIRST-ORDER
     GLOG() << "k = 2-body ..." << std::endl;
-    for (auto it1 = beginAtomic(); it1 != endAtomic(); ++it1) {
-        atomic_t *a = *it1;
+    for (int ia = 0; ia < n_parts; ++ia) {
+        atomic_t *a = _atomic_array[ia];
         int sa = a->getTypeIdx();
-        vec ra = a->getCenter()->getPos();
-        for (auto it2 = beginAtomic(); it2 != endAtomic(); ++it2) {
-            atomic_t *b = *it2;
+        for (int k = nb_ptr[ia]; k < nb_ptr[ia+1]; ++k) {
+            atomic_t *b = _atomic_array[nb_idx[k]];
             int sb = b->getTypeIdx();
-            vec rb = b->getCenter()->getPos();
-            // Apply weight function
-            vec dr_ab = _structure->connect(ra, rb);
-            double R_ab = soap::linalg::abs(dr_ab);
-            if (! _cutoff->isWithinCutoff(R_ab)) continue;
-            double w_ab = _cutoff->calculateWeight(R_ab);
-            GLOG() << "    " << a->getCenter()->getId() << ":" << b->getCenter()->getId() << " R=" << R_ab << " w=" << w_ab << std::endl;
+            double R_ab = nb_R[k];
+            double w_ab = nb_w[k];
+            GLOG_DEBUG() << "    " << a->getCenter()->getId() << ":" << b->getCenter()->getId() << " R=" << R_ab << " w=" << w_ab << std::endl;
             // Interact
             double inter_ab = w_ab/pow(R_ab+R0, gamma);
             a->_Q1(sa, sb) += (
@@ -161,25 +181,20 @@ void HierarchicalCoulomb::compute() {
     if (norm) {
         for (auto it = beginAtomic(); it != endAtomic(); ++it) {
             atomic_t *a = *it;
-            a->_Q1 = a->_Q1/ub::norm_frobenius(a->_Q1);
+            a->_Q1 /= double(ub::norm_frobenius(a->_Q1));
         }
     }
     // SECOND-ORDER
     GLOG() << "k = 3-body ..." << std::endl;
-    for (auto it1 = beginAtomic(); it1 != endAtomic(); ++it1) {
-        atomic_t *a = *it1;
+    for (int ia = 0; ia < n_parts; ++ia) {
+        atomic_t *a = _atomic_array[ia];
         int sa = a->getTypeIdx();
-        vec ra = a->getCenter()->getPos();
-        for (auto it2 = beginAtomic(); it2 != endAtomic(); ++it2) {
-            atomic_t *b = *it2;
+        for (int k = nb_ptr[ia]; k < nb_ptr[ia+1]; ++k) {
+            atomic_t *b = _atomic_array[nb_idx[k]];
             int sb = b->getTypeIdx();
-            vec rb = b->getCenter()->getPos();
-            // Apply weight function
-            vec dr_ab = _structure->connect(ra, rb);
-            double R_ab = soap::linalg::abs(dr_ab);
-            if (! _cutoff->isWithinCutoff(R_ab)) continue;
-            double w_ab = _cutoff->calculateWeight(R_ab);
-            GLOG() << "    " << a->getCenter()->getId() << ":" << b->getCenter()->getId() << " R=" << R_ab << " w=" << w_ab << std::endl;
+            double R_ab = nb_R[k];
+            double w_ab = nb_w[k];
+            GLOG_DEBUG() << "    " << a->getCenter()->getId() << ":" << b->getCenter()->getId() << " R=" << R_ab << " w=" << w_ab << std::endl;
             // Interact
             double inter_ab = w_ab/pow(R_ab+R0, gamma);
             for (int sb = 0; sb < _S; ++sb) {
@@ -195,26 +210,21 @@ void HierarchicalCoulomb::compute() {
     if (norm) {
         for (auto it = beginAtomic(); it != endAtomic(); ++it) {
             atomic_t *a = *it;
-            a->_Q2 = a->_Q2/ub::norm_frobenius(a->_Q2);
+            a->_Q2 /= double(ub::norm_frobenius(a->_Q2));
         }
     }
 
     // THIRD-ORDER
     GLOG() << "k = 4-body ..." << std::endl;
-    for (auto it1 = beginAtomic(); it1 != endAtomic(); ++it1) {
-        atomic_t *a = *it1;
+    for (int ia = 0; ia < n_parts; ++ia) {
+        atomic_t *a = _atomic_array[ia];
         int sa = a->getTypeIdx();
-        vec ra = a->getCenter()->getPos();
-        for (auto it2 = beginAtomic(); it2 != endAtomic(); ++it2) {
-            atomic_t *b = *it2;
+        for (int k = nb_ptr[ia]; k < nb_ptr[ia+1]; ++k) {
+            atomic_t *b = _atomic_array[nb_idx[k]];
             int sb = b->getTypeIdx();
-            vec rb = b->getCenter()->getPos();
-            // Apply weight function
-            vec dr_ab = _structure->connect(ra, rb);
-            double R_ab = soap::linalg::abs(dr_ab);
-            if (! _cutoff->isWithinCutoff(R_ab)) continue;
-            double w_ab = _cutoff->calculateWeight(R_ab);
-            GLOG() << "    " << a->getCenter()->getId() << ":" << b->getCenter()->getId() << " R=" << R_ab << " w=" << w_ab << std::endl;
+            double R_ab = nb_R[k];
+            double w_ab = nb_w[k];
+            GLOG_DEBUG() << "    " << a->getCenter()->getId() << ":" << b->getCenter()->getId() << " R=" << R_ab << " w=" << w_ab << std::endl;
             // Interact
             double inter_ab = w_ab/pow(R_ab+R0, gamma);
             for (int sb = 0; sb < _S; ++sb) {
@@ -234,7 +244,7 @@ void HierarchicalCoulomb::compute() {
     if (norm) {
         for (auto it = beginAtomic(); it != endAtomic(); ++it) {
             atomic_t *a = *it;
-            a->_Q3 = a->_Q3/ub::norm_frobenius(a->_Q3);
+            a->_Q3 /= double(ub::norm_frobenius(a->_Q3));
         }
     }
 
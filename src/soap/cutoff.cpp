@@ -24,31 +24,24 @@ bool CutoffFunction::isWithinCutoff(double r) {
 }
 
 double CutoffFunction::calculateWeight(double r) {
-    double weight_at_r = 1.;
-    if (r > _Rc) {
-        weight_at_r = -1.e-10;
-    }
-    else if (r <= _Rc - _Rc_width) {
-        weight_at_r = 1.;
-    }
-    else {
-        weight_at_r = 0.5*(1+cos(M_PI*(r-_Rc+_Rc_width)/_Rc_width));
-        //weight_at_r = pow(cos(0.5*M_PI*(r-_Rc+_Rc_width)/_Rc_width),2);
-    }
-    return weight_at_r;
+    if (r > _Rc) return -1.e-10;
+    cutoff_kernel_shifted_cosine kernel = { _Rc, _Rc_width };
+    double w, dw_dr;
+    kernel(r, w, dw_dr);
+    return w;
 }
 
 vec CutoffFunction::calculateGradientWeight(double r, vec d) {
-    vec grad_weight(0.,0.,0.);
-    if (r > _Rc || r <= _Rc - _Rc_width) {
-        ;
-    }
-    else {
-        grad_weight = -0.5*sin(M_PI*(r-_Rc+_Rc_width)/_Rc_width)*M_PI/_Rc_width * d;
-        //double phi = 0.5*M_PI*(r-_Rc+_Rc_width)/_Rc_width;
-        //grad_weight = - M_PI/_Rc_width*sin(phi)*cos(phi) * d;
-    }
-    return grad_weight;
+    if (r > _Rc) return vec(0.,0.,0.);
+    cutoff_kernel_shifted_cosine kernel = { _Rc, _Rc_width };
+    double w, dw_dr;
+    kernel(r, w, dw_dr);
+    return dw_dr*d;
+}
+
+int CutoffFunction::computeWeights(int n, const double *d2, int *idx, double *r, double *w, double *dw_dr) {
+    cutoff_kernel_shifted_cosine kernel = { _Rc, _Rc_width };
+    return cutoff_weights(kernel, _Rc, n, d2, idx, r, w, dw_dr);
 }
 
 void CutoffFunctionHeaviside::configure(Options &options) {
@@ -77,6 +70,10 @@ vec CutoffFunctionHeaviside::calculateGradientWeight(double r, vec d) {
     return vec(0.,0.,0.);
 }
 
+int CutoffFunctionHeaviside::computeWeights(int n, const double *d2, int *idx, double *r, double *w, double *dw_dr) {
+    return cutoff_weights(cutoff_kernel_heaviside(), _Rc, n, d2, idx, r, w, dw_dr);
+}
+
 void CutoffFunctionFactory::registerAll(void) {
 	CutoffFunctionOutlet().Register<CutoffFunction>("shifted-cosine");
 	CutoffFunctionOutlet().Register<CutoffFunctionHeaviside>("heaviside");
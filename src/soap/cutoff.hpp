@@ -2,6 +2,7 @@
 #define _SOAP_CUTOFF_HPP
 
 #include <string>
+#include <cmath>
 #include <math.h>
 #include <vector>
 #include <boost/serialization/base_object.hpp>
@@ -16,6 +17,55 @@ namespace soap {
 
 namespace ub = boost::numeric::ublas;
 
+// Per-distance weight kernels: weight w(r) and derivative dw/dr together,
+// for r <= Rc. Inlined into the batch loop of cutoff_weights (below).
+struct cutoff_kernel_shifted_cosine
+{
+    double Rc;
+    double Rc_width;
+    inline void operator()(double r, double &w, double &dw_dr) const {
+        if (r <= Rc - Rc_width) {
+            w = 1.;
+            dw_dr = 0.;
+        }
+        else {
+            double phi = M_PI*(r-Rc+Rc_width)/Rc_width;
+            w = 0.5*(1+cos(phi));
+            dw_dr = -0.5*sin(phi)*M_PI/Rc_width;
+            //w = pow(cos(0.5*phi),2), dw_dr = -M_PI/Rc_width*sin(0.5*phi)*cos(0.5*phi)
+        }
+    }
+};
+
+struct cutoff_kernel_heaviside
+{
+    inline void operator()(double r, double &w, double &dw_dr) const {
+        w = 1.;
+        dw_dr = 0.;
+    }
+};
+
+// Batched weighting of squared distances d2[0..n): pairs beyond the cutoff
+// are rejected on d2 (no sqrt), the remaining m pairs are returned as
+// idx[0..m) with distance r, weight w and derivative dw_dr.
+template<class Kernel>
+int cutoff_weights(const Kernel &kernel, double Rc, int n, const double *d2,
+        int *idx, double *r, double *w, double *dw_dr) {
+    double Rc2 = Rc*Rc;
+    int m = 0;
+    for (int k = 0; k < n; ++k) {
+        idx[m] = k;
+        m += (d2[k] <= Rc2);
+    }
+    for (int j = 0; j < m; ++j) {
+        r[j] = std::sqrt(d2[idx[j]]);
+    }
+    for (int j = 0; j < m; ++j) {
+        kernel(r[j], w[j], dw_dr[j]);
+    }
+    return m;
+}
+
 class CutoffFunction
 {
 public:
@@ -33,6 +83,9 @@ public:
     virtual bool isWithinCutoff(double r);
     virtual double calculateWeight(double r);
     virtual vec calculateGradientWeight(double r, vec d);
+    // Batch version of isWithinCutoff, calculateWeight and calculateGradientWeight
+    // (gradient = dw_dr*d), dispatched once per batch (see cutoff_weights)
+    virtual int computeWeights(int n, const double *d2, int *idx, double *r, double *w, double *dw_dr);
 
     template<class Archive>
     void serialize(Archive &arch, const unsigned int version) {
@@ -60,6 +113,7 @@ public:
     bool isWithinCutoff(double r);
     double calculateWeight(double r);
     virtual vec calculateGradientWeight(double r, vec d);
+    int computeWeights(int n, const double *d2, int *idx, double *r, double *w, double *dw_dr);
 
     template<class Archive>
     void serialize(Archive &arch, const unsigned int version) {
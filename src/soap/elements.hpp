@@ -0,0 +1,23 @@
+#ifndef _SOAP_ELEMENTS_HPP
+#define _SOAP_ELEMENTS_HPP
+
+#include <string>
+
+namespace soap {
+
+// Element symbols and masses by atomic number (cf. soapy/elements.py)
+struct element_t
+{
+    const char *symbol;
+    double mass;
+};
+
+int element_count();
+// Atomic number of <symbol>, 0 if unknown
+int element_number(const std::string &symbol);
+// Element with atomic number <z>, throws OutOfRange if unknown
+const element_t &element_get(int z);
+
+}
+
+#endif /* _SOAP_ELEMENTS_HPP */
@@ -1,6 +1,7 @@
 #include "soap/fieldtensor.hpp"
 #include "soap/linalg/numpy.hpp"
 #include "soap/linalg/wigner.hpp"
+#include "soap/base/profile.hpp"
 #include <boost/math/special_functions/legendre.hpp>
 
 namespace soap {
@@ -731,29 +732,31 @@ void InteractUpdateSourceTarget(
 }
 
 void FTSpectrum::computeFieldTensors(std::map<int, std::map<int, Tlmlm::coeff_t>> &i1_i2_T12) {
+    SOAP_PROFILE_SCOPE("ftspectrum.field_tensors");
     GLOG() << "Computing field tensors ..." << std::endl;
     int K = _K;
     int L = _L;
     Tlmlm T12(L);
+    std::vector<vec> dr1;
+    std::vector<double> d21;
     for (auto it1 = beginAtomic(); it1 != endAtomic(); ++it1) {
         // Particle 1
         atomic_t *a = *it1;
         int id1 = a->getCenter()->getId();
         int s1 = a->getTypeIdx();
-        vec r1 = a->getCenter()->getPos();
         double sigma1 = a->getCenter()->getSigma();
         // Initialise map
         i1_i2_T12[id1] = std::map<int, Tlmlm::coeff_t>();
+        this->connectAtomic(it1, dr1, d21);
         for (auto it2 = it1; it2 != endAtomic(); ++it2) {
             // Particle 2
             atomic_t *b = *it2;
             int id2 = b->getCenter()->getId();
             int s2 = b->getTypeIdx();
-            vec r2 = b->getCenter()->getPos();
             double sigma2 = b->getCenter()->getSigma();
             // Find connection, apply weight function
-            vec dr12 = _structure->connect(r1, r2);
-            double r12 = soap::linalg::abs(dr12);
+            const vec &dr12 = dr1[it2-it1];
+            double r12 = std::sqrt(d21[it2-it1]);
             vec d12 = dr12/r12;
             if (! _cutoff->isWithinCutoff(r12)) continue;
             double w12 = _cutoff->calculateWeight(r12);
@@ -773,6 +776,17 @@ void FTSpectrum::computeFieldTensors(std::map<int, std::map<int, Tlmlm::coeff_t>
     return;
 }
 
+void FTSpectrum::connectAtomic(atomic_it_t it1, std::vector<vec> &dr, std::vector<double> &d2) {
+    // Atomic spectra are created per particle in structure order (see
+    // createAtomic), such that their centers are contiguous in the positions
+    int offset = it1-beginAtomic();
+    int n = endAtomic()-it1;
+    dr.resize(n);
+    d2.resize(n);
+    _structure->connectMany((*it1)->getCenter()->getPos(), _structure->getPositions()+offset, n,
+        dr.data(), d2.data());
+}
+
 void FTSpectrum::createAtomic() {
     for (auto it = _atomic_array.begin(); it != _atomic_array.end(); ++it) {
         delete *it;
@@ -786,25 +800,26 @@ void FTSpectrum::createAtomic() {
 
 void FTSpectrum::energySCF(int k, std::map<int, std::map<int, Tlmlm::coeff_t> > &i1_i2_T12) {
     std::complex<double> energy_total;
+    std::vector<vec> dr1;
+    std::vector<double> d21;
     for (auto it1 = beginAtomic(); it1 != endAtomic(); ++it1) {
         // Particle 1
         atomic_t *a = *it1;
         int id1 = a->getCenter()->getId();
         std::string s1 = a->getType();
-        vec r1 = a->getCenter()->getPos();
         double sigma1 = a->getCenter()->getSigma();
         double w1 = a->getCenter()->getWeight();
+        this->connectAtomic(it1, dr1, d21);
         for (auto it2 = it1; it2 != endAtomic(); ++it2) {
             // Particle 2
             atomic_t *b = *it2;
             int id2 = b->getCenter()->getId();
             std::string s2 = b->getType();
-            vec r2 = b->getCenter()->getPos();
             double sigma2 = b->getCenter()->getSigma();
             double w2 = b->getCenter()->getWeight();
             // Find connection, apply weight function
-            vec dr12 = _structure->connect(r1, r2);
-            double r12 = soap::linalg::abs(dr12);
+            const vec &dr12 = dr1[it2-it1];
+            double r12 = std::sqrt(d21[it2-it1]);
             vec d12 = dr12/r12;
             if (! _cutoff->isWithinCutoff(r12)) continue;
             double w12 = _cutoff->calculateWeight(r12);
@@ -856,25 +871,26 @@ void FTSpectrum::polarize() {
 
     for (int k = 1; k <= _K; ++k) {
         // UPDATE FIELDS
+        std::vector<vec> dr1;
+        std::vector<double> d21;
         for (auto it1 = beginAtomic(); it1 != endAtomic(); ++it1) {
             // Particle 1
             atomic_t *a = *it1;
             int id1 = a->getCenter()->getId();
             std::string s1 = a->getType();
-            vec r1 = a->getCenter()->getPos();
             double sigma1 = a->getCenter()->getSigma();
             double w1 = a->getCenter()->getWeight();
+            this->connectAtomic(it1, dr1, d21);
             for (auto it2 = it1; it2 != endAtomic(); ++it2) {
                 // Particle 2
                 atomic_t *b = *it2;
                 int id2 = b->getCenter()->getId();
                 std::string s2 = b->getType();
-                vec r2 = b->getCenter()->getPos();
                 double sigma2 = b->getCenter()->getSigma();
                 double w2 = b->getCenter()->getWeight();
                 // Find connection, apply weight function
-                vec dr12 = _structure->connect(r1, r2);
-                double r12 = soap::linalg::abs(dr12);
+                const vec &dr12 = dr1[it2-it1];
+                double r12 = std::sqrt(d21[it2-it1]);
                 vec d12 = dr12/r12;
                 if (! _cutoff->isWithinCutoff(r12)) continue;
                 double w12 = _cutoff->calculateWeight(r12);
@@ -965,6 +981,7 @@ void FTSpectrum::polarize() {
 }
 
 void FTSpectrum::compute() {
+    SOAP_PROFILE_SCOPE("ftspectrum.compute");
     GLOG() << "Computing FTSpectrum ..." << std::endl;
 
     // CREATE ATOMIC SPECTRA
@@ -1018,25 +1035,26 @@ void FTSpectrum::compute() {
                 << " (LM-out = " << LM_out << ")"
                 << std::endl;
         #endif
+        std::vector<vec> dr1;
+        std::vector<double> d21;
         for (auto it1 = beginAtomic(); it1 != endAtomic(); ++it1) {
             // Particle 1
             atomic_t *a = *it1;
             int id1 = a->getCenter()->getId();
             std::string s1 = a->getType();
-            vec r1 = a->getCenter()->getPos();
             double sigma1 = a->getCenter()->getSigma();
             double w1 = a->getCenter()->getWeight();
+            this->connectAtomic(it1, dr1, d21);
             for (auto it2 = it1; it2 != endAtomic(); ++it2) {
                 // Particle 2
                 atomic_t *b = *it2;
                 int id2 = b->getCenter()->getId();
                 std::string s2 = b->getType();
-                vec r2 = b->getCenter()->getPos();
                 double sigma2 = b->getCenter()->getSigma();
                 double w2 = b->getCenter()->getWeight();
                 // Find connection, apply weight function
-                vec dr12 = _structure->connect(r1, r2);
-                double r12 = soap::linalg::abs(dr12);
+                const vec &dr12 = dr1[it2-it1];
+                double r12 = std::sqrt(d21[it2-it1]);
                 vec d12 = dr12/r12;
                 if (! _cutoff->isWithinCutoff(r12)) continue;
                 double w12 = _cutoff->calculateWeight(r12);
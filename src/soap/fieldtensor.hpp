@@ -147,6 +147,9 @@ public:
     static void registerPython();
 
 private:
+    // Connections from the center of atomic <it1> to the centers of [it1, endAtomic())
+    void connectAtomic(atomic_it_t it1, std::vector<vec> &dr, std::vector<double> &d2);
+
     Structure *_structure;
     Options *_options;
     CutoffFunction *_cutoff;
@@ -75,15 +75,15 @@ SphericalGaussian::SphericalGaussian(vec r0, double sigma) :
 
 ModifiedSphericalBessel1stKind::ModifiedSphericalBessel1stKind(int degree) :
     _degree(degree) {
-    _in.reserve(degree);
-    _din.reserve(degree);
+    _in.reserve(degree+2); // <- eval may append one entry beyond degree
+    _din.reserve(degree+1);
 }
 
 void ModifiedSphericalBessel1stKind::evaluate(double r, bool differentiate) {
     _in.clear();
     _din.clear();
 
-    _in = ModifiedSphericalBessel1stKind::eval(_degree, r);
+    ModifiedSphericalBessel1stKind::eval(_degree, r, _in);
 
     if (differentiate) {
         _din.resize(_degree+1, 0.);
@@ -111,6 +111,12 @@ void ModifiedSphericalBessel1stKind::evaluate(double r, bool differentiate) {
 
 std::vector<double> ModifiedSphericalBessel1stKind::eval(int degree, double r) {
 	std::vector<double> il;
+	ModifiedSphericalBessel1stKind::eval(degree, r, il);
+	return il;
+}
+
+void ModifiedSphericalBessel1stKind::eval(int degree, double r, std::vector<double> &il) {
+	il.clear();
 	if (r < RADZERO) {
 		il.push_back(1.);
 		il.push_back(0.);
@@ -128,7 +134,7 @@ std::vector<double> ModifiedSphericalBessel1stKind::eval(int degree, double r) {
 			il.push_back( il[l-2] - (2*(l-1)+1)/r*il[l-1] );
 		}
 	}
-	return il;
+	return;
 }
 
 // ==============================
@@ -136,11 +142,16 @@ std::vector<double> ModifiedSphericalBessel1stKind::eval(int degree, double r) {
 // ==============================
 
 std::vector<std::complex<double> > GradSphericalYlm::eval(int l, int m, vec &r) {
+    std::vector<std::complex<double> > dylm(3);
+    GradSphericalYlm::eval(l, m, r, &dylm[0]);
+    return dylm;
+}
+
+void GradSphericalYlm::eval(int l, int m, vec &r, cmplx *dylm) {
 
-    std::vector<std::complex<double> > dylm;
-    dylm.push_back(std::complex<double>(0.,0.));
-    dylm.push_back(std::complex<double>(0.,0.));
-    dylm.push_back(std::complex<double>(0.,0.));
+    dylm[0] = cmplx(0.,0.);
+    dylm[1] = cmplx(0.,0.);
+    dylm[2] = cmplx(0.,0.);
 
     // TODO WHAT IF RADIUS IS ZERO?
     double R = soap::linalg::abs(r);
@@ -235,7 +246,7 @@ std::vector<std::complex<double> > GradSphericalYlm::eval(int l, int m, vec &r)
     dylm[1] = dylm[1] - (l*y*ylm/(R*R));
     dylm[2] = dylm[2] - (l*z*ylm/(R*R));
 
-    return dylm;
+    return;
 }
 
 std::complex<double> pow_nnan(std::complex<double> z, double a) {
@@ -50,6 +50,7 @@ struct ModifiedSphericalBessel1stKind
     void evaluate(double r, bool differentiate);
 
 	static std::vector<double> eval(int degree, double r);
+	static void eval(int degree, double r, std::vector<double> &il); // <- reuses the storage of il
 	static constexpr double RADZERO = 1e-10;
 	static constexpr double SPHZERO = 1e-4;
 
@@ -62,6 +63,7 @@ struct GradSphericalYlm
 {
     typedef std::complex<double> cmplx;
     static std::vector<cmplx > eval(int l, int m, vec &r);
+    static void eval(int l, int m, vec &r, cmplx *dylm); // <- writes (d/dx, d/dy, d/dz) to dylm[0..2]
 
     static constexpr double RADZERO = 1e-10;
 };
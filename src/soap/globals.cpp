@@ -1,4 +1,5 @@
 #include "soap/globals.hpp"
+#include "soap/base/exceptions.hpp"
 
 namespace soap {
 
@@ -15,4 +16,13 @@ void GLOG_VERBOSE(bool verbose) {
     return;
 }
 
+void GLOG_SET_LEVEL(std::string level) {
+    if (level == "error") GLOG.setReportLevel(logERROR);
+    else if (level == "warning") GLOG.setReportLevel(logWARNING);
+    else if (level == "info") GLOG.setReportLevel(logINFO);
+    else if (level == "debug") GLOG.setReportLevel(logDEBUG);
+    else throw soap::base::APIError("Unknown log level '" + level + "'");
+    return;
+}
+
 }
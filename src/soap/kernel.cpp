@@ -0,0 +1,196 @@
+#include <thread>
+#include <algorithm>
+
+#include "soap/kernel.hpp"
+#include "soap/linalg/numpy.hpp"
+
+namespace soap {
+
+KernelDotQnlm::KernelDotQnlm(Options &options) :
+    _type("generic"), _precision("double"), _normalize(true), _n_threads(1), _N(-1), _L(-1) {
+    if (options.hasKey("kernel.qnlm.type")) _type = options.get<std::string>("kernel.qnlm.type");
+    if (options.hasKey("kernel.qnlm.normalize")) _normalize = options.get<bool>("kernel.qnlm.normalize");
+    if (options.hasKey("kernel.qnlm.threads")) _n_threads = options.get<int>("kernel.qnlm.threads");
+    if (options.hasKey("kernel.qnlm.precision")) _precision = options.get<std::string>("kernel.qnlm.precision");
+    if (_type != "generic" && _type != "specific") {
+        throw soap::base::APIError("<KernelDotQnlm> Unknown kernel.qnlm.type '" + _type + "'");
+    }
+    if (_precision != "double" && _precision != "single") {
+        throw soap::base::APIError("<KernelDotQnlm> Unknown kernel.qnlm.precision '" + _precision + "'");
+    }
+    if (_n_threads < 1) _n_threads = 1;
+}
+
+void KernelDotQnlm::configure(Basis *basis1, Basis *basis2) {
+    _N = basis1->getRadBasis()->N();
+    _L = basis1->getAngBasis()->L();
+    if (basis2->getRadBasis()->N() != _N || basis2->getAngBasis()->L() != _L) {
+        throw soap::base::APIError("<KernelDotQnlm::compute> Spectra expanded in incompatible bases.");
+    }
+    bool with_sqrt_2l_1_norm = basis1->getConfig().sqrt_2l1_norm;
+    _cl2.resize(_L+1);
+    for (int l = 0; l <= _L; ++l) {
+        // Square of PowerExpansion normalization sqrt(8\pi^2/(2l+1))
+        _cl2[l] = (with_sqrt_2l_1_norm) ? 8.*M_PI*M_PI/(2.*l+1) : 1.;
+    }
+}
+
+template<typename T>
+void KernelDotQnlm::pack(Spectrum &spectrum, std::map<std::string, int> &type_slots, std::vector<packed_t<T> > &packed) {
+    int size_slot = _N*(_L+1)*(_L+1);
+    packed.clear();
+    packed.resize(spectrum.length());
+    int i = 0;
+    for (auto it = spectrum.beginAtomic(); it != spectrum.endAtomic(); ++it, ++i) {
+        // Collect densities: type-agnostic or one per neighbour type
+        std::vector<std::pair<int, BasisExpansion*> > slot_qnlm;
+        if (_type == "generic") {
+            slot_qnlm.push_back(std::pair<int, BasisExpansion*>(0, (*it)->getQnlmGeneric()));
+        }
+        else {
+            AtomicSpectrum::map_qnlm_t &map_qnlm = (*it)->getQnlmMap();
+            for (auto jt = map_qnlm.begin(); jt != map_qnlm.end(); ++jt) {
+                auto st = type_slots.find(jt->first);
+                if (st == type_slots.end()) {
+                    int slot = type_slots.size();
+                    type_slots[jt->first] = slot;
+                    st = type_slots.find(jt->first);
+                }
+                slot_qnlm.push_back(std::pair<int, BasisExpansion*>(st->second, jt->second));
+            }
+            std::sort(slot_qnlm.begin(), slot_qnlm.end());
+        }
+        // Repack (n, lm) -> (lm, n)
+        packed_t<T> &pck = packed[i];
+        pck.coeff.resize(slot_qnlm.size()*size_slot);
+        for (int s = 0; s < slot_qnlm.size(); ++s) {
+            pck.slots.push_back(slot_qnlm[s].first);
+            BasisExpansion::coeff_t &qnlm = slot_qnlm[s].second->getCoefficients();
+            std::complex<T> *dest = &pck.coeff[s*size_slot];
+            for (int lm = 0; lm < (_L+1)*(_L+1); ++lm) {
+                for (int n = 0; n < _N; ++n) {
+                    dest[lm*_N+n] = std::complex<T>(qnlm(n, lm));
+                }
+            }
+        }
+        pck.self = -1.;
+    }
+    return;
+}
+
+template<typename T>
+double KernelDotQnlm::evaluate(const packed_t<T> &a, const packed_t<T> &b, std::vector<std::complex<T> > &mmat) {
+    int size_slot = _N*(_L+1)*(_L+1);
+    double k = 0.;
+    for (int l = 0; l <= _L; ++l) {
+        int dim = 2*l+1;
+        std::fill(mmat.begin(), mmat.begin()+dim*dim, std::complex<T>(0.,0.));
+        // M_{mm'} = sum_mu sum_n a^mu_{nlm} conj(b^mu_{nlm'}) over types shared by a and b
+        int ia = 0;
+        int ib = 0;
+        bool any = false;
+        while (ia < a.slots.size() && ib < b.slots.size()) {
+            if (a.slots[ia] < b.slots[ib]) { ++ia; continue; }
+            if (a.slots[ia] > b.slots[ib]) { ++ib; continue; }
+            const std::complex<T> *pa = &a.coeff[ia*size_slot + _N*l*l];
+            const std::complex<T> *pb = &b.coeff[ib*size_slot + _N*l*l];
+            for (int m1 = 0; m1 < dim; ++m1) {
+                for (int m2 = 0; m2 < dim; ++m2) {
+                    // Real arithmetic: std::complex products go through __mulsc3/__muldc3
+                    // (inf/nan handling), which would dominate and not vectorize
+                    const T *ra = reinterpret_cast<const T*>(pa + m1*_N);
+                    const T *rb = reinterpret_cast<const T*>(pb + m2*_N);
+                    T re = 0.;
+                    T im = 0.;
+                    for (int n = 0; n < _N; ++n) {
+                        re += ra[2*n]*rb[2*n] + ra[2*n+1]*rb[2*n+1];
+                        im += ra[2*n+1]*rb[2*n] - ra[2*n]*rb[2*n+1];
+                    }
+                    mmat[m1*dim+m2] += std::complex<T>(re, im);
+                }
+            }
+            any = true;
+            ++ia;
+            ++ib;
+        }
+        if (!any) break; // <- No shared types, nothing for any l
+        double kl = 0.;
+        for (int mm = 0; mm < dim*dim; ++mm) kl += std::norm(std::complex<double>(mmat[mm]));
+        k += _cl2[l]*kl;
+    }
+    return k;
+}
+
+void KernelDotQnlm::compute(Spectrum &spectrum1, Spectrum &spectrum2, kernel_t &kmat) {
+    this->configure(spectrum1.getBasis(), spectrum2.getBasis());
+    GLOG() << "Computing q_nlm dot kernel (" << _type << ", " << _precision << ") for "
+        << spectrum1.length() << " x " << spectrum2.length() << " centers ..." << std::endl;
+    if (_precision == "single") this->computeKernel<float>(spectrum1, spectrum2, kmat);
+    else this->computeKernel<double>(spectrum1, spectrum2, kmat);
+    return;
+}
+
+template<typename T>
+void KernelDotQnlm::computeKernel(Spectrum &spectrum1, Spectrum &spectrum2, kernel_t &kmat) {
+    // REPACK DENSITIES, TYPE SLOTS SHARED BETWEEN BOTH SPECTRA
+    std::map<std::string, int> type_slots;
+    std::vector<packed_t<T> > packed1;
+    std::vector<packed_t<T> > packed2;
+    this->pack<T>(spectrum1, type_slots, packed1);
+    this->pack<T>(spectrum2, type_slots, packed2);
+
+    int n1 = packed1.size();
+    int n2 = packed2.size();
+    kmat = ub::zero_matrix<double>(n1, n2);
+    int n_threads = std::max(1, std::min(_n_threads, n1));
+
+    // SELF-KERNELS (FOR NORMALIZATION), THEN ALL PAIRS; ROWS DEALT ROUND-ROBIN
+    auto work = [&](int t) {
+        std::vector<std::complex<T> > mmat((2*_L+1)*(2*_L+1));
+        if (_normalize) {
+            for (int i = t; i < n1; i += n_threads) packed1[i].self = this->evaluate(packed1[i], packed1[i], mmat);
+            for (int j = t; j < n2; j += n_threads) packed2[j].self = this->evaluate(packed2[j], packed2[j], mmat);
+        }
+    };
+    auto work_pairs = [&](int t) {
+        std::vector<std::complex<T> > mmat((2*_L+1)*(2*_L+1));
+        for (int i = t; i < n1; i += n_threads) {
+            for (int j = 0; j < n2; ++j) {
+                double kij = this->evaluate(packed1[i], packed2[j], mmat);
+                if (_normalize) {
+                    double norm = std::sqrt(packed1[i].self*packed2[j].self);
+                    kij = (norm > 0.) ? kij/norm : 0.;
+                }
+                kmat(i,j) = kij;
+            }
+        }
+    };
+    if (n_threads == 1) {
+        work(0);
+        work_pairs(0);
+    }
+    else {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < n_threads; ++t) threads.push_back(std::thread(work, t));
+        for (auto &th : threads) th.join();
+        threads.clear();
+        for (int t = 0; t < n_threads; ++t) threads.push_back(std::thread(work_pairs, t));
+        for (auto &th : threads) th.join();
+    }
+    return;
+}
+
+boost::python::object KernelDotQnlm::computeNumpy(Spectrum &spectrum1, Spectrum &spectrum2) {
+    kernel_t kmat;
+    this->compute(spectrum1, spectrum2, kmat);
+    soap::linalg::numpy_converter npc("float64");
+    return npc.ublas_to_numpy<double>(kmat);
+}
+
+void KernelDotQnlm::registerPython() {
+    using namespace boost::python;
+    class_<KernelDotQnlm>("KernelDotQnlm", init<Options &>())
+        .def("compute", &KernelDotQnlm::computeNumpy);
+}
+
+}
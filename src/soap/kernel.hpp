@@ -0,0 +1,73 @@
+#ifndef _SOAP_KERNEL_HPP
+#define _SOAP_KERNEL_HPP
+
+#include <vector>
+#include <complex>
+#include <boost/numeric/ublas/matrix.hpp>
+
+#include "soap/base/exceptions.hpp"
+#include "soap/options.hpp"
+#include "soap/spectrum.hpp"
+
+namespace soap {
+
+namespace ub = boost::numeric::ublas;
+
+// Dot-product kernel between the power spectra of two sets of atomic
+// environments, evaluated directly from the density coefficients q_nlm:
+//     X_i.X_j = sum_l c_l^2 || Q_i^l (Q_j^l)^+ ||_F^2
+// with (Q^l)_{nm} = q_nlm and c_l the optional sqrt(8\pi^2/(2l+1)) factor.
+// Power spectra are never built: the cost per pair is ~N*L^3 rather than
+// N^2*L, which pays off for large radial bases.
+//
+// Options
+// o kernel.qnlm.type    : 'generic' (g/c spectrum) or 'specific' (all type pairs)
+// o kernel.qnlm.normalize : divide by sqrt(k_ii*k_jj)
+// o kernel.qnlm.threads : number of worker threads
+// o kernel.qnlm.precision : 'double' or 'single' (coefficients and m-contractions
+//                         in float, Frobenius sums accumulated in double)
+class KernelDotQnlm
+{
+public:
+    typedef std::complex<double> cmplx_t;
+    typedef ub::matrix<double> kernel_t;
+
+    // Per-center density coefficients, repacked so that the m-rows of each
+    // l-block are contiguous in n: offset(slot, l, m) = slot*N*(L+1)^2 + N*(l*l+m+l)
+    template<typename T>
+    struct packed_t
+    {
+        std::vector<int> slots; // <- sorted type slots (0 for generic)
+        std::vector<std::complex<T> > coeff;
+        double self;
+    };
+
+    KernelDotQnlm(Options &options);
+   ~KernelDotQnlm() {;}
+
+    void compute(Spectrum &spectrum1, Spectrum &spectrum2, kernel_t &kmat);
+    boost::python::object computeNumpy(Spectrum &spectrum1, Spectrum &spectrum2);
+    static void registerPython();
+
+private:
+    void configure(Basis *basis1, Basis *basis2);
+    template<typename T>
+    void computeKernel(Spectrum &spectrum1, Spectrum &spectrum2, kernel_t &kmat);
+    template<typename T>
+    void pack(Spectrum &spectrum, std::map<std::string, int> &type_slots, std::vector<packed_t<T> > &packed);
+    template<typename T>
+    double evaluate(const packed_t<T> &a, const packed_t<T> &b, std::vector<std::complex<T> > &mmat);
+
+    std::string _type;
+    std::string _precision;
+    bool _normalize;
+    int _n_threads;
+
+    int _N;
+    int _L;
+    std::vector<double> _cl2;
+};
+
+}
+
+#endif /* _SOAP_KERNEL_HPP */
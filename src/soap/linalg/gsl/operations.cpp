@@ -3,6 +3,8 @@
 #include <gsl/gsl_linalg.h>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_eigen.h>
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_complex_math.h>
 
 namespace soap { namespace linalg {
 
@@ -75,4 +77,20 @@ void linalg_invert(ub::matrix<double> &A, ub::matrix<double> &V){
 }
 
 
+void linalg_zgemm_conj_trans(int M, int N, int K,
+        const std::complex<double> *A, int lda,
+        const std::complex<double> *B, int ldb,
+        std::complex<double> *C, int ldc) {
+    // C = A*B^H using GSL (std::complex<double> and gsl_complex share their layout)
+    gsl_matrix_complex_const_view A_view = gsl_matrix_complex_const_view_array_with_tda(
+        reinterpret_cast<const double*>(A), M, K, lda);
+    gsl_matrix_complex_const_view B_view = gsl_matrix_complex_const_view_array_with_tda(
+        reinterpret_cast<const double*>(B), N, K, ldb);
+    gsl_matrix_complex_view C_view = gsl_matrix_complex_view_array_with_tda(
+        reinterpret_cast<double*>(C), M, N, ldc);
+    gsl_complex alpha = gsl_complex_rect(1., 0.);
+    gsl_complex beta = gsl_complex_rect(0., 0.);
+    gsl_blas_zgemm(CblasNoTrans, CblasConjTrans, alpha, &A_view.matrix, &B_view.matrix, beta, &C_view.matrix);
+}
+
 }}
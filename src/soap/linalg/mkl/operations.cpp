@@ -76,4 +76,15 @@ void linalg_invert( ub::matrix<double> &A, ub::matrix<double> &V){
 }
 
 
+void linalg_zgemm_conj_trans(int M, int N, int K,
+        const std::complex<double> *A, int lda,
+        const std::complex<double> *B, int ldb,
+        std::complex<double> *C, int ldc) {
+    // C = A*B^H using MKL
+    MKL_Complex16 alpha = {1., 0.};
+    MKL_Complex16 beta = {0., 0.};
+    cblas_zgemm(CblasRowMajor, CblasNoTrans, CblasConjTrans, M, N, K,
+        &alpha, A, lda, B, ldb, &beta, C, ldc);
+}
+
 }}
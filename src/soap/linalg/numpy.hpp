@@ -5,10 +5,12 @@
 
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/python.hpp>
+#include "soap/base/profile.hpp"
 
 namespace soap { namespace linalg {
 
-/** Converts between numpy arrays and boost ublas matrices. */
+/** Converts between numpy arrays and boost ublas matrices (or dense
+ *  matrices with the same interface, such as linalg::aligned_matrix). */
 struct numpy_converter
 {
     //using namespace boost::python;
@@ -42,12 +44,13 @@ struct numpy_converter
 	}
 
 	/** Convert a numpy matrix to a ublas one. */
-	template< typename T >
-	boost::numeric::ublas::matrix< T > &
+	template< typename T, typename matrix_t >
+	matrix_t &
 	numpy_to_ublas(
 		boost::python::object a,
-		boost::numeric::ublas::matrix< T > & m )
+		matrix_t & m )
 	{
+		SOAP_PROFILE_SCOPE("export.from_numpy");
 		boost::python::tuple shape( a.attr("shape") );
 		if( boost::python::len( shape ) != 2 )
 		{
@@ -68,11 +71,12 @@ boost::python::make_tuple( i, j ) ] );
 	}
 
 	/** Convert a ublas matrix to a numpy matrix. */
-	template< typename T >
+	template< typename T, typename matrix_t >
 	boost::python::object
 	ublas_to_numpy(
-		const boost::numeric::ublas::matrix< T > & m )
+		const matrix_t & m )
 	{
+		SOAP_PROFILE_SCOPE("export.to_numpy");
 		//create a numpy array to put it in
 		boost::python::object result(
 			array_type(
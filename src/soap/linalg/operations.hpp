@@ -4,6 +4,7 @@
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/symmetric.hpp>
+#include <complex>
 
 namespace soap { namespace linalg {
     namespace ub = boost::numeric::ublas;
@@ -139,6 +140,23 @@ namespace soap { namespace linalg {
      * 
      */
     bool linalg_eigenvalues_general( ub::matrix<double> &A,ub::matrix<double> &B, ub::vector<double> &E, ub::matrix<double> &V);
+
+    /**
+     * \brief complex matrix product C = A*B^H on raw row-major storage
+     * @param M rows of A and C
+     * @param N rows of B, columns of C
+     * @param K columns of A and B
+     * @param A pointer to first element of A, leading dimension lda
+     * @param B pointer to first element of B, leading dimension ldb
+     * @param C pointer to first element of C, leading dimension ldc (overwritten)
+     *
+     * This function wraps gsl_blas_zgemm / cblas_zgemm. The leading dimensions
+     * allow operating on column blocks of larger matrices without copying.
+     */
+    void linalg_zgemm_conj_trans(int M, int N, int K,
+        const std::complex<double> *A, int lda,
+        const std::complex<double> *B, int ldb,
+        std::complex<double> *C, int ldc);
     
     
     
@@ -0,0 +1,305 @@
+#ifndef _SOAP_LINALG_TENSOR_HPP
+#define _SOAP_LINALG_TENSOR_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <complex>
+#include <new>
+#include <algorithm>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/array.hpp>
+#include <boost/serialization/complex.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+
+#include "soap/base/arena.hpp"
+
+namespace soap { namespace linalg {
+
+/**
+ * \brief Raw kernels on contiguous arrays, shared by the containers below
+ * and by callers that hold coefficient blocks in plain buffers.
+ * Complex arrays are processed as interleaved (re, im) doubles.
+ */
+
+/** \brief y += alpha*x */
+template<typename T, typename S>
+inline void axpy(std::size_t n, S alpha, const T *x, T *y) {
+    for (std::size_t i = 0; i < n; ++i) y[i] += alpha*x[i];
+}
+
+template<typename S>
+inline void axpy(std::size_t n, S alpha, const std::complex<double> *x, std::complex<double> *y) {
+    const double *xd = reinterpret_cast<const double*>(x);
+    double *yd = reinterpret_cast<double*>(y);
+    double a = alpha;
+    for (std::size_t i = 0; i < 2*n; ++i) yd[i] += a*xd[i];
+}
+
+/** \brief x *= alpha */
+template<typename T, typename S>
+inline void scale(std::size_t n, S alpha, T *x) {
+    for (std::size_t i = 0; i < n; ++i) x[i] *= alpha;
+}
+
+template<typename S>
+inline void scale(std::size_t n, S alpha, std::complex<double> *x) {
+    double *xd = reinterpret_cast<double*>(x);
+    double a = alpha;
+    for (std::size_t i = 0; i < 2*n; ++i) xd[i] *= a;
+}
+
+/** \brief sum_i a_i*conj(b_i) */
+inline std::complex<double> conj_dot(std::size_t n, const std::complex<double> *a, const std::complex<double> *b) {
+    const double *ad = reinterpret_cast<const double*>(a);
+    const double *bd = reinterpret_cast<const double*>(b);
+    double re = 0.;
+    double im = 0.;
+    for (std::size_t i = 0; i < n; ++i) {
+        re += ad[2*i]*bd[2*i] + ad[2*i+1]*bd[2*i+1];
+        im += ad[2*i+1]*bd[2*i] - ad[2*i]*bd[2*i+1];
+    }
+    return std::complex<double>(re, im);
+}
+
+inline double conj_dot(std::size_t n, const double *a, const double *b) {
+    double s = 0.;
+    for (std::size_t i = 0; i < n; ++i) s += a[i]*b[i];
+    return s;
+}
+
+/**
+ * \brief Contiguous, zero-initialised storage aligned to ALIGNMENT bytes,
+ * for trivially copyable element types (double, std::complex<double>).
+ *
+ * Resizing keeps the allocation if it is large enough, so containers that
+ * are re-zeroed per call (see aligned_matrix::operator=(aligned_zero_matrix))
+ * do not go back to the heap. With an arena set (setArena), storage comes
+ * from the arena and is released with it. Serializes like ublas::unbounded_array.
+ */
+template<typename T>
+class aligned_array
+{
+public:
+    static const std::size_t ALIGNMENT = 64;
+
+    aligned_array() : _data(NULL), _size(0), _capacity(0), _arena(NULL) {;}
+    explicit aligned_array(std::size_t n) : _data(NULL), _size(0), _capacity(0), _arena(NULL) { this->resize(n); }
+    aligned_array(const aligned_array &other) : _data(NULL), _size(0), _capacity(0), _arena(NULL) { *this = other; }
+    aligned_array(aligned_array &&other) : _data(other._data), _size(other._size), _capacity(other._capacity), _arena(other._arena) {
+        other._data = NULL;
+        other._size = other._capacity = 0;
+    }
+    ~aligned_array() { this->deallocate(); }
+
+    aligned_array &operator=(const aligned_array &other) {
+        if (this == &other) return *this;
+        this->resize(other._size);
+        if (_size) std::memcpy(_data, other._data, _size*sizeof(T));
+        return *this;
+    }
+    aligned_array &operator=(aligned_array &&other) {
+        this->swap(other);
+        return *this;
+    }
+
+    std::size_t size() const { return _size; }
+    T &operator[](std::size_t i) { return _data[i]; }
+    const T &operator[](std::size_t i) const { return _data[i]; }
+    T *begin() { return _data; }
+    T *end() { return _data+_size; }
+    const T *begin() const { return _data; }
+    const T *end() const { return _data+_size; }
+
+    /** \brief Resizes to n elements, all zero */
+    void resize(std::size_t n) {
+        if (n > _capacity) {
+            this->deallocate();
+            void *ptr = NULL;
+            if (_arena) ptr = _arena->allocate(n*sizeof(T), ALIGNMENT);
+            else if (posix_memalign(&ptr, ALIGNMENT, n*sizeof(T)) != 0) throw std::bad_alloc();
+            else SOAP_PROFILE_COUNT("memory.heap_bytes", n*sizeof(T));
+            _data = static_cast<T*>(ptr);
+            _capacity = n;
+        }
+        _size = n;
+        this->zero();
+    }
+    /** \brief Takes further storage from arena (NULL: heap), drops the current one */
+    void setArena(base::Arena *arena) {
+        this->deallocate();
+        _arena = arena;
+    }
+    void zero() { std::fill_n(_data, _size, T()); }
+    void swap(aligned_array &other) {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_capacity, other._capacity);
+        std::swap(_arena, other._arena);
+    }
+
+    template<class Archive>
+    void serialize(Archive &arch, const unsigned int version) {
+        boost::serialization::collection_size_type s(_size);
+        arch & boost::serialization::make_nvp("size", s);
+        if (Archive::is_loading::value) this->resize(s);
+        arch & boost::serialization::make_array(_data, s);
+    }
+
+private:
+    void deallocate() {
+        if (!_arena) std::free(_data);
+        _data = NULL;
+        _size = _capacity = 0;
+    }
+
+    T *_data;
+    std::size_t _size;
+    std::size_t _capacity;
+    base::Arena *_arena;
+};
+
+/** \brief Shape-only tag: assigning it to an aligned_matrix resizes and zeroes in place */
+template<typename T>
+struct aligned_zero_matrix
+{
+    aligned_zero_matrix(std::size_t n1, std::size_t n2) : size1(n1), size2(n2) {;}
+    std::size_t size1;
+    std::size_t size2;
+};
+
+template<typename T>
+struct aligned_zero_vector
+{
+    explicit aligned_zero_vector(std::size_t n) : size(n) {;}
+    std::size_t size;
+};
+
+/**
+ * \brief Dense row-major matrix on aligned_array storage.
+ *
+ * Mirrors the parts of ublas::matrix used on the expansion hot paths
+ * ((i,j), size1(), size2(), data()[k], clear()) and adds fused in-place
+ * updates in place of ublas expression templates. Serializes with the same
+ * layout as ublas::matrix, so archives written before remain readable.
+ */
+template<typename T>
+class aligned_matrix
+{
+public:
+    typedef T value_type;
+    typedef aligned_array<T> array_type;
+
+    aligned_matrix() : _size1(0), _size2(0) {;}
+    aligned_matrix(std::size_t n1, std::size_t n2) : _size1(n1), _size2(n2), _data(n1*n2) {;}
+    aligned_matrix(const aligned_zero_matrix<T> &z) : _size1(z.size1), _size2(z.size2), _data(z.size1*z.size2) {;}
+
+    aligned_matrix &operator=(const aligned_zero_matrix<T> &z) {
+        this->resize(z.size1, z.size2);
+        return *this;
+    }
+
+    std::size_t size1() const { return _size1; }
+    std::size_t size2() const { return _size2; }
+    T &operator()(std::size_t i, std::size_t j) { return _data[i*_size2+j]; }
+    const T &operator()(std::size_t i, std::size_t j) const { return _data[i*_size2+j]; }
+    array_type &data() { return _data; }
+    const array_type &data() const { return _data; }
+
+    /** \brief Resizes to (n1, n2), all zero */
+    void resize(std::size_t n1, std::size_t n2) {
+        _size1 = n1;
+        _size2 = n2;
+        _data.resize(n1*n2);
+    }
+    /** \brief Zeroes all elements, keeps the shape (as ublas::matrix::clear) */
+    void clear() { _data.zero(); }
+    void setArena(base::Arena *arena) {
+        _size1 = _size2 = 0;
+        _data.setArena(arena);
+    }
+    void swap(aligned_matrix &other) {
+        std::swap(_size1, other._size1);
+        std::swap(_size2, other._size2);
+        _data.swap(other._data);
+    }
+
+    aligned_matrix &operator+=(const aligned_matrix &other) {
+        linalg::axpy(_data.size(), 1., other._data.begin(), _data.begin());
+        return *this;
+    }
+    /** \brief this += alpha*other */
+    void axpy(double alpha, const aligned_matrix &other) {
+        linalg::axpy(_data.size(), alpha, other._data.begin(), _data.begin());
+    }
+    void scale(double alpha) {
+        linalg::scale(_data.size(), alpha, _data.begin());
+    }
+    /** \brief this(i,j) = conj(this(i,j)) */
+    void conjugate() {
+        for (std::size_t i = 0; i < _data.size(); ++i) _data[i] = std::conj(_data[i]);
+    }
+
+    template<class Archive>
+    void serialize(Archive &arch, const unsigned int version) {
+        boost::serialization::collection_size_type s1(_size1);
+        boost::serialization::collection_size_type s2(_size2);
+        arch & boost::serialization::make_nvp("size1", s1)
+             & boost::serialization::make_nvp("size2", s2);
+        if (Archive::is_loading::value) {
+            _size1 = s1;
+            _size2 = s2;
+        }
+        arch & boost::serialization::make_nvp("data", _data);
+    }
+
+private:
+    std::size_t _size1;
+    std::size_t _size2;
+    array_type _data;
+};
+
+/** \brief conj_dot over all elements of two matrices of the same shape */
+template<typename T>
+inline T conj_dot(const aligned_matrix<T> &a, const aligned_matrix<T> &b) {
+    return conj_dot(a.data().size(), a.data().begin(), b.data().begin());
+}
+
+/** \brief Dense vector on aligned_array storage, see aligned_matrix */
+template<typename T>
+class aligned_vector
+{
+public:
+    typedef T value_type;
+    typedef aligned_array<T> array_type;
+
+    aligned_vector() {;}
+    explicit aligned_vector(std::size_t n) : _data(n) {;}
+    aligned_vector(const aligned_zero_vector<T> &z) : _data(z.size) {;}
+
+    aligned_vector &operator=(const aligned_zero_vector<T> &z) {
+        _data.resize(z.size);
+        return *this;
+    }
+
+    std::size_t size() const { return _data.size(); }
+    T &operator()(std::size_t i) { return _data[i]; }
+    const T &operator()(std::size_t i) const { return _data[i]; }
+    array_type &data() { return _data; }
+    const array_type &data() const { return _data; }
+
+    void resize(std::size_t n) { _data.resize(n); }
+    void clear() { _data.zero(); }
+    void setArena(base::Arena *arena) { _data.setArena(arena); }
+
+    template<class Archive>
+    void serialize(Archive &arch, const unsigned int version) {
+        arch & boost::serialization::make_nvp("data", _data);
+    }
+
+private:
+    array_type _data;
+};
+
+}} /* CLOSE NAMESPACE */
+
+#endif /* _SOAP_LINALG_TENSOR_HPP */
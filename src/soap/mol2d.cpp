@@ -25,9 +25,15 @@ double Mol2D::computeSurface(double res) {
     double min_z = 0.0;
     double max_z = 0.0;
 
-	Structure::particle_it_t pit;
-	for (pit = _structure->beginParticles(); pit != _structure->endParticles(); ++pit) {
-		 vec dr = _structure->connect(center->getPos(), (*pit)->getPos());
+    int n_parts = _structure->getNumberOfParticles();
+    vec *positions = _structure->getPositions();
+    double *sigmas = _structure->getSigmas();
+    std::vector<vec> dr_parts(n_parts);
+    std::vector<double> d2_parts(n_parts);
+    _structure->connectMany(center->getPos(), positions, n_parts, dr_parts.data(), NULL);
+
+	for (int p = 0; p < n_parts; ++p) {
+		 const vec &dr = dr_parts[p];
          if (dr.getX() < min_x) min_x = dr.getX();
          if (dr.getX() > max_x) max_x = dr.getX();
          if (dr.getY() < min_y) min_y = dr.getY();
@@ -58,10 +64,10 @@ double Mol2D::computeSurface(double res) {
 
                 bool on_surface = false;
                 bool outside = true;
-                for (pit = _structure->beginParticles(); pit != _structure->endParticles(); ++pit) {
-                     vec rij = _structure->connect(ri, (*pit)->getPos());
-                     double dij = soap::linalg::abs(rij);
-                     double s = dij - (*pit)->getSigma();
+                _structure->connectMany(ri, positions, n_parts, dr_parts.data(), d2_parts.data());
+                for (int p = 0; p < n_parts; ++p) {
+                     double dij = std::sqrt(d2_parts[p]);
+                     double s = dij - sigmas[p];
                      if (s*s <= dx*dx) {
                         on_surface = true;
                      }
@@ -91,9 +97,15 @@ double Mol2D::computeVolume(double res) {
     auto center = _structure->particles()[0];
     bool debug = false;
 
-	Structure::particle_it_t pit;
-	for (pit = _structure->beginParticles(); pit != _structure->endParticles(); ++pit) {
-		 vec dr = _structure->connect(center->getPos(), (*pit)->getPos());
+    int n_parts = _structure->getNumberOfParticles();
+    vec *positions = _structure->getPositions();
+    double *sigmas = _structure->getSigmas();
+    std::vector<vec> dr_parts(n_parts);
+    std::vector<double> d2_parts(n_parts);
+    _structure->connectMany(center->getPos(), positions, n_parts, dr_parts.data(), NULL);
+
+	for (int p = 0; p < n_parts; ++p) {
+		 const vec &dr = dr_parts[p];
          if (dr.getX() < min_x) min_x = dr.getX();
          if (dr.getX() > max_x) max_x = dr.getX();
          if (dr.getY() < min_y) min_y = dr.getY();
@@ -123,10 +135,10 @@ double Mol2D::computeVolume(double res) {
                 vec ri = r0 + dr;
 
                 bool outside = true;
-                for (pit = _structure->beginParticles(); pit != _structure->endParticles(); ++pit) {
-                     vec rij = _structure->connect(ri, (*pit)->getPos());
-                     double dij = soap::linalg::abs(rij);
-                     if (dij <= (*pit)->getSigma()) {
+                _structure->connectMany(ri, positions, n_parts, dr_parts.data(), d2_parts.data());
+                for (int p = 0; p < n_parts; ++p) {
+                     double dij = std::sqrt(d2_parts[p]);
+                     if (dij <= sigmas[p]) {
                         outside = false;
                         break;
                      } else ;
@@ -0,0 +1,209 @@
+#include "soap/nlmkernels.hpp"
+
+namespace soap {
+
+typedef nlm_kernels_t::cmplx_t cmplx_t;
+
+// Complex arrays are accessed as interleaved (re, im) doubles
+static inline const double *as_doubles(const cmplx_t *c) { return reinterpret_cast<const double*>(c); }
+static inline double *as_doubles(cmplx_t *c) { return reinterpret_cast<double*>(c); }
+
+constexpr int lm_offset(int l) { return l*l; }
+constexpr int lm_size(int L) { return (L+1)*(L+1); }
+
+// =======
+// GENERIC
+// =======
+
+static void power_generic(int N, int L, const cmplx_t *q1, const cmplx_t *q2,
+        const double *prefac, double scale, bool accumulate, cmplx_t *xnkl) {
+    const double *a = as_doubles(q1);
+    const double *b = as_doubles(q2);
+    double *x = as_doubles(xnkl);
+    int LM = lm_size(L);
+    for (int n = 0; n < N; ++n) {
+        for (int k = 0; k < N; ++k) {
+            const double *a_n = a + 2*n*LM;
+            const double *b_k = b + 2*k*LM;
+            double *x_nk = x + 2*(n*N+k)*(L+1);
+            for (int l = 0; l <= L; ++l) {
+                double re = 0.;
+                double im = 0.;
+                for (int lm = lm_offset(l); lm < lm_offset(l+1); ++lm) {
+                    re += a_n[2*lm]*b_k[2*lm] + a_n[2*lm+1]*b_k[2*lm+1];
+                    im += a_n[2*lm+1]*b_k[2*lm] - a_n[2*lm]*b_k[2*lm+1];
+                }
+                double f = scale*prefac[l];
+                if (accumulate) {
+                    x_nk[2*l] += f*re;
+                    x_nk[2*l+1] += f*im;
+                }
+                else {
+                    x_nk[2*l] = f*re;
+                    x_nk[2*l+1] = f*im;
+                }
+            }
+        }
+    }
+}
+
+static inline void merge_body(int N, int L, const double *radial, const cmplx_t *angular,
+        double scale, cmplx_t *qnlm) {
+    const double *ang = as_doubles(angular);
+    double *q = as_doubles(qnlm);
+    int LM = lm_size(L);
+    for (int n = 0; n < N; ++n) {
+        for (int l = 0; l <= L; ++l) {
+            double r = radial[n*(L+1)+l];
+            for (int lm = lm_offset(l); lm < lm_offset(l+1); ++lm) {
+                q[2*(n*LM+lm)] = r*ang[2*lm]*scale;
+                q[2*(n*LM+lm)+1] = r*ang[2*lm+1]*scale;
+            }
+        }
+    }
+}
+
+static inline void merge_grad_body(int N, int L, const double *radial, const double *dradial,
+        const cmplx_t *angular, const cmplx_t *dangular,
+        double weight, double weight_scale, double dweight_scale, cmplx_t *dqnlm) {
+    const double *ang = as_doubles(angular);
+    const double *dang = as_doubles(dangular);
+    double *dq = as_doubles(dqnlm);
+    int LM = lm_size(L);
+    for (int n = 0; n < N; ++n) {
+        for (int l = 0; l <= L; ++l) {
+            double r = radial[n*(L+1)+l];
+            double dr = dradial[n*(L+1)+l];
+            for (int lm = lm_offset(l); lm < lm_offset(l+1); ++lm) {
+                for (int c = 0; c < 2; ++c) {
+                    dq[2*(n*LM+lm)+c] = weight*(
+                          weight_scale*r*dang[2*lm+c]
+                        + weight_scale*dr*ang[2*lm+c]
+                        + dweight_scale*r*ang[2*lm+c]);
+                }
+            }
+        }
+    }
+}
+
+static void merge_generic(int N, int L, const double *radial, const cmplx_t *angular,
+        double scale, cmplx_t *qnlm) {
+    merge_body(N, L, radial, angular, scale, qnlm);
+}
+
+static void merge_grad_generic(int N, int L, const double *radial, const double *dradial,
+        const cmplx_t *angular, const cmplx_t *dangular,
+        double weight, double weight_scale, double dweight_scale, cmplx_t *dqnlm) {
+    merge_grad_body(N, L, radial, dradial, angular, dangular, weight, weight_scale, dweight_scale, dqnlm);
+}
+
+// ===========
+// SPECIALIZED
+// ===========
+
+// Unrolled sum over m of q1(lm)*conj(q2(lm)) for lm in [l*l, l*l+M)
+template<int l, int M>
+struct power_m
+{
+    static inline void apply(const double *a, const double *b, double &re, double &im) {
+        power_m<l, M-1>::apply(a, b, re, im);
+        const int lm = lm_offset(l)+M-1;
+        re += a[2*lm]*b[2*lm] + a[2*lm+1]*b[2*lm+1];
+        im += a[2*lm+1]*b[2*lm] - a[2*lm]*b[2*lm+1];
+    }
+};
+
+template<int l>
+struct power_m<l, 0>
+{
+    static inline void apply(const double *a, const double *b, double &re, double &im) {;}
+};
+
+template<int l>
+struct power_l
+{
+    static inline void apply(const double *a, const double *b, const double *prefac,
+            double scale, bool accumulate, double *x) {
+        power_l<l-1>::apply(a, b, prefac, scale, accumulate, x);
+        double re = 0.;
+        double im = 0.;
+        power_m<l, 2*l+1>::apply(a, b, re, im);
+        double f = scale*prefac[l];
+        if (accumulate) {
+            x[2*l] += f*re;
+            x[2*l+1] += f*im;
+        }
+        else {
+            x[2*l] = f*re;
+            x[2*l+1] = f*im;
+        }
+    }
+};
+
+template<>
+struct power_l<-1>
+{
+    static inline void apply(const double *a, const double *b, const double *prefac,
+        double scale, bool accumulate, double *x) {;}
+};
+
+template<int N, int L>
+static void power_nl(int, int, const cmplx_t *q1, const cmplx_t *q2,
+        const double *prefac, double scale, bool accumulate, cmplx_t *xnkl) {
+    const double *a = as_doubles(q1);
+    const double *b = as_doubles(q2);
+    double *x = as_doubles(xnkl);
+    for (int n = 0; n < N; ++n) {
+        for (int k = 0; k < N; ++k) {
+            power_l<L>::apply(a + 2*n*lm_size(L), b + 2*k*lm_size(L), prefac, scale, accumulate,
+                x + 2*(n*N+k)*(L+1));
+        }
+    }
+}
+
+// The merge is a contiguous stream over lm per (n, l), which the compiler
+// vectorizes better than an unrolled sequence: specialized on the bounds only
+template<int N, int L>
+static void merge_nl(int, int, const double *radial, const cmplx_t *angular,
+        double scale, cmplx_t *qnlm) {
+    merge_body(N, L, radial, angular, scale, qnlm);
+}
+
+template<int N, int L>
+static void merge_grad_nl(int, int, const double *radial, const double *dradial,
+        const cmplx_t *angular, const cmplx_t *dangular,
+        double weight, double weight_scale, double dweight_scale, cmplx_t *dqnlm) {
+    merge_grad_body(N, L, radial, dradial, angular, dangular, weight, weight_scale, dweight_scale, dqnlm);
+}
+
+// ==========
+// DISPATCHER
+// ==========
+
+#define SOAP_NL_KERNELS_ENTRY(N, L) { N, L, &power_nl<N, L>, &merge_nl<N, L>, &merge_grad_nl<N, L> },
+
+static const nlm_kernels_t NLM_KERNELS_SPECIALIZED[] = {
+    SOAP_NL_SPECIALIZATIONS(SOAP_NL_KERNELS_ENTRY)
+};
+
+static const nlm_kernels_t NLM_KERNELS_GENERIC = {
+    -1, -1, &power_generic, &merge_generic, &merge_grad_generic
+};
+
+#undef SOAP_NL_KERNELS_ENTRY
+
+const nlm_kernels_t *nlm_kernels_resolve(int N, int L) {
+    int n_specialized = sizeof(NLM_KERNELS_SPECIALIZED)/sizeof(nlm_kernels_t);
+    for (int i = 0; i < n_specialized; ++i) {
+        if (NLM_KERNELS_SPECIALIZED[i].N == N && NLM_KERNELS_SPECIALIZED[i].L == L) {
+            return &NLM_KERNELS_SPECIALIZED[i];
+        }
+    }
+    return &NLM_KERNELS_GENERIC;
+}
+
+const nlm_kernels_t *nlm_kernels_generic() {
+    return &NLM_KERNELS_GENERIC;
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef _SOAP_NLMKERNELS_HPP
+#define _SOAP_NLMKERNELS_HPP
+
+#include <complex>
+
+namespace soap {
+
+// Inner loops of BasisExpansion and PowerExpansion on raw (row-major)
+// coefficient arrays:
+// o qnlm (N, (L+1)^2) with column l*l+l+m
+// o xnkl (N*N, L+1) with row n*N+k
+// o radial (N, L+1), angular ((L+1)^2)
+// Kernels specialized at compile time on (N, L) fully unroll the (l, m)
+// contraction of the power spectrum and fix the bounds of the merges, all
+// other sizes take the generic path with runtime bounds. Both evaluate the
+// same expressions in the same order.
+//
+// Specialized sizes as X(N, L) pairs, may be overridden at compile time:
+// -D'SOAP_NL_SPECIALIZATIONS(X)=X(9,6) X(12,9) X(...)'
+#ifndef SOAP_NL_SPECIALIZATIONS
+#define SOAP_NL_SPECIALIZATIONS(X) X(9,6) X(12,9)
+#endif
+
+struct nlm_kernels_t
+{
+    typedef std::complex<double> cmplx_t;
+    int N; // <- -1 for the generic path
+    int L;
+    // xnkl(n*N+k, l) (+)= scale*prefac[l]*sum_m q1(n,lm)*conj(q2(k,lm))
+    void (*power)(int N, int L, const cmplx_t *q1, const cmplx_t *q2,
+        const double *prefac, double scale, bool accumulate, cmplx_t *xnkl);
+    // qnlm(n,lm) = radial(n,l)*angular(lm)*scale
+    void (*merge)(int N, int L, const double *radial, const cmplx_t *angular,
+        double scale, cmplx_t *qnlm);
+    // dqnlm(n,lm) = weight*(weight_scale*radial(n,l)*dangular(lm)
+    //     + weight_scale*dradial(n,l)*angular(lm) + dweight_scale*radial(n,l)*angular(lm))
+    void (*merge_grad)(int N, int L, const double *radial, const double *dradial,
+        const cmplx_t *angular, const cmplx_t *dangular,
+        double weight, double weight_scale, double dweight_scale, cmplx_t *dqnlm);
+};
+
+// Specialized kernels for (N, L) if available, otherwise the generic ones
+const nlm_kernels_t *nlm_kernels_resolve(int N, int L);
+const nlm_kernels_t *nlm_kernels_generic();
+
+}
+
+#endif /* _SOAP_NLMKERNELS_HPP */
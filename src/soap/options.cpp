@@ -9,6 +9,10 @@ Options::Options() :
 	// Set defaults
     this->set("spectrum.gradients", false);
     this->set("spectrum.2l1_norm", true);
+    this->set("spectrum.arena", true);
+    this->set("spectrum.memory_budget", 0.);
+    this->set("spectrum.basis_cache", false);
+    this->set("spectrum.half_neighbour_list", false);
 	this->set("radialbasis.type", "gaussian");
 	this->set("radialbasis.mode", "equispaced");
 	this->set("radialbasis.N", 9);
@@ -24,6 +28,36 @@ Options::Options() :
 	this->set("densitygrid.dx", 0.15);
 }
 
+SpectrumConfig::SpectrumConfig() :
+    N(-1), L(-1), integration_steps(-1), sigma(0.), Rc(0.), Rc_width(0.), center_weight(1.),
+    gradients(false), sqrt_2l1_norm(true), arena(true), memory_budget(0.), basis_cache(false), half_neighbour_list(false),
+    exclude_centers(false), exclude_targets(false) {
+    ;
+}
+
+void SpectrumConfig::resolve(Options &options) {
+    radialbasis_type = options.get<std::string>("radialbasis.type");
+    radialbasis_mode = options.get<std::string>("radialbasis.mode");
+    angularbasis_type = options.get<std::string>("angularbasis.type");
+    cutoff_type = options.get<std::string>("radialcutoff.type");
+    N = options.get<int>("radialbasis.N");
+    L = options.get<int>("angularbasis.L");
+    integration_steps = options.get<int>("radialbasis.integration_steps");
+    sigma = options.get<double>("radialbasis.sigma");
+    Rc = options.get<double>("radialcutoff.Rc");
+    Rc_width = options.get<double>("radialcutoff.Rc_width");
+    center_weight = options.get<double>("radialcutoff.center_weight");
+    gradients = options.get<bool>("spectrum.gradients");
+    sqrt_2l1_norm = options.get<bool>("spectrum.2l1_norm");
+    arena = (options.hasKey("spectrum.arena")) ? options.get<bool>("spectrum.arena") : true; // <- absent in older archives
+    memory_budget = (options.hasKey("spectrum.memory_budget")) ? options.get<double>("spectrum.memory_budget") : 0.;
+    basis_cache = (options.hasKey("spectrum.basis_cache")) ? options.get<bool>("spectrum.basis_cache") : false;
+    half_neighbour_list = (options.hasKey("spectrum.half_neighbour_list")) ? options.get<bool>("spectrum.half_neighbour_list") : false;
+    exclude_centers = options.hasCenterExclusions();
+    exclude_targets = options.hasTargetExclusions();
+    return;
+}
+
 //template<typename return_t>
 //return_t Options::get(std::string key) {
 	//return soap::lexical_cast<return_t, std::string>(_key_value_map[key], "wrong or missing type in " + key);
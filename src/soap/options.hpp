@@ -28,6 +28,7 @@ public:
     void set(std::string key, int value) { this->set(key, boost::lexical_cast<std::string>(value)); }
     void set(std::string key, double value) { this->set(key, boost::lexical_cast<std::string>(value)); }
     bool hasKey(std::string key) { return (_key_value_map.find(key) == _key_value_map.end()) ? false : true; }
+    const map_options_t &getKeyValueMap() { return _key_value_map; }
     //void set(std::string key, bool value) { this->set(key, boost::lexical_cast<std::string>(value)); }
 	//void configureCenters(boost::python::list center_excludes) { _center_excludes = center_excludes; }
 	std::string summarizeOptions();
@@ -46,6 +47,8 @@ public:
 	bool doExcludeTargetId(int pid);
 	boost::python::list getExcludeCenterIdList() { return _exclude_center_id_list; }
 	boost::python::list getExcludeTargetIdList() { return _exclude_target_id_list; }
+	bool hasCenterExclusions() { return _exclude_center.size() || _exclude_center_id.size(); }
+	bool hasTargetExclusions() { return _exclude_target.size() || _exclude_target_id.size(); }
 
     // USED IN SERIALIZATION-LOAD: std::map TO boost::python::list
     void generateExclusionLists();
@@ -87,6 +90,37 @@ private:
     boost::python::list _exclude_target_id_list;
 };
 
+// Typed snapshot of the options used by the compute kernels, resolved once
+// (see Basis, Spectrum) rather than parsed from strings on every access.
+// Options changed after resolving are not picked up.
+struct SpectrumConfig
+{
+    SpectrumConfig();
+    void resolve(Options &options);
+
+    // Basis
+    std::string radialbasis_type;
+    std::string radialbasis_mode;
+    std::string angularbasis_type;
+    std::string cutoff_type;
+    int N;
+    int L;
+    int integration_steps;
+    double sigma;
+    double Rc;
+    double Rc_width;
+    double center_weight;
+    // Spectrum
+    bool gradients;
+    bool sqrt_2l1_norm; // <- spectrum.2l1_norm, normalization sqrt(8\pi^2/(2l+1))
+    bool arena; // <- spectrum.arena, place atomic expansions in the spectrum's arena
+    double memory_budget; // <- spectrum.memory_budget in MB, 0: unlimited
+    bool basis_cache; // <- spectrum.basis_cache, opt-in: share bases between spectra through BasisCache
+    bool half_neighbour_list; // <- spectrum.half_neighbour_list, expand each center-center pair once
+    bool exclude_centers; // <- any center exclusions (by type or id)
+    bool exclude_targets; // <- any target exclusions (by type or id)
+};
+
 }
 
 #endif
@@ -5,16 +5,22 @@ namespace soap {
 
 const std::string PowerExpansion::_numpy_t = "complex128";
 
-PowerExpansion::PowerExpansion(Basis *basis) :
+PowerExpansion::PowerExpansion(Basis *basis, base::Arena *arena) :
     _basis(basis),
     _L(basis->getAngBasis()->L()),
     _N(basis->getRadBasis()->N()),
     _has_gradients(false) {
+    if (arena) {
+        _coeff.setArena(arena);
+        _coeff_grad_x.setArena(arena);
+        _coeff_grad_y.setArena(arena);
+        _coeff_grad_z.setArena(arena);
+    }
 
     _has_scalars = true;
     _coeff = coeff_zero_t(_N*_N, _L+1);
 
-    _with_sqrt_2l_1_norm = _basis->getOptions()->get<bool>("spectrum.2l1_norm");  // With/without normalization sqrt(8\pi^2/(2l+1))
+    _with_sqrt_2l_1_norm = _basis->getConfig().sqrt_2l1_norm;  // With/without normalization sqrt(8\pi^2/(2l+1))
 
 }
 
@@ -70,85 +76,42 @@ void PowerExpansion::computeCoefficientsGradients(BasisExpansion *basex1, BasisE
     BasisExpansion::coeff_t &qnlm = basex->getCoefficients();
 
     // Compute
-    if (same_types) {
-        for (int n = 0; n < _N; ++n) {
-            for (int k = 0; k < _N; ++k) {
-                for (int l = 0; l < (_L+1); ++l) {
-                    dtype_t c_nkl_dx = 0.0;
-                    dtype_t c_nkl_dy = 0.0;
-                    dtype_t c_nkl_dz = 0.0;
-                    for (int m = -l; m <= l; ++m) {
-                        int lm = l*l+l+m;
-                        c_nkl_dx += dqnlm_dx(n,lm)*std::conj(qnlm(k,lm))
-                                 + qnlm(n,lm)*std::conj(dqnlm_dx(k,lm));
-                        c_nkl_dy += dqnlm_dy(n,lm)*std::conj(qnlm(k,lm))
-                                 + qnlm(n,lm)*std::conj(dqnlm_dy(k,lm));
-                        c_nkl_dz += dqnlm_dz(n,lm)*std::conj(qnlm(k,lm))
-                                 + qnlm(n,lm)*std::conj(dqnlm_dz(k,lm));
-                    }
-                    double prefac_2l_1 = (_with_sqrt_2l_1_norm) ? 2.*sqrt(2.)*M_PI/sqrt(2.*l+1) : 1.; // Normalization = sqrt(8\pi^2/(2l+1))
-                    _coeff_grad_x(n*_N+k, l) = prefac_2l_1*c_nkl_dx;
-                    _coeff_grad_y(n*_N+k, l) = prefac_2l_1*c_nkl_dy;
-                    _coeff_grad_z(n*_N+k, l) = prefac_2l_1*c_nkl_dz;
-                }
-            }
+    const nlm_kernels_t *kernels = _basis->getKernels();
+    const double *prefac = _basis->getPowerPrefactors();
+    BasisExpansion::coeff_t *dqnlm[3] = { &dqnlm_dx, &dqnlm_dy, &dqnlm_dz };
+    coeff_t *dxnkl[3] = { &_coeff_grad_x, &_coeff_grad_y, &_coeff_grad_z };
+    for (int i = 0; i < 3; ++i) {
+        const dtype_t *dq = &dqnlm[i]->data()[0];
+        const dtype_t *q = &qnlm.data()[0];
+        dtype_t *dx = &dxnkl[i]->data()[0];
+        if (same_types) {
+            kernels->power(_N, _L, dq, q, prefac, 1., false, dx);
+            kernels->power(_N, _L, q, dq, prefac, 1., true, dx);
         }
-    } else {
-        for (int n = 0; n < _N; ++n) {
-            for (int k = 0; k < _N; ++k) {
-                for (int l = 0; l < (_L+1); ++l) {
-                    dtype_t c_nkl_dx = 0.0;
-                    dtype_t c_nkl_dy = 0.0;
-                    dtype_t c_nkl_dz = 0.0;
-                    if (grad_first) {
-                        for (int m = -l; m <= l; ++m) {
-                            int lm = l*l+l+m;
-                            c_nkl_dx += dqnlm_dx(n,lm)*std::conj(qnlm(k,lm));
-                            c_nkl_dy += dqnlm_dy(n,lm)*std::conj(qnlm(k,lm));
-                            c_nkl_dz += dqnlm_dz(n,lm)*std::conj(qnlm(k,lm));
-                        }
-                    }
-                    else {
-                        for (int m = -l; m <= l; ++m) {
-                            int lm = l*l+l+m;
-                            c_nkl_dx += qnlm(n,lm)*std::conj(dqnlm_dx(k,lm));
-                            c_nkl_dy += qnlm(n,lm)*std::conj(dqnlm_dy(k,lm));
-                            c_nkl_dz += qnlm(n,lm)*std::conj(dqnlm_dz(k,lm));
-                        }
-                    }
-                    double prefac_2l_1 = (_with_sqrt_2l_1_norm) ? 2.*sqrt(2.)*M_PI/sqrt(2.*l+1) : 1.; // Normalization = sqrt(8\pi^2/(2l+1))
-                    _coeff_grad_x(n*_N+k, l) = prefac_2l_1*c_nkl_dx;
-                    _coeff_grad_y(n*_N+k, l) = prefac_2l_1*c_nkl_dy;
-                    _coeff_grad_z(n*_N+k, l) = prefac_2l_1*c_nkl_dz;
-                }
-            }
+        else if (grad_first) {
+            kernels->power(_N, _L, dq, q, prefac, 1., false, dx);
         }
-    } // not same_types
+        else {
+            kernels->power(_N, _L, q, dq, prefac, 1., false, dx);
+        }
+    }
     return;
 }
 
+void PowerExpansion::zeroGradient() {
+    _has_gradients = true;
+    _coeff_grad_x = coeff_zero_t(_N*_N, _L+1);
+    _coeff_grad_y = coeff_zero_t(_N*_N, _L+1);
+    _coeff_grad_z = coeff_zero_t(_N*_N, _L+1);
+}
+
 void PowerExpansion::computeCoefficientsHermConj(BasisExpansion *basex1, BasisExpansion *basex2, double scale) {
     if (!_basis) throw soap::base::APIError("PowerExpansion::computeCoefficientsHermConj, basis not initialised.");
 
-    BasisExpansion::coeff_t &coeff1 = basex1->getCoefficients();
-    BasisExpansion::coeff_t &coeff2 = basex2->getCoefficients();
-    for (int n = 0; n < _N; ++n) {
-        for (int k = 0; k < _N; ++k) {
-            for (int l = 0; l < (_L+1); ++l) {
-                //std::cout << n << " " << k << " " << l << " : " << std::flush;
-                dtype_t c_nkl = 0.0;
-                for (int m = -l; m <= l; ++m) {
-                    //std::cout << m << " " << std::flush;
-                    c_nkl += coeff1(n, l*l+l+m)*std::conj(coeff2(k, l*l+l+m));
-                }
-                //c_nkl = 0.5*(c_nkl + std::conj(c_nkl)); // = c_nkl.real()
-                double prefac_2l_1 = (_with_sqrt_2l_1_norm) ? 2.*sqrt(2.)*M_PI/sqrt(2.*l+1) : 1.; // Normalization = sqrt(8\pi^2/(2l+1))
-                _coeff(n*_N+k, l) = prefac_2l_1*scale*c_nkl;
-                //std::cout << std::endl;
-            }
-        }
-    }
-    //throw soap::base::APIError("");
+    const double *prefac = _basis->getPowerPrefactors();
+    _basis->getKernels()->power(_N, _L,
+        &basex1->getCoefficients().data()[0], &basex2->getCoefficients().data()[0],
+        prefac, scale, false, &_coeff.data()[0]);
     return;
 }
 
@@ -157,31 +120,22 @@ void PowerExpansion::computeCoefficients(BasisExpansion *basex1, BasisExpansion
     //assert(basex1->hasGradients() == false); // <- Not a requirement, just to check this function is used in the intended manner
     //assert(basex2->hasGradients() == false);
 
-    BasisExpansion::coeff_t &coeff1 = basex1->getCoefficients();
-    BasisExpansion::coeff_t &coeff2 = basex2->getCoefficients();
-    for (int n = 0; n < _N; ++n) {
-        for (int k = 0; k < _N; ++k) {
-            for (int l = 0; l < (_L+1); ++l) {
-                //std::cout << n << " " << k << " " << l << " : " << std::flush;
-                dtype_t c_nkl = 0.0;
-                for (int m = -l; m <= l; ++m) {
-                    //std::cout << m << " " << std::flush;
-                    c_nkl += coeff1(n, l*l+l+m)*std::conj(coeff2(k, l*l+l+m));
-                }
-                double prefac_2l_1 = (_with_sqrt_2l_1_norm) ? 2.*sqrt(2.)*M_PI/sqrt(2.*l+1) : 1.; // Normalization = sqrt(8\pi^2/(2l+1))
-                _coeff(n*_N+k, l) = prefac_2l_1*c_nkl;
-                //std::cout << std::endl;
-            }
-        }
-    }
-    //throw soap::base::APIError("");
+    const double *prefac = _basis->getPowerPrefactors();
+    _basis->getKernels()->power(_N, _L,
+        &basex1->getCoefficients().data()[0], &basex2->getCoefficients().data()[0],
+        prefac, 1., false, &_coeff.data()[0]);
     return;
 }
 
+size_t PowerExpansion::getMemoryUsage() {
+    return (_coeff.data().size() + _coeff_grad_x.data().size()
+        + _coeff_grad_y.data().size() + _coeff_grad_z.data().size())*sizeof(dtype_t);
+}
+
 void PowerExpansion::add(PowerExpansion *other) {
     assert(other->_basis == _basis &&
         "Should not sum expansions linked against different bases.");
-    _coeff = _coeff + other->_coeff;
+    _coeff += other->_coeff;
     return;
 }
 
@@ -18,14 +18,14 @@ class PowerExpansion
 {
 public:
     typedef std::complex<double> dtype_t;
-	typedef ub::matrix< dtype_t > coeff_t;
-	typedef ub::zero_matrix< dtype_t > coeff_zero_t;
+	typedef linalg::aligned_matrix< dtype_t > coeff_t;
+	typedef linalg::aligned_zero_matrix< dtype_t > coeff_zero_t;
 
 	static const std::string _numpy_t;
     static constexpr double IMAG_EPSILON = 1e-15;
 
 	PowerExpansion() : _basis(NULL), _L(-1), _N(-1), _has_scalars(false), _has_gradients(false) {;}
-    PowerExpansion(Basis *basis);
+    PowerExpansion(Basis *basis, base::Arena *arena = NULL); // <- coefficient storage from arena if given
 
     Basis *getBasis() { return _basis; }
     coeff_t &getCoefficients() { return _coeff; }
@@ -35,7 +35,9 @@ public:
     void computeCoefficients(BasisExpansion *basex1, BasisExpansion *basex2);
     void computeCoefficientsHermConj(BasisExpansion *basex1, BasisExpansion *basex2, double scale);
     void computeCoefficientsGradients(BasisExpansion *dqnlm, BasisExpansion *qnlm, bool same_types);
+    void zeroGradient();
     void add(PowerExpansion *other);
+    size_t getMemoryUsage(); // <- bytes of coefficient storage
     void writeDensity(std::string filename, Options *options, Structure *structure, Particle *center);
 
     void setCoefficientsNumpy(boost::python::object &np_array);
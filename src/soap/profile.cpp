@@ -0,0 +1,60 @@
+#include <map>
+#include <memory>
+#include <mutex>
+#include "soap/base/profile.hpp"
+
+namespace soap { namespace base {
+
+namespace {
+
+struct profile_registry_t
+{
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<ProfileEntry> > entries;
+};
+
+profile_registry_t &registry() {
+    static profile_registry_t *reg = new profile_registry_t(); // <- outlives static destructors
+    return *reg;
+}
+
+}
+
+ProfileEntry &Profiler::entry(const std::string &name) {
+    profile_registry_t &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::unique_ptr<ProfileEntry> &ptr = reg.entries[name];
+    if (!ptr) ptr.reset(new ProfileEntry(name));
+    return *ptr;
+}
+
+std::vector<profile_record_t> Profiler::report() {
+    profile_registry_t &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::vector<profile_record_t> records;
+    for (auto it = reg.entries.begin(); it != reg.entries.end(); ++it) {
+        profile_record_t record;
+        record.name = it->first;
+        record.calls = it->second->calls.load(std::memory_order_relaxed);
+        record.time = 1e-9*it->second->nanoseconds.load(std::memory_order_relaxed);
+        record.count = it->second->count.load(std::memory_order_relaxed);
+        records.push_back(record);
+    }
+    return records;
+}
+
+void Profiler::reset() {
+    profile_registry_t &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (auto it = reg.entries.begin(); it != reg.entries.end(); ++it) it->second->reset();
+}
+
+bool Profiler::isEnabled() {
+#ifdef SOAP_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+}}
@@ -1,4 +1,5 @@
 #include <math.h>
+#include <algorithm>
 #include <boost/math/special_functions/erf.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/io.hpp>
@@ -17,6 +18,23 @@ namespace soap {
 
 namespace ub = boost::numeric::ublas;
 
+// G <- T*G in place, one column at a time (same summation order as ub::prod)
+static void transform_in_place(const ub::matrix<double> &T, RadialBasis::radcoeff_t &G, std::vector<double> &col) {
+    int N = G.size1();
+    int L1 = G.size2();
+    const double *t = &T.data()[0];
+    double *g = &G.data()[0];
+    col.resize(N);
+    for (int l = 0; l < L1; ++l) {
+        for (int j = 0; j < N; ++j) col[j] = g[j*L1+l];
+        for (int i = 0; i < N; ++i) {
+            double s = 0.;
+            for (int j = 0; j < N; ++j) s += t[i*N+j]*col[j];
+            g[i*L1+l] = s;
+        }
+    }
+}
+
 // ======================
 // RadialBasis BASE CLASS
 // ======================
@@ -311,7 +329,8 @@ void RadialBasisGaussian::computeCoefficients(
 			    Gnl(n, l) = gn_at_r;
 			}
 		}
-		Gnl = ub::prod(_Tij, Gnl);
+		std::vector<double> col;
+		transform_in_place(_Tij, Gnl, col);
 	}
 	else {
 		// Particle properties
@@ -320,6 +339,10 @@ void RadialBasisGaussian::computeCoefficients(
 		SphericalGaussian gi_sph(vec(0,0,0), particle_sigma); // <- position should not matter, as only normalization used here
 		double norm_g_dV_sph_i = gi_sph._norm_g_dV;
 
+		// Integrals per l, reset for each k
+		std::vector<double> integrals(Gnl.size2(), 0.);
+		std::vector<double> integrals_derivative((gradients) ? Gnl.size2() : 0, 0.);
+
 		int k = 0;
 		basis_it_t it;
 		for (it = _basis.begin(), k = 0; it != _basis.end(); ++it, ++k) {
@@ -350,10 +373,8 @@ void RadialBasisGaussian::computeCoefficients(
 			// Compute integrals S r^2 dr i_l(2*ai*ri*r) exp(-beta_ik*(r-rho_ik)^2)
 			// and (derivative) S 2*ai*r^3 dr i_l(2*ai*ri*r) exp(-beta_ik*(r-rho_ik)^2)
 			if (gradients) {
-			    std::vector<double> integrals;
-                integrals.resize(Gnl.size2(), 0.);
-                std::vector<double> integrals_derivative;
-			    integrals_derivative.resize(Gnl.size2(), 0.);
+			    std::fill(integrals.begin(), integrals.end(), 0.);
+			    std::fill(integrals_derivative.begin(), integrals_derivative.end(), 0.);
 			    compute_integrals_il_expik_r2_dr(
                     ai, ri, beta_ik, rho_ik, Gnl.size2(), _integration_steps,
                     &integrals, &integrals_derivative);
@@ -366,8 +387,7 @@ void RadialBasisGaussian::computeCoefficients(
                 }
 			}
 			else {
-			    std::vector<double> integrals;
-                integrals.resize(Gnl.size2(), 0.);
+			    std::fill(integrals.begin(), integrals.end(), 0.);
                 compute_integrals_il_expik_r2_dr(
                     ai, ri, beta_ik, rho_ik, Gnl.size2(), _integration_steps,
                     &integrals, NULL);
@@ -384,11 +404,12 @@ void RadialBasisGaussian::computeCoefficients(
 //		    }
 //		}
 
-		Gnl = ub::prod(_Tij, Gnl);
+		std::vector<double> col;
+		transform_in_place(_Tij, Gnl, col);
 		if (gradients) {
-		    (*dGnl_dx) = ub::prod(_Tij, *dGnl_dx);
-		    (*dGnl_dy) = ub::prod(_Tij, *dGnl_dy);
-		    (*dGnl_dz) = ub::prod(_Tij, *dGnl_dz);
+		    transform_in_place(_Tij, *dGnl_dx, col);
+		    transform_in_place(_Tij, *dGnl_dy, col);
+		    transform_in_place(_Tij, *dGnl_dz, col);
 		}
 	}
     return;
@@ -10,6 +10,7 @@
 #include "soap/base/objectfactory.hpp"
 #include "soap/options.hpp"
 #include "soap/functions.hpp"
+#include "soap/linalg/tensor.hpp"
 
 namespace soap {
 
@@ -24,8 +25,8 @@ namespace ub = boost::numeric::ublas;
 class RadialBasis
 {
 public:
-	typedef ub::matrix<double> radcoeff_t;
-	typedef ub::zero_matrix<double> radcoeff_zero_t;
+	typedef linalg::aligned_matrix<double> radcoeff_t;
+	typedef linalg::aligned_zero_matrix<double> radcoeff_zero_t;
 
 	virtual ~RadialBasis() {;}
 
@@ -582,6 +582,10 @@ class KernelAdaptorGeneric(object):
         dX_dy = dX_dy/mag_X - np.dot(X, dX_dy)/mag_X**3 * X
         dX_dz = dX_dz/mag_X - np.dot(X, dX_dz)/mag_X**3 * X
         return dX_dx, dX_dy, dX_dz
+    def adaptSensitivities(self, X, dE_dX_norm):
+        # NOTE X is not normalized (=> X = X'); returns dE/dX'
+        mag_X = np.dot(X,X)**0.5
+        return dE_dX_norm/mag_X - np.dot(X, dE_dX_norm)/mag_X**3 * X
 
 class KernelAdaptorGlobalGeneric(object):
     def __init__(self, options, types_global=None):
@@ -624,6 +628,10 @@ class KernelAdaptorGlobalGeneric(object):
         dX_dy = dX_dy/mag_X - np.dot(X, dX_dy)/mag_X**3 * X
         dX_dz = dX_dz/mag_X - np.dot(X, dX_dz)/mag_X**3 * X
         return dX_dx, dX_dy, dX_dz
+    def adaptSensitivities(self, X, dE_dX_norm):
+        # NOTE X is not normalized (=> X = X'); returns dE/dX'
+        mag_X = np.dot(X,X)**0.5
+        return dE_dX_norm/mag_X - np.dot(X, dE_dX_norm)/mag_X**3 * X
 
 class KernelFunctionGaussianDiff(object):
     def __init__(self, options):
@@ -971,11 +979,40 @@ class KernelPotential(object):
                 #raw_input('...')
         return forces
 
+    def computeForcesAdjoint(self, structure):
+        # Same as ::computeForces, but contracts dE/dX with the density gradients
+        # in C++ rather than materializing the power-spectrum gradients. The
+        # spectrum is computed without density gradients: these are recomputed
+        # neighbour by neighbour in the backward pass and never stored.
+        # Only the generic-coherent power spectrum has sensitivities in C++.
+        if not hasattr(self.adaptor, 'adaptSensitivities'):
+            raise NotImplementedError("Adjoint forces require the 'generic' or 'global-generic' adaptor, not '%s'" \
+                % self.options.get('kernel.adaptor'))
+        logging.info("Compute forces (adjoint) on %d particles ..." % structure.n_particles)
+        gradients = self.options.get('spectrum.gradients')
+        self.options.set('spectrum.gradients', False)
+        try:
+            spectrum = soap.Spectrum(structure, self.options, self.basis)
+        finally:
+            self.options.set('spectrum.gradients', gradients)
+        spectrum.compute()
+        spectrum.computePower()
+        if self.use_global_spectrum:
+            atomic_global = spectrum.computeGlobal()
+            spectrum_iter = [ atomic_global ]
+        else:
+            spectrum_iter = spectrum
+        dE_dX = []
+        for atomic in spectrum_iter:
+            X_unnorm, X_norm = self.adaptor.adaptScalar(atomic)
+            dIC = self.kernelfct.computeDerivativeOuter(self.IX, X_norm)
+            alpha_dIC = self.alpha.dot(dIC)
+            dE_dX.append(self.adaptor.adaptSensitivities(X_unnorm, alpha_dIC))
+        forces = spectrum.computeForcesAdjoint(np.array(dE_dX), self.use_global_spectrum)
+        return [ forces[i] for i in range(structure.n_particles) ]
+
 def restore_positions(structure, positions):
-    idx = 0
-    for part in structure:
-        part.pos = positions[idx]
-        idx += 1
+    structure.setPositions(np.array(positions))
     return [ part.pos for part in structure ]
 
 def perturb_positions(structure, exclude_pid=[]):
@@ -1005,14 +1042,11 @@ def apply_force_step(structure, forces, scale, constrain_particles=[]):
     if max_f > max_step: scale = scale*max_step/max_f
     else: pass
     #print "Scale =", scale
-    idx = -1
-    for part in structure:
-        idx += 1
-        if part.id in constrain_particles:
-            print "Skip force step, pid =", part.id
-            continue
-        #if np.random.uniform(0.,1.) > 0.5: continue
-        part.pos = part.pos + scale*forces[idx]
+    step = scale*np.array(forces)
+    for pid in constrain_particles:
+        print "Skip force step, pid =", pid
+        step[pid-1] = 0.
+    structure.setPositions(structure.positions + step)
     return [ part.pos for part in structure ]
 
 def apply_force_norm_step(structure, forces, scale, constrain_particles=[]):
@@ -39,8 +39,7 @@ class SimSpaceNode(object):
         self.pid_X_norm = {}
         self.pid_nbpid_dX = {}
     def assignPositions(self, x0, compute=True):
-        for idx, part in enumerate(self.structure):
-            part.pos = x0[idx]
+        self.structure.setPositions(x0)
         if compute: self.acquire()
         return
     def randomizePositions(self, scale=0.1, zero_pids=[0], compute=True):
@@ -53,10 +52,8 @@ class SimSpaceNode(object):
         x0 = np.random.uniform(-1.*scale, +1.*scale, (self.structure.n_particles, 3))
         for pid in zero_pids:
             x0[pid-1,:] = 0.
-        for idx, part in enumerate(self.structure):
-            pos = part.pos
-            part.pos = part.pos + x0[idx]
-            x0[idx] = part.pos
+        x0 = self.structure.positions + x0
+        self.structure.setPositions(x0)
         if compute: self.acquire()
         return x0
     def acquire(self, reset=True):
@@ -1,31 +1,83 @@
 #include <fstream>
+#include <set>
+#include <algorithm>
 #include <boost/format.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 
 #include "soap/spectrum.hpp"
+#include "soap/linalg/numpy.hpp"
+#include "soap/base/profile.hpp"
 
 namespace soap {
 
+namespace {
+
+// Footprint of an atomic spectrum after computePower, from the neighbours
+// found so far (see AtomicSpectrum::estimateMemory), for spectrum.memory_budget
+struct atomic_footprint_t
+{
+    atomic_footprint_t() : n_pids(0), bytes(0) {;}
+    // Adds a neighbour image, returns the growth in bytes
+    size_t add(int N, int L, bool gradients, const std::string &type, bool new_pid, bool virial) {
+        types.insert(type);
+        if (virial) virial_types.insert(type);
+        n_pids += new_pid;
+        size_t bytes_prev = bytes;
+        bytes = AtomicSpectrum::estimateMemory(N, L, types.size(), n_pids, virial_types.size(),
+            gradients, false).total();
+        return bytes - bytes_prev;
+    }
+    std::set<std::string> types;
+    std::set<std::string> virial_types; // <- of images carrying gradients
+    int n_pids;
+    size_t bytes;
+};
+
+}
+
+// Candidates c = (target, image) of a center with their connections, and the
+// n_within of these inside the cutoff: idx[j] = c with distance and weights
+struct neighbour_list_t
+{
+    std::vector<int> cand_target; // <- index into the targets
+    std::vector<vec> cand_dr;
+    std::vector<double> cand_d2;
+    std::vector<char> cand_is_center;
+    std::vector<int> idx;
+    std::vector<double> r_within;
+    std::vector<double> weight_scale;
+    std::vector<double> dweight_scale;
+    int n_within;
+};
+
 Spectrum::Spectrum(Structure &structure, Options &options) :
-    _log(NULL), _options(&options), _structure(&structure), _own_basis(true), _global_atomic(NULL) {
+    _log(NULL), _options(&options), _structure(&structure), _own_basis(true), _cached_basis(false), _arena(new base::Arena()), _global_atomic(NULL), _targets_valid(false) {
 	GLOG() << "Configuring spectrum ..." << std::endl;
-	// CREATE & CONFIGURE BASIS
-	_basis = new Basis(&options);
+	// CREATE & CONFIGURE BASIS, SHARED WITH OTHER SPECTRA IF CACHED
+	if (options.hasKey("spectrum.basis_cache") && options.get<bool>("spectrum.basis_cache")) {
+		_basis = BasisCache::get(options);
+		_own_basis = false;
+		_cached_basis = true;
+	}
+	else {
+		_basis = new Basis(&options);
+	}
+	_config.resolve(options); // <- as adjusted by the basis
 }
 
 Spectrum::Spectrum(Structure &structure, Options &options, Basis &basis) :
-	_log(NULL), _options(&options), _structure(&structure), _basis(&basis), _own_basis(false), _global_atomic(NULL) {
-	;
+	_log(NULL), _options(&options), _structure(&structure), _basis(&basis), _own_basis(false), _cached_basis(false), _arena(new base::Arena()), _global_atomic(NULL), _targets_valid(false) {
+	_config.resolve(options);
 }
 
 Spectrum::Spectrum(std::string archfile) :
-	_log(NULL), _options(NULL), _structure(NULL), _basis(NULL), _own_basis(true), _global_atomic(NULL) {
+	_log(NULL), _options(NULL), _structure(NULL), _basis(NULL), _own_basis(true), _cached_basis(false), _arena(new base::Arena()), _global_atomic(NULL), _targets_valid(false) {
 	this->load(archfile);
 }
 
 Spectrum::Spectrum() :
-	_log(NULL), _options(NULL), _structure(NULL), _basis(NULL), _own_basis(true), _global_atomic(NULL) { 
+	_log(NULL), _options(NULL), _structure(NULL), _basis(NULL), _own_basis(true), _cached_basis(false), _arena(new base::Arena()), _global_atomic(NULL), _targets_valid(false) { 
     ;
 }
 
@@ -36,6 +88,17 @@ Spectrum::~Spectrum() {
 		delete _basis;
 		_basis = NULL;
 	}
+	else if (_cached_basis) {
+		BasisCache::release(_basis);
+		_basis = NULL;
+	}
+	this->clean();
+	delete _arena;
+	_arena = NULL;
+}
+
+void Spectrum::clean() {
+	this->assertNoArrayViews();
 	atomspec_array_t::iterator it;
 	for (it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
 		delete *it;
@@ -46,6 +109,10 @@ Spectrum::~Spectrum() {
 
 	if (_global_atomic) delete _global_atomic;
 	_global_atomic = NULL;
+	_targets.clear();
+	_targets_valid = false;
+	// Nothing placed in the arena is referenced any more
+	_arena->release();
 }
 
 void Spectrum::compute() {
@@ -61,25 +128,49 @@ void Spectrum::compute(Segment *center, Segment *target) {
 }
 
 void Spectrum::compute(Structure::particle_array_t &centers, Structure::particle_array_t &targets) {
-    GLOG() << "Compute spectrum "
+    SOAP_PROFILE_SCOPE("spectrum.compute");
+    GLOG_AT(logINFO) << "Compute spectrum "
         << "(centers " << centers.size() << ", targets " << targets.size() << ") ..." << std::endl;
-    GLOG() << _options->summarizeOptions() << std::endl;
-    GLOG() << "Using radial basis of type '" << _basis->getRadBasis()->identify() << "'" << std::endl;
-    GLOG() << "Using angular basis of type '" << _basis->getAngBasis()->identify() << "'" << std::endl;
-    GLOG() << "Using cutoff function of type '" << _basis->getCutoff()->identify() << "'" << std::endl;
+    GLOG_AT(logINFO) << _options->summarizeOptions() << std::endl;
+    GLOG_AT(logINFO) << "Using radial basis of type '" << _basis->getRadBasis()->identify() << "'" << std::endl;
+    GLOG_AT(logINFO) << "Using angular basis of type '" << _basis->getAngBasis()->identify() << "'" << std::endl;
+    GLOG_AT(logINFO) << "Using cutoff function of type '" << _basis->getCutoff()->identify() << "'" << std::endl;
 
-    Structure::particle_it_t pit;
-    for (pit = centers.begin(); pit != centers.end(); ++pit) {
-        // Continue if exclusion defined ...
-        if (_options->doExcludeCenter((*pit)->getType()) ||
-            _options->doExcludeCenterId((*pit)->getId())) continue;
-        // Compute ...
-        AtomicSpectrum *atomic_spectrum = this->computeAtomic(*pit, targets);
-        this->addAtomic(atomic_spectrum);
+    // With a memory budget, the footprint predicted from the neighbours is
+    // checked center by center, before expanding, and nothing is kept on failure
+    size_t budget_bytes = (_config.memory_budget > 0.) ? this->getMemoryUsage().total() : 0;
+    size_t *budget = (_config.memory_budget > 0.) ? &budget_bytes : NULL;
+    int n_atomic = _atomspec_array.size();
+    if (n_atomic == 0) {
+        _targets = targets;
+        _targets_valid = true;
+    }
+    else if (!(_targets_valid && _targets == targets)) {
+        _targets_valid = false; // <- atomic spectra over different targets
+    }
+    try {
+        if (_config.half_neighbour_list && &centers == &targets) {
+            this->computeHalf(centers, budget);
+            return;
+        }
+        Structure::particle_it_t pit;
+        for (pit = centers.begin(); pit != centers.end(); ++pit) {
+            // Continue if exclusion defined ...
+            if (_config.exclude_centers && (_options->doExcludeCenter((*pit)->getType()) ||
+                _options->doExcludeCenterId((*pit)->getId()))) continue;
+            // Compute ...
+            AtomicSpectrum *atomic_spectrum = this->computeAtomic(*pit, targets, budget);
+            this->addAtomic(atomic_spectrum);
+        }
+    }
+    catch (soap::base::MemoryBudgetExceeded &) {
+        this->removeAtomics(n_atomic);
+        throw;
     }
 }
 
 void Spectrum::computePower() {
+    SOAP_PROFILE_SCOPE("spectrum.power");
     atomspec_array_t::iterator it;
     for (it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
         (*it)->computePower();
@@ -88,6 +179,20 @@ void Spectrum::computePower() {
 }
 
 void Spectrum::computePowerGradients() {
+    SOAP_PROFILE_SCOPE("spectrum.power_gradients");
+    this->assertNoArrayViews(); // <- before any atomic spectrum is recomputed
+    if (_config.memory_budget > 0.) {
+        // Exact from the neighbour lists, replaces power gradients present
+        int N = _basis->getRadBasis()->N();
+        int L = _basis->getAngBasis()->L();
+        size_t bytes = this->getMemoryUsage().total();
+        for (auto it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
+            bytes -= (*it)->getMemoryUsage().power_gradients;
+            bytes += AtomicSpectrum::estimateMemory(N, L, (*it)->getQnlmMap().size(),
+                (*it)->getQnlmGradPids().size(), 0, true, true).power_gradients;
+        }
+        this->checkMemoryBudget(bytes, "<Spectrum::computePowerGradients>");
+    }
     for (auto it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
         (*it)->computePowerGradients();
     }
@@ -98,9 +203,11 @@ AtomicSpectrum *Spectrum::computeAtomic(Particle *center) {
 }
 
 AtomicSpectrum *Spectrum::computeAtomic(Particle *center, Structure::particle_array_t &targets) {
-    GLOG() << "Compute atomic spectrum for particle " << center->getId()
-        << " (type " << center->getType() << ", targets " << targets.size() << ") ..." << std::endl;
+    size_t budget_bytes = (_config.memory_budget > 0.) ? this->getMemoryUsage().total() : 0;
+    return this->computeAtomic(center, targets, (_config.memory_budget > 0.) ? &budget_bytes : NULL);
+}
 
+void Spectrum::findNeighbours(Particle *center, Structure::particle_array_t &targets, neighbour_list_t &nbs) {
     // FIND IMAGE REPITIONS REQUIRED TO SATISFY CUTOFF
     vec box_a = _structure->getBoundary()->getBox().getCol(0);
     vec box_b = _structure->getBoundary()->getBox().getCol(1);
@@ -116,15 +223,26 @@ AtomicSpectrum *Spectrum::computeAtomic(Particle *center, Structure::particle_ar
     //GLOG() << rc << std::endl;
     //GLOG() << na_max << " " << nb_max << " " << nc_max << std::endl;
 
-    // CREATE BLANK
-    AtomicSpectrum *atomic_spectrum = new AtomicSpectrum(center, this->_basis);
+    // MINIMUM-IMAGE CONNECTIONS CENTER -> TARGETS, IN ONE BATCH
+    SOAP_PROFILE_SCOPE("spectrum.neighbours");
+    int n_targets = targets.size();
+    std::vector<vec> dr_targets(n_targets);
+    if (&targets == &_structure->particles()) {
+        _structure->connectMany(center->getPos(), _structure->getPositions(), n_targets, dr_targets.data(), NULL);
+    }
+    else {
+        std::vector<vec> r_targets(n_targets);
+        for (int t = 0; t < n_targets; ++t) r_targets[t] = targets[t]->getPos();
+        _structure->connectMany(center->getPos(), r_targets.data(), n_targets, dr_targets.data(), NULL);
+    }
 
-    Structure::particle_it_t pit;
-    for (pit = targets.begin(); pit != targets.end(); ++pit) { // TODO Consider images
+    // CANDIDATES (TARGET x IMAGE) WITH SQUARED DISTANCES
+    for (int t = 0; t < n_targets; ++t) { // TODO Consider images
+        Particle *target = targets[t];
 
         // CHECK FOR EXCLUSIONS
-        if (_options->doExcludeTarget((*pit)->getType()) ||
-            _options->doExcludeTargetId((*pit)->getId())) continue;
+        if (_config.exclude_targets && (_options->doExcludeTarget(target->getType()) ||
+            _options->doExcludeTargetId(target->getId()))) continue;
 
     for (int na=-na_max; na<na_max+1; ++na) {
     for (int nb=-nb_max; nb<nb_max+1; ++nb) {
@@ -132,51 +250,551 @@ AtomicSpectrum *Spectrum::computeAtomic(Particle *center, Structure::particle_ar
 
         //GLOG() << na << " " << nb << " " << nc << std::endl;
         vec L = na*box_a + nb*box_b + nc*box_c;
+        vec dr = dr_targets[t] + L;
+        nbs.cand_target.push_back(t);
+        nbs.cand_dr.push_back(dr);
+        nbs.cand_d2.push_back(dr*dr);
+        nbs.cand_is_center.push_back(target == center && na==0 && nb==0 && nc==0); // TODO Consider images
+
+    }}} // Close loop over images
+    } // Close loop over particles
+
+    // CHECK CUTOFF, APPLY CUTOFF (= WEIGHT REDUCTION), IN ONE BATCH
+    int n_cand = nbs.cand_target.size();
+    nbs.idx.resize(n_cand);
+    nbs.r_within.resize(n_cand);
+    nbs.weight_scale.resize(n_cand);
+    nbs.dweight_scale.resize(n_cand);
+    nbs.n_within = _basis->getCutoff()->computeWeights(n_cand, nbs.cand_d2.data(),
+        nbs.idx.data(), nbs.r_within.data(), nbs.weight_scale.data(), nbs.dweight_scale.data());
+    SOAP_PROFILE_COUNT("spectrum.pairs_visited", n_cand);
+    SOAP_PROFILE_COUNT("spectrum.pairs_accepted", nbs.n_within);
+}
 
-        // FIND DISTANCE & DIRECTION, CHECK CUTOFF
-        vec dr = _structure->connect(center->getPos(), (*pit)->getPos()) + L;  // TODO Consider images
-        double r = soap::linalg::abs(dr);
-        if (! this->_basis->getCutoff()->isWithinCutoff(r)) continue;
-        vec d = (r > 0.) ? dr/r : vec(0.,0.,1.);
-
-        // APPLY CUTOFF (= WEIGHT REDUCTION)
-        bool is_image = (*pit == center);
-        bool is_center = (*pit == center && na==0 && nb==0 && nc==0); // TODO Consider images
-        double weight0 = (*pit)->getWeight();
-        double weight_scale = _basis->getCutoff()->calculateWeight(r);
-        if (is_center) {
-            weight0 *= _basis->getCutoff()->getCenterWeight();
+void Spectrum::computeNeighbourExpansion(Structure::particle_array_t &targets, neighbour_list_t &nbs,
+        int j, bool gradients, BasisExpansion &nb_expansion) {
+    int c = nbs.idx[j];
+    Particle *target = targets[nbs.cand_target[c]];
+    const vec &dr = nbs.cand_dr[c];
+    double r = nbs.r_within[j];
+    vec d = (r > 0.) ? dr/r : vec(0.,0.,1.);
+    double weight0 = target->getWeight();
+    if (nbs.cand_is_center[c]) {
+        weight0 *= _basis->getCutoff()->getCenterWeight();
+    }
+    GLOG_DEBUG() << target->getType() << " X " << dr.getX() << " Y " << dr.getY() << " Z " << dr.getZ() << " W " << target->getWeight() << " S " << target->getSigma() << std::endl;
+    nb_expansion.computeCoefficients(r, d, weight0, nbs.weight_scale[j], nbs.dweight_scale[j]*d,
+        target->getSigma(), gradients);
+}
+
+AtomicSpectrum *Spectrum::computeAtomic(Particle *center, Structure::particle_array_t &targets, size_t *budget_bytes) {
+    GLOG_AT(logINFO) << "Compute atomic spectrum for particle " << center->getId()
+        << " (type " << center->getType() << ", targets " << targets.size() << ") ..." << std::endl;
+    neighbour_list_t nbs;
+    this->findNeighbours(center, targets, nbs);
+
+    // CHECK BUDGET, CREATE BLANK
+    if (budget_bytes) {
+        atomic_footprint_t footprint;
+        int N = _basis->getRadBasis()->N();
+        int L = _basis->getAngBasis()->L();
+        int t_prev = -1;
+        for (int j = 0; j < nbs.n_within; ++j) {
+            int c = nbs.idx[j];
+            Particle *target = targets[nbs.cand_target[c]];
+            *budget_bytes += footprint.add(N, L, _config.gradients, target->getType(),
+                nbs.cand_target[c] != t_prev && target != center, !nbs.cand_is_center[c]);
+            t_prev = nbs.cand_target[c];
+        }
+        this->checkMemoryBudget(*budget_bytes, "<Spectrum::computeAtomic>");
+    }
+    AtomicSpectrum *atomic_spectrum = new AtomicSpectrum(center, this->_basis, (_config.arena) ? _arena : NULL);
+    if (_config.gradients) {
+        // One gradient block per neighbour other than the center, images adjacent
+        int n_nb = 0;
+        int t_prev = -1;
+        for (int j = 0; j < nbs.n_within; ++j) {
+            int t = nbs.cand_target[nbs.idx[j]];
+            n_nb += (t != t_prev && targets[t] != center);
+            t_prev = t;
         }
+        atomic_spectrum->reserveNeighbours(n_nb);
+    }
 
-        GLOG() << (*pit)->getType() << " X " << dr.getX() << " Y " << dr.getY() << " Z " << dr.getZ() << " W " << (*pit)->getWeight() << " S " << (*pit)->getSigma() << std::endl;
+    // Scratch expansions reused for all neighbours, with and without gradients
+    // (an expansion that has computed gradients keeps doing so)
+    BasisExpansion nb_expansion_grad(this->_basis);
+    BasisExpansion nb_expansion_scalar(this->_basis);
+    SOAP_PROFILE_SCOPE("spectrum.expansions");
+    int n_with_gradients = 0;
+    for (int j = 0; j < nbs.n_within; ++j) {
+        int c = nbs.idx[j];
+        Particle *target = targets[nbs.cand_target[c]];
 
         // COMPUTE EXPANSION & ADD TO SPECTRUM
-        bool gradients = (is_image) ? false : _options->get<bool>("spectrum.gradients");
-        BasisExpansion *nb_expansion = new BasisExpansion(this->_basis); // <- kept by AtomicSpectrum
-        nb_expansion->computeCoefficients(r, d, weight0, weight_scale, (*pit)->getSigma(), gradients);
-        atomic_spectrum->addQnlmNeighbour(*pit, nb_expansion); // TODO Consider images
-
-    }}} // Close loop over images
-    } // Close loop over particles
+        // Periodic images of the center do not move relative to the center,
+        // but still require gradients for the virial (see AtomicSpectrum::addQnlmNeighbour)
+        bool gradients = (nbs.cand_is_center[c]) ? false : _config.gradients;
+        BasisExpansion &nb_expansion = (gradients) ? nb_expansion_grad : nb_expansion_scalar;
+        n_with_gradients += gradients;
+        this->computeNeighbourExpansion(targets, nbs, j, gradients, nb_expansion);
+        atomic_spectrum->addQnlmNeighbour(target, nb_expansion, nbs.cand_dr[c], &_nb_index); // TODO Consider images
+    }
+    atomic_spectrum->releaseNeighbourIndex(_nb_index);
+    SOAP_PROFILE_COUNT("basis.expansions", nbs.n_within);
+    SOAP_PROFILE_COUNT("basis.expansions_with_gradients", n_with_gradients);
 
     return atomic_spectrum;
 }
 
+void Spectrum::computeHalf(Structure::particle_array_t &particles, size_t *budget_bytes) {
+    // Each pair (i, j > i) within the cutoff is expanded once, as seen from i,
+    // and added to j with the parity of the spherical harmonics and the weight
+    // of i (see BasisExpansion::assignInverted). The radial part depends on the
+    // sigma of the neighbour, so pairs with different sigmas (or a neighbour
+    // of weight zero) are expanded from both ends as in computeAtomic.
+    GLOG_AT(logINFO) << "Compute atomic spectra with half neighbour list "
+        << "(particles " << particles.size() << ") ..." << std::endl;
+    vec box_a = _structure->getBoundary()->getBox().getCol(0);
+    vec box_b = _structure->getBoundary()->getBox().getCol(1);
+    vec box_c = _structure->getBoundary()->getBox().getCol(2);
+    double rc = _basis->getCutoff()->getCutoff();
+    std::vector<int> na_nb_nc = _structure->getBoundary()->calculateRepetitions(rc);
+    int na_max = na_nb_nc[0];
+    int nb_max = na_nb_nc[1];
+    int nc_max = na_nb_nc[2];
+
+    // CREATE BLANKS, FLAG TARGETS
+    int n_particles = particles.size();
+    std::vector<AtomicSpectrum*> atomic(n_particles, NULL);
+    std::vector<char> is_target(n_particles, true);
+    std::vector<vec> r_particles(n_particles);
+    for (int i = 0; i < n_particles; ++i) {
+        Particle *particle = particles[i];
+        r_particles[i] = particle->getPos();
+        if (_config.exclude_targets && (_options->doExcludeTarget(particle->getType()) ||
+            _options->doExcludeTargetId(particle->getId()))) is_target[i] = false;
+        if (_config.exclude_centers && (_options->doExcludeCenter(particle->getType()) ||
+            _options->doExcludeCenterId(particle->getId()))) continue;
+        atomic[i] = new AtomicSpectrum(particle, this->_basis, (_config.arena) ? _arena : NULL);
+        this->addAtomic(atomic[i]);
+    }
+
+    std::vector<vec> dr_targets(n_particles);
+    std::vector<int> cand_target;
+    std::vector<vec> cand_dr;
+    std::vector<double> cand_d2;
+    std::vector<char> cand_is_center;
+    std::vector<int> idx;
+    std::vector<double> r_within;
+    std::vector<double> weight_scale;
+    std::vector<double> dweight_scale;
+    BasisExpansion nb_expansion_grad(this->_basis);
+    BasisExpansion nb_expansion_scalar(this->_basis);
+    BasisExpansion nb_expansion_inverted(this->_basis);
+    // Neighbour lookups: _nb_index for i (which only gains j >= i while i is
+    // visited), nb_index_j for i as seen from the j at hand (reset for every j)
+    std::vector<int> nb_index_j;
+    std::vector<atomic_footprint_t> footprints((budget_bytes) ? n_particles : 0);
+    for (int i = 0; i < n_particles; ++i) {
+        Particle *center = particles[i];
+        int pid_i = center->getId();
+        int n_within = 0;
+        {
+        SOAP_PROFILE_SCOPE("spectrum.neighbours");
+        // CONNECTIONS i -> j >= i, CANDIDATES (j x IMAGE) NEEDED BY EITHER END
+        int n_targets = n_particles - i;
+        _structure->connectMany(r_particles[i], &r_particles[i], n_targets, dr_targets.data(), NULL);
+        cand_target.clear();
+        cand_dr.clear();
+        cand_d2.clear();
+        cand_is_center.clear();
+        for (int t = 0; t < n_targets; ++t) {
+            int j = i + t;
+            if (!(atomic[i] && is_target[j]) && !(j != i && atomic[j] && is_target[i])) continue;
+        for (int na=-na_max; na<na_max+1; ++na) {
+        for (int nb=-nb_max; nb<nb_max+1; ++nb) {
+        for (int nc=-nc_max; nc<nc_max+1; ++nc) {
+            vec dr = dr_targets[t] + na*box_a + nb*box_b + nc*box_c;
+            cand_target.push_back(j);
+            cand_dr.push_back(dr);
+            cand_d2.push_back(dr*dr);
+            cand_is_center.push_back(j == i && na==0 && nb==0 && nc==0);
+        }}} // Close loop over images
+        } // Close loop over particles
+
+        // CHECK CUTOFF, APPLY CUTOFF (= WEIGHT REDUCTION), IN ONE BATCH
+        int n_cand = cand_target.size();
+        idx.resize(n_cand);
+        r_within.resize(n_cand);
+        weight_scale.resize(n_cand);
+        dweight_scale.resize(n_cand);
+        n_within = _basis->getCutoff()->computeWeights(n_cand, cand_d2.data(),
+            idx.data(), r_within.data(), weight_scale.data(), dweight_scale.data());
+        SOAP_PROFILE_COUNT("spectrum.pairs_visited", n_cand);
+        SOAP_PROFILE_COUNT("spectrum.pairs_accepted", n_within);
+        }
+
+        // CHECK BUDGET, NOW THAT ALL PAIRS (i, j >= i) ARE KNOWN
+        if (budget_bytes) {
+            int N = _basis->getRadBasis()->N();
+            int L = _basis->getAngBasis()->L();
+            int j_prev = -1;
+            for (int w = 0; w < n_within; ++w) {
+                int c = idx[w];
+                int j = cand_target[c];
+                bool new_pid = (j != j_prev && j != i);
+                j_prev = j;
+                if (atomic[i] && is_target[j]) {
+                    *budget_bytes += footprints[i].add(N, L, _config.gradients, particles[j]->getType(),
+                        new_pid, !cand_is_center[c]);
+                }
+                if (j != i && atomic[j] && is_target[i]) {
+                    *budget_bytes += footprints[j].add(N, L, _config.gradients, center->getType(), new_pid, true);
+                }
+            }
+            this->checkMemoryBudget(*budget_bytes, "<Spectrum::computeHalf>");
+        }
+
+        // After this pass, i gains no more neighbours: reserve its final count
+        if (_config.gradients && atomic[i]) {
+            int n_nb = atomic[i]->getQnlmGradPids().size();
+            int j_prev = -1;
+            for (int w = 0; w < n_within; ++w) {
+                int j = cand_target[idx[w]];
+                n_nb += (j != j_prev && j != i && is_target[j]);
+                j_prev = j;
+            }
+            atomic[i]->reserveNeighbours(n_nb);
+        }
+
+        SOAP_PROFILE_SCOPE("spectrum.expansions");
+        int n_expanded = 0;
+        int n_with_gradients = 0;
+        int n_inverted = 0;
+        int j_prev = -1;
+        for (int w = 0; w < n_within; ++w) {
+            int c = idx[w];
+            int j = cand_target[c];
+            Particle *target = particles[j];
+            if (j != j_prev && pid_i >= 0 && pid_i < nb_index_j.size()) nb_index_j[pid_i] = -1; // <- images of j are adjacent
+            j_prev = j;
+            const vec &dr = cand_dr[c];
+            double r = r_within[w];
+            vec d = (r > 0.) ? dr/r : vec(0.,0.,1.);
+            if (j == i) {
+                // Center and its periodic images, as in computeAtomic
+                bool is_center = cand_is_center[c];
+                double weight0 = target->getWeight();
+                if (is_center) weight0 *= _basis->getCutoff()->getCenterWeight();
+                bool gradients = (is_center) ? false : _config.gradients;
+                BasisExpansion &nb_expansion = (gradients) ? nb_expansion_grad : nb_expansion_scalar;
+                nb_expansion.computeCoefficients(r, d, weight0, weight_scale[w], dweight_scale[w]*d,
+                    target->getSigma(), gradients);
+                atomic[i]->addQnlmNeighbour(target, nb_expansion, dr, &_nb_index);
+                n_expanded += 1;
+                n_with_gradients += gradients;
+                continue;
+            }
+            bool to_i = atomic[i] && is_target[j];
+            bool to_j = atomic[j] && is_target[i];
+            bool gradients = _config.gradients;
+            BasisExpansion &nb_expansion = (gradients) ? nb_expansion_grad : nb_expansion_scalar;
+            // j AS SEEN FROM i
+            if (to_i) {
+                nb_expansion.computeCoefficients(r, d, target->getWeight(), weight_scale[w], dweight_scale[w]*d,
+                    target->getSigma(), gradients);
+                atomic[i]->addQnlmNeighbour(target, nb_expansion, dr, &_nb_index);
+                n_expanded += 1;
+                n_with_gradients += gradients;
+            }
+            // i AS SEEN FROM j, FROM THE SAME EXPANSION IF POSSIBLE
+            if (to_j) {
+                BasisExpansion *nb_expansion_j = &nb_expansion;
+                if (to_i && target->getSigma() == center->getSigma() && target->getWeight() != 0.) {
+                    nb_expansion_inverted.assignInverted(nb_expansion, center->getWeight()/target->getWeight());
+                    nb_expansion_j = &nb_expansion_inverted;
+                    n_inverted += 1;
+                }
+                else {
+                    nb_expansion.computeCoefficients(r, -d, center->getWeight(), weight_scale[w], -dweight_scale[w]*d,
+                        center->getSigma(), gradients);
+                    n_expanded += 1;
+                    n_with_gradients += gradients;
+                }
+                atomic[j]->addQnlmNeighbour(center, *nb_expansion_j, -dr, &nb_index_j);
+            }
+        }
+        if (pid_i >= 0 && pid_i < nb_index_j.size()) nb_index_j[pid_i] = -1;
+        if (atomic[i]) atomic[i]->releaseNeighbourIndex(_nb_index);
+        SOAP_PROFILE_COUNT("basis.expansions", n_expanded);
+        SOAP_PROFILE_COUNT("basis.expansions_with_gradients", n_with_gradients);
+        SOAP_PROFILE_COUNT("basis.expansions_inverted", n_inverted);
+    }
+}
+
 AtomicSpectrum *Spectrum::computeGlobal() {
     if (_global_atomic) throw soap::base::APIError("<Spectrum::computeGlobal> Already initialised.");
-    _global_atomic = new AtomicSpectrum(_basis);
+    SOAP_PROFILE_SCOPE("spectrum.global");
+    if (_config.memory_budget > 0.) {
+        std::set<std::string> types;
+        std::set<int> pids;
+        for (auto it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
+            AtomicSpectrum::map_qnlm_t &map_qnlm = (*it)->getQnlmMap();
+            for (auto jt = map_qnlm.begin(); jt != map_qnlm.end(); ++jt) types.insert(jt->first);
+            pids.insert((*it)->getQnlmGradPids().begin(), (*it)->getQnlmGradPids().end());
+        }
+        spectrum_memory_t predicted = AtomicSpectrum::estimateMemory(_basis->getRadBasis()->N(),
+            _basis->getAngBasis()->L(), types.size(), pids.size(), types.size(), // <- at most one virial per type
+            _config.gradients, _config.gradients);
+        this->checkMemoryBudget(this->getMemoryUsage().total() + predicted.total(), "<Spectrum::computeGlobal>");
+    }
+    _global_atomic = new AtomicSpectrum(_basis, (_config.arena) ? _arena : NULL);
     GLOG() << "Computing global spectrum ..." << std::endl;
-    bool gradients = _options->get<bool>("spectrum.gradients");
+    bool gradients = _config.gradients;
+    if (gradients) {
+        std::set<int> pids;
+        for (auto it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
+            pids.insert((*it)->getQnlmGradPids().begin(), (*it)->getQnlmGradPids().end());
+        }
+        _global_atomic->reserveNeighbours(pids.size());
+    }
     for (auto it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
-        GLOG() << "  Adding center " << (*it)->getCenter()->getId()
+        GLOG_AT(logINFO) << "  Adding center " << (*it)->getCenter()->getId()
             << " (type " << (*it)->getCenter()->getType() << ")" << std::endl;
-        _global_atomic->mergeQnlm(*it, 0.5, gradients); // <- Scale factor 0.5 necessary in order not to overcount pairs
+        _global_atomic->mergeQnlm(*it, 0.5, gradients, &_nb_index); // <- Scale factor 0.5 necessary in order not to overcount pairs
     }
+    _global_atomic->releaseNeighbourIndex(_nb_index);
     _global_atomic->computePower();
     if (gradients) _global_atomic->computePowerGradients();
     return _global_atomic;
 }
 
+spectrum_memory_t Spectrum::getMemoryUsage() {
+    spectrum_memory_t usage;
+    for (auto it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
+        usage += (*it)->getMemoryUsage();
+    }
+    if (_global_atomic) usage += _global_atomic->getMemoryUsage();
+    return usage;
+}
+
+spectrum_memory_t Spectrum::estimateMemory(Structure &structure, Options &options,
+        bool power_gradients, bool global) {
+    return Spectrum::estimateMemory(structure, options, structure.particles(), structure.particles(),
+        power_gradients, global);
+}
+
+spectrum_memory_t Spectrum::estimateMemory(Structure &structure, Options &options,
+        Structure::particle_array_t &centers, Structure::particle_array_t &targets,
+        bool power_gradients, bool global) {
+    // Counts, per center, the density types, the distinct neighbours (with
+    // gradients) and the types of those & of images of the center (virials)
+    // within the cutoff, as computeAtomic would find them
+    int N = options.get<int>("radialbasis.N");
+    int L = options.get<int>("angularbasis.L");
+    double rc = options.get<double>("radialcutoff.Rc");
+    if (options.hasKey("radialcutoff.Rc_heaviside")) rc = options.get<double>("radialcutoff.Rc_heaviside"); // <- see CutoffFunction::configure
+    bool gradients = options.get<bool>("spectrum.gradients");
+    std::vector<int> na_nb_nc = structure.getBoundary()->calculateRepetitions(rc);
+    vec box_a = structure.getBoundary()->getBox().getCol(0);
+    vec box_b = structure.getBoundary()->getBox().getCol(1);
+    vec box_c = structure.getBoundary()->getBox().getCol(2);
+
+    int n_targets = targets.size();
+    std::vector<vec> r_targets(n_targets);
+    std::vector<char> is_excluded(n_targets);
+    for (int t = 0; t < n_targets; ++t) {
+        r_targets[t] = targets[t]->getPos();
+        is_excluded[t] = options.doExcludeTarget(targets[t]->getType())
+            || options.doExcludeTargetId(targets[t]->getId());
+    }
+    std::vector<vec> dr_targets(n_targets);
+    std::set<std::string> types_global;
+    std::set<std::string> virial_types_global;
+    std::set<int> pids_global;
+    spectrum_memory_t usage;
+    for (auto cit = centers.begin(); cit != centers.end(); ++cit) {
+        Particle *center = *cit;
+        if (options.doExcludeCenter(center->getType()) || options.doExcludeCenterId(center->getId())) continue;
+        structure.connectMany(center->getPos(), r_targets.data(), n_targets, dr_targets.data(), NULL);
+        std::set<std::string> types;
+        std::set<std::string> virial_types;
+        int n_pids = 0;
+        for (int t = 0; t < n_targets; ++t) {
+            if (is_excluded[t]) continue;
+            bool is_center = (targets[t] == center);
+            bool within = false;
+            bool within_grad = false; // <- any image that carries gradients
+            for (int na = -na_nb_nc[0]; na <= na_nb_nc[0]; ++na) {
+            for (int nb = -na_nb_nc[1]; nb <= na_nb_nc[1]; ++nb) {
+            for (int nc = -na_nb_nc[2]; nc <= na_nb_nc[2]; ++nc) {
+                vec dr = dr_targets[t] + na*box_a + nb*box_b + nc*box_c;
+                if (dr*dr > rc*rc) continue;
+                within = true;
+                if (!is_center || na != 0 || nb != 0 || nc != 0) within_grad = true;
+            }}}
+            if (!within) continue;
+            types.insert(targets[t]->getType());
+            if (within_grad) virial_types.insert(targets[t]->getType());
+            if (!is_center) {
+                n_pids += 1;
+                if (global) pids_global.insert(targets[t]->getId());
+            }
+        }
+        usage += AtomicSpectrum::estimateMemory(N, L, types.size(), n_pids, virial_types.size(),
+            gradients, power_gradients);
+        if (global) {
+            types_global.insert(types.begin(), types.end());
+            virial_types_global.insert(virial_types.begin(), virial_types.end());
+        }
+    }
+    if (global) {
+        usage += AtomicSpectrum::estimateMemory(N, L, types_global.size(), pids_global.size(),
+            virial_types_global.size(), gradients, gradients);
+    }
+    return usage;
+}
+
+boost::python::dict Spectrum::getMemoryUsagePython() {
+    boost::python::dict usage = this->getMemoryUsage().toPython();
+    usage["arena"] = _arena->getBytesReserved(); // <- chunks backing the above
+    return usage;
+}
+
+boost::python::dict Spectrum::estimateMemoryPython(Structure &structure, Options &options,
+        bool power_gradients, bool global) {
+    return Spectrum::estimateMemory(structure, options, power_gradients, global).toPython();
+}
+
+void Spectrum::checkMemoryBudget(size_t bytes, std::string where) {
+    double mb = bytes/(1024.*1024.);
+    if (_config.memory_budget > 0. && mb > _config.memory_budget) {
+        throw soap::base::MemoryBudgetExceeded((boost::format(
+            "%1$s Needs %2$.1f MB, exceeds spectrum.memory_budget of %3$.1f MB") % where % mb % _config.memory_budget).str());
+    }
+}
+
+void Spectrum::computeForcesAdjoint(ub::matrix<double> &dE_dX, bool global, ub::matrix<double> &forces) {
+    // Forces F = -sum_i dE/dX_i . dX_i/dr from the sensitivities dE/dX_i of the
+    // (unnormalised, real) generic-coherent power spectra, one row per atomic
+    // spectrum (or a single row for the global spectrum), each of length N*N*(L+1).
+    // With spectrum.gradients, the stored density gradients are contracted.
+    // Without, the expansions of the neighbours are recomputed one image at a time
+    // and dropped after use, so that only O(N*(L+1)^2) is held per center.
+    int N = _basis->getRadBasis()->N();
+    int L = _basis->getAngBasis()->L();
+    int n_rows = (global) ? 1 : _atomspec_array.size();
+    if (dE_dX.size1() != n_rows || dE_dX.size2() != N*N*(L+1)) {
+        throw soap::base::APIError("<Spectrum::computeForcesAdjoint> Sensitivities have inconsistent shape.");
+    }
+    if (global && !_global_atomic) {
+        throw soap::base::APIError("<Spectrum::computeForcesAdjoint> Global spectrum not computed.");
+    }
+    forces = ub::zero_matrix<double>(_structure->particles().size(), 3);
+    if (_config.gradients) {
+        if (global) {
+            _global_atomic->computeForcesAdjoint(&dE_dX.data()[0], forces);
+        }
+        else {
+            for (int i = 0; i < n_rows; ++i) {
+                _atomspec_array[i]->computeForcesAdjoint(&dE_dX.data()[i*dE_dX.size2()], forces);
+            }
+        }
+        return;
+    }
+    if (!_targets_valid) {
+        throw soap::base::APIError("<Spectrum::computeForcesAdjoint> Targets of the atomic spectra unknown "
+            "(loaded or computed over different targets), compute with spectrum.gradients instead.");
+    }
+    // The gradients of the global spectrum are the (unscaled) sum over the centers
+    BasisExpansion::coeff_t lambda;
+    if (global) _global_atomic->computeQnlmSensitivity(&dE_dX.data()[0], lambda);
+    for (int i = 0; i < _atomspec_array.size(); ++i) {
+        if (!global) _atomspec_array[i]->computeQnlmSensitivity(&dE_dX.data()[i*dE_dX.size2()], lambda);
+        this->addForcesAdjoint(_atomspec_array[i]->getCenter(), lambda, forces);
+    }
+    return;
+}
+
+void Spectrum::addForcesAdjoint(Particle *center, BasisExpansion::coeff_t &lambda, ub::matrix<double> &forces) {
+    // As AtomicSpectrum::computeForcesAdjoint, for the neighbours of computeAtomic
+    // among the targets of compute (images of the center carry no gradient)
+    Structure::particle_array_t &targets = _targets;
+    neighbour_list_t nbs;
+    this->findNeighbours(center, targets, nbs);
+    BasisExpansion nb_expansion(this->_basis);
+    const std::complex<double> *lambda_d = &lambda.data()[0];
+    int size_lambda = lambda.data().size();
+    int n_with_gradients = 0;
+    for (int j = 0; j < nbs.n_within; ++j) {
+        Particle *target = targets[nbs.cand_target[nbs.idx[j]]];
+        if (target == center) continue;
+        ++n_with_gradients;
+        this->computeNeighbourExpansion(targets, nbs, j, true, nb_expansion);
+        BasisExpansion::coeff_t *dq[3] = {
+            &nb_expansion.getCoefficientsGradX(),
+            &nb_expansion.getCoefficientsGradY(),
+            &nb_expansion.getCoefficientsGradZ() };
+        int pid = target->getId();
+        if (pid < 1 || pid > forces.size1()) {
+            throw soap::base::OutOfRange("<Spectrum::computeForcesAdjoint> Particle id");
+        }
+        for (int d = 0; d < 3; ++d) {
+            forces(pid-1, d) -= linalg::conj_dot(size_lambda, &dq[d]->data()[0], lambda_d).real();
+        }
+    }
+    SOAP_PROFILE_COUNT("basis.expansions_with_gradients", n_with_gradients);
+}
+
+boost::python::object Spectrum::computeForcesAdjointNumpy(boost::python::object &dE_dX, bool global) {
+    soap::linalg::numpy_converter npc("float64");
+    ub::matrix<double> dE_dX_mat;
+    npc.numpy_to_ublas<double>(dE_dX, dE_dX_mat);
+    ub::matrix<double> forces;
+    this->computeForcesAdjoint(dE_dX_mat, global, forces);
+    return npc.ublas_to_numpy<double>(forces);
+}
+
+boost::python::tuple Spectrum::getLinearGradBSR() {
+    // Density gradients of all centers as (data, indices, indptr, shape) with
+    // o data (nnz, 1, 3*N*(L+1)^2) the dQ/dr blocks in AtomicSpectrum::getLinearGradArray order
+    // o indices (nnz,) the neighbour particle index (= id-1)
+    // o indptr (n_centers+1,)
+    // such that scipy.sparse.bsr_matrix((data, indices, indptr), shape=shape)
+    // is the (n_centers, n_particles*3*N*(L+1)^2) Jacobian.
+#if BOOST_VERSION >= 106400
+    namespace np = boost::python::numpy;
+    int N = _basis->getRadBasis()->N();
+    int L = _basis->getAngBasis()->L();
+    int size_block = 3*N*(L+1)*(L+1);
+    int nnz = 0;
+    for (auto it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
+        nnz += (*it)->getQnlmGradPids().size();
+    }
+    np::ndarray data = np::empty(boost::python::make_tuple(nnz, 1, size_block), np::dtype::get_builtin< std::complex<double> >());
+    np::ndarray indices = np::empty(boost::python::make_tuple(nnz), np::dtype::get_builtin<int>());
+    np::ndarray indptr = np::empty(boost::python::make_tuple(_atomspec_array.size()+1), np::dtype::get_builtin<int>());
+    std::complex<double> *data_ptr = reinterpret_cast<std::complex<double>*>(data.get_data());
+    int *indices_ptr = reinterpret_cast<int*>(indices.get_data());
+    int *indptr_ptr = reinterpret_cast<int*>(indptr.get_data());
+    int offset = 0;
+    indptr_ptr[0] = 0;
+    for (int i = 0; i < _atomspec_array.size(); ++i) {
+        std::vector<int> &pids = _atomspec_array[i]->getQnlmGradPids();
+        AtomicSpectrum::qnlm_grad_t &qnlm_grad = _atomspec_array[i]->getQnlmGrad();
+        std::copy(qnlm_grad.begin(), qnlm_grad.end(), data_ptr+offset*size_block);
+        for (int j = 0; j < pids.size(); ++j) indices_ptr[offset+j] = pids[j]-1;
+        offset += pids.size();
+        indptr_ptr[i+1] = offset;
+    }
+    boost::python::tuple shape = boost::python::make_tuple(_atomspec_array.size(), _structure->particles().size()*size_block);
+    return boost::python::make_tuple(data, indices, indptr, shape);
+#else
+    throw soap::base::NotImplemented("Spectrum::getLinearGradBSR requires boost >= 1.64");
+#endif
+}
+
 AtomicSpectrum *Spectrum::getAtomic(int slot_idx, std::string center_type) {
 	AtomicSpectrum *atomic_spectrum = NULL;
 	// FIND SPECTRUM
@@ -279,6 +897,31 @@ void Spectrum::addAtomic(AtomicSpectrum *atomspec) {
 	return;
 }
 
+void Spectrum::deleteGlobal() {
+	if (_global_atomic) {
+		_global_atomic->assertNoArrayViews();
+		delete _global_atomic;
+		_global_atomic = NULL;
+	}
+}
+
+void Spectrum::assertNoArrayViews() {
+	for (auto it = _atomspec_array.begin(); it != _atomspec_array.end(); ++it) {
+		(*it)->assertNoArrayViews();
+	}
+	if (_global_atomic) _global_atomic->assertNoArrayViews();
+}
+
+void Spectrum::removeAtomics(int n_keep) {
+	for (int i = n_keep; i < _atomspec_array.size(); ++i) {
+		atomspec_array_t &array = _map_atomspec_array[_atomspec_array[i]->getCenterType()];
+		array.erase(std::remove(array.begin(), array.end(), _atomspec_array[i]), array.end());
+		if (array.size() == 0) _map_atomspec_array.erase(_atomspec_array[i]->getCenterType());
+		delete _atomspec_array[i];
+	}
+	_atomspec_array.resize(n_keep);
+}
+
 void Spectrum::save(std::string archfile) {
 	std::ofstream ofs(archfile.c_str());
 	boost::archive::binary_oarchive arch(ofs);
@@ -288,6 +931,7 @@ void Spectrum::save(std::string archfile) {
 
 std::string Spectrum::saves(bool prune) {
     if (prune) {
+        this->assertNoArrayViews();
         // Delete all pid-resolved data from atomic spectra.
         // Note that this data is required to compute gradients.
         // Pruning will no longer allow computing gradients
@@ -331,7 +975,7 @@ void Spectrum::registerPython() {
     	.def(init<Structure &, Options &, Basis &>())
     	.def(init<std::string>())
         .def(init<>())
-    	.def("__iter__", range<return_value_policy<reference_existing_object> >(&Spectrum::beginAtomic, &Spectrum::endAtomic))
+    	.def("__iter__", range<return_internal_reference<> >(&Spectrum::beginAtomic, &Spectrum::endAtomic))
         .def("__len__", &Spectrum::length)
 	    .def("compute", computeAll)
         .def("compute", computeSeg)
@@ -339,12 +983,18 @@ void Spectrum::registerPython() {
 	    .def("compute", computeCentersTargets)
 		.def("computePower", &Spectrum::computePower)
 		.def("computePowerGradients", &Spectrum::computePowerGradients)
+		.def("computeForcesAdjoint", &Spectrum::computeForcesAdjointNumpy)
+		.def("getLinearGradBSR", &Spectrum::getLinearGradBSR)
+		.def("getMemoryUsage", &Spectrum::getMemoryUsagePython)
+		.def("estimateMemory", &Spectrum::estimateMemoryPython)
+		.staticmethod("estimateMemory")
         .def("deleteGlobal", &Spectrum::deleteGlobal)
-		.def("computeGlobal", &Spectrum::computeGlobal, return_value_policy<reference_existing_object>())
+		.def("computeGlobal", &Spectrum::computeGlobal, return_internal_reference<>())
 		.def("addAtomic", &Spectrum::addAtomic)
-		.def("getAtomic", &Spectrum::getAtomic, return_value_policy<reference_existing_object>())
-		.def("getGlobal", &Spectrum::getGlobal, return_value_policy<reference_existing_object>())
+		.def("getAtomic", &Spectrum::getAtomic, return_internal_reference<>())
+		.def("getGlobal", &Spectrum::getGlobal, return_internal_reference<>())
 	    .def("saveAndClean", &Spectrum::saveAndClean)
+        .def("clean", &Spectrum::clean)
 		.def("save", &Spectrum::save)
 		.def("load", &Spectrum::load)
         .def("saves", &Spectrum::saves)
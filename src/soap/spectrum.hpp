@@ -19,6 +19,7 @@
 
 namespace soap {
 
+struct neighbour_list_t;
 
 // TODO Spectrum(System1, System2, options) where Sys1 <> Sources, Sys2 <> Targets
 class Spectrum
@@ -46,7 +47,7 @@ public:
     std::string saves(bool prune = true);
 	void load(std::string archfile);
     Spectrum &loads(std::string bstr);
-	void clean();
+	void clean(); // <- deletes all atomic spectra, releases the arena
     int length() { return _atomspec_array.size(); }
 
 	void compute();
@@ -56,7 +57,7 @@ public:
 	AtomicSpectrum *computeAtomic(Particle *center);
 	AtomicSpectrum *computeAtomic(Particle *center, Structure::particle_array_t &targets);
     AtomicSpectrum *computeGlobal();
-	void deleteGlobal() { if (_global_atomic) { delete _global_atomic; _global_atomic = NULL; } }
+	void deleteGlobal();
 	void addAtomic(AtomicSpectrum *atomspec);
 	AtomicSpectrum *getAtomic(int slot_idx, std::string center_type);
 	AtomicSpectrum *getGlobal() { assert(_global_atomic && "Compute first"); return _global_atomic; }
@@ -69,6 +70,22 @@ public:
 	void computePower();
 	void computePowerGradients();
 	void computeLinear();
+	// MEMORY
+	// Coefficient storage held by the atomic & global spectra
+	spectrum_memory_t getMemoryUsage();
+	// Predicted footprint of compute & computePower (+ computePowerGradients, + computeGlobal)
+	// from the neighbours within the cutoff, without expanding any densities
+	static spectrum_memory_t estimateMemory(Structure &structure, Options &options,
+	    bool power_gradients, bool global);
+	static spectrum_memory_t estimateMemory(Structure &structure, Options &options,
+	    Structure::particle_array_t &centers, Structure::particle_array_t &targets,
+	    bool power_gradients, bool global);
+	boost::python::dict getMemoryUsagePython();
+	static boost::python::dict estimateMemoryPython(Structure &structure, Options &options,
+	    bool power_gradients, bool global);
+	void computeForcesAdjoint(ub::matrix<double> &dE_dX, bool global, ub::matrix<double> &forces);
+	boost::python::object computeForcesAdjointNumpy(boost::python::object &dE_dX, bool global);
+	boost::python::tuple getLinearGradBSR();
 
 	static void registerPython();
 
@@ -82,21 +99,55 @@ public:
 		arch & _map_atomspec_array;
 
 		arch & _global_atomic;
+		if (Archive::is_loading::value && _options) _config.resolve(*_options);
+		if (Archive::is_loading::value) _targets_valid = false; // <- not archived
 		return;
 	}
 
 private:
+	// Throws MemoryBudgetExceeded if <bytes> exceed spectrum.memory_budget (if any)
+	void checkMemoryBudget(size_t bytes, std::string where);
+	// Neighbour images of <center> among <targets> within the cutoff, with their weights
+	void findNeighbours(Particle *center, Structure::particle_array_t &targets, neighbour_list_t &nbs);
+	// Expansion of the j-th neighbour image within the cutoff into <nb_expansion>
+	void computeNeighbourExpansion(Structure::particle_array_t &targets, neighbour_list_t &nbs,
+	    int j, bool gradients, BasisExpansion &nb_expansion);
+	// Adds -Re sum_nlm dQ_nlm/dr_j conj(<lambda>_nlm) to the force on each neighbour j
+	// of <center>, recomputing dQ/dr_j image by image rather than reading stored blocks
+	void addForcesAdjoint(Particle *center, BasisExpansion::coeff_t &lambda, ub::matrix<double> &forces);
+	// <budget_bytes>: bytes held & predicted so far, grown by the footprint of each
+	// center as its neighbours are found and checked against spectrum.memory_budget
+	AtomicSpectrum *computeAtomic(Particle *center, Structure::particle_array_t &targets, size_t *budget_bytes);
+	// All <particles> as centers and targets, visiting each pair once (spectrum.half_neighbour_list)
+	void computeHalf(Structure::particle_array_t &particles, size_t *budget_bytes);
+	// Deletes the atomic spectra beyond the first <n_keep>
+	void removeAtomics(int n_keep);
+	// Throws if numpy views onto any atomic spectrum are alive (see AtomicSpectrum::assertNoArrayViews)
+	void assertNoArrayViews();
 
 	Logger *_log;
 	Options *_options;
+	SpectrumConfig _config;
     Structure *_structure;
     Basis *_basis;
     bool _own_basis;
+    bool _cached_basis; // <- acquired from BasisCache, released on destruction
+    // Backs the expansions of the atomic spectra computed here (if _config.arena),
+    // so these are released in one go rather than expansion by expansion
+    base::Arena *_arena;
+    // Pid => neighbour index of the atomic spectrum under construction (or -1),
+    // reset after each (see AtomicSpectrum::releaseNeighbourIndex)
+    std::vector<int> _nb_index;
 
     atomspec_array_t _atomspec_array;
     map_atomspec_array_t _map_atomspec_array;
 
     AtomicSpectrum *_global_atomic;
+    // Targets of compute, which computeForcesAdjoint recomputes the neighbour
+    // expansions over (without spectrum.gradients). Valid only if all atomic
+    // spectra were computed here over the same targets.
+    Structure::particle_array_t _targets;
+    bool _targets_valid;
 };
 
 
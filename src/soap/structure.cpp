@@ -4,7 +4,9 @@
 #define BOOST_LIB_NAME "boost_numpy"
 #include <boost/config/auto_link.hpp>
 #endif
+#include <algorithm>
 #include "soap/structure.hpp"
+#include "soap/elements.hpp"
 
 
 namespace soap {
@@ -14,6 +16,8 @@ namespace soap {
 // ========
 
 void Particle::null() {
+	_structure = NULL;
+	_idx = -1;
 	_id = -1;
 	_pos = vec(0,0,0);
 	_name = "?";
@@ -27,22 +31,32 @@ void Particle::null() {
 
 void Particle::model(Particle &model) {
     // ID assigned internally, so is Segment pointer
-    _pos = model._pos;
+    this->pos() = model.pos();
     _name = model._name;
-    _type_id = model._type_id;
+    this->typeId() = model.typeId();
     _type = model._type;
     _mass = model._mass;
-    _weight = model._weight;
-    _sigma = model._sigma;
+    this->weight() = model.weight();
+    this->sigma() = model.sigma();
+}
+
+void Particle::store() {
+    if (!_structure) return;
+    _pos = this->pos();
+    _type_id = this->typeId();
+    _weight = this->weight();
+    _sigma = this->sigma();
 }
 
 #if BOOST_VERSION >= 106400
 boost::python::numpy::ndarray Particle::getPosNumeric() {
-	boost::python::numpy::ndarray pos(boost::python::numpy::array(boost::python::make_tuple(_pos.x(), _pos.y(), _pos.z()))); return pos;
+	vec &r = this->pos();
+	boost::python::numpy::ndarray pos(boost::python::numpy::array(boost::python::make_tuple(r.x(), r.y(), r.z()))); return pos;
 }
 #else
 boost::python::numeric::array Particle::getPosNumeric() {
-	boost::python::numeric::array pos(boost::python::make_tuple(_pos.x(), _pos.y(), _pos.z())); return pos;
+	vec &r = this->pos();
+	boost::python::numeric::array pos(boost::python::make_tuple(r.x(), r.y(), r.z())); return pos;
 }
 #endif
 
@@ -83,17 +97,17 @@ void Segment::registerPython() {
 // STRUCTURE
 // =========
 
-Structure::Structure(std::string label) {
+Structure::Structure(std::string label) : _n_array_views(0) {
 	this->null();
 	_label = label;
 
 }
 
-Structure::Structure() {
+Structure::Structure() : _n_array_views(0) {
 	this->null();
 }
 
-Structure::Structure(const Structure &structure) {
+Structure::Structure(const Structure &structure) : _n_array_views(0) {
     this->null();
     assert(false && "COPY CONSTRUCTOR NOT AVAILABLE. USE ::model(Structure &) instead.");
 }
@@ -138,6 +152,10 @@ Structure::~Structure() {
 		delete *pit;
 	}
 	_particles.clear();
+	_positions.clear();
+	_type_ids.clear();
+	_weights.clear();
+	_sigmas.clear();
 }
 
 Segment &Structure::addSegment() {
@@ -147,14 +165,139 @@ Segment &Structure::addSegment() {
 	return *new_seg;
 }
 
+void Structure::assertNoArrayViews() {
+	if (_n_array_views > 0) {
+		throw soap::base::APIError("Structure: cannot add particles while views onto the particle arrays "
+			"(positions, type_ids, weights, sigmas) are alive, copy or delete them first");
+	}
+}
+
 Particle &Structure::addParticle(Segment &seg) {
+	this->assertNoArrayViews();
 	int id = _particles.size()+1;
 	Particle *new_part = new Particle(id);
 	_particles.push_back(new_part);
+	this->attach(new_part);
 	seg.addParticle(new_part);
 	return *new_part;
 }
 
+void Structure::attach(Particle *part) {
+	// Move values held by the particle into the arrays
+	part->_idx = _positions.size();
+	part->_structure = this;
+	_positions.push_back(part->_pos);
+	_type_ids.push_back(part->_type_id);
+	_weights.push_back(part->_weight);
+	_sigmas.push_back(part->_sigma);
+}
+
+Segment &Structure::addParticles(int n, const double *xyz, const std::string *types, const int *z,
+	const double *weights, const double *sigmas, const double *masses) {
+	this->assertNoArrayViews();
+	Segment &seg = this->addSegment();
+	int n0 = _particles.size();
+	_particles.reserve(n0+n);
+	seg.particles().reserve(n);
+	_positions.reserve(n0+n);
+	_type_ids.reserve(n0+n);
+	_weights.reserve(n0+n);
+	_sigmas.reserve(n0+n);
+	for (int i = 0; i < n; ++i) {
+		Particle &part = this->addParticle(seg);
+		part.setPos(xyz[3*i+0], xyz[3*i+1], xyz[3*i+2]);
+		int zi = (z) ? z[i] : ((types) ? element_number(types[i]) : 0);
+		if (types) part.setType(types[i]);
+		else if (zi > 0 && zi < element_count()) part.setType(element_get(zi).symbol);
+		part.setName(part.getType());
+		part.setTypeId(zi);
+		if (masses) part.setMass(masses[i]);
+		else part.setMass((zi > 0 && zi < element_count()) ? element_get(zi).mass : 0.);
+		part.setWeight((weights) ? weights[i] : 1.);
+		part.setSigma((sigmas) ? sigmas[i] : 0.5);
+	}
+	return seg;
+}
+
+static_assert(sizeof(vec) == 3*sizeof(double), "vec must be layout-compatible with double[3]");
+
+void Structure::setPositions(const double *xyz) {
+	std::copy(xyz, xyz + 3*_positions.size(), reinterpret_cast<double*>(_positions.data()));
+}
+
+void Structure::setPositionsNumeric(boost::python::object positions) {
+#if BOOST_VERSION >= 106400
+	namespace np = boost::python::numpy;
+	// Copies only if needed to get C-ordered doubles (astype would keep Fortran order)
+	np::ndarray arr = np::from_object(positions, np::dtype::get_builtin<double>(), np::ndarray::C_CONTIGUOUS);
+	if (arr.get_nd() != 2 || arr.shape(0) != this->getNumberOfParticles() || arr.shape(1) != 3) {
+		throw soap::base::APIError("Structure::setPositions: expected array of shape (n_particles, 3)");
+	}
+	this->setPositions(reinterpret_cast<const double*>(arr.get_data()));
+#else
+	throw soap::base::NotImplemented("Structure::setPositions requires boost >= 1.64");
+#endif
+}
+
+class ParticleArrayOwner
+{
+public:
+	// Base object of the numpy views onto the particle arrays of a structure:
+	// keeps the structure alive, and particle creation (which may reallocate
+	// the arrays) refused, for as long as any view exists
+	ParticleArrayOwner(boost::python::object self) : _self(self) {
+		_structure = boost::python::extract<Structure*>(self);
+		++_structure->_n_array_views;
+	}
+   ~ParticleArrayOwner() { --_structure->_n_array_views; }
+	static void registerPython() {
+		boost::python::class_<ParticleArrayOwner, boost::noncopyable>("_ParticleArrayOwner", boost::python::no_init);
+	}
+private:
+	boost::python::object _self;
+	Structure *_structure;
+};
+
+template<typename T>
+static boost::python::object particle_array_view(boost::python::object self, T *ptr, int n, int dim) {
+	// Writable view onto a particle array (see ParticleArrayOwner)
+#if BOOST_VERSION >= 106400
+	namespace np = boost::python::numpy;
+	boost::python::manage_new_object::apply<ParticleArrayOwner*>::type convert;
+	boost::python::object owner(boost::python::handle<>(convert(new ParticleArrayOwner(self))));
+	if (dim > 1) {
+		return np::from_data(ptr, np::dtype::get_builtin<T>(),
+			boost::python::make_tuple(n, dim),
+			boost::python::make_tuple(dim*sizeof(T), sizeof(T)), owner);
+	}
+	return np::from_data(ptr, np::dtype::get_builtin<T>(),
+		boost::python::make_tuple(n), boost::python::make_tuple(sizeof(T)), owner);
+#else
+	throw soap::base::NotImplemented("Particle array views require boost >= 1.64");
+#endif
+}
+
+boost::python::object Structure::getPositionsNumeric(boost::python::object self) {
+	Structure &structure = boost::python::extract<Structure&>(self);
+	return particle_array_view(self, reinterpret_cast<double*>(structure.getPositions()),
+		structure.getNumberOfParticles(), 3);
+}
+
+boost::python::object Structure::getTypeIdsNumeric(boost::python::object self) {
+	Structure &structure = boost::python::extract<Structure&>(self);
+	return particle_array_view(self, structure.getTypeIds(), structure.getNumberOfParticles(), 1);
+}
+
+boost::python::object Structure::getWeightsNumeric(boost::python::object self) {
+	Structure &structure = boost::python::extract<Structure&>(self);
+	return particle_array_view(self, structure.getWeights(), structure.getNumberOfParticles(), 1);
+}
+
+boost::python::object Structure::getSigmasNumeric(boost::python::object self) {
+	Structure &structure = boost::python::extract<Structure&>(self);
+	return particle_array_view(self, structure.getSigmas(), structure.getNumberOfParticles(), 1);
+}
+
 #if BOOST_VERSION >= 106400
 boost::python::numpy::ndarray Structure::connectNumeric(
 	const boost::python::numpy::ndarray &a1,
@@ -177,6 +320,23 @@ boost::python::numeric::array Structure::connectNumeric(
 }
 #endif
 
+void Structure::setBoundary(const double *box, const bool *pbc) {
+	// Fully periodic (<box>), or open (pbc all false, or no box)
+	matrix m;
+	m.ZeroMatrix();
+	bool periodic = (box != NULL);
+	if (box && pbc) {
+		if (pbc[0] != pbc[1] || pbc[0] != pbc[2]) {
+			throw soap::base::NotImplemented("Structure::setBoundary: partial periodicity");
+		}
+		periodic = pbc[0];
+	}
+	if (periodic) {
+		for (int i = 0; i < 3; ++i) for (int j = 0; j < 3; ++j) m.set(i, j, box[3*i+j]);
+	}
+	this->setBoundary(m);
+}
+
 void Structure::setBoundary(const matrix &box) {
 	delete _box;
 	if(box.get(0,0)==0 && box.get(0,1)==0 && box.get(0,2)==0 &&
@@ -229,6 +389,176 @@ boost::python::numeric::array Structure::getBoundaryNumeric() {
 }
 #endif
 
+#if BOOST_VERSION >= 106400
+template<typename T>
+static boost::python::numpy::ndarray structure_cast(boost::python::object obj) {
+	// Contiguous array of T from <obj>. Casts explicitly, since from_object
+	// rejects unsafe casts such as int64 -> int32 (ASE atomic numbers)
+	namespace np = boost::python::numpy;
+	np::ndarray arr = np::array(obj);
+	if (arr.get_dtype() != np::dtype::get_builtin<T>()) arr = arr.astype(np::dtype::get_builtin<T>());
+	return np::from_object(arr, np::dtype::get_builtin<T>(), np::ndarray::C_CONTIGUOUS);
+}
+
+template<typename T>
+static boost::python::numpy::ndarray structure_array(boost::python::object obj, int size, const char *name) {
+	// Contiguous array of T from <obj>, checked for <size> elements
+	namespace np = boost::python::numpy;
+	np::ndarray arr = structure_cast<T>(obj);
+	int arr_size = 1;
+	for (int d = 0; d < arr.get_nd(); ++d) arr_size *= arr.shape(d);
+	if (arr_size != size) {
+		throw soap::base::APIError(std::string("Structure::fromArrays: unexpected size of ")+name);
+	}
+	return arr;
+}
+
+template<typename T>
+static const T *structure_array_data(boost::python::numpy::ndarray &arr) {
+	return reinterpret_cast<const T*>(arr.get_data());
+}
+
+static void structure_species(boost::python::object species, int n,
+	std::vector<std::string> &types, std::vector<int> &z) {
+	// Species as a sequence of strings or array of atomic numbers
+	if (n == 0) return;
+	if (boost::python::extract<std::string>(species[0]).check()) {
+		if (boost::python::len(species) != n) {
+			throw soap::base::APIError("Structure::fromArrays: unexpected size of species");
+		}
+		types.resize(n);
+		for (int i = 0; i < n; ++i) types[i] = boost::python::extract<std::string>(species[i]);
+	}
+	else {
+		// Atomic numbers of any integer width, but no truncated floats
+		std::string kind = boost::python::extract<std::string>(
+			boost::python::numpy::array(species).get_dtype().attr("kind"));
+		if (kind != "i" && kind != "u") {
+			throw soap::base::APIError("Structure::fromArrays: species must be symbols or integer atomic numbers");
+		}
+		boost::python::numpy::ndarray arr = structure_array<int>(species, n, "species");
+		const int *ptr = structure_array_data<int>(arr);
+		z.assign(ptr, ptr+n);
+	}
+}
+#endif
+
+std::vector<Structure*> Structure::createFromArraysPacked(boost::python::object labels,
+	boost::python::object positions, boost::python::object species, boost::python::object offsets,
+	boost::python::object weights, boost::python::object sigmas,
+	boost::python::object boxes, boost::python::object pbc, boost::python::object masses) {
+#if BOOST_VERSION >= 106400
+	namespace np = boost::python::numpy;
+	// OFFSETS
+	int n_structures = boost::python::len(offsets)-1;
+	if (n_structures < 0) throw soap::base::APIError("Structure::fromArrays: offsets must not be empty");
+	np::ndarray offsets_arr = structure_array<int>(offsets, n_structures+1, "offsets");
+	const int *offs = structure_array_data<int>(offsets_arr);
+	int n = offs[n_structures];
+	for (int s = 0; s < n_structures; ++s) {
+		if (offs[s] < 0 || offs[s] > offs[s+1]) {
+			throw soap::base::APIError("Structure::fromArrays: offsets must be non-negative and ascending");
+		}
+	}
+	bool has_labels = !labels.is_none();
+	if (has_labels && boost::python::len(labels) != n_structures) {
+		throw soap::base::APIError("Structure::fromArrays: unexpected number of labels");
+	}
+	// PARTICLE ARRAYS
+	np::ndarray xyz_arr = structure_array<double>(positions, 3*n, "positions");
+	const double *xyz = structure_array_data<double>(xyz_arr);
+	std::vector<std::string> types;
+	std::vector<int> z;
+	structure_species(species, n, types, z);
+	np::ndarray weights_arr = (weights.is_none()) ? xyz_arr : structure_array<double>(weights, n, "weights");
+	const double *w = (weights.is_none()) ? NULL : structure_array_data<double>(weights_arr);
+	np::ndarray sigmas_arr = (sigmas.is_none()) ? xyz_arr : structure_array<double>(sigmas, n, "sigmas");
+	const double *sig = (sigmas.is_none()) ? NULL : structure_array_data<double>(sigmas_arr);
+	np::ndarray masses_arr = (masses.is_none()) ? xyz_arr : structure_array<double>(masses, n, "masses");
+	const double *m = (masses.is_none()) ? NULL : structure_array_data<double>(masses_arr);
+	// BOUNDARIES: shared or per structure
+	const double *box = NULL;
+	int box_stride = 0;
+	np::ndarray boxes_arr = xyz_arr;
+	if (!boxes.is_none()) {
+		boxes_arr = structure_cast<double>(boxes);
+		box_stride = (boxes_arr.get_nd() == 3) ? 9 : 0;
+		boxes_arr = structure_array<double>(boxes_arr, (box_stride) ? 9*n_structures : 9, "box");
+		box = structure_array_data<double>(boxes_arr);
+	}
+	const bool *periodic = NULL;
+	int pbc_stride = 0;
+	np::ndarray pbc_arr = xyz_arr;
+	if (!pbc.is_none()) {
+		pbc_arr = structure_cast<bool>(pbc);
+		pbc_stride = (pbc_arr.get_nd() == 2) ? 3 : 0;
+		pbc_arr = structure_array<bool>(pbc_arr, (pbc_stride) ? 3*n_structures : 3, "pbc");
+		periodic = structure_array_data<bool>(pbc_arr);
+	}
+	// CREATE STRUCTURES
+	std::vector<Structure*> structures;
+	structures.reserve(n_structures);
+	try {
+		for (int s = 0; s < n_structures; ++s) {
+			std::string label = (has_labels) ? boost::python::extract<std::string>(labels[s])() : "?";
+			Structure *structure = new Structure(label);
+			structures.push_back(structure);
+			int i0 = offs[s];
+			structure->setBoundary((box) ? box+s*box_stride : NULL, (periodic) ? periodic+s*pbc_stride : NULL);
+			structure->addParticles(offs[s+1]-i0, xyz+3*i0,
+				(types.size()) ? &types[i0] : NULL,
+				(z.size()) ? &z[i0] : NULL,
+				(w) ? w+i0 : NULL,
+				(sig) ? sig+i0 : NULL,
+				(m) ? m+i0 : NULL);
+		}
+	}
+	catch (...) {
+		for (auto it = structures.begin(); it != structures.end(); ++it) delete *it;
+		throw;
+	}
+	return structures;
+#else
+	throw soap::base::NotImplemented("Structure::fromArrays requires boost >= 1.64");
+#endif
+}
+
+Structure *Structure::fromArrays(std::string label,
+	boost::python::object positions, boost::python::object species,
+	boost::python::object weights, boost::python::object sigmas,
+	boost::python::object box, boost::python::object pbc, boost::python::object masses) {
+	boost::python::list labels;
+	labels.append(label);
+	boost::python::list offsets;
+	offsets.append(0);
+	offsets.append(boost::python::len(positions));
+	return Structure::createFromArraysPacked(labels, positions, species, offsets, weights, sigmas, box, pbc, masses)[0];
+}
+
+boost::python::list Structure::fromArraysPacked(boost::python::object labels,
+	boost::python::object positions, boost::python::object species, boost::python::object offsets,
+	boost::python::object weights, boost::python::object sigmas,
+	boost::python::object boxes, boost::python::object pbc, boost::python::object masses) {
+	std::vector<Structure*> structures = Structure::createFromArraysPacked(labels, positions, species, offsets,
+		weights, sigmas, boxes, pbc, masses);
+	// Hand over ownership to python, structures not yet handed over are deleted on failure
+	boost::python::list py_structures;
+	boost::python::manage_new_object::apply<Structure*>::type convert;
+	int s = 0;
+	try {
+		for ( ; s < structures.size(); ++s) {
+			boost::python::handle<> handle(convert(structures[s]));
+			structures[s] = NULL;
+			py_structures.append(boost::python::object(handle));
+		}
+	}
+	catch (...) {
+		for ( ; s < structures.size(); ++s) delete structures[s];
+		throw;
+	}
+	return py_structures;
+}
+
 void Structure::registerPython() {
 	using namespace boost::python;
 	class_<Structure>("Structure", init<std::string>())
@@ -241,9 +571,22 @@ void Structure::registerPython() {
 	   .add_property("particles", range<return_value_policy<reference_existing_object> >(&Structure::beginParticles, &Structure::endParticles))
 	   .add_property("segments", range<return_value_policy<reference_existing_object> >(&Structure::beginSegments, &Structure::endSegments))
        .add_property("n_particles", &Structure::getNumberOfParticles)
+	   .add_property("positions", &Structure::getPositionsNumeric, &Structure::setPositionsNumeric)
+	   .add_property("type_ids", &Structure::getTypeIdsNumeric)
+	   .add_property("weights", &Structure::getWeightsNumeric)
+	   .add_property("sigmas", &Structure::getSigmasNumeric)
+	   .def("setPositions", &Structure::setPositionsNumeric)
 	   .def("connect", &Structure::connectNumeric)
 	   .add_property("box", &Structure::getBoundaryNumeric, &Structure::setBoundaryNumeric)
 	   .add_property("label", make_function(&Structure::getLabel, copy_non_const()), &Structure::setLabel);
+	def("structure_from_arrays", &Structure::fromArrays,
+		(arg("label"), arg("positions"), arg("species"), arg("weights")=object(),
+		 arg("sigmas")=object(), arg("box")=object(), arg("pbc")=object(), arg("masses")=object()),
+		return_value_policy<manage_new_object>());
+	def("structures_from_arrays", &Structure::fromArraysPacked,
+		(arg("labels"), arg("positions"), arg("species"), arg("offsets"), arg("weights")=object(),
+		 arg("sigmas")=object(), arg("boxes")=object(), arg("pbc")=object(), arg("masses")=object()));
+	ParticleArrayOwner::registerPython();
 	class_<particle_array_t>("ParticleContainer")
 	   .def(vector_indexing_suite<particle_array_t>());
 	class_<segment_array_t>("SegmentContainer")
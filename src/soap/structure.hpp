@@ -28,6 +28,9 @@ namespace soap {
 class Segment;
 class Structure;
 
+// Particles created by a Structure are views onto its contiguous per-particle
+// arrays (position, type id, weight, sigma). Standalone particles store these
+// values themselves.
 class Particle
 {
 public:
@@ -37,14 +40,14 @@ public:
     void null();
     void model(Particle &model);
     // Position
-    void setPos(vec &pos) { _pos = pos; }
-    void setPos(double x, double y, double z) { _pos = vec(x,y,z); }
-    vec &getPos() { return _pos; }
+    void setPos(vec &pos) { this->pos() = pos; }
+    void setPos(double x, double y, double z) { this->pos() = vec(x,y,z); }
+    vec &getPos() { return this->pos(); }
 #if BOOST_VERSION >= 106400
-    void setPosNumeric(const boost::python::numpy::ndarray &pos) { _pos = vec(pos); }
+    void setPosNumeric(const boost::python::numpy::ndarray &pos) { this->pos() = vec(pos); }
     boost::python::numpy::ndarray getPosNumeric();
 #else
-    void setPosNumeric(const boost::python::numeric::array &pos) { _pos = vec(pos); }
+    void setPosNumeric(const boost::python::numeric::array &pos) { this->pos() = vec(pos); }
     boost::python::numeric::array getPosNumeric();
 #endif
     // Name
@@ -54,8 +57,8 @@ public:
     void setId(int id) { _id = id; }
     int getId() { return _id; }
     // Type Id
-    void setTypeId(int id) { _type_id = id; }
-    int &getTypeId() { return _type_id; }
+    void setTypeId(int id) { this->typeId() = id; }
+    int &getTypeId() { return this->typeId(); }
     // Type
     void setType(std::string type) { _type = type; }
     std::string &getType() { return _type; }
@@ -63,11 +66,11 @@ public:
     void setMass(double mass) { _mass = mass; }
     double &getMass() { return _mass; }
     // Weight
-    void setWeight(double weight) { _weight = weight; }
-    double &getWeight() { return _weight; }
+    void setWeight(double weight) { this->weight() = weight; }
+    double &getWeight() { return this->weight(); }
     // Sigma
-    void setSigma(double sigma) { _sigma = sigma; }
-    double &getSigma() { return _sigma; }
+    void setSigma(double sigma) { this->sigma() = sigma; }
+    double &getSigma() { return this->sigma(); }
     // Segment
     Segment *getSegment() { return _segment; }
     
@@ -75,6 +78,8 @@ public:
 
     template<class Archive>
 	void serialize(Archive &arch, const unsigned int version) {
+    	// Values held by the structure are restored by Structure::attach on loading
+    	if (!Archive::is_loading::value) this->store();
     	arch & _segment;
     	arch & _id;
     	arch & _name;
@@ -88,7 +93,16 @@ public:
 	}
 
 private:
+    friend class Structure;
+    vec &pos();
+    int &typeId();
+    double &weight();
+    double &sigma();
+    void store();
+
     Segment *_segment;
+    Structure *_structure; // <- owner of the particle arrays, NULL if standalone
+    int _idx;
     // Labels
     int _id;
     std::string _name;
@@ -169,6 +183,19 @@ public:
     int getNumberOfParticles() { return _particles.size(); }
     Particle *getParticle(int pid) { return _particles[pid-1]; }
 
+    // PARTICLE ARRAYS (indexed by pid-1, reallocated when particles are added,
+    // which is refused while numpy views onto them are alive)
+    vec *getPositions() { return _positions.data(); }
+    int *getTypeIds() { return _type_ids.data(); }
+    double *getWeights() { return _weights.data(); }
+    double *getSigmas() { return _sigmas.data(); }
+    void setPositions(const double *xyz);
+    void setPositionsNumeric(boost::python::object positions);
+    static boost::python::object getPositionsNumeric(boost::python::object self);
+    static boost::python::object getTypeIdsNumeric(boost::python::object self);
+    static boost::python::object getWeightsNumeric(boost::python::object self);
+    static boost::python::object getSigmasNumeric(boost::python::object self);
+
     // SEGMENT CONTAINER
     segment_array_t &segments() { return _segments; }
     segment_it_t beginSegments() { return _segments.begin(); }
@@ -182,11 +209,42 @@ public:
     // PARTICLE CREATION & INTERFACE
     Segment &addSegment();
     Particle &addParticle(Segment &seg);
+    // Bulk creation of <n> particles in a new segment. Species are given as
+    // <types> or atomic numbers <z>: the type id is the atomic number, the
+    // mass taken from the element table unless given. Arrays other than <xyz>
+    // may be NULL (defaults: weight 1, sigma 0.5).
+    Segment &addParticles(int n, const double *xyz, const std::string *types, const int *z,
+        const double *weights, const double *sigmas, const double *masses = NULL);
+    // From numpy arrays: positions (n,3), species (n) as strings or atomic
+    // numbers (any integer dtype), optional weights (n), sigmas (n), box (3,3),
+    // pbc (3) and masses (n). Packed
+    // input stacks the particles of all structures, with structure i
+    // spanning offsets[i]:offsets[i+1]; boxes (n_structures,3,3) and pbc
+    // (n_structures,3) or (3) are then per structure or shared.
+    static Structure *fromArrays(std::string label,
+        boost::python::object positions, boost::python::object species,
+        boost::python::object weights, boost::python::object sigmas,
+        boost::python::object box, boost::python::object pbc, boost::python::object masses);
+    static boost::python::list fromArraysPacked(boost::python::object labels,
+        boost::python::object positions, boost::python::object species, boost::python::object offsets,
+        boost::python::object weights, boost::python::object sigmas,
+        boost::python::object boxes, boost::python::object pbc, boost::python::object masses);
+    // As fromArraysPacked, with the structures owned by the caller. Throws
+    // before any structure is returned, and then keeps none of them.
+    static std::vector<Structure*> createFromArraysPacked(boost::python::object labels,
+        boost::python::object positions, boost::python::object species, boost::python::object offsets,
+        boost::python::object weights, boost::python::object sigmas,
+        boost::python::object boxes, boost::python::object pbc, boost::python::object masses);
 
     // BOUNDARY CREATION & INTERFACE
     Boundary *getBoundary() { return _box; }
     void setBoundary(const matrix &box);
+    void setBoundary(const double *box, const bool *pbc);
     vec connect(const vec &r1, const vec &r2) { return _box->connect(r1, r2); /* 1->2 */ }
+    // Batched connect (see Boundary::connectMany), e.g., of <r1> to all particles:
+    // connectMany(r1, getPositions(), getNumberOfParticles(), dr, d2)
+    void connectMany(const vec &r1, const vec *r2, int n, vec *dr, double *d2) { _box->connectMany(r1, r2, n, dr, d2); }
+    void connectPairs(const vec *r1, const vec *r2, int n, vec *dr, double *d2) { _box->connectPairs(r1, r2, n, dr, d2); }
 #if BOOST_VERSION >= 106400
     void setBoundaryNumeric(const boost::python::numpy::ndarray &m);
     boost::python::numpy::ndarray getBoundaryNumeric();
@@ -211,14 +269,29 @@ public:
     	arch & _segments;
     	arch & _particles;
     	arch & _box;
+    	if (Archive::is_loading::value) {
+    	    for (particle_it_t pit = _particles.begin(); pit != _particles.end(); ++pit) {
+    	        this->attach(*pit);
+    	    }
+    	}
     	return;
     }
 
 private:
+    friend class Particle;
+    friend class ParticleArrayOwner;
+    void attach(Particle *part);
+    void assertNoArrayViews();
+
     int _id;
     std::string _label;
     segment_array_t _segments;
     particle_array_t _particles;
+    std::vector<vec> _positions;
+    std::vector<int> _type_ids;
+    std::vector<double> _weights;
+    std::vector<double> _sigmas;
+    int _n_array_views;
 
     Particle* _center;
     bool _has_center;
@@ -227,6 +300,13 @@ private:
 };
 
 
+
+inline vec &Particle::pos() { return (_structure) ? _structure->_positions[_idx] : _pos; }
+inline int &Particle::typeId() { return (_structure) ? _structure->_type_ids[_idx] : _type_id; }
+inline double &Particle::weight() { return (_structure) ? _structure->_weights[_idx] : _weight; }
+inline double &Particle::sigma() { return (_structure) ? _structure->_sigmas[_idx] : _sigma; }
+
+
 } // soap namespace
 
 /*
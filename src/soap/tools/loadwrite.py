@@ -19,6 +19,11 @@ def structures_from_xyz(xyz_file, **kwargs):
         ase_configs=ase_configs, 
         **kwargs)
 
+def structures_from_xyz_native(xyz_file, n_threads=1):
+    # Read via the native (extended) XYZ reader, bypassing ASE
+    reader = soap.XyzReader(xyz_file)
+    return reader.readChunk(0, len(reader), n_threads)
+
 def structures_from_ase(
         configs, 
         return_all=False, 
@@ -112,6 +117,13 @@ def structure_from_ase(
             pbc=config.pbc)
     else:
         top = [('SEG', 1, len(positions))]
+        if not add_fragment_com:
+            # Fast path: single segment, built natively
+            structure = soap.structure_from_arrays(label, positions, types, box=box)
+            structure.getSegment(1).name = 'SEG'
+            atom_labels = list(types)
+            if log: log << log.endl
+            return config, structure, top, frag_bond_matrix, atom_bond_matrix, frag_labels, atom_labels
     # Check particle count consistent with top
     atom_count = 0
     for section in top:
@@ -220,9 +232,12 @@ def setup_structure_ase(label, ase_config, top=None):
     positions = ase_config.get_positions()
     masses = ase_config.get_masses()
     names = ase_config.get_chemical_symbols()
-    # DEFAULT TOPOLOGY
+    # DEFAULT TOPOLOGY: single segment, built natively (keeps ASE's masses)
     if top == None:
-        top = [('segment', 1, len(positions))]
+        structure = soap.structure_from_arrays(label, positions, types, box=box, masses=masses)
+        structure.getSegment(1).name = 'segment'
+        structure.getSegment(1).type = 'segment'
+        return structure
     # VERIFY PARTICLE COUNT
     atom_count = 0
     for section in top:
@@ -246,7 +261,7 @@ def setup_structure_ase(label, ase_config, top=None):
                 particle.sigma = 0.5
                 particle.name = names[atom_idx]
                 particle.type = names[atom_idx]
-                particle.type_id = types[atom_idx]
+                particle.type_id = int(types[atom_idx]) # <- boost.python accepts numpy integers only where these subclass int
                 atom_idx += 1
     return structure 
 
@@ -0,0 +1,328 @@
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/lexical_cast.hpp>
+
+#include "soap/xyz.hpp"
+
+namespace soap {
+
+typedef std::pair<const char*, const char*> xyz_field_t;
+
+static inline bool xyz_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static void xyz_fields(const char *begin, const char *end, std::vector<xyz_field_t> &fields) {
+    // Whitespace-separated fields of line [begin, end)
+    fields.clear();
+    const char *p = begin;
+    while (p < end) {
+        while (p < end && xyz_is_space(*p)) ++p;
+        if (p == end) break;
+        const char *q = p;
+        while (q < end && !xyz_is_space(*q)) ++q;
+        fields.push_back(xyz_field_t(p, q));
+        p = q;
+    }
+}
+
+static double xyz_double(const xyz_field_t &field) {
+    // The mapped file is not null-terminated, hence the copy
+    char buffer[64];
+    size_t length = field.second - field.first;
+    if (length == 0 || length >= sizeof(buffer)) {
+        throw soap::base::IOError("XyzReader: invalid number '" + std::string(field.first, field.second) + "'");
+    }
+    std::memcpy(buffer, field.first, length);
+    buffer[length] = '\0';
+    char *end = NULL;
+    double value = std::strtod(buffer, &end);
+    if (end != buffer+length) {
+        throw soap::base::IOError("XyzReader: invalid number '" + std::string(buffer) + "'");
+    }
+    return value;
+}
+
+static bool xyz_bool(const std::string &value) {
+    if (value == "T" || value == "True" || value == "true" || value == "1") return true;
+    if (value == "F" || value == "False" || value == "false" || value == "0") return false;
+    throw soap::base::IOError("XyzReader: invalid boolean '" + value + "'");
+}
+
+XyzReader::XyzReader(std::string filename) :
+    _filename(filename), _fd(-1), _data(NULL), _size(0) {
+    _fd = ::open(filename.c_str(), O_RDONLY);
+    if (_fd < 0) throw soap::base::IOError("Bad file handle: " + filename);
+    struct stat st;
+    if (::fstat(_fd, &st) != 0) {
+        ::close(_fd);
+        throw soap::base::IOError("Could not stat file: " + filename);
+    }
+    _size = st.st_size;
+    if (_size > 0) {
+        void *data = ::mmap(NULL, _size, PROT_READ, MAP_SHARED, _fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(_fd);
+            throw soap::base::IOError("Could not map file: " + filename);
+        }
+        _data = static_cast<const char*>(data);
+    }
+    try {
+        this->index();
+    }
+    catch (...) {
+        if (_data) ::munmap(const_cast<char*>(_data), _size);
+        ::close(_fd);
+        throw;
+    }
+}
+
+XyzReader::~XyzReader() {
+    if (_data) ::munmap(const_cast<char*>(_data), _size);
+    if (_fd >= 0) ::close(_fd);
+    _data = NULL;
+    _fd = -1;
+}
+
+const char *XyzReader::lineEnd(const char *p) const {
+    const char *end = _data + _size;
+    const char *nl = static_cast<const char*>(std::memchr(p, '\n', end-p));
+    return (nl) ? nl : end;
+}
+
+void XyzReader::index() {
+    // Frame: atom count, comment line, atom lines. Blank lines between frames are skipped.
+    const char *end = _data + _size;
+    const char *p = _data;
+    std::vector<xyz_field_t> fields;
+    while (p < end) {
+        const char *eol = this->lineEnd(p);
+        xyz_fields(p, eol, fields);
+        if (fields.size() == 0) {
+            p = eol+1;
+            continue;
+        }
+        int n_atoms = -1;
+        if (fields.size() == 1) {
+            try {
+                n_atoms = boost::lexical_cast<int>(std::string(fields[0].first, fields[0].second));
+            }
+            catch (const boost::bad_lexical_cast &) {
+                n_atoms = -1;
+            }
+        }
+        if (n_atoms < 0) {
+            throw soap::base::IOError("XyzReader: expected atom count at offset "
+                + boost::lexical_cast<std::string>(p-_data) + " in " + _filename);
+        }
+        xyz_frame_t frame;
+        frame.n_atoms = n_atoms;
+        frame.offset_header = eol+1-_data;
+        p = eol+1;
+        for (int i = 0; i < n_atoms+1; ++i) {
+            if (p >= end) {
+                throw soap::base::IOError("XyzReader: truncated frame "
+                    + boost::lexical_cast<std::string>(_frames.size()) + " in " + _filename);
+            }
+            if (i == 1) frame.offset_atoms = p-_data;
+            p = this->lineEnd(p)+1;
+        }
+        if (n_atoms == 0) frame.offset_atoms = p-_data;
+        _frames.push_back(frame);
+    }
+}
+
+const xyz_frame_t &XyzReader::getFrame(int frame) {
+    if (frame < 0 || frame >= this->nFrames()) throw soap::base::OutOfRange("XyzReader: frame");
+    return _frames[frame];
+}
+
+void XyzReader::parseHeader(int frame, std::map<std::string, std::string> &info) {
+    // key=value, key="quoted value" or key (flag)
+    const char *p = _data + this->getFrame(frame).offset_header;
+    const char *end = this->lineEnd(p);
+    while (p < end) {
+        while (p < end && xyz_is_space(*p)) ++p;
+        if (p == end) break;
+        const char *k = p;
+        while (p < end && *p != '=' && !xyz_is_space(*p)) ++p;
+        std::string key(k, p);
+        if (p == end || *p != '=') {
+            info[key] = "T";
+            continue;
+        }
+        ++p;
+        const char *v = p;
+        if (p < end && (*p == '"' || *p == '\'')) {
+            char quote = *p;
+            v = ++p;
+            while (p < end && *p != quote) ++p;
+            info[key] = std::string(v, p);
+            if (p < end) ++p;
+        }
+        else {
+            while (p < end && !xyz_is_space(*p)) ++p;
+            info[key] = std::string(v, p);
+        }
+    }
+}
+
+std::map<std::string, std::string> XyzReader::getInfo(int frame) {
+    std::map<std::string, std::string> info;
+    this->parseHeader(frame, info);
+    return info;
+}
+
+Structure *XyzReader::read(int frame) {
+    const xyz_frame_t &fr = this->getFrame(frame);
+    std::map<std::string, std::string> info;
+    this->parseHeader(frame, info);
+    std::vector<xyz_field_t> fields;
+    // CELL
+    double box[9];
+    bool pbc[3] = { true, true, true };
+    bool has_box = (info.count("Lattice") > 0);
+    if (has_box) {
+        const std::string &lattice = info["Lattice"];
+        xyz_fields(lattice.data(), lattice.data()+lattice.size(), fields);
+        if (fields.size() != 9) throw soap::base::IOError("XyzReader: Lattice requires 9 components");
+        for (int i = 0; i < 9; ++i) box[i] = xyz_double(fields[i]);
+    }
+    if (info.count("pbc") > 0) {
+        const std::string &flags = info["pbc"];
+        xyz_fields(flags.data(), flags.data()+flags.size(), fields);
+        if (fields.size() != 3) throw soap::base::IOError("XyzReader: pbc requires 3 flags");
+        for (int i = 0; i < 3; ++i) pbc[i] = xyz_bool(std::string(fields[i].first, fields[i].second));
+    }
+    // COLUMNS
+    int col_species = 0;
+    int col_pos = 1;
+    if (info.count("Properties") > 0) {
+        std::vector<std::string> props;
+        const std::string &properties = info["Properties"];
+        size_t p0 = 0;
+        while (p0 <= properties.size()) {
+            size_t p1 = properties.find(':', p0);
+            if (p1 == std::string::npos) p1 = properties.size();
+            props.push_back(properties.substr(p0, p1-p0));
+            p0 = p1+1;
+        }
+        if (props.size() % 3 != 0) throw soap::base::IOError("XyzReader: invalid Properties");
+        col_species = col_pos = -1;
+        int col = 0;
+        for (int i = 0; i < props.size(); i += 3) {
+            if (props[i] == "species") col_species = col;
+            else if (props[i] == "pos") col_pos = col;
+            col += boost::lexical_cast<int>(props[i+2]);
+        }
+        if (col_species < 0 || col_pos < 0) {
+            throw soap::base::IOError("XyzReader: Properties require species and pos");
+        }
+    }
+    int n_cols = std::max(col_species+1, col_pos+3);
+    // ATOMS
+    std::vector<double> xyz(3*fr.n_atoms);
+    std::vector<std::string> types(fr.n_atoms);
+    const char *p = _data + fr.offset_atoms;
+    for (int i = 0; i < fr.n_atoms; ++i) {
+        const char *eol = this->lineEnd(p);
+        xyz_fields(p, eol, fields);
+        if (fields.size() < n_cols) {
+            throw soap::base::IOError("XyzReader: too few columns in frame "
+                + boost::lexical_cast<std::string>(frame) + ", atom " + boost::lexical_cast<std::string>(i));
+        }
+        types[i].assign(fields[col_species].first, fields[col_species].second);
+        for (int d = 0; d < 3; ++d) xyz[3*i+d] = xyz_double(fields[col_pos+d]);
+        p = eol+1;
+    }
+    std::string label = (info.count("label") > 0) ? info["label"] : "?";
+    Structure *structure = new Structure(label);
+    try {
+        structure->setBoundary((has_box) ? box : NULL, pbc);
+        structure->addParticles(fr.n_atoms, xyz.data(), types.data(), NULL, NULL, NULL);
+    }
+    catch (...) {
+        delete structure;
+        throw;
+    }
+    return structure;
+}
+
+void XyzReader::readChunk(int first, int n, int n_threads, std::vector<Structure*> &structures) {
+    if (first < 0 || n < 0 || first+n > this->nFrames()) throw soap::base::OutOfRange("XyzReader: frames");
+    if (n_threads < 1) n_threads = 1;
+    if (n_threads > n) n_threads = std::max(n, 1);
+    std::vector<Structure*> chunk(n, NULL);
+    std::vector<std::string> errors(n_threads);
+    // Contiguous ranges of frames per thread
+    auto parse = [&](int t) {
+        try {
+            for (int i = t*n/n_threads; i < (t+1)*n/n_threads; ++i) chunk[i] = this->read(first+i);
+        }
+        catch (const std::exception &e) {
+            errors[t] = e.what();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < n_threads; ++t) threads.push_back(std::thread(parse, t));
+    parse(0);
+    for (auto it = threads.begin(); it != threads.end(); ++it) it->join();
+    for (int t = 0; t < n_threads; ++t) {
+        if (errors[t] != "") {
+            for (auto it = chunk.begin(); it != chunk.end(); ++it) delete *it;
+            throw soap::base::IOError(errors[t]);
+        }
+    }
+    structures.insert(structures.end(), chunk.begin(), chunk.end());
+}
+
+boost::python::dict XyzReader::getInfoPython(int frame) {
+    // Values converted to int or float where possible
+    std::map<std::string, std::string> info = this->getInfo(frame);
+    boost::python::dict py_info;
+    for (auto it = info.begin(); it != info.end(); ++it) {
+        const std::string &value = it->second;
+        char *end = NULL;
+        long value_int = std::strtol(value.c_str(), &end, 10);
+        if (value.size() && end == value.c_str()+value.size()) {
+            py_info[it->first] = value_int;
+            continue;
+        }
+        double value_double = std::strtod(value.c_str(), &end);
+        if (value.size() && end == value.c_str()+value.size()) {
+            py_info[it->first] = value_double;
+            continue;
+        }
+        py_info[it->first] = value;
+    }
+    return py_info;
+}
+
+boost::python::list XyzReader::readChunkPython(int first, int n, int n_threads) {
+    std::vector<Structure*> structures;
+    this->readChunk(first, n, n_threads, structures);
+    boost::python::list py_structures;
+    boost::python::manage_new_object::apply<Structure*>::type convert;
+    for (int s = 0; s < structures.size(); ++s) {
+        py_structures.append(boost::python::object(boost::python::handle<>(convert(structures[s]))));
+    }
+    return py_structures;
+}
+
+void XyzReader::registerPython() {
+    using namespace boost::python;
+    class_<XyzReader, boost::noncopyable>("XyzReader", init<std::string>())
+        .add_property("n_frames", &XyzReader::nFrames)
+        .def("__len__", &XyzReader::nFrames)
+        .def("info", &XyzReader::getInfoPython)
+        .def("read", &XyzReader::read, return_value_policy<manage_new_object>())
+        .def("readChunk", &XyzReader::readChunkPython);
+}
+
+}